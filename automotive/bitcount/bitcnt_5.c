@@ -0,0 +1,259 @@
+/* +++Date last modified: 18-Oct-2026 */
+
+/*
+**  Bit counting over whole buffers (bit arrays, bitmap indexes)
+**
+**  bitcount_buffer() counts the one bits in n bytes at p, using the
+**  fastest kernel the CPU supports:
+**
+**    bitcount_buffer_c       64 bits at a time, SWAR ("Ratko's mystery
+**                            algorithm" widened to 64 bits)
+**    bitcount_buffer_popcnt  the POPCNT instruction, 64 bits at a time
+**    bitcount_buffer_avx2    Harley-Seal carry-save adders over 16 x 256
+**                            bits, PSHUFB nybble lookup for the counts
+**    bitcount_buffer_avx512  VPOPCNTQ on 512 bits at a time
+**
+**  The kernels are exported so they can be benchmarked against each
+**  other; bitcount_cpu() tells which of them the CPU can run.  Off
+**  x86-64 (or without GCC) all of them are bitcount_buffer_c().
+*/
+
+#include <string.h>
+#include "bitops.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+ #define HAVE_X86_KERNELS
+ #include <immintrin.h>
+#endif
+
+typedef unsigned long long u64;
+
+#define B2(n) n,     n + 1,     n + 1,     n + 2
+#define B4(n) B2(n), B2(n + 1), B2(n + 1), B2(n + 2)
+#define B6(n) B4(n), B4(n + 1), B4(n + 1), B4(n + 2)
+
+static const unsigned char bitcnt_tab[256] = {    /* bits in each byte   */
+      B6(0), B6(1), B6(1), B6(2)
+};
+
+static size_t tail_count(const unsigned char *p, size_t n)
+{
+      size_t cnt = 0;
+
+      while (n--)
+            cnt += bitcnt_tab[*p++];
+      return cnt;
+}
+
+size_t bitcount_buffer_c(const void *buf, size_t n)
+{
+      const unsigned char *p = (const unsigned char *)buf;
+      size_t cnt = 0;
+      u64 x;
+
+      for (; n >= 8; n -= 8, p += 8)
+      {
+            memcpy(&x, p, 8);
+            x = x - ((x >> 1) & 0x5555555555555555ULL);
+            x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+            x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+            cnt += (size_t)((x * 0x0101010101010101ULL) >> 56);
+      }
+      return cnt + tail_count(p, n);
+}
+
+#ifdef HAVE_X86_KERNELS
+
+__attribute__((target("popcnt")))
+size_t bitcount_buffer_popcnt(const void *buf, size_t n)
+{
+      const unsigned char *p = (const unsigned char *)buf;
+      u64 a, b, c, d;
+      size_t cnt = 0;
+
+      /* Four independent chains hide the instruction's latency */
+      for (; n >= 32; n -= 32, p += 32)
+      {
+            memcpy(&a, p, 8);
+            memcpy(&b, p + 8, 8);
+            memcpy(&c, p + 16, 8);
+            memcpy(&d, p + 24, 8);
+            cnt += _mm_popcnt_u64(a) + _mm_popcnt_u64(b) +
+                   _mm_popcnt_u64(c) + _mm_popcnt_u64(d);
+      }
+      for (; n >= 8; n -= 8, p += 8)
+      {
+            memcpy(&a, p, 8);
+            cnt += _mm_popcnt_u64(a);
+      }
+      return cnt + tail_count(p, n);
+}
+
+/*
+**  Per-byte bit counts of a 256 bit vector, summed into four 64 bit lanes
+*/
+
+__attribute__((target("avx2")))
+static __m256i popcount256(__m256i v)
+{
+      const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                              1, 2, 2, 3, 2, 3, 3, 4,
+                                              0, 1, 1, 2, 1, 2, 2, 3,
+                                              1, 2, 2, 3, 2, 3, 3, 4);
+      const __m256i low = _mm256_set1_epi8(0x0f);
+      __m256i lo = _mm256_and_si256(v, low);
+      __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+
+      return _mm256_sad_epu8(_mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                             _mm256_shuffle_epi8(lookup, hi)),
+                             _mm256_setzero_si256());
+}
+
+#define CSA(h, l, a, b, c)                                            \
+      do {                                                            \
+            __m256i u_ = _mm256_xor_si256(a, b);                      \
+            h = _mm256_or_si256(_mm256_and_si256(a, b),               \
+                                _mm256_and_si256(u_, c));             \
+            l = _mm256_xor_si256(u_, c);                              \
+      } while (0)
+
+#define LD(i) _mm256_loadu_si256((const __m256i *)p + (i))
+
+__attribute__((target("avx2,popcnt")))
+size_t bitcount_buffer_avx2(const void *buf, size_t n)
+{
+      const unsigned char *p = (const unsigned char *)buf;
+      __m256i total = _mm256_setzero_si256();
+      __m256i ones = _mm256_setzero_si256(), twos = _mm256_setzero_si256();
+      __m256i fours = _mm256_setzero_si256(), eights = _mm256_setzero_si256();
+      __m256i sixteens, twosA, twosB, foursA, foursB, eightsA, eightsB;
+      u64 lane[4];
+
+      /*
+      **  Harley-Seal: a tree of carry-save adders reduces 16 vectors to
+      **  one "sixteens" vector, so popcount256() runs once per 512 bytes.
+      */
+      for (; n >= 16 * 32; n -= 16 * 32, p += 16 * 32)
+      {
+            CSA(twosA, ones, ones, LD(0), LD(1));
+            CSA(twosB, ones, ones, LD(2), LD(3));
+            CSA(foursA, twos, twos, twosA, twosB);
+            CSA(twosA, ones, ones, LD(4), LD(5));
+            CSA(twosB, ones, ones, LD(6), LD(7));
+            CSA(foursB, twos, twos, twosA, twosB);
+            CSA(eightsA, fours, fours, foursA, foursB);
+            CSA(twosA, ones, ones, LD(8), LD(9));
+            CSA(twosB, ones, ones, LD(10), LD(11));
+            CSA(foursA, twos, twos, twosA, twosB);
+            CSA(twosA, ones, ones, LD(12), LD(13));
+            CSA(twosB, ones, ones, LD(14), LD(15));
+            CSA(foursB, twos, twos, twosA, twosB);
+            CSA(eightsB, fours, fours, foursA, foursB);
+            CSA(sixteens, eights, eights, eightsA, eightsB);
+            total = _mm256_add_epi64(total, popcount256(sixteens));
+      }
+
+      total = _mm256_slli_epi64(total, 4);
+      total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(eights), 3));
+      total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(fours), 2));
+      total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(twos), 1));
+      total = _mm256_add_epi64(total, popcount256(ones));
+      for (; n >= 32; n -= 32, p += 32)
+            total = _mm256_add_epi64(total, popcount256(LD(0)));
+
+      _mm256_storeu_si256((__m256i *)lane, total);
+      return (size_t)(lane[0] + lane[1] + lane[2] + lane[3]) +
+             bitcount_buffer_popcnt(p, n);
+}
+
+#undef LD
+#undef CSA
+
+__attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+size_t bitcount_buffer_avx512(const void *buf, size_t n)
+{
+      const unsigned char *p = (const unsigned char *)buf;
+      __m512i a = _mm512_setzero_si512(), b = _mm512_setzero_si512();
+
+      for (; n >= 128; n -= 128, p += 128)
+      {
+            a = _mm512_add_epi64(a, _mm512_popcnt_epi64(
+                                          _mm512_loadu_si512(p)));
+            b = _mm512_add_epi64(b, _mm512_popcnt_epi64(
+                                          _mm512_loadu_si512(p + 64)));
+      }
+      if (n >= 64)
+      {
+            a = _mm512_add_epi64(a, _mm512_popcnt_epi64(
+                                          _mm512_loadu_si512(p)));
+            n -= 64;
+            p += 64;
+      }
+      return (size_t)_mm512_reduce_add_epi64(_mm512_add_epi64(a, b)) +
+             bitcount_buffer_popcnt(p, n);
+}
+
+int bitcount_cpu(void)
+{
+      static int flags = -1;
+      int f = 0;
+
+      if (flags < 0)
+      {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("popcnt"))
+            {
+                  f |= BITCNT_POPCNT;
+                  if (__builtin_cpu_supports("avx2"))
+                        f |= BITCNT_AVX2;
+                  if (__builtin_cpu_supports("avx512f") &&
+                      __builtin_cpu_supports("avx512vpopcntdq"))
+                        f |= BITCNT_AVX512;
+            }
+            flags = f;
+      }
+      return flags;
+}
+
+#else /* !HAVE_X86_KERNELS */
+
+size_t bitcount_buffer_popcnt(const void *buf, size_t n)
+{
+      return bitcount_buffer_c(buf, n);
+}
+
+size_t bitcount_buffer_avx2(const void *buf, size_t n)
+{
+      return bitcount_buffer_c(buf, n);
+}
+
+size_t bitcount_buffer_avx512(const void *buf, size_t n)
+{
+      return bitcount_buffer_c(buf, n);
+}
+
+int bitcount_cpu(void)
+{
+      return 0;
+}
+
+#endif /* HAVE_X86_KERNELS */
+
+/*
+**  Short buffers don't amortize the vector setup; POPCNT wins there.
+*/
+
+#define BITCNT_SHORT 512
+
+size_t bitcount_buffer(const void *buf, size_t n)
+{
+      int cpu = bitcount_cpu();
+
+      if (n >= BITCNT_SHORT && (cpu & BITCNT_AVX512))
+            return bitcount_buffer_avx512(buf, n);
+      if (n >= BITCNT_SHORT && (cpu & BITCNT_AVX2))
+            return bitcount_buffer_avx2(buf, n);
+      if (cpu & BITCNT_POPCNT)
+            return bitcount_buffer_popcnt(buf, n);
+      return bitcount_buffer_c(buf, n);
+}
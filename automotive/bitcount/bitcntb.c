@@ -0,0 +1,106 @@
+/* +++Date last modified: 18-Oct-2026 */
+
+/*
+**  BITCNTB.C - Throughput benchmark for bulk bit counting
+**
+**  Counts the bits of a random bit array (a stand-in for a bitmap index)
+**  with every bitcount_buffer kernel the CPU supports and reports GB/s.
+**  All kernels must agree with the plain C one, on the whole array and
+**  on an odd-sized, misaligned slice of it.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <float.h>
+#include "bitops.h"
+
+#define KERNELS 5
+
+int main(int argc, char *argv[])
+{
+      clock_t start, stop;
+      double ct, cmin = DBL_MAX;
+      int i, r, runs, cminix = 0, cpu = bitcount_cpu();
+      size_t bytes, bits, n, ref = 0, refslice = 0;
+      unsigned long long x = 88172645463325252ULL;
+      char *set;
+      static size_t (*pBufCntFunc[KERNELS])(const void *, size_t) = {
+            bitcount_buffer_c,
+            bitcount_buffer_popcnt,
+            bitcount_buffer_avx2,
+            bitcount_buffer_avx512,
+            bitcount_buffer
+      };
+      static int needs[KERNELS] = {
+            0, BITCNT_POPCNT, BITCNT_AVX2, BITCNT_AVX512, 0
+      };
+      static char *text[KERNELS] = {
+            "64-bit SWAR",
+            "Hardware POPCNT",
+            "AVX2 Harley-Seal",
+            "AVX-512 VPOPCNTDQ",
+            "bitcount_buffer (dispatched)"
+      };
+
+      if (argc < 3)
+      {
+            fprintf(stderr, "Usage: bitcntb <megabytes> <runs>\n");
+            exit(-1);
+      }
+      bytes = (size_t)atol(argv[1]) << 20;
+      if ((runs = atoi(argv[2])) < 1)
+            runs = 1;
+      bits = bytes * CHAR_BIT;
+      if ((set = alloc_bit_array(bits)) == NULL)
+      {
+            fprintf(stderr, "Can't allocate %lu bits\n", (unsigned long)bits);
+            exit(-1);
+      }
+      for (n = 0; n < bytes; n++)                 /* xorshift64 fill     */
+      {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            set[n] = (char)(x >> 32);
+      }
+
+      puts("Bulk bit counter benchmark\n");
+
+      for (i = 0; i < KERNELS; i++)
+      {
+            if ((cpu & needs[i]) != needs[i])
+            {
+                  printf("%-38s> not supported by this CPU\n", text[i]);
+                  continue;
+            }
+            start = clock();
+            for (r = 0; r < runs; r++)
+                  n = pBufCntFunc[i](set, bytes);
+            stop = clock();
+            ct = (stop - start) / (double)CLOCKS_PER_SEC;
+            if (0 == i)
+            {
+                  ref = n;
+                  refslice = bytes > 2 ? bitcount_buffer_c(set + 1, bytes - 2)
+                                       : 0;
+            }
+            else if (n != ref || (bytes > 2 &&
+                     pBufCntFunc[i](set + 1, bytes - 2) != refslice))
+            {
+                  printf("%-38s> Wrong bit count\n", text[i]);
+                  return 1;
+            }
+            if (ct < cmin)
+            {
+                  cmin = ct;
+                  cminix = i;
+            }
+            printf("%-38s> Time: %7.3f sec.; %7.2f GB/s; Bits: %lu\n", text[i],
+                   ct, ct > 0 ? (double)bytes * runs / ct / 1e9 : 0.0,
+                   (unsigned long)n);
+      }
+      printf("\nBest  > %s\n", text[cminix]);
+      free(set);
+      return 0;
+}
@@ -109,4 +109,19 @@ int CDECL AR_btbl_bitcount(long int x);
 int CDECL ntbl_bitcnt(long x);
 int CDECL btbl_bitcnt(long x);
 
+/*
+**  BITCNT_5.C
+*/
+
+#define BITCNT_POPCNT 1                         /* bitcount_cpu() flags */
+#define BITCNT_AVX2   2
+#define BITCNT_AVX512 4
+
+size_t bitcount_buffer(const void *buf, size_t n);
+size_t bitcount_buffer_c(const void *buf, size_t n);
+size_t bitcount_buffer_popcnt(const void *buf, size_t n);
+size_t bitcount_buffer_avx2(const void *buf, size_t n);
+size_t bitcount_buffer_avx512(const void *buf, size_t n);
+int    bitcount_cpu(void);
+
 #endif /*  BITOPS__H */
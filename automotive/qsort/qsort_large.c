@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include "textload.h"
 
 
 struct my3DVertexStruct {
@@ -26,7 +27,8 @@ int
 main(int argc, char *argv[]) {
   struct my3DVertexStruct* array;
   int size;
-  FILE *fp;
+  int *v;
+  long n;
   int i,count=0;
   int x, y, z;
   
@@ -37,15 +39,22 @@ main(int argc, char *argv[]) {
   else {
     size = atoi(argv[1]);
     array = (struct my3DVertexStruct*) malloc(size*sizeof(struct my3DVertexStruct));
-    fp = fopen(argv[2],"r");
+    if ((n = tl_load_ints(argv[2], 3L*size, &v)) < 0) {
+      perror(argv[2]);
+      exit(-1);
+    }
     
-    while((fscanf(fp, "%d", &x) == 1) && (fscanf(fp, "%d", &y) == 1) && (fscanf(fp, "%d", &z) == 1) &&  (count < size)) {
+    while(3*count+2 < n) {
+	 x = v[3*count];
+	 y = v[3*count+1];
+	 z = v[3*count+2];
 	 array[count].x = x;
 	 array[count].y = y;
 	 array[count].z = z;
 	 array[count].distance = sqrt(pow(x, 2) + pow(y, 2) + pow(z, 2));
 	 count++;
     }
+    free(v);
   }
   printf("\nSorting %d vectors based on distance from the origin.\n\n",count);
   qsort(array,count,sizeof(struct my3DVertexStruct),compare);
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include "textload.h"
 
 
 struct myStringStruct {
@@ -20,7 +21,7 @@ int compare(const void *elem1, const void *elem2)
 int
 main(int argc, char *argv[]) {
   struct myStringStruct *array;
-  FILE *fp;
+  struct tl_words words;
   int i,count=0;
   int size;
   
@@ -31,13 +32,19 @@ main(int argc, char *argv[]) {
   else {
 
     size = atoi(argv[1]);
-    fp = fopen(argv[2],"r");
+    if (tl_load_words(argv[2], size, &words) < 0) {
+      perror(argv[2]);
+      exit(-1);
+    }
    
    array = (struct myStringStruct*) malloc(size*sizeof(struct myStringStruct));
 
-    while((fscanf(fp, "%s", &array[count].qstring) == 1) && (count < size)) {
+    while(count < words.count) {
+	 strncpy(array[count].qstring, words.word[count], sizeof(array[count].qstring) - 1);
+	 array[count].qstring[sizeof(array[count].qstring) - 1] = '\0';
 	 count++;
     }
+    tl_free_words(&words);
   }
   printf("\nSorting %d elements.\n\n",count);
   qsort(array,count,sizeof(struct myStringStruct),compare);
@@ -0,0 +1,3 @@
+#!/bin/bash
+./rawcaudio_${PLATFORM} -b 1017 -j $(nproc) < ../input_data/adpcm_input.pcm > adpcm_framed_output.adpcm
+./rawdaudio_${PLATFORM} -f -j $(nproc) < adpcm_framed_output.adpcm > adpcm_framed_output.pcm
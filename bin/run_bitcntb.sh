@@ -0,0 +1,2 @@
+#!/bin/bash
+./bitcntb_${PLATFORM} ${BITCOUNT_BUFFER_INPUT} 20 > bitcntb_output.txt
@@ -0,0 +1,2 @@
+#!/bin/bash
+./gsmbench_${PLATFORM} -c 256 -j $(nproc) -s 10 ../input_data/gsm_input.au > gsmbench_output.txt
@@ -0,0 +1,3 @@
+#!/bin/bash
+./cjpeg_${PLATFORM} -dct int -restart 1 -threads $(nproc) -outfile jpeg_restart_output.jpeg ../input_data/jpeg_input.ppm
+./djpeg_${PLATFORM} -dct int -ppm -threads $(nproc) -outfile jpeg_restart_output.ppm jpeg_restart_output.jpeg
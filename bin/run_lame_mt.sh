@@ -0,0 +1,2 @@
+#!/bin/bash
+./lame_${PLATFORM} --segments $(nproc) --threads 2 ../input_data/lame_input.wav lame_mt_output.mp3
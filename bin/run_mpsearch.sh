@@ -0,0 +1,2 @@
+#!/bin/bash
+./mpsearch_${PLATFORM} ../office/stringsearch/patterns_large.txt ../input_data/sha_input.asc > mpsearch_output.txt
@@ -0,0 +1,2 @@
+#!/bin/bash
+./search_mt_${PLATFORM} ../input_data/sha_input.asc porttitor $(nproc) > search_mt_output.txt
@@ -0,0 +1,503 @@
+/*
+ * textload.c
+ *
+ * Bulk loader for whitespace separated text inputs.  See textload.h.
+ *
+ * The file is mapped read-only and split into up to MIBENCH_THREADS
+ * chunks.  Chunk boundaries are moved to the next white space (or the
+ * next newline for line records) so that no token is ever split.
+ * Every chunk is parsed into its own growable byte buffer, and the
+ * buffers are concatenated in file order afterwards.  The concatenated
+ * buffer is exactly what gets stored in the binary sidecar:
+ *
+ *   TL_INTS   an array of int
+ *   TL_WORDS  the words, each followed by a NUL byte
+ *   TL_RECS   an array of struct tl_rec
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "textload.h"
+
+#define TL_INTS		1
+#define TL_WORDS	2
+#define TL_RECS		3
+
+#define TL_MAXTHREADS	64
+#define TL_MINCHUNK	(1 << 20)	/* don't bother threading below this */
+
+static const char tl_magic[4] = { 'T', 'L', 'C', '1' };
+
+/*
+ * Sidecar header, followed by len bytes of parsed data.
+ */
+struct tl_hdr {
+	char magic[4];
+	int kind;
+	long long size;		/* size of the text file	*/
+	long long mtime;	/* mtime of the text file	*/
+	long long count;	/* number of items		*/
+	long long len;		/* bytes of data		*/
+};
+
+struct tl_buf {
+	char *data;
+	size_t len;
+	size_t cap;
+	long count;
+	int stopped;		/* hit a token that did not parse */
+	int nomem;
+};
+
+struct tl_job {
+	int kind;
+	const unsigned char *p;
+	const unsigned char *end;
+	struct tl_buf out;
+};
+
+/* Same set as isspace() in the C locale, which is what fscanf() skips. */
+static const unsigned char tl_space[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1
+};
+
+static int
+tl_reserve(struct tl_buf *b, size_t n)
+{
+	size_t cap;
+	char *data;
+
+	if (b->len + n <= b->cap)
+		return 1;
+	cap = b->cap ? b->cap : 4096;
+	while (cap < b->len + n)
+		cap *= 2;
+	if ((data = (char *)realloc(b->data, cap)) == NULL) {
+		b->nomem = 1;
+		return 0;
+	}
+	b->data = data;
+	b->cap = cap;
+	return 1;
+}
+
+/*
+ * Return the first white space character at or after p.
+ * With SSE2, sixteen bytes are tested at a time for anything <= ' ';
+ * only those candidates are looked up in tl_space[].
+ */
+static const unsigned char *
+tl_token_end(const unsigned char *p, const unsigned char *end)
+{
+#ifdef __SSE2__
+	const __m128i lim = _mm_set1_epi8(' ' + 1);
+	__m128i x;
+	int m;
+
+	while (end - p >= 16) {
+		x = _mm_loadu_si128((const __m128i *)p);
+		m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, lim), x));
+		m &= 0xffff;
+		while (m) {
+			if (tl_space[p[__builtin_ctz(m)]])
+				return p + __builtin_ctz(m);
+			m &= m - 1;
+		}
+		p += 16;
+	}
+#endif
+	while (p < end && !tl_space[*p])
+		p++;
+	return p;
+}
+
+/*
+ * Parse one "%d" at p.  Returns the end of the number, or NULL if p
+ * does not start with an integer.
+ */
+static const unsigned char *
+tl_int(const unsigned char *p, const unsigned char *end, int *v)
+{
+	unsigned long n = 0;
+	int neg = 0;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		neg = *p++ == '-';
+	if (p == end || (unsigned)(*p - '0') > 9)
+		return NULL;
+	while (p < end && (unsigned)(*p - '0') <= 9)
+		n = n * 10 + (*p++ - '0');
+	*v = (int)(neg ? -n : n);
+	return p;
+}
+
+static void
+tl_parse_ints(struct tl_job *j)
+{
+	const unsigned char *p = j->p, *end = j->end, *q;
+	int v;
+
+	for (;;) {
+		while (p < end && tl_space[*p])
+			p++;
+		if (p == end)
+			break;
+		if ((q = tl_int(p, end, &v)) == NULL) {
+			j->out.stopped = 1;
+			break;
+		}
+		if (!tl_reserve(&j->out, sizeof(int)))
+			break;
+		memcpy(j->out.data + j->out.len, &v, sizeof(int));
+		j->out.len += sizeof(int);
+		j->out.count++;
+		p = q;
+	}
+}
+
+static void
+tl_parse_words(struct tl_job *j)
+{
+	const unsigned char *p = j->p, *end = j->end, *q;
+
+	for (;;) {
+		while (p < end && tl_space[*p])
+			p++;
+		if (p == end)
+			break;
+		q = tl_token_end(p, end);
+		if (!tl_reserve(&j->out, (q - p) + 1))
+			break;
+		memcpy(j->out.data + j->out.len, p, q - p);
+		j->out.len += q - p;
+		j->out.data[j->out.len++] = '\0';
+		j->out.count++;
+		p = q;
+	}
+}
+
+/*
+ * "<float> <int>" per line.  The float goes through strtof() so that
+ * it rounds exactly like sscanf("%f"); lines that do not hold both
+ * fields are skipped.
+ */
+static void
+tl_parse_recs(struct tl_job *j)
+{
+	const unsigned char *p = j->p, *end = j->end, *eol, *q;
+	char tmp[64], *e;
+	struct tl_rec r;
+	size_t n;
+
+	for (; p < end; p = eol + 1) {
+		if ((eol = memchr(p, '\n', end - p)) == NULL)
+			eol = end;
+		while (p < eol && tl_space[*p])
+			p++;
+		q = tl_token_end(p, eol);
+		if ((n = q - p) == 0)
+			continue;
+		if (n >= sizeof(tmp))
+			n = sizeof(tmp) - 1;
+		memcpy(tmp, p, n);
+		tmp[n] = '\0';
+		r.f = strtof(tmp, &e);
+		if (e == tmp)
+			continue;
+		p += e - tmp;
+		while (p < eol && tl_space[*p])
+			p++;
+		if (tl_int(p, eol, &r.i) == NULL)
+			continue;
+		if (!tl_reserve(&j->out, sizeof(r)))
+			break;
+		memcpy(j->out.data + j->out.len, &r, sizeof(r));
+		j->out.len += sizeof(r);
+		j->out.count++;
+		if (eol == end)
+			break;
+	}
+}
+
+static void *
+tl_run(void *arg)
+{
+	struct tl_job *j = (struct tl_job *)arg;
+
+	switch (j->kind) {
+	case TL_INTS:	tl_parse_ints(j);	break;
+	case TL_WORDS:	tl_parse_words(j);	break;
+	case TL_RECS:	tl_parse_recs(j);	break;
+	}
+	return NULL;
+}
+
+static int
+tl_nthreads(size_t size)
+{
+	char *s = getenv("MIBENCH_THREADS");
+	int n = s ? atoi(s) : 1;
+
+	if (n > TL_MAXTHREADS)
+		n = TL_MAXTHREADS;
+	if ((size_t)n > size / TL_MINCHUNK)
+		n = (int)(size / TL_MINCHUNK);
+	return n < 1 ? 1 : n;
+}
+
+/*
+ * Parse buf[0..size) into out, on several threads if asked to.
+ */
+static int
+tl_parse(int kind, const unsigned char *buf, size_t size, struct tl_buf *out)
+{
+	struct tl_job job[TL_MAXTHREADS];
+	pthread_t tid[TL_MAXTHREADS];
+	int started[TL_MAXTHREADS];
+	int i, n = tl_nthreads(size);
+	size_t b, len;
+
+	memset(job, 0, sizeof(job[0]) * n);
+	for (i = 0; i < n; i++) {
+		job[i].kind = kind;
+		job[i].p = i ? job[i - 1].end : buf;
+		b = i == n - 1 ? size : (size / n) * (i + 1);
+		if (b < (size_t)(job[i].p - buf))
+			b = job[i].p - buf;
+		if (kind == TL_RECS) {
+			while (b > 0 && b < size && buf[b - 1] != '\n')
+				b++;
+		} else {
+			while (b < size && !tl_space[buf[b]])
+				b++;
+		}
+		job[i].end = buf + b;
+	}
+
+	for (i = 1; i < n; i++)
+		started[i] = pthread_create(&tid[i], NULL, tl_run, &job[i]) == 0;
+	tl_run(&job[0]);
+	for (i = 1; i < n; i++) {
+		if (started[i])
+			pthread_join(tid[i], NULL);
+		else
+			tl_run(&job[i]);
+	}
+
+	/* Concatenate in file order, up to the first chunk that stopped. */
+	*out = job[0].out;
+	for (i = 1; i < n && !out->stopped && !out->nomem; i++) {
+		len = job[i].out.len;
+		if (!tl_reserve(out, len))
+			break;
+		memcpy(out->data + out->len, job[i].out.data, len);
+		out->len += len;
+		out->count += job[i].out.count;
+		out->stopped = job[i].out.stopped;
+		out->nomem = job[i].out.nomem;
+	}
+	for (i = 1; i < n; i++)
+		free(job[i].out.data);
+	if (out->nomem) {
+		free(out->data);
+		errno = ENOMEM;
+		return -1;
+	}
+	return 0;
+}
+
+static char *
+tl_sidecar_name(const char *path)
+{
+	char *name = (char *)malloc(strlen(path) + 5);
+
+	if (name != NULL)
+		sprintf(name, "%s.tlc", path);
+	return name;
+}
+
+static int
+tl_caching(void)
+{
+	char *s = getenv("MIBENCH_CACHE");
+
+	return s != NULL && *s != '\0' && strcmp(s, "0") != 0;
+}
+
+/*
+ * Load a sidecar that matches st.  Returns 0 on success.
+ */
+static int
+tl_read_sidecar(const char *path, int kind, const struct stat *st,
+		struct tl_buf *out)
+{
+	struct tl_hdr h;
+	char *name;
+	FILE *fp;
+	int ok = 0;
+
+	if ((name = tl_sidecar_name(path)) == NULL)
+		return -1;
+	fp = fopen(name, "rb");
+	free(name);
+	if (fp == NULL)
+		return -1;
+	if (fread(&h, sizeof(h), 1, fp) == 1 &&
+	    memcmp(h.magic, tl_magic, sizeof(tl_magic)) == 0 &&
+	    h.kind == kind && h.size == (long long)st->st_size &&
+	    h.mtime == (long long)st->st_mtime && h.len >= 0) {
+		memset(out, 0, sizeof(*out));
+		out->data = (char *)malloc(h.len ? (size_t)h.len : 1);
+		if (out->data != NULL &&
+		    fread(out->data, 1, (size_t)h.len, fp) == (size_t)h.len) {
+			out->len = out->cap = (size_t)h.len;
+			out->count = (long)h.count;
+			ok = 1;
+		} else {
+			free(out->data);
+		}
+	}
+	fclose(fp);
+	return ok ? 0 : -1;
+}
+
+/*
+ * Best effort: a sidecar that can't be written is simply not there
+ * next time.
+ */
+static void
+tl_write_sidecar(const char *path, int kind, const struct stat *st,
+		 const struct tl_buf *b)
+{
+	struct tl_hdr h;
+	char *name;
+	FILE *fp;
+
+	if ((name = tl_sidecar_name(path)) == NULL)
+		return;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, tl_magic, sizeof(tl_magic));
+	h.kind = kind;
+	h.size = st->st_size;
+	h.mtime = st->st_mtime;
+	h.count = b->count;
+	h.len = b->len;
+	if ((fp = fopen(name, "wb")) != NULL) {
+		if (fwrite(&h, sizeof(h), 1, fp) != 1 ||
+		    fwrite(b->data, 1, b->len, fp) != b->len) {
+			fclose(fp);
+			unlink(name);
+		} else if (fclose(fp) != 0) {
+			unlink(name);
+		}
+	}
+	free(name);
+}
+
+static int
+tl_load(const char *path, int kind, struct tl_buf *out)
+{
+	struct stat st;
+	void *map;
+	int fd, cache = tl_caching(), r;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return -1;
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return -1;
+	}
+	if (cache && tl_read_sidecar(path, kind, &st, out) == 0) {
+		close(fd);
+		return 0;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		memset(out, 0, sizeof(*out));
+		return 0;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -1;
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+	r = tl_parse(kind, (const unsigned char *)map, st.st_size, out);
+	munmap(map, st.st_size);
+	if (r == 0 && cache)
+		tl_write_sidecar(path, kind, &st, out);
+	return r;
+}
+
+long
+tl_load_ints(const char *path, long max, int **out)
+{
+	struct tl_buf b;
+
+	if (tl_load(path, TL_INTS, &b) < 0)
+		return -1;
+	*out = (int *)b.data;
+	return max >= 0 && b.count > max ? max : b.count;
+}
+
+long
+tl_load_recs(const char *path, long max, struct tl_rec **out)
+{
+	struct tl_buf b;
+
+	if (tl_load(path, TL_RECS, &b) < 0)
+		return -1;
+	*out = (struct tl_rec *)b.data;
+	return max >= 0 && b.count > max ? max : b.count;
+}
+
+long
+tl_load_words(const char *path, long max, struct tl_words *w)
+{
+	struct tl_buf b;
+	char *p;
+	long i;
+
+	memset(w, 0, sizeof(*w));
+	if (tl_load(path, TL_WORDS, &b) < 0)
+		return -1;
+	if (max >= 0 && b.count > max)
+		b.count = max;
+	w->word = (char **)malloc((b.count ? b.count : 1) * sizeof(char *));
+	if (w->word == NULL) {
+		free(b.data);
+		errno = ENOMEM;
+		return -1;
+	}
+	for (i = 0, p = b.data; i < b.count; i++) {
+		w->word[i] = p;
+		p += strlen(p) + 1;
+	}
+	w->store = b.data;
+	w->count = b.count;
+	return w->count;
+}
+
+void
+tl_free_words(struct tl_words *w)
+{
+	free(w->word);
+	free(w->store);
+	w->word = NULL;
+	w->store = NULL;
+	w->count = 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * textload.h
+ *
+ * Bulk loader for the whitespace separated text inputs used by
+ * qsort_small, qsort_large, dijkstra and patricia.
+ *
+ * The input file is mapped with mmap() and scanned by a hand-rolled
+ * tokenizer instead of one fscanf() call per token.  Large files can
+ * be split into chunks that are parsed on several threads, and the
+ * parsed result can be kept in a binary sidecar (<file>.tlc) so that
+ * repeated runs on the same input skip parsing altogether.
+ *
+ * Both extras are controlled through the environment so that the
+ * benchmark command lines stay unchanged:
+ *
+ *   MIBENCH_THREADS=<n>   parse with <n> threads (default 1)
+ *   MIBENCH_CACHE=1       read/write the binary sidecar
+ *
+ * The sidecar records the size and modification time of the text file
+ * it was made from and is ignored once the text file changes.
+ */
+
+#ifndef _TEXTLOAD_H_
+#define _TEXTLOAD_H_
+
+/*
+ * Words as returned by tl_load_words().  word[i] points into store
+ * and is NUL terminated.
+ */
+struct tl_words {
+	char **word;
+	long count;
+	char *store;
+};
+
+/*
+ * One "<float> <int>" line as read by sscanf(line, "%f %d", ...).
+ */
+struct tl_rec {
+	float f;
+	int i;
+};
+
+/*
+ * Each loader reads at most max items (all of them if max < 0) and
+ * stops at the first token that does not parse, like a fscanf() loop.
+ * They return the number of items read, or -1 if the file could not
+ * be read (errno is set).
+ */
+extern long tl_load_ints(const char *path, long max, int **out);
+extern long tl_load_words(const char *path, long max, struct tl_words *w);
+extern long tl_load_recs(const char *path, long max, struct tl_rec **out);
+
+extern void tl_free_words(struct tl_words *w);
+
+#endif /* _TEXTLOAD_H_ */
@@ -14,6 +14,11 @@
 #ifdef NEED_SIGNAL_CATCHER
 #include <signal.h>		/* to declare signal() */
 #endif
+#ifndef NO_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>		/* to declare fstat() */
+#include <sys/mman.h>		/* to declare mmap() */
+#endif
 #ifdef USE_SETMODE
 #include <fcntl.h>		/* to declare setmode()'s parameter macros */
 /* If you have setmode() but not <io.h>, just delete this line: */
@@ -177,3 +182,50 @@ write_stdout (void)
 #endif
   return output_file;
 }
+
+
+/*
+ * Map an input file into memory, so that it can be read in place instead of
+ * being copied through stdio buffers.  Returns the start of the whole file,
+ * with the file's size and the stream's current position in *size and
+ * *offset, or NULL if the file can't be mapped (pipes and terminals, files
+ * with no data left at the current position, or NO_MMAP defined for
+ * systems without mmap()).  The stream itself is not disturbed.
+ */
+
+GLOBAL(JOCTET *)
+map_input_file (FILE * file, size_t * offset, size_t * size)
+{
+#ifndef NO_MMAP
+  struct stat st;
+  long pos;
+  void * map;
+
+  if (fstat(fileno(file), &st) != 0 || ! S_ISREG(st.st_mode) ||
+      (off_t) (size_t) st.st_size != st.st_size)
+    return NULL;
+  if ((pos = ftell(file)) < 0 || (off_t) pos >= st.st_size)
+    return NULL;
+  map = mmap((void *) NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+	     fileno(file), (off_t) 0);
+  if (map == MAP_FAILED)
+    return NULL;
+#ifdef MADV_SEQUENTIAL
+  (void) madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+#endif
+  *offset = (size_t) pos;
+  *size = (size_t) st.st_size;
+  return (JOCTET *) map;
+#else
+  return NULL;
+#endif
+}
+
+
+GLOBAL(void)
+unmap_input_file (JOCTET * map, size_t size)
+{
+#ifndef NO_MMAP
+  (void) munmap((void *) map, size);
+#endif
+}
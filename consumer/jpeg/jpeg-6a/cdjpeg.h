@@ -107,11 +107,17 @@ typedef struct cdjpeg_progress_mgr * cd_progress_ptr;
 #define set_quant_slots		SetQSlots
 #define set_sample_factors	SetSFacts
 #define read_color_map		RdCMap
+#define can_compress_parallel	CanCmpPar
+#define compress_image_parallel	CmpImgPar
+#define read_file_buffer	RdFileBuf
+#define read_image_parallel	RdImgPar
 #define enable_signal_catcher	EnSigCatcher
 #define start_progress_monitor	StProgMon
 #define end_progress_monitor	EnProgMon
 #define read_stdin		RdStdin
 #define write_stdout		WrStdout
+#define map_input_file		MapInFile
+#define unmap_input_file	UnmapInFile
 #endif /* NEED_SHORT_EXTERNAL_NAMES */
 
 /* Module selection routines for I/O modules. */
@@ -140,6 +146,21 @@ EXTERN(boolean) set_sample_factors JPP((j_compress_ptr cinfo, char *arg));
 
 EXTERN(void) read_color_map JPP((j_decompress_ptr cinfo, FILE * infile));
 
+/* cjpeg -threads support routines (in cjpar.c) */
+
+EXTERN(boolean) can_compress_parallel JPP((j_compress_ptr cinfo));
+EXTERN(boolean) compress_image_parallel JPP((j_compress_ptr cinfo,
+					     cjpeg_source_ptr sinfo,
+					     FILE * outfile, int nthreads));
+
+/* djpeg -threads support routines (in djpar.c) */
+
+EXTERN(JOCTET *) read_file_buffer JPP((FILE * infile, size_t * size));
+EXTERN(boolean) read_image_parallel JPP((j_decompress_ptr cinfo,
+					 djpeg_dest_ptr dest,
+					 const JOCTET * data, size_t size,
+					 int nthreads));
+
 /* common support routines (in cdjpeg.c) */
 
 EXTERN(void) enable_signal_catcher JPP((j_common_ptr cinfo));
@@ -149,6 +170,9 @@ EXTERN(void) end_progress_monitor JPP((j_common_ptr cinfo));
 EXTERN(boolean) keymatch JPP((char * arg, const char * keyword, int minchars));
 EXTERN(FILE *) read_stdin JPP((void));
 EXTERN(FILE *) write_stdout JPP((void));
+EXTERN(JOCTET *) map_input_file JPP((FILE * file, size_t * offset,
+				     size_t * size));
+EXTERN(void) unmap_input_file JPP((JOCTET * map, size_t size));
 
 /* miscellaneous useful macros */
 
@@ -0,0 +1,425 @@
+/*
+ * cjpar.c
+ *
+ * This file is part of the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains routines for cjpeg's -threads switch: compressing
+ * an image in horizontal bands on several threads.
+ *
+ * With a restart interval of a whole number of MCU rows, the entropy
+ * coder starts afresh (DC predictions reset, bit buffer flushed) at
+ * every band boundary that falls on a restart marker, and without input
+ * smoothing no stage looks across MCU rows.  So a band of restart
+ * intervals can be color converted, downsampled, transformed, quantized
+ * and Huffman coded by a compression object of its own, and the
+ * compressed bands can be spliced together: the header of the first
+ * band (with the full image height), the entropy coded segments of all
+ * bands with their RSTn markers renumbered, and an EOI.  The result is
+ * the same file the serial compressor writes with the same parameters.
+ *
+ * The main thread reads the input rows and writes the spliced bands in
+ * order; at most two bands per thread are in memory at any time.
+ * Progressive, multi-scan and optimized-Huffman files, and input
+ * smoothing, are left to the serial compressor.
+ */
+
+#include "cdjpeg.h"		/* Common decls for cjpeg/djpeg applications */
+#include <pthread.h>
+
+#define MAX_THREADS	64
+#define BANDS_PER_THREAD	4	/* bands to split the image into */
+#define BANDS_IN_FLIGHT	2	/* bands per thread read but not written */
+
+#define M_SOF0	0xC0
+#define M_RST0	0xD0
+#define M_EOI	0xD9
+#define M_SOS	0xDA
+
+
+/*
+ * State shared by the band compressors.
+ */
+
+typedef struct {
+  int first, last;		/* restart intervals in this band */
+  JDIMENSION top, height;	/* image rows */
+  JSAMPARRAY rows;		/* input rows, while being compressed */
+  JOCTET * data;		/* compressed band, once done */
+  size_t header_end;		/* end of its SOS segment */
+  size_t data_end;		/* start of its EOI */
+  long num_warnings;		/* from its compression object */
+  boolean done;
+} cband_info;
+
+typedef struct {
+  j_compress_ptr cinfo;		/* the application's (serial) object */
+  JDIMENSION row_bytes;
+  int nintervals;
+
+  cband_info * bands;
+  int nbands, nready, next_band;
+  pthread_mutex_t lock;
+  pthread_cond_t band_ready, band_done;
+} cpar_state;
+
+
+/*
+ * Give a band compressor the application's compression parameters.
+ */
+
+LOCAL(void)
+copy_parameters (j_compress_ptr dst, j_compress_ptr src)
+{
+  int i;
+
+  jpeg_set_colorspace(dst, src->jpeg_color_space);
+  dst->data_precision = src->data_precision;
+  for (i = 0; i < src->num_components; i++) {
+    dst->comp_info[i].component_id = src->comp_info[i].component_id;
+    dst->comp_info[i].h_samp_factor = src->comp_info[i].h_samp_factor;
+    dst->comp_info[i].v_samp_factor = src->comp_info[i].v_samp_factor;
+    dst->comp_info[i].quant_tbl_no = src->comp_info[i].quant_tbl_no;
+    dst->comp_info[i].dc_tbl_no = src->comp_info[i].dc_tbl_no;
+    dst->comp_info[i].ac_tbl_no = src->comp_info[i].ac_tbl_no;
+  }
+  for (i = 0; i < NUM_QUANT_TBLS; i++) {
+    if (src->quant_tbl_ptrs[i] == NULL)
+      dst->quant_tbl_ptrs[i] = NULL;
+    else {
+      if (dst->quant_tbl_ptrs[i] == NULL)
+	dst->quant_tbl_ptrs[i] = jpeg_alloc_quant_table((j_common_ptr) dst);
+      MEMCOPY(dst->quant_tbl_ptrs[i]->quantval, src->quant_tbl_ptrs[i]->quantval,
+	      SIZEOF(dst->quant_tbl_ptrs[i]->quantval));
+    }
+  }
+  for (i = 0; i < NUM_HUFF_TBLS; i++) {
+    if (src->dc_huff_tbl_ptrs[i] == NULL)
+      dst->dc_huff_tbl_ptrs[i] = NULL;
+    else {
+      if (dst->dc_huff_tbl_ptrs[i] == NULL)
+	dst->dc_huff_tbl_ptrs[i] = jpeg_alloc_huff_table((j_common_ptr) dst);
+      MEMCOPY(dst->dc_huff_tbl_ptrs[i], src->dc_huff_tbl_ptrs[i],
+	      SIZEOF(JHUFF_TBL));
+    }
+    if (src->ac_huff_tbl_ptrs[i] == NULL)
+      dst->ac_huff_tbl_ptrs[i] = NULL;
+    else {
+      if (dst->ac_huff_tbl_ptrs[i] == NULL)
+	dst->ac_huff_tbl_ptrs[i] = jpeg_alloc_huff_table((j_common_ptr) dst);
+      MEMCOPY(dst->ac_huff_tbl_ptrs[i], src->ac_huff_tbl_ptrs[i],
+	      SIZEOF(JHUFF_TBL));
+    }
+  }
+  dst->dct_method = src->dct_method;
+  dst->restart_interval = src->restart_interval;
+  dst->restart_in_rows = src->restart_in_rows;
+  dst->write_JFIF_header = src->write_JFIF_header;
+  dst->density_unit = src->density_unit;
+  dst->X_density = src->X_density;
+  dst->Y_density = src->Y_density;
+  dst->write_Adobe_marker = src->write_Adobe_marker;
+  dst->mem->max_memory_to_use = src->mem->max_memory_to_use;
+}
+
+
+/*
+ * Compress band b into memory, then locate its entropy coded data and
+ * renumber its RSTn markers to their place in the whole image.
+ * cinfo is the worker's own compression object, reused from band to band
+ * so that the memory manager recycles the previous band's pools.
+ */
+
+LOCAL(void)
+compress_band (cpar_state * ps, cband_info * band, j_compress_ptr cinfo)
+{
+  j_compress_ptr app = ps->cinfo;
+  unsigned char * outbuffer = NULL;
+  unsigned long outsize = 0;
+  JDIMENSION n;
+  JOCTET * d;
+  size_t pos, len;
+  int m, k;
+
+  cinfo->err->num_warnings = 0;
+  jpeg_mem_dest(cinfo, &outbuffer, &outsize); /* collect the band here */
+
+  cinfo->image_width = app->image_width;
+  cinfo->image_height = band->height;
+  cinfo->input_components = app->input_components;
+  cinfo->in_color_space = app->in_color_space;
+  cinfo->input_gamma = app->input_gamma;
+  jpeg_set_defaults(cinfo);
+  copy_parameters(cinfo, app);
+
+  jpeg_start_compress(cinfo, TRUE);
+  while (cinfo->next_scanline < cinfo->image_height) {
+    n = jpeg_write_scanlines(cinfo, band->rows + cinfo->next_scanline,
+			     cinfo->image_height - cinfo->next_scanline);
+    if (n == 0)
+      break;
+  }
+  jpeg_finish_compress(cinfo);
+  band->num_warnings = cinfo->err->num_warnings;
+  free(band->rows[0]);
+  free(band->rows);
+  band->rows = NULL;
+
+  /* Walk the header up to the end of the SOS segment */
+  d = (JOCTET *) outbuffer;
+  for (pos = 2; ; pos += 2 + len) {
+    m = d[pos+1];
+    len = ((size_t) d[pos+2] << 8) + d[pos+3];
+    if ((m == M_SOF0 || m == M_SOF0 + 1) && band->first == 0) {
+      d[pos+5] = (JOCTET) (app->image_height >> 8); /* the full height */
+      d[pos+6] = (JOCTET) (app->image_height & 0xFF);
+    }
+    if (m == M_SOS)
+      break;
+  }
+  band->header_end = pos + 2 + len;
+  band->data_end = (size_t) outsize - 2;	/* the EOI */
+
+  /* The band's k'th marker follows the image's (first + k)'th interval */
+  k = band->first;
+  for (pos = band->header_end; pos + 1 < band->data_end; pos++) {
+    if (d[pos] != 0xFF)
+      continue;
+    if (d[pos+1] >= M_RST0 && d[pos+1] <= M_RST0 + 7)
+      d[pos+1] = (JOCTET) (M_RST0 + (k++ & 7));
+    pos++;			/* skip the stuffed zero or marker code */
+  }
+  band->data = d;
+}
+
+
+METHODDEF(void *)
+cband_worker (void * arg)
+{
+  cpar_state * ps = (cpar_state *) arg;
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  int b;
+
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  for (;;) {
+    pthread_mutex_lock(&ps->lock);
+    while (ps->next_band >= ps->nready && ps->next_band < ps->nbands)
+      pthread_cond_wait(&ps->band_ready, &ps->lock);
+    b = ps->next_band++;
+    pthread_mutex_unlock(&ps->lock);
+    if (b >= ps->nbands)
+      break;
+    compress_band(ps, &ps->bands[b], &cinfo);
+    pthread_mutex_lock(&ps->lock);
+    ps->bands[b].done = TRUE;
+    pthread_cond_broadcast(&ps->band_done);
+    pthread_mutex_unlock(&ps->lock);
+  }
+  jpeg_destroy_compress(&cinfo);
+  return NULL;
+}
+
+
+/*
+ * Read the input rows of a band.  Input modules may deliver several
+ * rows per call, so rows left over from the previous band are kept in
+ * the source buffer.
+ */
+
+LOCAL(void)
+read_band (cpar_state * ps, cjpeg_source_ptr sinfo, cband_info * band,
+	   JDIMENSION * pending, JDIMENSION * avail)
+{
+  JDIMENSION r;
+
+  band->rows = (JSAMPARRAY) malloc(band->height * SIZEOF(JSAMPROW));
+  if (band->rows == NULL ||
+      (band->rows[0] = (JSAMPROW) malloc((size_t) band->height *
+					 ps->row_bytes)) == NULL)
+    ERREXIT1(ps->cinfo, JERR_OUT_OF_MEMORY, 11);
+  for (r = 0; r < band->height; r++) {
+    if (r > 0)
+      band->rows[r] = band->rows[r-1] + ps->row_bytes;
+    if (*pending == *avail) {
+      *avail = (*sinfo->get_pixel_rows) (ps->cinfo, sinfo);
+      *pending = 0;
+    }
+    MEMCOPY(band->rows[r], sinfo->buffer[(*pending)++], ps->row_bytes);
+  }
+}
+
+
+LOCAL(void)
+write_band (cpar_state * ps, cband_info * band, FILE * outfile)
+{
+  JOCTET marker[2];
+
+  if (band->first == 0)
+    JFWRITE(outfile, band->data, band->header_end);
+  else {
+    marker[0] = 0xFF;		/* end of the previous band's last interval */
+    marker[1] = (JOCTET) (M_RST0 + ((band->first - 1) & 7));
+    JFWRITE(outfile, marker, 2);
+  }
+  JFWRITE(outfile, band->data + band->header_end,
+	  band->data_end - band->header_end);
+  ps->cinfo->err->num_warnings += band->num_warnings;
+  free(band->data);
+}
+
+
+/*
+ * Tell whether the compression parameters allow the image to be compressed
+ * in bands, given a restart interval of whole MCU rows.
+ */
+
+GLOBAL(boolean)
+can_compress_parallel (j_compress_ptr cinfo)
+{
+  return (cinfo->scan_info == NULL && ! cinfo->arith_code &&
+	  ! cinfo->optimize_coding && ! cinfo->raw_data_in &&
+	  cinfo->smoothing_factor == 0 && ! cinfo->CCIR601_sampling &&
+	  cinfo->num_components <= MAX_COMPS_IN_SCAN &&
+	  cinfo->data_precision == BITS_IN_JSAMPLE && cinfo->image_height != 0);
+}
+
+
+/*
+ * Compress the whole image on nthreads threads and write it to outfile.
+ * Call after the source module's start_input and the final compression
+ * parameters have been set, instead of jpeg_start_compress and friends.
+ * Returns FALSE, with nothing done, if the image can't be compressed in
+ * bands.  The caller still calls the source module's finish_input.
+ */
+
+GLOBAL(boolean)
+compress_image_parallel (j_compress_ptr cinfo, cjpeg_source_ptr sinfo,
+			 FILE * outfile, int nthreads)
+{
+  cpar_state ps;
+  pthread_t tid[MAX_THREADS];
+  int max_h = 1, max_v = 1, mcu_height, rows_per_interval;
+  long mcus_per_row, mcu_rows;
+  int b, nstarted, next_write, window;
+  JDIMENSION pending = 0, avail = 0;
+  JOCTET eoi[2];
+
+  if (nthreads > MAX_THREADS)
+    nthreads = MAX_THREADS;
+  if (nthreads < 1 || ! can_compress_parallel(cinfo))
+    return FALSE;
+
+  /* Geometry of the (single, interleaved unless 1 component) scan */
+  for (b = 0; b < cinfo->num_components; b++) {
+    if (cinfo->comp_info[b].h_samp_factor > max_h)
+      max_h = cinfo->comp_info[b].h_samp_factor;
+    if (cinfo->comp_info[b].v_samp_factor > max_v)
+      max_v = cinfo->comp_info[b].v_samp_factor;
+  }
+  if (cinfo->num_components == 1)
+    max_h = max_v = 1;
+  mcu_height = DCTSIZE * max_v;
+  mcus_per_row = ((long) cinfo->image_width + DCTSIZE * max_h - 1) /
+    (DCTSIZE * max_h);
+  mcu_rows = ((long) cinfo->image_height + mcu_height - 1) / mcu_height;
+  if (cinfo->restart_in_rows > 0)
+    rows_per_interval = cinfo->restart_in_rows;
+  else if (cinfo->restart_interval > 0 &&
+	   cinfo->restart_interval % mcus_per_row == 0)
+    rows_per_interval = (int) (cinfo->restart_interval / mcus_per_row);
+  else
+    return FALSE;
+  if (mcus_per_row * rows_per_interval > 65535L)
+    return FALSE;		/* the library would refuse it too */
+
+  ps.cinfo = cinfo;
+  ps.row_bytes = cinfo->image_width * cinfo->input_components *
+    SIZEOF(JSAMPLE);
+  ps.nintervals = (int) ((mcu_rows + rows_per_interval - 1) /
+			 rows_per_interval);
+  ps.nbands = nthreads * BANDS_PER_THREAD;
+  if (ps.nbands > ps.nintervals)
+    ps.nbands = ps.nintervals;
+  ps.bands = (cband_info *) malloc(ps.nbands * SIZEOF(cband_info));
+  if (ps.bands == NULL)
+    return FALSE;
+  for (b = 0; b < ps.nbands; b++) {
+    cband_info * band = &ps.bands[b];
+    long top, end;
+
+    band->first = (int) ((long) ps.nintervals * b / ps.nbands);
+    band->last = (int) ((long) ps.nintervals * (b+1) / ps.nbands) - 1;
+    top = (long) band->first * rows_per_interval * mcu_height;
+    end = (long) (band->last + 1) * rows_per_interval * mcu_height;
+    if (end > (long) cinfo->image_height)
+      end = (long) cinfo->image_height;
+    band->top = (JDIMENSION) top;
+    band->height = (JDIMENSION) (end - top);
+    band->rows = NULL;
+    band->data = NULL;
+    band->done = FALSE;
+  }
+
+  ps.nready = ps.next_band = 0;
+  pthread_mutex_init(&ps.lock, NULL);
+  pthread_cond_init(&ps.band_ready, NULL);
+  pthread_cond_init(&ps.band_done, NULL);
+  nstarted = 0;
+  for (b = 0; b < nthreads && b < ps.nbands; b++)
+    if (pthread_create(&tid[nstarted], NULL, cband_worker, &ps) == 0)
+      nstarted++;
+  if (nstarted == 0) {
+    pthread_cond_destroy(&ps.band_done);
+    pthread_cond_destroy(&ps.band_ready);
+    pthread_mutex_destroy(&ps.lock);
+    free(ps.bands);
+    return FALSE;
+  }
+
+  /* Input modules that buffer the image (BMP, bottom-up Targa) use
+   * virtual arrays, which jpeg_start_compress would have realized.
+   */
+  (*cinfo->mem->realize_virt_arrays) ((j_common_ptr) cinfo);
+
+  /* Read bands while few enough are outstanding, write them in order */
+  window = nstarted * BANDS_IN_FLIGHT;
+  for (next_write = 0; next_write < ps.nbands; ) {
+    boolean can_write;
+
+    pthread_mutex_lock(&ps.lock);
+    can_write = ps.bands[next_write].done;
+    if (! can_write && (ps.nready == ps.nbands ||
+			ps.nready - next_write >= window)) {
+      while (! ps.bands[next_write].done)
+	pthread_cond_wait(&ps.band_done, &ps.lock);
+      can_write = TRUE;
+    }
+    pthread_mutex_unlock(&ps.lock);
+
+    if (can_write) {
+      write_band(&ps, &ps.bands[next_write++], outfile);
+    } else {
+      read_band(&ps, sinfo, &ps.bands[ps.nready], &pending, &avail);
+      pthread_mutex_lock(&ps.lock);
+      ps.nready++;
+      pthread_cond_broadcast(&ps.band_ready);
+      pthread_mutex_unlock(&ps.lock);
+    }
+  }
+  eoi[0] = 0xFF;
+  eoi[1] = M_EOI;
+  JFWRITE(outfile, eoi, 2);
+  fflush(outfile);
+  if (ferror(outfile))
+    ERREXIT(cinfo, JERR_FILE_WRITE);
+
+  for (b = 0; b < nstarted; b++)
+    pthread_join(tid[b], NULL);
+  pthread_cond_destroy(&ps.band_done);
+  pthread_cond_destroy(&ps.band_ready);
+  pthread_mutex_destroy(&ps.lock);
+  free(ps.bands);
+  return TRUE;
+}
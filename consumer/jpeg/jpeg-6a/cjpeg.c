@@ -135,6 +135,7 @@ select_file_type (j_compress_ptr cinfo, FILE * infile)
 
 static const char * progname;	/* program name for error messages */
 static char * outfilename;	/* for -outfile switch */
+static int num_threads;		/* for -threads switch, 0 if none */
 
 
 LOCAL(void)
@@ -179,6 +180,7 @@ usage (void)
 #endif
   fprintf(stderr, "  -maxmemory N   Maximum memory to use (in kbytes)\n");
   fprintf(stderr, "  -outfile name  Specify name for output file\n");
+  fprintf(stderr, "  -threads N     Compress bands of restart intervals on N threads\n");
   fprintf(stderr, "  -verbose  or  -debug   Emit debug output\n");
   fprintf(stderr, "Switches for wizards:\n");
 #ifdef C_ARITH_CODING_SUPPORTED
@@ -213,6 +215,7 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
   int q_scale_factor;		/* scaling percentage for -qtables */
   boolean force_baseline;
   boolean simple_progressive;
+  boolean restart_given = FALSE;
   char * qtablefile = NULL;	/* saves -qtables filename if any */
   char * qslotsarg = NULL;	/* saves -qslots parm if any */
   char * samplearg = NULL;	/* saves -sample parm if any */
@@ -228,6 +231,7 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
   simple_progressive = FALSE;
   is_targa = FALSE;
   outfilename = NULL;
+  num_threads = 0;
   cinfo->err->trace_level = 0;
 
   /* Scan command line options, adjust parameters */
@@ -371,6 +375,7 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
 	cinfo->restart_in_rows = (int) lval;
 	/* restart_interval will be computed during startup */
       }
+      restart_given = TRUE;
 
     } else if (keymatch(arg, "sample", 2)) {
       /* Set sampling factors. */
@@ -411,6 +416,13 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
       /* Input file is Targa format. */
       is_targa = TRUE;
 
+    } else if (keymatch(arg, "threads", 2)) {
+      /* Compress restart interval bands in parallel. */
+      if (++argn >= argc)	/* advance to next argument */
+	usage();
+      if (sscanf(argv[argn], "%d", &num_threads) != 1 || num_threads < 1)
+	usage();
+
     } else {
       usage();			/* bogus switch */
     }
@@ -447,6 +459,13 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
       if (! read_scan_script(cinfo, scansarg))
 	usage();
 #endif
+
+    /* Bands are cut at restart markers; the default is one per MCU row,
+     * whatever the number of threads, so the output doesn't depend on it.
+     * Images left to the serial compressor keep the serial default.
+     */
+    if (num_threads > 0 && ! restart_given && can_compress_parallel(cinfo))
+      cinfo->restart_in_rows = 1;
   }
 
   return argn;			/* return index of next arg (file name) */
@@ -576,18 +595,23 @@ main (int argc, char **argv)
   /* Specify data destination for compression */
   jpeg_stdio_dest(&cinfo, output_file);
 
-  /* Start compressor */
-  jpeg_start_compress(&cinfo, TRUE);
+  if (num_threads > 0 &&
+      compress_image_parallel(&cinfo, src_mgr, output_file, num_threads)) {
+    (*src_mgr->finish_input) (&cinfo, src_mgr);
+  } else {
+    /* Start compressor */
+    jpeg_start_compress(&cinfo, TRUE);
 
-  /* Process data */
-  while (cinfo.next_scanline < cinfo.image_height) {
-    num_scanlines = (*src_mgr->get_pixel_rows) (&cinfo, src_mgr);
-    (void) jpeg_write_scanlines(&cinfo, src_mgr->buffer, num_scanlines);
-  }
+    /* Process data */
+    while (cinfo.next_scanline < cinfo.image_height) {
+      num_scanlines = (*src_mgr->get_pixel_rows) (&cinfo, src_mgr);
+      (void) jpeg_write_scanlines(&cinfo, src_mgr->buffer, num_scanlines);
+    }
 
-  /* Finish compression and release memory */
-  (*src_mgr->finish_input) (&cinfo, src_mgr);
-  jpeg_finish_compress(&cinfo);
+    /* Finish compression and release memory */
+    (*src_mgr->finish_input) (&cinfo, src_mgr);
+    jpeg_finish_compress(&cinfo);
+  }
   jpeg_destroy_compress(&cinfo);
 
   /* Close files, if we opened them */
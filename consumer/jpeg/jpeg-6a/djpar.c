@@ -0,0 +1,649 @@
+/*
+ * djpar.c
+ *
+ * This file is part of the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains routines for djpeg's -threads switch: decoding an
+ * image with restart markers in horizontal bands on several threads.
+ *
+ * A baseline image whose restart interval is a whole number of MCU rows
+ * can be cut at its RSTn markers into independent pieces: the DC
+ * predictions are reset at every marker, so each band of restart
+ * intervals can be entropy decoded by itself.  Each band is handed to a
+ * decompression object of its own as a complete JPEG datastream (the
+ * original header with the image height patched, the band's entropy
+ * coded segments with renumbered RSTn markers, and an EOI), so
+ * dequantization, IDCT, upsampling and color conversion of the band
+ * also run on its thread.
+ *
+ * Fancy upsampling looks one sample row beyond the rows it produces, so
+ * each band also decodes the restart interval above it and one MCU row
+ * below it and throws those rows away; the rows it keeps are the same
+ * as the serial decoder's.  Bands are emitted in order through the
+ * regular output module, so the output file is byte-identical.
+ *
+ * The band decoders don't report their warnings and trace messages
+ * themselves.  Each keeps those of the restart intervals it owns, with
+ * the RSTn markers numbered as in the file, and the main thread passes
+ * them to the application's error handler as it emits the band; the
+ * bottom band reads up to EOI.  So the messages, the warning count and
+ * hence djpeg's exit status are those of the serial decoder too.
+ *
+ * Everything else (progressive or multi-scan files, no restart markers,
+ * intervals that are not whole MCU rows, color quantization) is left to
+ * the serial decoder.
+ */
+
+#define JPEG_INTERNALS		/* for cinfo->marker->discarded_bytes */
+#include "cdjpeg.h"		/* Common decls for cjpeg/djpeg applications */
+#include <pthread.h>
+
+#define MAX_THREADS	64
+
+#define M_SOF0	0xC0
+#define M_SOF1	0xC1
+#define M_SOF15	0xCF
+#define M_DHT	0xC4
+#define M_JPG	0xC8
+#define M_DAC	0xCC
+#define M_RST0	0xD0
+#define M_SOI	0xD8
+#define M_EOI	0xD9
+#define M_SOS	0xDA
+
+static const JOCTET marker_bytes[][2] = {
+  { 0xFF, M_RST0 + 0 }, { 0xFF, M_RST0 + 1 }, { 0xFF, M_RST0 + 2 },
+  { 0xFF, M_RST0 + 3 }, { 0xFF, M_RST0 + 4 }, { 0xFF, M_RST0 + 5 },
+  { 0xFF, M_RST0 + 6 }, { 0xFF, M_RST0 + 7 }, { 0xFF, M_EOI }
+};
+#define EOI_BYTES	marker_bytes[8]
+
+
+/*
+ * Data source made of a list of memory pieces, read one after another.
+ */
+
+typedef struct {
+  const JOCTET * data;
+  size_t size;
+} mem_piece;
+
+typedef struct {
+  struct jpeg_source_mgr pub;	/* public fields */
+
+  const mem_piece * pieces;	/* data to deliver */
+  int npieces, next_piece;
+  int note_piece;		/* on reaching this piece, note down */
+  unsigned int noted_discarded;	/* cinfo->marker->discarded_bytes */
+} piece_source_mgr;
+
+typedef piece_source_mgr * piece_src_ptr;
+
+
+METHODDEF(void)
+init_source (j_decompress_ptr cinfo)
+{
+  piece_src_ptr src = (piece_src_ptr) cinfo->src;
+
+  src->next_piece = 0;
+}
+
+
+METHODDEF(boolean)
+fill_input_buffer (j_decompress_ptr cinfo)
+{
+  piece_src_ptr src = (piece_src_ptr) cinfo->src;
+
+  while (src->next_piece < src->npieces &&
+	 src->pieces[src->next_piece].size == 0)
+    src->next_piece++;		/* skip empty segments */
+  if (src->next_piece >= src->note_piece && src->note_piece >= 0) {
+    src->noted_discarded = cinfo->marker->discarded_bytes;
+    src->note_piece = -1;
+  }
+  if (src->next_piece < src->npieces) {
+    src->pub.next_input_byte = src->pieces[src->next_piece].data;
+    src->pub.bytes_in_buffer = src->pieces[src->next_piece].size;
+    src->next_piece++;
+  } else {
+    WARNMS(cinfo, JWRN_JPEG_EOF);
+    /* Insert a fake EOI marker */
+    src->pub.next_input_byte = EOI_BYTES;
+    src->pub.bytes_in_buffer = 2;
+  }
+  return TRUE;
+}
+
+
+METHODDEF(void)
+skip_input_data (j_decompress_ptr cinfo, long num_bytes)
+{
+  piece_src_ptr src = (piece_src_ptr) cinfo->src;
+
+  if (num_bytes > 0) {
+    while (num_bytes > (long) src->pub.bytes_in_buffer) {
+      num_bytes -= (long) src->pub.bytes_in_buffer;
+      (void) fill_input_buffer(cinfo);
+    }
+    src->pub.next_input_byte += (size_t) num_bytes;
+    src->pub.bytes_in_buffer -= (size_t) num_bytes;
+  }
+}
+
+
+METHODDEF(void)
+term_source (j_decompress_ptr cinfo)
+{
+  /* no work necessary here */
+}
+
+
+LOCAL(void)
+pieces_src (j_decompress_ptr cinfo, const mem_piece * pieces, int npieces)
+{
+  piece_src_ptr src;
+
+  if (cinfo->src == NULL) {	/* first time for this JPEG object? */
+    cinfo->src = (struct jpeg_source_mgr *)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+				  SIZEOF(piece_source_mgr));
+  }
+  src = (piece_src_ptr) cinfo->src;
+  src->pub.init_source = init_source;
+  src->pub.fill_input_buffer = fill_input_buffer;
+  src->pub.skip_input_data = skip_input_data;
+  src->pub.resync_to_restart = jpeg_resync_to_restart; /* use default method */
+  src->pub.term_source = term_source;
+  src->pieces = pieces;
+  src->npieces = npieces;
+  src->note_piece = -1;
+  src->pub.bytes_in_buffer = 0; /* forces fill_input_buffer on first read */
+  src->pub.next_input_byte = NULL;
+}
+
+
+/*
+ * Slurp a whole file into malloc'd memory.  Returns NULL on failure.
+ */
+
+GLOBAL(JOCTET *)
+read_file_buffer (FILE * infile, size_t * size)
+{
+  JOCTET * buffer = NULL, * bigger;
+  size_t alloced = 0, len = 0, nbytes;
+
+  do {
+    if (len == alloced) {
+      alloced = alloced ? alloced * 2 : 65536;
+      if ((bigger = (JOCTET *) realloc(buffer, alloced)) == NULL) {
+	free(buffer);
+	return NULL;
+      }
+      buffer = bigger;
+    }
+    nbytes = JFREAD(infile, buffer + len, alloced - len);
+    len += nbytes;
+  } while (nbytes > 0);
+  if (ferror(infile)) {
+    free(buffer);
+    return NULL;
+  }
+  *size = len;
+  return buffer;
+}
+
+
+/*
+ * State shared by the band decoders.
+ */
+
+typedef struct {		/* a message kept for the main thread */
+  int msg_level;
+  int msg_code;
+  union {
+    int i[8];
+    char s[JMSG_STR_PARM_MAX];
+  } msg_parm;
+} band_msg;
+
+typedef struct {
+  int first, last;		/* restart intervals kept by this band */
+  JSAMPARRAY rows;		/* its output rows, once done */
+  JDIMENSION nrows;
+  band_msg * msgs;		/* its messages, in order */
+  int nmsgs, maxmsgs;
+  int carry_msg;		/* message that takes bytes discarded above */
+  unsigned int discarded;	/* discarded bytes not reported at its end */
+  boolean reported;		/* whether they start within the band */
+  boolean done;
+} band_info;
+
+/*
+ * The marker reader only reports the bytes discarded at restart markers
+ * when it next has to look for a marker, which may be intervals later,
+ * in another band.  So a band decoder's count starts at DISCARD_BASE:
+ * the first report in the band is the one that takes the bytes left
+ * unreported by the bands above, and if the band itself leaves bytes
+ * unreported, the count tells whether it reported any before them.
+ */
+
+#define DISCARD_BASE	0x40000000U
+
+typedef struct {
+  j_decompress_ptr cinfo;	/* the application's (serial) object */
+  const JOCTET * data;		/* the JPEG file */
+  size_t sof_pos, sos_end;	/* SOF marker, end of SOS segment */
+  size_t * seg_start, * seg_end;	/* entropy coded segments */
+  int nintervals;
+  int mcu_rows_per_interval;	/* R */
+  int mcu_height, out_mcu_height;	/* MCU row, in image/output rows */
+  JDIMENSION row_bytes;
+
+  band_info * bands;
+  int nbands, next_band;
+  pthread_mutex_t lock;
+  pthread_cond_t band_done;
+} par_state;
+
+
+/*
+ * Error manager of a band decoder.  Messages are kept in the band
+ * rather than printed; only those raised while reading the restart
+ * intervals the band owns are kept, since the intervals decoded on
+ * either side of it belong to its neighbours and the header has been
+ * read by the application's object already.  The interval being read
+ * is told by the piece the source is in: piece 0 is the header, then
+ * each interval is followed by its marker.  A marker goes with the
+ * interval after it (the EOI with the bottom band), because a band
+ * need not read on to the marker after its last interval, while the
+ * band below always reads the interval above it to the end.
+ */
+
+typedef struct {
+  struct jpeg_error_mgr pub;	/* "public" fields */
+
+  band_info * band;		/* where to keep messages */
+  int first;			/* first interval in the datastream */
+  int end;			/* last interval kept, nintervals for EOI */
+} band_error_mgr;
+
+typedef band_error_mgr * band_err_ptr;
+
+
+METHODDEF(void)
+band_emit_message (j_common_ptr cinfo, int msg_level)
+{
+  band_err_ptr err = (band_err_ptr) cinfo->err;
+  piece_src_ptr src = (piece_src_ptr) ((j_decompress_ptr) cinfo)->src;
+  band_info * band = err->band;
+  band_msg * msg;
+  int piece, k;
+
+  if (msg_level > err->pub.trace_level)
+    return;
+  if (src == NULL || src->next_piece < 2)
+    return;			/* still in the header */
+  piece = src->next_piece - 1;
+  k = err->first + (piece - 1) / 2;	/* interval read, or the one before */
+  if ((piece & 1) == 0 ? k + 1 < band->first || k + 1 > err->end :
+      k < band->first || k > band->last)
+    return;
+
+  if (band->nmsgs == band->maxmsgs) {
+    band->maxmsgs = band->maxmsgs ? band->maxmsgs * 2 : 16;
+    band->msgs = (band_msg *) realloc(band->msgs,
+				      band->maxmsgs * SIZEOF(band_msg));
+    if (band->msgs == NULL) {
+      fprintf(stderr, "djpeg: out of memory for band decoder\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  msg = &band->msgs[band->nmsgs++];
+  msg->msg_level = msg_level;
+  msg->msg_code = err->pub.msg_code;
+  MEMCOPY(&msg->msg_parm, &err->pub.msg_parm, SIZEOF(msg->msg_parm));
+
+  if (msg->msg_code == JWRN_EXTRANEOUS_DATA) {
+    if ((unsigned int) msg->msg_parm.i[0] >= DISCARD_BASE) {
+      msg->msg_parm.i[0] -= (int) DISCARD_BASE;
+      band->carry_msg = band->nmsgs - 1;
+    }
+    /* The band's RSTn markers are numbered from its first interval */
+    if (msg->msg_parm.i[1] >= M_RST0 && msg->msg_parm.i[1] < M_RST0 + 8)
+      msg->msg_parm.i[1] = M_RST0 + (k & 7);
+  } else if (msg->msg_code == JTRC_RST)
+    msg->msg_parm.i[0] = k & 7;
+}
+
+
+/*
+ * Find the SOF and SOS markers in the header and the entropy coded
+ * segments of the (only) scan.  Returns FALSE if the file doesn't have
+ * the layout the band decoders need.
+ */
+
+LOCAL(boolean)
+locate_segments (par_state * ps, size_t size)
+{
+  const JOCTET * d = ps->data;
+  size_t pos = 2, len, q;
+  int m, k = 0;
+
+  ps->sof_pos = 0;
+  if (size < 4 || d[0] != 0xFF || d[1] != M_SOI)
+    return FALSE;
+  for (;;) {			/* walk the header markers */
+    if (pos + 4 > size || d[pos] != 0xFF)
+      return FALSE;
+    while (pos + 4 <= size && d[pos+1] == 0xFF)
+      pos++;			/* fill bytes */
+    m = d[pos+1];
+    len = ((size_t) d[pos+2] << 8) + d[pos+3];
+    if (pos + 2 + len > size)
+      return FALSE;
+    if (m >= M_SOF0 && m <= M_SOF15 && m != M_DHT && m != M_JPG && m != M_DAC) {
+      if (ps->sof_pos || (m != M_SOF0 && m != M_SOF1))
+	return FALSE;		/* only sequential Huffman coding */
+      ps->sof_pos = pos;
+    }
+    pos += 2 + len;
+    if (m == M_SOS)
+      break;
+  }
+  if (ps->sof_pos == 0)
+    return FALSE;
+  ps->sos_end = pos;
+
+  /* The entropy coded data may only be interrupted by RST0..7 in order. */
+  ps->seg_start[0] = pos;
+  for (;;) {
+    const JOCTET * ff = (const JOCTET *) memchr(d + pos, 0xFF, size - pos);
+
+    if (ff == NULL)
+      return FALSE;
+    pos = ff - d;
+    q = pos + 1;
+    while (q < size && d[q] == 0xFF)
+      q++;			/* fill bytes */
+    if (q >= size)
+      return FALSE;
+    m = d[q];
+    if (m == 0) {		/* stuffed zero */
+      pos = q + 1;
+      continue;
+    }
+    if (k >= ps->nintervals)
+      return FALSE;
+    ps->seg_end[k] = pos;
+    if (m == M_EOI)
+      return k == ps->nintervals - 1;
+    if (m != M_RST0 + (k & 7) || k == ps->nintervals - 1)
+      return FALSE;
+    pos = q + 1;
+    ps->seg_start[++k] = pos;
+  }
+}
+
+
+/*
+ * Decode band b into memory, with the worker's own decompression object.
+ * The object outlives the band, so the next band decoded with it gets
+ * its memory from the pools this one leaves behind.
+ */
+
+LOCAL(void)
+decode_band (par_state * ps, band_info * band, j_decompress_ptr cinfo)
+{
+  j_decompress_ptr app = ps->cinfo;
+  int first = band->first > 0 ? band->first - 1 : 0;
+  int last = band->last < ps->nintervals - 1 ? band->last + 1 : band->last;
+  int bottom = band->last == ps->nintervals - 1;
+  long top_row, end_row;
+  JDIMENSION skip, want, got;
+  JOCTET * header;
+  mem_piece * pieces;
+  JSAMPARRAY scratch;
+  int k, n = 0;
+
+  /* Image rows covered: the interval above, the band, one MCU row below */
+  top_row = (long) first * ps->mcu_rows_per_interval * ps->mcu_height;
+  end_row = bottom ? (long) app->image_height :
+    ((long) (band->last + 1) * ps->mcu_rows_per_interval + 1) * ps->mcu_height;
+  if (end_row > (long) app->image_height)
+    end_row = (long) app->image_height;
+
+  header = (JOCTET *) malloc(ps->sos_end);
+  pieces = (mem_piece *) malloc((2 * (last - first + 1) + 1) * SIZEOF(mem_piece));
+  if (header == NULL || pieces == NULL) {
+    fprintf(stderr, "djpeg: out of memory for band decoder\n");
+    exit(EXIT_FAILURE);
+  }
+  MEMCOPY(header, ps->data, ps->sos_end);
+  header[ps->sof_pos + 5] = (JOCTET) ((end_row - top_row) >> 8);
+  header[ps->sof_pos + 6] = (JOCTET) ((end_row - top_row) & 0xFF);
+  pieces[n].data = header;
+  pieces[n++].size = ps->sos_end;
+  for (k = first; k <= last; k++) {
+    pieces[n].data = ps->data + ps->seg_start[k];
+    pieces[n++].size = ps->seg_end[k] - ps->seg_start[k];
+    pieces[n].data = k < last ? marker_bytes[(k - first) & 7] : EOI_BYTES;
+    pieces[n++].size = 2;
+  }
+
+  ((band_err_ptr) cinfo->err)->band = band;
+  ((band_err_ptr) cinfo->err)->first = first;
+  ((band_err_ptr) cinfo->err)->end = bottom ? band->last + 1 : band->last;
+  cinfo->err->trace_level = app->err->trace_level;
+  pieces_src(cinfo, pieces, n);
+  /* Note the discarded bytes as the band's last interval is begun */
+  ((piece_src_ptr) cinfo->src)->note_piece = 2 * (band->last - first) + 1;
+  (void) jpeg_read_header(cinfo, TRUE);
+
+  /* Same decompression parameters as the application's object */
+  cinfo->out_color_space = app->out_color_space;
+  cinfo->scale_num = app->scale_num;
+  cinfo->scale_denom = app->scale_denom;
+  cinfo->output_gamma = app->output_gamma;
+  cinfo->dct_method = app->dct_method;
+  cinfo->do_fancy_upsampling = app->do_fancy_upsampling;
+  cinfo->do_block_smoothing = app->do_block_smoothing;
+  cinfo->mem->max_memory_to_use = app->mem->max_memory_to_use;
+  (void) jpeg_start_decompress(cinfo);
+  cinfo->marker->discarded_bytes = DISCARD_BASE;
+
+  skip = (JDIMENSION) (band->first - first) * ps->mcu_rows_per_interval *
+    ps->out_mcu_height;
+  want = bottom ? app->output_height -
+    (JDIMENSION) band->first * ps->mcu_rows_per_interval * ps->out_mcu_height :
+    (JDIMENSION) (band->last - band->first + 1) * ps->mcu_rows_per_interval *
+    ps->out_mcu_height;
+
+  band->rows = (JSAMPARRAY) malloc(want * SIZEOF(JSAMPROW));
+  if (band->rows == NULL ||
+      (band->rows[0] = (JSAMPROW) malloc((size_t) want * ps->row_bytes)) == NULL) {
+    fprintf(stderr, "djpeg: out of memory for band decoder\n");
+    exit(EXIT_FAILURE);
+  }
+  for (got = 1; got < want; got++)
+    band->rows[got] = band->rows[got-1] + ps->row_bytes;
+
+  scratch = (*cinfo->mem->alloc_sarray)
+    ((j_common_ptr) cinfo, JPOOL_IMAGE, ps->row_bytes, (JDIMENSION) 1);
+  while (cinfo->output_scanline < skip)
+    (void) jpeg_read_scanlines(cinfo, scratch, (JDIMENSION) 1);
+  for (got = 0; got < want; )
+    got += jpeg_read_scanlines(cinfo, band->rows + got, want - got);
+  band->nrows = want;
+  band->discarded = ((piece_src_ptr) cinfo->src)->noted_discarded;
+  band->reported = band->discarded < DISCARD_BASE;
+  if (! band->reported)
+    band->discarded -= DISCARD_BASE;
+
+  /* The bottom band reads on to EOI, as jpeg_finish_decompress does in
+   * the serial decoder, so that data left before it is reported; the
+   * rest of the other bands' datastreams is of no interest.
+   */
+  if (bottom)
+    (void) jpeg_finish_decompress(cinfo);
+  else
+    jpeg_abort_decompress(cinfo);
+  free(pieces);
+  free(header);
+}
+
+
+METHODDEF(void *)
+band_worker (void * arg)
+{
+  par_state * ps = (par_state *) arg;
+  struct jpeg_decompress_struct cinfo;
+  band_error_mgr jerr;
+  int b;
+
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.emit_message = band_emit_message;
+  jpeg_create_decompress(&cinfo);
+  for (;;) {
+    pthread_mutex_lock(&ps->lock);
+    b = ps->next_band++;
+    pthread_mutex_unlock(&ps->lock);
+    if (b >= ps->nbands)
+      break;
+    decode_band(ps, &ps->bands[b], &cinfo);
+    pthread_mutex_lock(&ps->lock);
+    ps->bands[b].done = TRUE;
+    pthread_cond_broadcast(&ps->band_done);
+    pthread_mutex_unlock(&ps->lock);
+  }
+  jpeg_destroy_decompress(&cinfo);
+  return NULL;
+}
+
+
+/*
+ * Decode the whole image on nthreads threads and emit it through dest.
+ * Call after jpeg_start_decompress and (*dest->start_output); data/size
+ * must be the complete file that cinfo is reading.  Returns FALSE, with
+ * nothing done, if the image can't be decoded in bands.  After TRUE the
+ * application finishes with (*dest->finish_output) and
+ * jpeg_abort_decompress instead of jpeg_finish_decompress; the messages
+ * the latter would give have been passed to cinfo's error handler.
+ */
+
+GLOBAL(boolean)
+read_image_parallel (j_decompress_ptr cinfo, djpeg_dest_ptr dest,
+		     const JOCTET * data, size_t size, int nthreads)
+{
+  par_state ps;
+  pthread_t tid[MAX_THREADS];
+  long mcu_rows;
+  int b, m, nstarted;
+  unsigned int discarded;
+  JDIMENSION r, n, i;
+  boolean ok;
+
+  if (nthreads > MAX_THREADS)
+    nthreads = MAX_THREADS;
+  if (nthreads < 2 || cinfo->progressive_mode || cinfo->quantize_colors ||
+      cinfo->buffered_image || cinfo->raw_data_out ||
+      cinfo->comps_in_scan != cinfo->num_components ||
+      cinfo->restart_interval == 0 ||
+      cinfo->restart_interval % cinfo->MCUs_per_row != 0 ||
+      cinfo->output_scanline != 0)
+    return FALSE;
+
+  ps.cinfo = cinfo;
+  ps.data = data;
+  ps.mcu_rows_per_interval = (int) (cinfo->restart_interval /
+				    cinfo->MCUs_per_row);
+  ps.mcu_height = DCTSIZE * (cinfo->comps_in_scan > 1 ?
+			     cinfo->max_v_samp_factor : 1);
+  ps.out_mcu_height = ps.mcu_height * cinfo->min_DCT_scaled_size / DCTSIZE;
+  ps.row_bytes = cinfo->output_width * cinfo->output_components *
+    SIZEOF(JSAMPLE);
+  mcu_rows = (long) cinfo->MCU_rows_in_scan;
+  ps.nintervals = (int) ((mcu_rows + ps.mcu_rows_per_interval - 1) /
+			 ps.mcu_rows_per_interval);
+  if (ps.nintervals < 2)
+    return FALSE;
+  ps.nbands = ps.nintervals < nthreads ? ps.nintervals : nthreads;
+
+  ps.seg_start = (size_t *) malloc(ps.nintervals * SIZEOF(size_t));
+  ps.seg_end = (size_t *) malloc(ps.nintervals * SIZEOF(size_t));
+  ps.bands = (band_info *) malloc(ps.nbands * SIZEOF(band_info));
+  ok = ps.seg_start != NULL && ps.seg_end != NULL && ps.bands != NULL &&
+    locate_segments(&ps, size);
+
+  nstarted = 0;
+  if (ok) {
+    for (b = 0; b < ps.nbands; b++) {
+      ps.bands[b].first = (int) ((long) ps.nintervals * b / ps.nbands);
+      ps.bands[b].last = (int) ((long) ps.nintervals * (b+1) / ps.nbands) - 1;
+      ps.bands[b].rows = NULL;
+      ps.bands[b].msgs = NULL;
+      ps.bands[b].nmsgs = ps.bands[b].maxmsgs = 0;
+      ps.bands[b].carry_msg = -1;
+      ps.bands[b].done = FALSE;
+    }
+    ps.next_band = 0;
+    pthread_mutex_init(&ps.lock, NULL);
+    pthread_cond_init(&ps.band_done, NULL);
+    for (b = 0; b < ps.nbands; b++)
+      if (pthread_create(&tid[nstarted], NULL, band_worker, &ps) == 0)
+	nstarted++;
+    ok = nstarted > 0;
+  }
+  if (! ok) {
+    free(ps.bands);
+    free(ps.seg_end);
+    free(ps.seg_start);
+    return FALSE;
+  }
+
+  /* Emit the bands in order as they come in */
+  discarded = 0;
+  for (b = 0; b < ps.nbands; b++) {
+    band_info * band = &ps.bands[b];
+
+    pthread_mutex_lock(&ps.lock);
+    while (! band->done)
+      pthread_cond_wait(&ps.band_done, &ps.lock);
+    pthread_mutex_unlock(&ps.lock);
+
+    for (m = 0; m < band->nmsgs; m++) {
+      if (m == band->carry_msg) {
+	band->msgs[m].msg_parm.i[0] += (int) discarded;
+	if (band->msgs[m].msg_parm.i[0] == 0)
+	  continue;
+      }
+      cinfo->err->msg_code = band->msgs[m].msg_code;
+      MEMCOPY(&cinfo->err->msg_parm, &band->msgs[m].msg_parm,
+	      SIZEOF(cinfo->err->msg_parm));
+      (*cinfo->err->emit_message) ((j_common_ptr) cinfo,
+				   band->msgs[m].msg_level);
+    }
+    free(band->msgs);
+    discarded = band->reported ? band->discarded : discarded + band->discarded;
+    for (r = 0; r < band->nrows; r += n) {
+      n = band->nrows - r;
+      if (n > dest->buffer_height)
+	n = dest->buffer_height;
+      for (i = 0; i < n; i++)
+	MEMCOPY(dest->buffer[i], band->rows[r + i], ps.row_bytes);
+      cinfo->output_scanline += n;
+      (*dest->put_pixel_rows) (cinfo, dest, n);
+    }
+    free(band->rows[0]);
+    free(band->rows);
+  }
+
+  for (b = 0; b < nstarted; b++)
+    pthread_join(tid[b], NULL);
+  pthread_cond_destroy(&ps.band_done);
+  pthread_mutex_destroy(&ps.lock);
+  free(ps.bands);
+  free(ps.seg_end);
+  free(ps.seg_start);
+  return TRUE;
+}
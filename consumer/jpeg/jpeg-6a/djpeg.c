@@ -84,6 +84,7 @@ static IMAGE_FORMATS requested_fmt;
 
 static const char * progname;	/* program name for error messages */
 static char * outfilename;	/* for -outfile switch */
+static int num_threads;		/* for -threads switch */
 
 
 LOCAL(void)
@@ -153,6 +154,7 @@ usage (void)
 #endif
   fprintf(stderr, "  -maxmemory N   Maximum memory to use (in kbytes)\n");
   fprintf(stderr, "  -outfile name  Specify name for output file\n");
+  fprintf(stderr, "  -threads N     Decode images with restart markers on N threads\n");
   fprintf(stderr, "  -verbose  or  -debug   Emit debug output\n");
   exit(EXIT_FAILURE);
 }
@@ -176,6 +178,7 @@ parse_switches (j_decompress_ptr cinfo, int argc, char **argv,
   /* Set up default JPEG parameters. */
   requested_fmt = DEFAULT_FMT;	/* set default output file format */
   outfilename = NULL;
+  num_threads = 1;
   cinfo->err->trace_level = 0;
 
   /* Scan command line options, adjust parameters */
@@ -334,6 +337,13 @@ parse_switches (j_decompress_ptr cinfo, int argc, char **argv,
       /* Targa output format. */
       requested_fmt = FMT_TARGA;
 
+    } else if (keymatch(arg, "threads", 2)) {
+      /* Decode restart interval bands in parallel. */
+      if (++argn >= argc)	/* advance to next argument */
+	usage();
+      if (sscanf(argv[argn], "%d", &num_threads) != 1 || num_threads < 1)
+	usage();
+
     } else {
       usage();			/* bogus switch */
     }
@@ -427,6 +437,11 @@ main (int argc, char **argv)
   djpeg_dest_ptr dest_mgr = NULL;
   FILE * input_file;
   FILE * output_file;
+  JOCTET * input_map;		/* input file mapped into memory */
+  JOCTET * input_buffer = NULL;	/* or read into memory */
+  const JOCTET * input_data = NULL;
+  size_t map_offset, map_size, input_size;
+  boolean parallel = FALSE;
   JDIMENSION num_scanlines;
 
   /* On Mac, fetch a command line. */
@@ -513,8 +528,26 @@ main (int argc, char **argv)
   start_progress_monitor((j_common_ptr) &cinfo, &progress);
 #endif
 
-  /* Specify data source for decompression */
-  jpeg_stdio_src(&cinfo, input_file);
+  /* Specify data source for decompression.  A regular file is mapped into
+   * memory and decoded in place.  The band decoders of -threads need the
+   * whole file in memory, so other input is read into a buffer for them.
+   */
+  input_map = map_input_file(input_file, &map_offset, &map_size);
+  if (input_map != NULL) {
+    input_data = input_map + map_offset;
+    input_size = map_size - map_offset;
+  } else if (num_threads > 1) {
+    if ((input_buffer = read_file_buffer(input_file, &input_size)) == NULL) {
+      fprintf(stderr, "%s: can't read %s\n", progname,
+	      file_index < argc ? argv[file_index] : "standard input");
+      exit(EXIT_FAILURE);
+    }
+    input_data = input_buffer;
+  }
+  if (input_data != NULL)
+    jpeg_mem_src(&cinfo, input_data, (unsigned long) input_size);
+  else
+    jpeg_stdio_src(&cinfo, input_file);
 
   /* Read file header, set default decompression parameters */
   (void) jpeg_read_header(&cinfo, TRUE);
@@ -567,6 +600,9 @@ main (int argc, char **argv)
   (*dest_mgr->start_output) (&cinfo, dest_mgr);
 
   /* Process data */
+  if (num_threads > 1 && input_data != NULL)
+    parallel = read_image_parallel(&cinfo, dest_mgr, input_data,
+				   input_size, num_threads);
   while (cinfo.output_scanline < cinfo.output_height) {
     num_scanlines = jpeg_read_scanlines(&cinfo, dest_mgr->buffer,
 					dest_mgr->buffer_height);
@@ -585,8 +621,15 @@ main (int argc, char **argv)
    * of lifespan JPOOL_IMAGE; it needs to finish before releasing memory.
    */
   (*dest_mgr->finish_output) (&cinfo, dest_mgr);
-  (void) jpeg_finish_decompress(&cinfo);
+  if (parallel)			/* the bands read the datastream */
+    jpeg_abort_decompress(&cinfo);
+  else
+    (void) jpeg_finish_decompress(&cinfo);
   jpeg_destroy_decompress(&cinfo);
+  if (input_map != NULL)
+    unmap_input_file(input_map, map_size);
+  if (input_buffer != NULL)
+    free(input_buffer);
 
   /* Close files, if we opened them */
   if (input_file != stdin)
@@ -250,6 +250,7 @@ compress_first_pass (j_compress_ptr cinfo, JSAMPIMAGE input_buf)
   JCOEF lastDC;
   jpeg_component_info *compptr;
   JBLOCKARRAY buffer;
+  JBLOCKARRAY iMCU_buffer[MAX_COMPONENTS];
   JBLOCKROW thisblockrow, lastblockrow;
 
   for (ci = 0, compptr = cinfo->comp_info; ci < cinfo->num_components;
@@ -259,6 +260,7 @@ compress_first_pass (j_compress_ptr cinfo, JSAMPIMAGE input_buf)
       ((j_common_ptr) cinfo, coef->whole_image[ci],
        coef->iMCU_row_num * compptr->v_samp_factor,
        (JDIMENSION) compptr->v_samp_factor, TRUE);
+    iMCU_buffer[ci] = buffer;
     /* Count non-dummy DCT block rows in this iMCU row. */
     if (coef->iMCU_row_num < last_iMCU_row)
       block_rows = compptr->v_samp_factor;
@@ -317,6 +319,18 @@ compress_first_pass (j_compress_ptr cinfo, JSAMPIMAGE input_buf)
       }
     }
   }
+  /* If the entropy encoder is gathering statistics for every scan at once,
+   * hand it the whole iMCU row while it is still in cache.  This can't
+   * suspend.
+   */
+  if (cinfo->entropy->gather_iMCU_row != NULL) {
+    (*cinfo->entropy->gather_iMCU_row) (cinfo, iMCU_buffer,
+					coef->iMCU_row_num);
+    coef->iMCU_row_num++;
+    start_iMCU_row(cinfo);
+    return TRUE;
+  }
+
   /* NB: compress_output will increment iMCU_row_num if successful.
    * A suspension return will result in redoing all the work above next time.
    */
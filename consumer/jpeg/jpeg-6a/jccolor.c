@@ -11,6 +11,7 @@
 #define JPEG_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jsimd.h"		/* SIMD support */
 
 
 /* Private subobject */
@@ -172,6 +173,161 @@ rgb_ycc_convert (j_compress_ptr cinfo,
 }
 
 
+#ifdef JSIMD_SUPPORTED
+
+/*
+ * SSE2 and AVX2 versions of rgb_ycc_convert.  Instead of looking up the
+ * table entries they compute them, with exact 32-bit products, and sum
+ * them in the same order, so the outputs are identical.  The SSE2 version
+ * does 8 pixels at a time, the AVX2 version 16; the last pixels of a row
+ * are done by converting the row's last 8 or 16 pixels again.  Images
+ * narrower than that are left to rgb_ycc_convert.
+ */
+
+/* Accumulate x * c into the 32-bit sums lo, hi, for a constant c
+ * of either sign.
+ */
+#define ACCUM_SSE2(lo,hi,x,c)  \
+  { __m128i plo_, phi_; \
+    jsimd_mulu16_sse2(x, (int) ((c) < 0 ? -(c) : (c)), &plo_, &phi_); \
+    if ((c) < 0) { lo = _mm_sub_epi32(lo, plo_); hi = _mm_sub_epi32(hi, phi_); } \
+    else { lo = _mm_add_epi32(lo, plo_); hi = _mm_add_epi32(hi, phi_); } }
+
+#define ACCUM_AVX2(lo,hi,x,c)  \
+  { __m256i plo_, phi_; \
+    jsimd_mulu16_avx2(x, (int) ((c) < 0 ? -(c) : (c)), &plo_, &phi_); \
+    if ((c) < 0) { lo = _mm256_sub_epi32(lo, plo_); hi = _mm256_sub_epi32(hi, phi_); } \
+    else { lo = _mm256_add_epi32(lo, plo_); hi = _mm256_add_epi32(hi, phi_); } }
+
+/* One output component, (k + r*cr + g*cg + b*cb) >> SCALEBITS, as 16-bit
+ * lanes.
+ */
+
+static __inline__ __m128i
+ycc_component_sse2 (__m128i r, __m128i g, __m128i b,
+		    INT32 cr, INT32 cg, INT32 cb, INT32 k)
+{
+  __m128i lo = _mm_set1_epi32((int) k), hi = lo;
+
+  ACCUM_SSE2(lo, hi, r, cr);
+  ACCUM_SSE2(lo, hi, g, cg);
+  ACCUM_SSE2(lo, hi, b, cb);
+  return _mm_packs_epi32(_mm_srai_epi32(lo, SCALEBITS),
+			 _mm_srai_epi32(hi, SCALEBITS));
+}
+
+JSIMD_AVX2_TARGET static __inline__ __m256i
+ycc_component_avx2 (__m256i r, __m256i g, __m256i b,
+		    INT32 cr, INT32 cg, INT32 cb, INT32 k)
+{
+  __m256i lo = _mm256_set1_epi32((int) k), hi = lo;
+
+  ACCUM_AVX2(lo, hi, r, cr);
+  ACCUM_AVX2(lo, hi, g, cg);
+  ACCUM_AVX2(lo, hi, b, cb);
+  return _mm256_packs_epi32(_mm256_srai_epi32(lo, SCALEBITS),
+			    _mm256_srai_epi32(hi, SCALEBITS));
+}
+
+#define Y_COEFS		FIX(0.29900), FIX(0.58700), FIX(0.11400), ONE_HALF
+#define CB_COEFS	(-FIX(0.16874)), (-FIX(0.33126)), FIX(0.50000), \
+			CBCR_OFFSET + ONE_HALF-1
+#define CR_COEFS	FIX(0.50000), (-FIX(0.41869)), (-FIX(0.08131)), \
+			CBCR_OFFSET + ONE_HALF-1
+
+METHODDEF(void)
+rgb_ycc_convert_sse2 (j_compress_ptr cinfo,
+		      JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+		      JDIMENSION output_row, int num_rows)
+{
+  INT16 rs[8], gs[8], bs[8];
+  __m128i r, g, b, y, cb, cr;
+  register JSAMPROW inptr, pixptr;
+  register JSAMPROW outptr0, outptr1, outptr2;
+  JDIMENSION col;
+  JDIMENSION num_cols = cinfo->image_width;
+  int i;
+
+  if (num_cols < 8) {
+    rgb_ycc_convert(cinfo, input_buf, output_buf, output_row, num_rows);
+    return;
+  }
+  while (--num_rows >= 0) {
+    inptr = *input_buf++;
+    outptr0 = output_buf[0][output_row];
+    outptr1 = output_buf[1][output_row];
+    outptr2 = output_buf[2][output_row];
+    output_row++;
+    for (col = 0; ; col += 8) {
+      if (col > num_cols - 8)
+	col = num_cols - 8;
+      /* SSE2 can't shuffle bytes; deinterleave the pixels in C */
+      pixptr = inptr + col * RGB_PIXELSIZE;
+      for (i = 0; i < 8; i++) {
+	rs[i] = GETJSAMPLE(pixptr[RGB_RED]);
+	gs[i] = GETJSAMPLE(pixptr[RGB_GREEN]);
+	bs[i] = GETJSAMPLE(pixptr[RGB_BLUE]);
+	pixptr += RGB_PIXELSIZE;
+      }
+      r = _mm_loadu_si128((__m128i *) rs);
+      g = _mm_loadu_si128((__m128i *) gs);
+      b = _mm_loadu_si128((__m128i *) bs);
+      y = ycc_component_sse2(r, g, b, Y_COEFS);
+      cb = ycc_component_sse2(r, g, b, CB_COEFS);
+      cr = ycc_component_sse2(r, g, b, CR_COEFS);
+      _mm_storel_epi64((__m128i *) (outptr0 + col), _mm_packus_epi16(y, y));
+      _mm_storel_epi64((__m128i *) (outptr1 + col), _mm_packus_epi16(cb, cb));
+      _mm_storel_epi64((__m128i *) (outptr2 + col), _mm_packus_epi16(cr, cr));
+      if (col + 8 >= num_cols)
+	break;
+    }
+  }
+}
+
+JSIMD_AVX2_TARGET METHODDEF(void)
+rgb_ycc_convert_avx2 (j_compress_ptr cinfo,
+		      JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+		      JDIMENSION output_row, int num_rows)
+{
+  __m128i r8, g8, b8;
+  __m256i r, g, b, y, cb, cr;
+  register JSAMPROW inptr;
+  register JSAMPROW outptr0, outptr1, outptr2;
+  JDIMENSION col;
+  JDIMENSION num_cols = cinfo->image_width;
+
+  if (num_cols < 16) {
+    rgb_ycc_convert(cinfo, input_buf, output_buf, output_row, num_rows);
+    return;
+  }
+  while (--num_rows >= 0) {
+    inptr = *input_buf++;
+    outptr0 = output_buf[0][output_row];
+    outptr1 = output_buf[1][output_row];
+    outptr2 = output_buf[2][output_row];
+    output_row++;
+    for (col = 0; ; col += 16) {
+      if (col > num_cols - 16)
+	col = num_cols - 16;
+      jsimd_load_rgb_avx2(inptr + col * RGB_PIXELSIZE, &r8, &g8, &b8);
+      r = _mm256_cvtepu8_epi16(r8);
+      g = _mm256_cvtepu8_epi16(g8);
+      b = _mm256_cvtepu8_epi16(b8);
+      y = ycc_component_avx2(r, g, b, Y_COEFS);
+      cb = ycc_component_avx2(r, g, b, CB_COEFS);
+      cr = ycc_component_avx2(r, g, b, CR_COEFS);
+      _mm_storeu_si128((__m128i *) (outptr0 + col), JSIMD_PACK16_AVX2(y));
+      _mm_storeu_si128((__m128i *) (outptr1 + col), JSIMD_PACK16_AVX2(cb));
+      _mm_storeu_si128((__m128i *) (outptr2 + col), JSIMD_PACK16_AVX2(cr));
+      if (col + 16 >= num_cols)
+	break;
+    }
+  }
+}
+
+#endif /* JSIMD_SUPPORTED */
+
+
 /**************** Cases other than RGB -> YCbCr **************/
 
 
@@ -422,6 +578,12 @@ jinit_color_converter (j_compress_ptr cinfo)
     if (cinfo->in_color_space == JCS_RGB) {
       cconvert->pub.start_pass = rgb_ycc_start;
       cconvert->pub.color_convert = rgb_ycc_convert;
+#ifdef JSIMD_SUPPORTED
+      if (jsimd_level() >= JSIMD_AVX2)
+	cconvert->pub.color_convert = rgb_ycc_convert_avx2;
+      else if (jsimd_level() >= JSIMD_SSE2)
+	cconvert->pub.color_convert = rgb_ycc_convert_sse2;
+#endif
     } else if (cinfo->in_color_space == JCS_YCbCr)
       cconvert->pub.color_convert = null_convert;
     else
@@ -15,6 +15,7 @@
 #include "jinclude.h"
 #include "jpeglib.h"
 #include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"		/* SIMD support */
 
 
 /* Private subobject for this module */
@@ -358,6 +359,12 @@ jinit_forward_dct (j_compress_ptr cinfo)
   case JDCT_ISLOW:
     fdct->pub.forward_DCT = forward_DCT;
     fdct->do_dct = jpeg_fdct_islow;
+#ifdef JSIMD_SUPPORTED
+    if (jsimd_level() >= JSIMD_AVX2)
+      fdct->do_dct = jpeg_fdct_islow_avx2;
+    else if (jsimd_level() >= JSIMD_SSE2)
+      fdct->do_dct = jpeg_fdct_islow_sse2;
+#endif
     break;
 #endif
 #ifdef DCT_IFAST_SUPPORTED
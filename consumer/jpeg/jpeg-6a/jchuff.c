@@ -835,6 +835,7 @@ jinit_huff_encoder (j_compress_ptr cinfo)
 				SIZEOF(huff_entropy_encoder));
   cinfo->entropy = (struct jpeg_entropy_encoder *) entropy;
   entropy->pub.start_pass = start_pass_huff;
+  entropy->pub.gather_iMCU_row = NULL;
 
   /* Mark tables unallocated */
   for (i = 0; i < NUM_HUFF_TBLS; i++) {
@@ -437,7 +437,7 @@ prepare_for_pass (j_compress_ptr cinfo)
   case output_pass:
     /* Do a data-output pass. */
     /* We need not repeat per-scan setup if prior optimization pass did it. */
-    if (! cinfo->optimize_coding) {
+    if (! cinfo->optimize_coding || master->pub.gather_all_scans) {
       select_scan_parameters(cinfo);
       per_scan_setup(cinfo);
     }
@@ -513,7 +513,7 @@ finish_pass_master (j_compress_ptr cinfo)
     break;
   case output_pass:
     /* next pass is either optimization or output of next scan */
-    if (cinfo->optimize_coding)
+    if (cinfo->optimize_coding && ! master->pub.gather_all_scans)
       master->pass_type = huff_opt_pass;
     master->scan_number++;
     break;
@@ -575,4 +575,18 @@ jinit_c_master_control (j_compress_ptr cinfo, boolean transcode_only)
     master->total_passes = cinfo->num_scans * 2;
   else
     master->total_passes = cinfo->num_scans;
+
+  /* A progressive Huffman encoder can gather the statistics of all scans
+   * during the main pass, since the whole coefficient image is passing
+   * through it then anyway.  That saves one pass over the coefficient
+   * buffer per scan.  (Not when transcoding: there is no main pass.)
+   */
+  master->pub.gather_all_scans = FALSE;
+#ifdef ENTROPY_OPT_SUPPORTED
+  if (! transcode_only && cinfo->progressive_mode &&
+      cinfo->optimize_coding && ! cinfo->arith_code) {
+    master->pub.gather_all_scans = TRUE;
+    master->total_passes = cinfo->num_scans + 1;
+  }
+#endif
 }
@@ -19,6 +19,31 @@
 
 #ifdef C_PROGRESSIVE_SUPPORTED
 
+/* When the master controller asks for it (gather_all_scans), the main pass
+ * gathers the statistics of every scan in the script, so that no separate
+ * optimization pass over the coefficient buffer is needed before each
+ * output pass.  Each scan then needs its own copy of the coding state
+ * that drives the symbol counts, and its own counts.
+ */
+
+typedef struct {
+  /* Scan parameters, and the layout per_scan_setup would compute */
+  int comps_in_scan;		/* # of components in scan */
+  jpeg_component_info * cur_comp_info[MAX_COMPS_IN_SCAN];
+  int Ss, Se, Ah, Al;		/* progressive JPEG parameters for scan */
+  JDIMENSION MCUs_per_row;	/* # of MCUs across the image */
+  unsigned int restart_interval; /* MCUs per restart interval, or 0 */
+
+  /* Coding status, as in the encoder object below */
+  int last_dc_val[MAX_COMPS_IN_SCAN]; /* last DC coef for each component */
+  unsigned int EOBRUN;		/* run length of EOBs */
+  unsigned int BE;		/* # of buffered correction bits before MCU */
+  unsigned int restarts_to_go;	/* MCUs left in this restart interval */
+
+  /* Statistics tables; only DC or only AC ones are used in one scan */
+  long * count_ptrs[NUM_HUFF_TBLS];
+} phuff_scan_stats;
+
 /* Expanded entropy encoder object for progressive Huffman encoding. */
 
 typedef struct {
@@ -57,6 +82,13 @@ typedef struct {
 
   /* Statistics tables for optimization; again, one set is enough */
   long * count_ptrs[NUM_HUFF_TBLS];
+
+  /* Per-scan statistics if the main pass gathers them for all scans */
+  phuff_scan_stats * scan_stats;	/* NULL if not used */
+  int next_scan;		/* index of scan for next output pass */
+
+  /* Position of each zigzag-order coefficient within a block */
+  const int * coef_order;
 } phuff_entropy_encoder;
 
 typedef phuff_entropy_encoder * phuff_entropy_ptr;
@@ -85,6 +117,19 @@ typedef phuff_entropy_encoder * phuff_entropy_ptr;
 #define IRIGHT_SHIFT(x,shft)	((x) >> (shft))
 #endif
 
+#ifdef ENTROPY_OPT_SUPPORTED
+/* When the main pass gathers statistics for all scans, it also reorders
+ * each block of the coefficient buffer into zigzag order, so that a
+ * spectral band is contiguous in memory for every later scan.
+ */
+static const int zigzag_order[DCTSIZE2] = {
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+  16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+  32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+  48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63
+};
+#endif
+
 /* Forward declarations */
 METHODDEF(boolean) encode_mcu_DC_first JPP((j_compress_ptr cinfo,
 					    JBLOCKROW *MCU_data));
@@ -96,6 +141,14 @@ METHODDEF(boolean) encode_mcu_AC_refine JPP((j_compress_ptr cinfo,
 					     JBLOCKROW *MCU_data));
 METHODDEF(void) finish_pass_phuff JPP((j_compress_ptr cinfo));
 METHODDEF(void) finish_pass_gather_phuff JPP((j_compress_ptr cinfo));
+#ifdef ENTROPY_OPT_SUPPORTED
+LOCAL(void) start_gather_all JPP((j_compress_ptr cinfo));
+LOCAL(void) install_scan_tables JPP((j_compress_ptr cinfo));
+METHODDEF(void) gather_iMCU_row_phuff JPP((j_compress_ptr cinfo,
+					   JBLOCKARRAY * buffer,
+					   JDIMENSION iMCU_row));
+METHODDEF(void) finish_pass_gather_all JPP((j_compress_ptr cinfo));
+#endif
 
 
 /*
@@ -112,6 +165,21 @@ start_pass_phuff (j_compress_ptr cinfo, boolean gather_statistics)
 
   entropy->cinfo = cinfo;
   entropy->gather_statistics = gather_statistics;
+  entropy->pub.gather_iMCU_row = NULL;
+  entropy->coef_order = jpeg_natural_order;
+
+#ifdef ENTROPY_OPT_SUPPORTED
+  if (cinfo->master->gather_all_scans) {
+    entropy->coef_order = zigzag_order;
+    if (gather_statistics) {
+      /* This is the main pass: set up to gather for every scan */
+      start_gather_all(cinfo);
+      return;
+    }
+    /* An output pass: make this scan's tables from its statistics */
+    install_scan_tables(cinfo);
+  }
+#endif
 
   is_DC_band = (cinfo->Ss == 0);
 
@@ -307,10 +375,17 @@ emit_buffered_bits (phuff_entropy_ptr entropy, char * bufstart,
   if (entropy->gather_statistics)
     return;			/* no real work */
 
+  /* Pack the bits into chunks of up to 16 so emit_bits runs once per chunk */
   while (nbits > 0) {
-    emit_bits(entropy, (unsigned int) (*bufstart), 1);
-    bufstart++;
-    nbits--;
+    unsigned int chunk = 0;
+    int size = (nbits > 16) ? 16 : (int) nbits;
+    int i;
+
+    for (i = 0; i < size; i++)
+      chunk = (chunk << 1) | (unsigned int) (bufstart[i] & 1);
+    emit_bits(entropy, chunk, size);
+    bufstart += size;
+    nbits -= size;
   }
 }
 
@@ -468,6 +543,7 @@ encode_mcu_AC_first (j_compress_ptr cinfo, JBLOCKROW *MCU_data)
   register int r, k;
   int Se = cinfo->Se;
   int Al = cinfo->Al;
+  const int * coef_order = entropy->coef_order;
   JBLOCKROW block;
 
   entropy->next_output_byte = cinfo->dest->next_output_byte;
@@ -486,7 +562,7 @@ encode_mcu_AC_first (j_compress_ptr cinfo, JBLOCKROW *MCU_data)
   r = 0;			/* r = run length of zeros */
    
   for (k = cinfo->Ss; k <= Se; k++) {
-    if ((temp = (*block)[jpeg_natural_order[k]]) == 0) {
+    if ((temp = (*block)[coef_order[k]]) == 0) {
       r++;
       continue;
     }
@@ -621,6 +697,7 @@ encode_mcu_AC_refine (j_compress_ptr cinfo, JBLOCKROW *MCU_data)
   unsigned int BR;
   int Se = cinfo->Se;
   int Al = cinfo->Al;
+  const int * coef_order = entropy->coef_order;
   JBLOCKROW block;
   int absvalues[DCTSIZE2];
 
@@ -640,7 +717,7 @@ encode_mcu_AC_refine (j_compress_ptr cinfo, JBLOCKROW *MCU_data)
    */
   EOB = 0;
   for (k = cinfo->Ss; k <= Se; k++) {
-    temp = (*block)[jpeg_natural_order[k]];
+    temp = (*block)[coef_order[k]];
     /* We must apply the point transform by Al.  For AC coefficients this
      * is an integer division with rounding towards 0.  To do this portably
      * in C, we shift after obtaining the absolute value.
@@ -696,7 +773,7 @@ encode_mcu_AC_refine (j_compress_ptr cinfo, JBLOCKROW *MCU_data)
     emit_symbol(entropy, entropy->ac_tbl_no, (r << 4) + 1);
 
     /* Emit output bit for newly-nonzero coef */
-    temp = ((*block)[jpeg_natural_order[k]] < 0) ? 0 : 1;
+    temp = ((*block)[coef_order[k]] < 0) ? 0 : 1;
     emit_bits(entropy, (unsigned int) temp, 1);
 
     /* Emit buffered correction bits that must be associated with this code */
@@ -802,6 +879,399 @@ finish_pass_gather_phuff (j_compress_ptr cinfo)
 }
 
 
+#ifdef ENTROPY_OPT_SUPPORTED
+
+/*
+ * Gathering statistics for all scans during the main pass.
+ *
+ * The routines below count exactly the symbols the encode_mcu routines
+ * above would emit for each scan, so the tables come out the same as with
+ * one optimization pass per scan.  They must be kept in step with them.
+ * The coefficients of an iMCU row are still in cache when they arrive
+ * here from the forward DCT, and are visited once for all scans.
+ */
+
+LOCAL(void)
+start_gather_all (j_compress_ptr cinfo)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+  const jpeg_scan_info * scanptr;
+  phuff_scan_stats * stats;
+  jpeg_component_info * compptr;
+  int scan, ci, tbl;
+  long nominal;
+
+  stats = (phuff_scan_stats *)
+    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				cinfo->num_scans * SIZEOF(phuff_scan_stats));
+  MEMZERO(stats, cinfo->num_scans * SIZEOF(phuff_scan_stats));
+  entropy->scan_stats = stats;
+  entropy->next_scan = 0;
+
+  for (scan = 0, scanptr = cinfo->scan_info; scan < cinfo->num_scans;
+       scan++, scanptr++, stats++) {
+    stats->comps_in_scan = scanptr->comps_in_scan;
+    for (ci = 0; ci < scanptr->comps_in_scan; ci++)
+      stats->cur_comp_info[ci] =
+	&cinfo->comp_info[scanptr->component_index[ci]];
+    stats->Ss = scanptr->Ss;
+    stats->Se = scanptr->Se;
+    stats->Ah = scanptr->Ah;
+    stats->Al = scanptr->Al;
+    /* Same MCU layout and restart interval as per_scan_setup in jcmaster.c */
+    if (stats->comps_in_scan == 1)
+      stats->MCUs_per_row = stats->cur_comp_info[0]->width_in_blocks;
+    else
+      stats->MCUs_per_row = (JDIMENSION)
+	jdiv_round_up((long) cinfo->image_width,
+		      (long) (cinfo->max_h_samp_factor*DCTSIZE));
+    stats->restart_interval = cinfo->restart_interval;
+    if (cinfo->restart_in_rows > 0) {
+      nominal = (long) cinfo->restart_in_rows * (long) stats->MCUs_per_row;
+      stats->restart_interval = (unsigned int) MIN(nominal, 65535L);
+    }
+    stats->restarts_to_go = stats->restart_interval;
+
+    /* Allocate and zero the statistics tables, as start_pass_phuff does */
+    if (stats->Ss == 0 && stats->Ah != 0)
+      continue;			/* DC refinement needs no table */
+    for (ci = 0; ci < stats->comps_in_scan; ci++) {
+      compptr = stats->cur_comp_info[ci];
+      tbl = (stats->Ss == 0) ? compptr->dc_tbl_no : compptr->ac_tbl_no;
+      if (tbl < 0 || tbl >= NUM_HUFF_TBLS)
+	ERREXIT1(cinfo, JERR_NO_HUFF_TABLE, tbl);
+      if (stats->count_ptrs[tbl] == NULL) {
+	stats->count_ptrs[tbl] = (long *)
+	  (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				      257 * SIZEOF(long));
+	MEMZERO(stats->count_ptrs[tbl], 257 * SIZEOF(long));
+      }
+    }
+  }
+
+  entropy->pub.gather_iMCU_row = gather_iMCU_row_phuff;
+  entropy->pub.finish_pass = finish_pass_gather_all;
+}
+
+
+/* Count any pending EOBRUN symbol, like emit_eobrun */
+
+LOCAL(void)
+count_eobrun (phuff_scan_stats * stats)
+{
+  register int temp, nbits;
+
+  if (stats->EOBRUN > 0) {
+    temp = stats->EOBRUN;
+    nbits = 0;
+    while ((temp >>= 1))
+      nbits++;
+    stats->count_ptrs[stats->cur_comp_info[0]->ac_tbl_no][nbits << 4]++;
+    stats->EOBRUN = 0;
+    stats->BE = 0;
+  }
+}
+
+
+/* Count the symbols of one block of a DC initial scan */
+
+INLINE
+LOCAL(void)
+count_DC_first (phuff_scan_stats * stats, JBLOCKROW block, int ci)
+{
+  register int temp, temp2;
+  register int nbits;
+  ISHIFT_TEMPS
+
+  temp2 = IRIGHT_SHIFT((int) ((*block)[0]), stats->Al);
+  temp = temp2 - stats->last_dc_val[ci];
+  stats->last_dc_val[ci] = temp2;
+  if (temp < 0)
+    temp = -temp;
+  nbits = 0;
+  while (temp) {
+    nbits++;
+    temp >>= 1;
+  }
+  stats->count_ptrs[stats->cur_comp_info[ci]->dc_tbl_no][nbits]++;
+}
+
+
+/* Count the symbols of one block of an AC initial scan */
+
+INLINE
+LOCAL(void)
+count_AC_first (phuff_scan_stats * stats, JBLOCKROW block, long * counts)
+{
+  register int temp;
+  register int nbits;
+  register int r, k;
+  int Se = stats->Se;
+  int Al = stats->Al;
+
+  int absvalues[DCTSIZE2];
+  int last;
+
+  last = stats->Ss - 1;
+  for (k = stats->Ss; k <= Se; k++) {
+    temp = (*block)[k];		/* block is in zigzag order here */
+    if (temp < 0)
+      temp = -temp;
+    temp >>= Al;
+    absvalues[k] = temp;
+    if (temp)
+      last = k;
+  }
+
+  r = 0;
+  for (k = stats->Ss; k <= last; k++) {
+    if ((temp = absvalues[k]) == 0) {
+      r++;
+      continue;
+    }
+    if (stats->EOBRUN > 0)
+      count_eobrun(stats);
+    while (r > 15) {
+      counts[0xF0]++;
+      r -= 16;
+    }
+    nbits = 1;
+    while ((temp >>= 1))
+      nbits++;
+    counts[(r << 4) + nbits]++;
+    r = 0;
+  }
+
+  if (last < Se) {
+    stats->EOBRUN++;
+    if (stats->EOBRUN == 0x7FFF)
+      count_eobrun(stats);
+  }
+}
+
+
+/* Count the symbols of one block of an AC refinement scan */
+
+INLINE
+LOCAL(void)
+count_AC_refine (phuff_scan_stats * stats, JBLOCKROW block, long * counts)
+{
+  register int temp;
+  register int r, k;
+  int EOB;
+  unsigned int BR;
+  int Se = stats->Se;
+  int Al = stats->Al;
+  int absvalues[DCTSIZE2];
+
+  EOB = 0;
+  for (k = stats->Ss; k <= Se; k++) {
+    temp = (*block)[k];		/* block is in zigzag order here */
+    if (temp < 0)
+      temp = -temp;
+    temp >>= Al;
+    absvalues[k] = temp;
+    if (temp == 1)
+      EOB = k;
+  }
+
+  r = 0;
+  BR = 0;
+  for (k = stats->Ss; k <= Se; k++) {
+    if ((temp = absvalues[k]) == 0) {
+      r++;
+      continue;
+    }
+    while (r > 15 && k <= EOB) {
+      count_eobrun(stats);
+      counts[0xF0]++;
+      r -= 16;
+      BR = 0;
+    }
+    if (temp > 1) {
+      BR++;			/* just a correction bit */
+      continue;
+    }
+    count_eobrun(stats);
+    counts[(r << 4) + 1]++;
+    BR = 0;
+    r = 0;
+  }
+
+  if (r > 0 || BR > 0) {
+    stats->EOBRUN++;
+    stats->BE += BR;
+    if (stats->EOBRUN == 0x7FFF || stats->BE > (MAX_CORR_BITS-DCTSIZE2+1))
+      count_eobrun(stats);
+  }
+}
+
+
+/* Reorder the coefficients of some blocks into zigzag order, in place */
+
+LOCAL(void)
+reorder_blocks (JBLOCKROW thisblockrow, JDIMENSION num_blocks)
+{
+  JBLOCK workspace;
+  register JCOEFPTR block;
+  register int k;
+
+  for (; num_blocks > 0; num_blocks--, thisblockrow++) {
+    block = *thisblockrow;
+    for (k = 0; k < DCTSIZE2; k++)
+      workspace[k] = block[jpeg_natural_order[k]];
+    MEMCOPY(block, workspace, SIZEOF(JBLOCK));
+  }
+}
+
+
+/*
+ * Count the symbols of all scans for one iMCU row.
+ * buffer[ci] holds the v_samp_factor block rows of component ci,
+ * including the dummy blocks made by the coefficient controller.
+ * The blocks are first put into zigzag order for the output passes.
+ */
+
+METHODDEF(void)
+gather_iMCU_row_phuff (j_compress_ptr cinfo, JBLOCKARRAY * buffer,
+		       JDIMENSION iMCU_row)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+  phuff_scan_stats * stats;
+  jpeg_component_info * compptr;
+  JBLOCKROW thisblockrow;
+  long * counts;
+  JDIMENSION MCU_col_num;
+  int scan, ci, xindex, yindex, block_rows;
+
+  /* Dummy blocks need no reordering; only their DC coefficient is used */
+  for (ci = 0, compptr = cinfo->comp_info; ci < cinfo->num_components;
+       ci++, compptr++) {
+    for (yindex = 0; yindex < compptr->v_samp_factor; yindex++)
+      reorder_blocks(buffer[ci][yindex], compptr->width_in_blocks);
+  }
+
+  for (scan = 0, stats = entropy->scan_stats; scan < cinfo->num_scans;
+       scan++, stats++) {
+    if (stats->Ss == 0 && stats->Ah != 0)
+      continue;			/* DC refinement scans have nothing to count */
+
+    if (stats->comps_in_scan == 1) {
+      /* Noninterleaved scan: one block per MCU, real blocks only */
+      compptr = stats->cur_comp_info[0];
+      block_rows = compptr->v_samp_factor;
+      if (iMCU_row == cinfo->total_iMCU_rows - 1) {
+	block_rows = (int) (compptr->height_in_blocks % compptr->v_samp_factor);
+	if (block_rows == 0) block_rows = compptr->v_samp_factor;
+      }
+      counts = stats->count_ptrs[compptr->ac_tbl_no];
+      for (yindex = 0; yindex < block_rows; yindex++) {
+	thisblockrow = buffer[compptr->component_index][yindex];
+	for (MCU_col_num = 0; MCU_col_num < stats->MCUs_per_row;
+	     MCU_col_num++, thisblockrow++) {
+	  if (stats->restart_interval) {
+	    if (stats->restarts_to_go == 0) {
+	      count_eobrun(stats);	/* as emit_restart would */
+	      stats->last_dc_val[0] = 0;
+	      stats->restarts_to_go = stats->restart_interval;
+	    }
+	    stats->restarts_to_go--;
+	  }
+	  if (stats->Ss == 0)
+	    count_DC_first(stats, thisblockrow, 0);
+	  else if (stats->Ah == 0)
+	    count_AC_first(stats, thisblockrow, counts);
+	  else
+	    count_AC_refine(stats, thisblockrow, counts);
+	}
+      }
+    } else {
+      /* Interleaved DC scan: one MCU row, dummy blocks included */
+      for (MCU_col_num = 0; MCU_col_num < stats->MCUs_per_row;
+	   MCU_col_num++) {
+	if (stats->restart_interval) {
+	  if (stats->restarts_to_go == 0) {
+	    for (ci = 0; ci < stats->comps_in_scan; ci++)
+	      stats->last_dc_val[ci] = 0;
+	    stats->restarts_to_go = stats->restart_interval;
+	  }
+	  stats->restarts_to_go--;
+	}
+	for (ci = 0; ci < stats->comps_in_scan; ci++) {
+	  compptr = stats->cur_comp_info[ci];
+	  for (yindex = 0; yindex < compptr->v_samp_factor; yindex++) {
+	    thisblockrow = buffer[compptr->component_index][yindex] +
+			   MCU_col_num * compptr->h_samp_factor;
+	    for (xindex = 0; xindex < compptr->h_samp_factor; xindex++)
+	      count_DC_first(stats, thisblockrow++, ci);
+	  }
+	}
+      }
+    }
+  }
+}
+
+
+/*
+ * Finish up the main pass: count the EOBRUNs still pending at the end
+ * of each scan.  The tables are made just before each output pass.
+ */
+
+METHODDEF(void)
+finish_pass_gather_all (j_compress_ptr cinfo)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+  int scan;
+
+  for (scan = 0; scan < cinfo->num_scans; scan++) {
+    if (entropy->scan_stats[scan].Ss != 0)
+      count_eobrun(&entropy->scan_stats[scan]);
+  }
+}
+
+
+/*
+ * Create the Huffman tables for the scan about to be output from the
+ * statistics gathered for it in the main pass.
+ */
+
+LOCAL(void)
+install_scan_tables (j_compress_ptr cinfo)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+  phuff_scan_stats * stats = &entropy->scan_stats[entropy->next_scan++];
+  boolean is_DC_band;
+  int ci, tbl;
+  jpeg_component_info * compptr;
+  JHUFF_TBL **htblptr;
+  boolean did[NUM_HUFF_TBLS];
+
+  is_DC_band = (stats->Ss == 0);
+  if (is_DC_band && stats->Ah != 0)
+    return;			/* DC refinement needs no table */
+
+  /* As in finish_pass_gather_phuff, only once per table */
+  MEMZERO(did, SIZEOF(did));
+
+  for (ci = 0; ci < stats->comps_in_scan; ci++) {
+    compptr = stats->cur_comp_info[ci];
+    tbl = is_DC_band ? compptr->dc_tbl_no : compptr->ac_tbl_no;
+    if (! did[tbl]) {
+      if (is_DC_band)
+        htblptr = & cinfo->dc_huff_tbl_ptrs[tbl];
+      else
+        htblptr = & cinfo->ac_huff_tbl_ptrs[tbl];
+      if (*htblptr == NULL)
+        *htblptr = jpeg_alloc_huff_table((j_common_ptr) cinfo);
+      jpeg_gen_optimal_table(cinfo, *htblptr, stats->count_ptrs[tbl]);
+      did[tbl] = TRUE;
+    }
+  }
+}
+
+#endif /* ENTROPY_OPT_SUPPORTED */
+
+
 /*
  * Module initialization routine for progressive Huffman entropy encoding.
  */
@@ -824,6 +1294,8 @@ jinit_phuff_encoder (j_compress_ptr cinfo)
     entropy->count_ptrs[i] = NULL;
   }
   entropy->bit_buffer = NULL;	/* needed only in AC refinement scan */
+  entropy->scan_stats = NULL;
+  entropy->pub.gather_iMCU_row = NULL;
 }
 
 #endif /* C_PROGRESSIVE_SUPPORTED */
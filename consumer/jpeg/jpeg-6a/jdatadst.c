@@ -6,9 +6,9 @@
  * For conditions of distribution and use, see the accompanying README file.
  *
  * This file contains compression data destination routines for the case of
- * emitting JPEG data to a file (or any stdio stream).  While these routines
- * are sufficient for most applications, some will want to use a different
- * destination manager.
+ * emitting JPEG data to a file (or any stdio stream), or to a buffer in
+ * memory.  While these routines are sufficient for most applications,
+ * some will want to use a different destination manager.
  * IMPORTANT: we assume that fwrite() will correctly transcribe an array of
  * JOCTETs into 8-bit-wide elements on external storage.  If char is wider
  * than 8 bits on your machine, you may need to do some tweaking.
@@ -149,3 +149,122 @@ jpeg_stdio_dest (j_compress_ptr cinfo, FILE * outfile)
   dest->pub.term_destination = term_destination;
   dest->outfile = outfile;
 }
+
+
+/*
+ * Memory destination: the datastream is collected in a malloc'd buffer that
+ * is doubled in size whenever it fills up.
+ */
+
+typedef struct {
+  struct jpeg_destination_mgr pub; /* public fields */
+
+  unsigned char ** outbuffer;	/* application's buffer pointer */
+  unsigned long * outsize;	/* and size */
+  JOCTET * buffer;		/* start of current buffer */
+  size_t bufsize;		/* its size */
+  JOCTET * newbuffer;		/* buffer we allocated, or NULL */
+} my_mem_destination_mgr;
+
+typedef my_mem_destination_mgr * my_mem_dest_ptr;
+
+
+METHODDEF(void)
+init_mem_destination (j_compress_ptr cinfo)
+{
+  /* no work necessary here */
+}
+
+
+METHODDEF(boolean)
+empty_mem_output_buffer (j_compress_ptr cinfo)
+{
+  my_mem_dest_ptr dest = (my_mem_dest_ptr) cinfo->dest;
+  size_t nextsize = dest->bufsize * 2;
+  JOCTET * nextbuffer;
+
+  /* We may grow a buffer we allocated in place; the application's own
+   * buffer must be left alone, so the data is copied out of it once.
+   */
+  if (dest->newbuffer != NULL)
+    nextbuffer = (JOCTET *) realloc(dest->newbuffer, nextsize);
+  else {
+    nextbuffer = (JOCTET *) malloc(nextsize);
+    if (nextbuffer != NULL)
+      MEMCOPY(nextbuffer, dest->buffer, dest->bufsize);
+  }
+  if (nextbuffer == NULL)
+    ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 10);
+
+  /* Keep the application's pointer current, so it can free the buffer
+   * even if compression is aborted.
+   */
+  *dest->outbuffer = (unsigned char *) nextbuffer;
+  dest->newbuffer = nextbuffer;
+  dest->pub.next_output_byte = nextbuffer + dest->bufsize;
+  dest->pub.free_in_buffer = dest->bufsize;
+  dest->buffer = nextbuffer;
+  dest->bufsize = nextsize;
+
+  return TRUE;
+}
+
+
+METHODDEF(void)
+term_mem_destination (j_compress_ptr cinfo)
+{
+  my_mem_dest_ptr dest = (my_mem_dest_ptr) cinfo->dest;
+
+  *dest->outbuffer = (unsigned char *) dest->buffer;
+  *dest->outsize = (unsigned long) (dest->bufsize - dest->pub.free_in_buffer);
+}
+
+
+/*
+ * Prepare for output to a memory buffer.
+ * If *outbuffer is NULL or *outsize is zero, an initial buffer is
+ * allocated; otherwise writing starts in the application's buffer of
+ * *outsize bytes.  Whenever the buffer fills up, a larger one is malloc'd.
+ * After jpeg_finish_compress, *outbuffer and *outsize describe the
+ * datastream.  If *outbuffer then differs from the buffer passed in (which
+ * also holds after an error exit), the application must free() it.
+ */
+
+GLOBAL(void)
+jpeg_mem_dest (j_compress_ptr cinfo,
+	       unsigned char ** outbuffer, unsigned long * outsize)
+{
+  my_mem_dest_ptr dest;
+
+  if (outbuffer == NULL || outsize == NULL)
+    ERREXIT(cinfo, JERR_BUFFER_SIZE);
+
+  /* As with jpeg_stdio_dest, the destination object is made permanent,
+   * and it is dangerous to use this manager and a different destination
+   * manager serially with the same JPEG object.
+   */
+  if (cinfo->dest == NULL) {	/* first time for this JPEG object? */
+    cinfo->dest = (struct jpeg_destination_mgr *)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+				  SIZEOF(my_mem_destination_mgr));
+  }
+
+  dest = (my_mem_dest_ptr) cinfo->dest;
+  dest->pub.init_destination = init_mem_destination;
+  dest->pub.empty_output_buffer = empty_mem_output_buffer;
+  dest->pub.term_destination = term_mem_destination;
+  dest->outbuffer = outbuffer;
+  dest->outsize = outsize;
+  dest->newbuffer = NULL;
+
+  if (*outbuffer == NULL || *outsize == 0) {
+    dest->newbuffer = (JOCTET *) malloc(OUTPUT_BUF_SIZE);
+    if (dest->newbuffer == NULL)
+      ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 10);
+    *outbuffer = (unsigned char *) dest->newbuffer;
+    *outsize = OUTPUT_BUF_SIZE;
+  }
+
+  dest->pub.next_output_byte = dest->buffer = (JOCTET *) *outbuffer;
+  dest->pub.free_in_buffer = dest->bufsize = (size_t) *outsize;
+}
@@ -11,6 +11,7 @@
 #define JPEG_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jsimd.h"		/* SIMD support */
 
 
 /* Private subobject */
@@ -157,6 +158,103 @@ ycc_rgb_convert (j_decompress_ptr cinfo,
 }
 
 
+#ifdef JSIMD_SUPPORTED
+
+/*
+ * SSE2 and AVX2 versions of ycc_rgb_convert, 16 pixels at a time.  The
+ * chroma terms are computed as exactly as the tables hold them (see
+ * jsimd.h), and saturating to 0..MAXJSAMPLE does what range_limit does
+ * for these sums, so the outputs are identical.  The last pixels of a
+ * row are done by converting the row's last 16 pixels again; images
+ * narrower than that are left to ycc_rgb_convert.
+ */
+
+METHODDEF(void)
+ycc_rgb_convert_sse2 (j_decompress_ptr cinfo,
+		      JSAMPIMAGE input_buf, JDIMENSION input_row,
+		      JSAMPARRAY output_buf, int num_rows)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i y, cb, cr, crl, cgl, cbl, crh, cgh, cbh, yl, yh;
+  register JSAMPROW outptr;
+  register JSAMPROW inptr0, inptr1, inptr2;
+  JDIMENSION col;
+  JDIMENSION num_cols = cinfo->output_width;
+
+  if (num_cols < 16) {
+    ycc_rgb_convert(cinfo, input_buf, input_row, output_buf, num_rows);
+    return;
+  }
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = *output_buf++;
+    for (col = 0; ; col += 16) {
+      if (col > num_cols - 16)
+	col = num_cols - 16;
+      y = _mm_loadu_si128((__m128i *) (inptr0 + col));
+      cb = _mm_loadu_si128((__m128i *) (inptr1 + col));
+      cr = _mm_loadu_si128((__m128i *) (inptr2 + col));
+      jsimd_ycc_chroma_sse2(_mm_unpacklo_epi8(cb, zero),
+			    _mm_unpacklo_epi8(cr, zero), &crl, &cgl, &cbl);
+      jsimd_ycc_chroma_sse2(_mm_unpackhi_epi8(cb, zero),
+			    _mm_unpackhi_epi8(cr, zero), &crh, &cgh, &cbh);
+      yl = _mm_unpacklo_epi8(y, zero);
+      yh = _mm_unpackhi_epi8(y, zero);
+      jsimd_store_rgb_sse2(outptr + col * RGB_PIXELSIZE,
+	_mm_packus_epi16(_mm_add_epi16(yl, crl), _mm_add_epi16(yh, crh)),
+	_mm_packus_epi16(_mm_add_epi16(yl, cgl), _mm_add_epi16(yh, cgh)),
+	_mm_packus_epi16(_mm_add_epi16(yl, cbl), _mm_add_epi16(yh, cbh)));
+      if (col + 16 >= num_cols)
+	break;
+    }
+  }
+}
+
+JSIMD_AVX2_TARGET METHODDEF(void)
+ycc_rgb_convert_avx2 (j_decompress_ptr cinfo,
+		      JSAMPIMAGE input_buf, JDIMENSION input_row,
+		      JSAMPARRAY output_buf, int num_rows)
+{
+  __m256i y, cred, cgreen, cblue;
+  register JSAMPROW outptr;
+  register JSAMPROW inptr0, inptr1, inptr2;
+  JDIMENSION col;
+  JDIMENSION num_cols = cinfo->output_width;
+
+  if (num_cols < 16) {
+    ycc_rgb_convert(cinfo, input_buf, input_row, output_buf, num_rows);
+    return;
+  }
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = *output_buf++;
+    for (col = 0; ; col += 16) {
+      if (col > num_cols - 16)
+	col = num_cols - 16;
+      jsimd_ycc_chroma_avx2(
+	_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (inptr1 + col))),
+	_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (inptr2 + col))),
+	&cred, &cgreen, &cblue);
+      y = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (inptr0 + col)));
+      jsimd_store_rgb_avx2(outptr + col * RGB_PIXELSIZE,
+			   JSIMD_PACK16_AVX2(_mm256_add_epi16(y, cred)),
+			   JSIMD_PACK16_AVX2(_mm256_add_epi16(y, cgreen)),
+			   JSIMD_PACK16_AVX2(_mm256_add_epi16(y, cblue)));
+      if (col + 16 >= num_cols)
+	break;
+    }
+  }
+}
+
+#endif /* JSIMD_SUPPORTED */
+
+
 /**************** Cases other than YCbCr -> RGB **************/
 
 
@@ -332,6 +430,12 @@ jinit_color_deconverter (j_decompress_ptr cinfo)
     cinfo->out_color_components = RGB_PIXELSIZE;
     if (cinfo->jpeg_color_space == JCS_YCbCr) {
       cconvert->pub.color_convert = ycc_rgb_convert;
+#ifdef JSIMD_SUPPORTED
+      if (jsimd_level() >= JSIMD_AVX2)
+	cconvert->pub.color_convert = ycc_rgb_convert_avx2;
+      else if (jsimd_level() >= JSIMD_SSE2)
+	cconvert->pub.color_convert = ycc_rgb_convert_sse2;
+#endif
       build_ycc_rgb_table(cinfo);
     } else if (cinfo->jpeg_color_space == JCS_RGB && RGB_PIXELSIZE == 3) {
       cconvert->pub.color_convert = null_convert;
@@ -19,6 +19,7 @@
 #include "jinclude.h"
 #include "jpeglib.h"
 #include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"		/* SIMD support */
 
 
 /*
@@ -118,6 +119,12 @@ start_pass (j_decompress_ptr cinfo)
 #ifdef DCT_ISLOW_SUPPORTED
       case JDCT_ISLOW:
 	method_ptr = jpeg_idct_islow;
+#ifdef JSIMD_SUPPORTED
+	if (jsimd_level() >= JSIMD_AVX2)
+	  method_ptr = jpeg_idct_islow_avx2;
+	else if (jsimd_level() >= JSIMD_SSE2)
+	  method_ptr = jpeg_idct_islow_sse2;
+#endif
 	method = JDCT_ISLOW;
 	break;
 #endif
@@ -119,6 +119,32 @@ start_pass_huff_decoder (j_decompress_ptr cinfo)
 }
 
 
+/*
+ * Finish up at the end of a Huffman-compressed scan.
+ */
+
+METHODDEF(void)
+finish_pass_huff_decoder (j_decompress_ptr cinfo)
+{
+  huff_entropy_ptr entropy = (huff_entropy_ptr) cinfo->entropy;
+
+  /* Throw away any unused bits remaining in bit buffer; */
+  /* include any full bytes in next_marker's count of discarded bytes, */
+  /* unless they are zeroes stuffed in at a premature marker */
+  if (! entropy->bitstate.printed_eod)
+    cinfo->marker->discarded_bytes += entropy->bitstate.bits_left / 8;
+  entropy->bitstate.bits_left = 0;
+
+  /* If we have read up to the marker already, next_marker won't be */
+  /* called to report them; do it here */
+  if (cinfo->unread_marker != 0 && cinfo->marker->discarded_bytes != 0) {
+    WARNMS2(cinfo, JWRN_EXTRANEOUS_DATA, cinfo->marker->discarded_bytes,
+	    cinfo->unread_marker);
+    cinfo->marker->discarded_bytes = 0;
+  }
+}
+
+
 /*
  * Compute the derived values for a Huffman table.
  * Note this is also used by jdphuff.c.
@@ -129,8 +155,8 @@ jpeg_make_d_derived_tbl (j_decompress_ptr cinfo, JHUFF_TBL * htbl,
 			 d_derived_tbl ** pdtbl)
 {
   d_derived_tbl *dtbl;
-  int p, i, l, si;
-  int lookbits, ctr;
+  int p, i, l, si, s;
+  int lookbits, ctr, extra;
   char huffsize[257];
   unsigned int huffcode[257];
   unsigned int code;
@@ -187,10 +213,12 @@ jpeg_make_d_derived_tbl (j_decompress_ptr cinfo, JHUFF_TBL * htbl,
    * First we set all the table entries to 0, indicating "too long";
    * then we iterate through the Huffman codes that are short enough and
    * fill in all the entries that correspond to bit sequences starting
-   * with that code.
+   * with that code.  Where the code's extra bits are among those bit
+   * sequences too, the combined tables get their value as well.
    */
 
   MEMZERO(dtbl->look_nbits, SIZEOF(dtbl->look_nbits));
+  MEMZERO(dtbl->look_total, SIZEOF(dtbl->look_total));
 
   p = 0;
   for (l = 1; l <= HUFF_LOOKAHEAD; l++) {
@@ -199,8 +227,16 @@ jpeg_make_d_derived_tbl (j_decompress_ptr cinfo, JHUFF_TBL * htbl,
       /* Generate left-justified code followed by all possible bit sequences */
       lookbits = huffcode[p] << (HUFF_LOOKAHEAD-l);
       for (ctr = 1 << (HUFF_LOOKAHEAD-l); ctr > 0; ctr--) {
-	dtbl->look_nbits[lookbits] = l;
+	dtbl->look_nbits[lookbits] = (UINT8) l;
 	dtbl->look_sym[lookbits] = htbl->huffval[p];
+	s = htbl->huffval[p] & 15;
+	if (l + s <= HUFF_LOOKAHEAD) {
+	  extra = (lookbits >> (HUFF_LOOKAHEAD-l-s)) & ((1<<s)-1);
+	  if (s && extra < (1<<(s-1)))	/* Figure F.12: extend sign bit */
+	    extra -= (1<<s) - 1;
+	  dtbl->look_total[lookbits] = (UINT8) (l + s);
+	  dtbl->look_value[lookbits] = (INT16) extra;
+	}
 	lookbits++;
       }
     }
@@ -215,8 +251,7 @@ jpeg_make_d_derived_tbl (j_decompress_ptr cinfo, JHUFF_TBL * htbl,
  * but are returned in the corresponding fields of the state struct.
  *
  * On most machines MIN_GET_BITS should be 25 to allow the full 32-bit width
- * of get_buffer to be used.  (On machines with wider words, an even larger
- * buffer could be used.)  However, on some machines 32-bit shifts are
+ * of get_buffer to be used (57 for a 64-bit get_buffer).  However, on some machines 32-bit shifts are
  * quite slow and take time proportional to the number of places shifted.
  * (This is true with most PC compilers, for instance.)  In this case it may
  * be a win to set MIN_GET_BITS to the minimum value of 15.  This reduces the
@@ -240,6 +275,31 @@ jpeg_fill_bit_buffer (bitread_working_state * state,
   register const JOCTET * next_input_byte = state->next_input_byte;
   register size_t bytes_in_buffer = state->bytes_in_buffer;
   register int c;
+#if BIT_BUF_SIZE == 64
+  register bit_buf_type w;
+  register int n;
+
+  /* Fast path: if the next 8 bytes contain no 0xFF, there is neither a
+   * stuffed zero byte nor a marker among them, and we can shift in at once
+   * the bytes that the loop below would read one at a time; stopping on
+   * the same byte keeps the count of bytes discarded at a marker the same.
+   */
+  if (state->unread_marker == 0 && bytes_in_buffer >= 8) {
+    w = 0;
+    for (n = 0; n < 8; n++)
+      w = (w << 8) | GETJOCTET(next_input_byte[n]);
+    if (((~w - 0x0101010101010101UL) & w & 0x8080808080808080UL) == 0) {
+      n = (MIN_GET_BITS + 7 - bits_left) >> 3; /* 1..8 bytes */
+      if (n == 8)
+	get_buffer = w;
+      else
+	get_buffer = (get_buffer << (n << 3)) | (w >> (64 - (n << 3)));
+      bits_left += n << 3;
+      next_input_byte += n;
+      bytes_in_buffer -= n;
+    }
+  }
+#endif
 
   /* Attempt to load at least MIN_GET_BITS bits into get_buffer. */
   /* (It is assumed that no request will be for more than that many bits.) */
@@ -327,7 +387,25 @@ jpeg_huff_decode (bitread_working_state * state,
   register INT32 code;
 
   /* HUFF_DECODE has determined that the code is at least min_bits */
-  /* bits long, so fetch that many bits in one swoop. */
+  /* bits long.  Usually all 16 bits of the longest possible code are */
+  /* already in get_buffer; then we can find the code length without */
+  /* fetching the code one bit at a time. */
+
+  if (bits_left >= 16) {
+    code = PEEK_BITS(16);
+    while (l <= 16 && (code >> (16 - l)) > htbl->maxcode[l])
+      l++;
+    if (l <= 16) {
+      DROP_BITS(l);
+      state->get_buffer = get_buffer;
+      state->bits_left = bits_left;
+      return htbl->pub->huffval[ htbl->valptr[l] +
+				((int) ((code >> (16 - l)) - htbl->mincode[l])) ];
+    }
+    l = min_bits;		/* bad code: take the slow path for the warning */
+  }
+
+  /* Otherwise fetch min_bits bits in one swoop. */
 
   CHECK_BIT_BUFFER(*state, l, return -1);
   code = GET_BITS(l);
@@ -469,12 +547,7 @@ decode_mcu (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
     /* Decode a single block's worth of coefficients */
 
     /* Section F.2.2.1: decode the DC coefficient difference */
-    HUFF_DECODE(s, br_state, dctbl, return FALSE, label1);
-    if (s) {
-      CHECK_BIT_BUFFER(br_state, s, return FALSE);
-      r = GET_BITS(s);
-      s = HUFF_EXTEND(r, s);
-    }
+    HUFF_DECODE_COEF(r, s, br_state, dctbl, return FALSE, label1);
 
     /* Shortcut if component's values are not interesting */
     if (! compptr->component_needed)
@@ -492,23 +565,17 @@ decode_mcu (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
       /* Section F.2.2.2: decode the AC coefficients */
       /* Since zeroes are skipped, output area must be cleared beforehand */
       for (k = 1; k < DCTSIZE2; k++) {
-	HUFF_DECODE(s, br_state, actbl, return FALSE, label2);
-      
-	r = s >> 4;
-	s &= 15;
+	HUFF_DECODE_COEF(r, s, br_state, actbl, return FALSE, label2);
       
-	if (s) {
-	  k += r;
-	  CHECK_BIT_BUFFER(br_state, s, return FALSE);
-	  r = GET_BITS(s);
-	  s = HUFF_EXTEND(r, s);
+	if (r & 15) {
+	  k += r >> 4;
 	  /* Output coefficient in natural (dezigzagged) order.
 	   * Note: the extra entries in jpeg_natural_order[] will save us
 	   * if k >= DCTSIZE2, which could happen if the data is corrupted.
 	   */
 	  (*block)[jpeg_natural_order[k]] = (JCOEF) s;
 	} else {
-	  if (r != 15)
+	  if (r != 0xF0)	/* EOB (anything but ZRL) */
 	    break;
 	  k += 15;
 	}
@@ -520,17 +587,12 @@ skip_ACs:
       /* Section F.2.2.2: decode the AC coefficients */
       /* In this path we just discard the values */
       for (k = 1; k < DCTSIZE2; k++) {
-	HUFF_DECODE(s, br_state, actbl, return FALSE, label3);
-      
-	r = s >> 4;
-	s &= 15;
+	HUFF_DECODE_COEF(r, s, br_state, actbl, return FALSE, label3);
       
-	if (s) {
-	  k += r;
-	  CHECK_BIT_BUFFER(br_state, s, return FALSE);
-	  DROP_BITS(s);
+	if (r & 15) {
+	  k += r >> 4;
 	} else {
-	  if (r != 15)
+	  if (r != 0xF0)	/* EOB (anything but ZRL) */
 	    break;
 	  k += 15;
 	}
@@ -566,6 +628,7 @@ jinit_huff_decoder (j_decompress_ptr cinfo)
   cinfo->entropy = (struct jpeg_entropy_decoder *) entropy;
   entropy->pub.start_pass = start_pass_huff_decoder;
   entropy->pub.decode_mcu = decode_mcu;
+  entropy->pub.finish_pass = finish_pass_huff_decoder;
 
   /* Mark tables unallocated */
   for (i = 0; i < NUM_HUFF_TBLS; i++) {
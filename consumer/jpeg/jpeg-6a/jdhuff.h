@@ -21,7 +21,7 @@
 
 /* Derived data constructed for each Huffman table */
 
-#define HUFF_LOOKAHEAD	8	/* # of bits of lookahead */
+#define HUFF_LOOKAHEAD	10	/* # of bits of lookahead */
 
 typedef struct {
   /* Basic tables: (element [0] of each array is unused) */
@@ -38,8 +38,15 @@ typedef struct {
    * than HUFF_LOOKAHEAD bits long, we can obtain its length and
    * the corresponding symbol directly from these tables.
    */
-  int look_nbits[1<<HUFF_LOOKAHEAD]; /* # bits, or 0 if too long */
+  UINT8 look_nbits[1<<HUFF_LOOKAHEAD]; /* # bits, or 0 if too long */
   UINT8 look_sym[1<<HUFF_LOOKAHEAD]; /* symbol, or unused */
+
+  /* Combined lookahead tables: if the code and the (symbol & 15) extra
+   * bits that follow it both fit in the next HUFF_LOOKAHEAD bits, we can
+   * also obtain the sign-extended value of the extra bits directly.
+   */
+  UINT8 look_total[1<<HUFF_LOOKAHEAD]; /* # bits incl. extra, or 0 */
+  INT16 look_value[1<<HUFF_LOOKAHEAD]; /* value of extra bits, or unused */
 } d_derived_tbl;
 
 /* Expand a Huffman table definition into the derived format */
@@ -65,16 +72,23 @@ EXTERN(void) jpeg_make_d_derived_tbl JPP((j_decompress_ptr cinfo,
  * necessary.
  */
 
-typedef INT32 bit_buf_type;	/* type of bit-extraction buffer */
-#define BIT_BUF_SIZE  32	/* size of buffer in bits */
-
 /* If long is > 32 bits on your machine, and shifting/masking longs is
  * reasonably fast, making bit_buf_type be long and setting BIT_BUF_SIZE
- * appropriately should be a win.  Unfortunately we can't do this with
- * something like  #define BIT_BUF_SIZE (sizeof(bit_buf_type)*8)
- * because not all machines measure sizeof in 8-bit bytes.
+ * appropriately is a win: jpeg_fill_bit_buffer is called about half as
+ * often, and can then load several bytes at once.  Unfortunately we can't
+ * do this with something like  #define BIT_BUF_SIZE (sizeof(bit_buf_type)*8)
+ * because not all machines measure sizeof in 8-bit bytes; so we only do it
+ * for the LP64 machines we know about.
  */
 
+#if defined(__LP64__) || defined(_LP64)
+typedef unsigned long bit_buf_type; /* type of bit-extraction buffer */
+#define BIT_BUF_SIZE  64	/* size of buffer in bits */
+#else
+typedef INT32 bit_buf_type;	/* type of bit-extraction buffer */
+#define BIT_BUF_SIZE  32	/* size of buffer in bits */
+#endif
+
 typedef struct {		/* Bitreading state saved across MCUs */
   bit_buf_type get_buffer;	/* current bit-extraction buffer */
   int bits_left;		/* # of unused bits in it */
@@ -162,9 +176,9 @@ EXTERN(boolean) jpeg_fill_bit_buffer
  * Again, this is time-critical and we make the main paths be macros.
  *
  * We use a lookahead table to process codes of up to HUFF_LOOKAHEAD bits
- * without looping.  Usually, more than 95% of the Huffman codes will be 8
- * or fewer bits long.  The few overlength codes are handled with a loop,
- * which need not be inline code.
+ * without looping.  Usually, more than 95% of the Huffman codes will be
+ * HUFF_LOOKAHEAD or fewer bits long.  The few overlength codes are handled
+ * with a loop, which need not be inline code.
  *
  * Notes about the HUFF_DECODE macro:
  * 1. Near the end of the data segment, we may fail to get enough bits
@@ -196,6 +210,51 @@ slowlabel: \
   } \
 }
 
+/*
+ * HUFF_DECODE_COEF decodes a Huffman code together with the extra bits
+ * that follow it: sym receives the symbol, val the sign-extended value of
+ * its (sym & 15) extra bits, or 0 if there are none.  That is the DC
+ * difference or the AC coefficient.  When the code and its extra bits fit
+ * in HUFF_LOOKAHEAD bits, which is so for most coefficients, both come
+ * from a single lookup in the combined tables.  Otherwise we do the same
+ * as HUFF_DECODE followed by GET_BITS.  The caller must define
+ * HUFF_EXTEND.
+ */
+
+#define HUFF_DECODE_COEF(sym,val,state,htbl,failaction,slowlabel) \
+{ register int nb, look; \
+  if (bits_left < HUFF_LOOKAHEAD) { \
+    if (! jpeg_fill_bit_buffer(&state,get_buffer,bits_left, 0)) {failaction;} \
+    get_buffer = state.get_buffer; bits_left = state.bits_left; \
+    if (bits_left < HUFF_LOOKAHEAD) { \
+      nb = 1; goto slowlabel; \
+    } \
+  } \
+  look = PEEK_BITS(HUFF_LOOKAHEAD); \
+  if ((nb = htbl->look_total[look]) != 0) { \
+    DROP_BITS(nb); \
+    sym = htbl->look_sym[look]; \
+    val = htbl->look_value[look]; \
+  } else { \
+    if ((nb = htbl->look_nbits[look]) != 0) { \
+      DROP_BITS(nb); \
+      sym = htbl->look_sym[look]; \
+    } else { \
+      nb = HUFF_LOOKAHEAD+1; \
+slowlabel: \
+      if ((sym=jpeg_huff_decode(&state,get_buffer,bits_left,htbl,nb)) < 0) \
+	{ failaction; } \
+      get_buffer = state.get_buffer; bits_left = state.bits_left; \
+    } \
+    val = 0; \
+    if ((nb = sym & 15) != 0) { \
+      CHECK_BIT_BUFFER(state, nb, failaction); \
+      val = GET_BITS(nb); \
+      val = HUFF_EXTEND(val, nb); \
+    } \
+  } \
+}
+
 /* Out-of-line case for Huffman code fetching */
 EXTERN(int) jpeg_huff_decode
 	JPP((bitread_working_state * state, register bit_buf_type get_buffer,
@@ -35,6 +35,7 @@
 #define JPEG_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jsimd.h"		/* SIMD support */
 
 #ifdef UPSAMPLE_MERGING_SUPPORTED
 
@@ -358,6 +359,223 @@ h2v2_merged_upsample (j_decompress_ptr cinfo,
 }
 
 
+#ifdef JSIMD_SUPPORTED
+
+/*
+ * SSE2 and AVX2 versions of h2v1_merged_upsample and h2v2_merged_upsample.
+ *
+ * The chroma terms of 8 (SSE2) or 16 (AVX2) Cb,Cr pairs are computed just
+ * as the tables hold them (see jsimd.h), doubled up to cover the two
+ * pixels of each pair and added to one or two rows of Y; saturating the
+ * sums to 0..MAXJSAMPLE is what range_limit does for them.  So the
+ * outputs are identical to the C code's.  The last pairs of a row are
+ * done by converting the row's last 8 or 16 pairs again; the extra
+ * column of an odd-width image is done as in C.  Images too narrow for
+ * one vector of pairs are left to the C routines.
+ */
+
+LOCAL(void)
+merged_last_column (j_decompress_ptr cinfo,
+		    JSAMPROW inptr1, JSAMPROW inptr2,
+		    JSAMPROW inptr00, JSAMPROW inptr01,
+		    JSAMPROW outptr0, JSAMPROW outptr1)
+/* Emit the last column of an odd-width image, for one or two rows */
+/* (inptr01 and outptr1 are NULL for one row) */
+{
+  my_upsample_ptr upsample = (my_upsample_ptr) cinfo->upsample;
+  JDIMENSION col = cinfo->output_width >> 1;
+  register int y, cred, cgreen, cblue;
+  int cb, cr;
+  register JSAMPLE * range_limit = cinfo->sample_range_limit;
+  SHIFT_TEMPS
+
+  cb = GETJSAMPLE(inptr1[col]);
+  cr = GETJSAMPLE(inptr2[col]);
+  cred = upsample->Cr_r_tab[cr];
+  cgreen = (int) RIGHT_SHIFT(upsample->Cb_g_tab[cb] + upsample->Cr_g_tab[cr],
+			     SCALEBITS);
+  cblue = upsample->Cb_b_tab[cb];
+  y  = GETJSAMPLE(inptr00[2*col]);
+  outptr0 += 2*col * RGB_PIXELSIZE;
+  outptr0[RGB_RED] =   range_limit[y + cred];
+  outptr0[RGB_GREEN] = range_limit[y + cgreen];
+  outptr0[RGB_BLUE] =  range_limit[y + cblue];
+  if (outptr1 != NULL) {
+    y  = GETJSAMPLE(inptr01[2*col]);
+    outptr1 += 2*col * RGB_PIXELSIZE;
+    outptr1[RGB_RED] =   range_limit[y + cred];
+    outptr1[RGB_GREEN] = range_limit[y + cgreen];
+    outptr1[RGB_BLUE] =  range_limit[y + cblue];
+  }
+}
+
+
+/* 16 pixels of one row: Y at inptr, doubled-up chroma terms in the
+ * 16-bit lanes cr, cg, cb (crl/crh etc. for SSE2), RGB out at outptr.
+ */
+
+#define MERGED_16_SSE2(inptr,outptr)  \
+  { __m128i y_ = _mm_loadu_si128((__m128i *) (inptr)); \
+    __m128i yl_ = _mm_unpacklo_epi8(y_, zero), yh_ = _mm_unpackhi_epi8(y_, zero); \
+    jsimd_store_rgb_sse2(outptr, \
+      _mm_packus_epi16(_mm_add_epi16(yl_, crl), _mm_add_epi16(yh_, crh)), \
+      _mm_packus_epi16(_mm_add_epi16(yl_, cgl), _mm_add_epi16(yh_, cgh)), \
+      _mm_packus_epi16(_mm_add_epi16(yl_, cbl), _mm_add_epi16(yh_, cbh))); }
+
+#define MERGED_16_AVX2(inptr,outptr,cr,cg,cb)  \
+  { __m256i y_ = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (inptr))); \
+    jsimd_store_rgb_avx2(outptr, JSIMD_PACK16_AVX2(_mm256_add_epi16(y_, cr)), \
+			 JSIMD_PACK16_AVX2(_mm256_add_epi16(y_, cg)), \
+			 JSIMD_PACK16_AVX2(_mm256_add_epi16(y_, cb))); }
+
+LOCAL(void)
+merged_upsample_sse2 (j_decompress_ptr cinfo,
+		      JSAMPROW inptr1, JSAMPROW inptr2,
+		      JSAMPROW inptr00, JSAMPROW inptr01,
+		      JSAMPROW outptr0, JSAMPROW outptr1)
+/* Upsample and convert one or two rows, 8 pairs of columns at a time */
+{
+  JDIMENSION pairs = cinfo->output_width >> 1;
+  JDIMENSION col;
+  __m128i zero = _mm_setzero_si128();
+  __m128i cred, cgreen, cblue, crl, crh, cgl, cgh, cbl, cbh;
+
+  for (col = 0; ; col += 8) {
+    if (col > pairs - 8)
+      col = pairs - 8;
+    jsimd_ycc_chroma_sse2(
+      _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *) (inptr1 + col)), zero),
+      _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *) (inptr2 + col)), zero),
+      &cred, &cgreen, &cblue);
+    crl = _mm_unpacklo_epi16(cred, cred);
+    crh = _mm_unpackhi_epi16(cred, cred);
+    cgl = _mm_unpacklo_epi16(cgreen, cgreen);
+    cgh = _mm_unpackhi_epi16(cgreen, cgreen);
+    cbl = _mm_unpacklo_epi16(cblue, cblue);
+    cbh = _mm_unpackhi_epi16(cblue, cblue);
+    MERGED_16_SSE2(inptr00 + 2*col, outptr0 + 2*col * RGB_PIXELSIZE);
+    if (outptr1 != NULL)
+      MERGED_16_SSE2(inptr01 + 2*col, outptr1 + 2*col * RGB_PIXELSIZE);
+    if (col + 8 >= pairs)
+      break;
+  }
+  if (cinfo->output_width & 1)
+    merged_last_column(cinfo, inptr1, inptr2, inptr00, inptr01,
+		       outptr0, outptr1);
+}
+
+JSIMD_AVX2_TARGET LOCAL(void)
+merged_upsample_avx2 (j_decompress_ptr cinfo,
+		      JSAMPROW inptr1, JSAMPROW inptr2,
+		      JSAMPROW inptr00, JSAMPROW inptr01,
+		      JSAMPROW outptr0, JSAMPROW outptr1)
+/* Upsample and convert one or two rows, 16 pairs of columns at a time */
+{
+  JDIMENSION pairs = cinfo->output_width >> 1;
+  JDIMENSION col;
+  __m256i cred, cgreen, cblue, lo, hi;
+  __m256i cr0, cr1, cg0, cg1, cb0, cb1;
+
+  for (col = 0; ; col += 16) {
+    if (col > pairs - 16)
+      col = pairs - 16;
+    jsimd_ycc_chroma_avx2(
+      _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (inptr1 + col))),
+      _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (inptr2 + col))),
+      &cred, &cgreen, &cblue);
+    /* Double up: pairs 0-7 make pixels 0-15, pairs 8-15 pixels 16-31 */
+    lo = _mm256_unpacklo_epi16(cred, cred);
+    hi = _mm256_unpackhi_epi16(cred, cred);
+    cr0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+    cr1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+    lo = _mm256_unpacklo_epi16(cgreen, cgreen);
+    hi = _mm256_unpackhi_epi16(cgreen, cgreen);
+    cg0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+    cg1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+    lo = _mm256_unpacklo_epi16(cblue, cblue);
+    hi = _mm256_unpackhi_epi16(cblue, cblue);
+    cb0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+    cb1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+    MERGED_16_AVX2(inptr00 + 2*col, outptr0 + 2*col * RGB_PIXELSIZE,
+		   cr0, cg0, cb0);
+    MERGED_16_AVX2(inptr00 + 2*col + 16,
+		   outptr0 + (2*col + 16) * RGB_PIXELSIZE, cr1, cg1, cb1);
+    if (outptr1 != NULL) {
+      MERGED_16_AVX2(inptr01 + 2*col, outptr1 + 2*col * RGB_PIXELSIZE,
+		     cr0, cg0, cb0);
+      MERGED_16_AVX2(inptr01 + 2*col + 16,
+		     outptr1 + (2*col + 16) * RGB_PIXELSIZE, cr1, cg1, cb1);
+    }
+    if (col + 16 >= pairs)
+      break;
+  }
+  if (cinfo->output_width & 1)
+    merged_last_column(cinfo, inptr1, inptr2, inptr00, inptr01,
+		       outptr0, outptr1);
+}
+
+
+METHODDEF(void)
+h2v1_merged_upsample_sse2 (j_decompress_ptr cinfo,
+			   JSAMPIMAGE input_buf, JDIMENSION in_row_group_ctr,
+			   JSAMPARRAY output_buf)
+{
+  if ((cinfo->output_width >> 1) < 8)
+    h2v1_merged_upsample(cinfo, input_buf, in_row_group_ctr, output_buf);
+  else
+    merged_upsample_sse2(cinfo, input_buf[1][in_row_group_ctr],
+			 input_buf[2][in_row_group_ctr],
+			 input_buf[0][in_row_group_ctr], NULL,
+			 output_buf[0], NULL);
+}
+
+METHODDEF(void)
+h2v2_merged_upsample_sse2 (j_decompress_ptr cinfo,
+			   JSAMPIMAGE input_buf, JDIMENSION in_row_group_ctr,
+			   JSAMPARRAY output_buf)
+{
+  if ((cinfo->output_width >> 1) < 8)
+    h2v2_merged_upsample(cinfo, input_buf, in_row_group_ctr, output_buf);
+  else
+    merged_upsample_sse2(cinfo, input_buf[1][in_row_group_ctr],
+			 input_buf[2][in_row_group_ctr],
+			 input_buf[0][in_row_group_ctr*2],
+			 input_buf[0][in_row_group_ctr*2 + 1],
+			 output_buf[0], output_buf[1]);
+}
+
+METHODDEF(void)
+h2v1_merged_upsample_avx2 (j_decompress_ptr cinfo,
+			   JSAMPIMAGE input_buf, JDIMENSION in_row_group_ctr,
+			   JSAMPARRAY output_buf)
+{
+  if ((cinfo->output_width >> 1) < 16)
+    h2v1_merged_upsample(cinfo, input_buf, in_row_group_ctr, output_buf);
+  else
+    merged_upsample_avx2(cinfo, input_buf[1][in_row_group_ctr],
+			 input_buf[2][in_row_group_ctr],
+			 input_buf[0][in_row_group_ctr], NULL,
+			 output_buf[0], NULL);
+}
+
+METHODDEF(void)
+h2v2_merged_upsample_avx2 (j_decompress_ptr cinfo,
+			   JSAMPIMAGE input_buf, JDIMENSION in_row_group_ctr,
+			   JSAMPARRAY output_buf)
+{
+  if ((cinfo->output_width >> 1) < 16)
+    h2v2_merged_upsample(cinfo, input_buf, in_row_group_ctr, output_buf);
+  else
+    merged_upsample_avx2(cinfo, input_buf[1][in_row_group_ctr],
+			 input_buf[2][in_row_group_ctr],
+			 input_buf[0][in_row_group_ctr*2],
+			 input_buf[0][in_row_group_ctr*2 + 1],
+			 output_buf[0], output_buf[1]);
+}
+
+#endif /* JSIMD_SUPPORTED */
+
+
 /*
  * Module initialization routine for merged upsampling/color conversion.
  *
@@ -383,6 +601,12 @@ jinit_merged_upsampler (j_decompress_ptr cinfo)
   if (cinfo->max_v_samp_factor == 2) {
     upsample->pub.upsample = merged_2v_upsample;
     upsample->upmethod = h2v2_merged_upsample;
+#ifdef JSIMD_SUPPORTED
+    if (jsimd_level() >= JSIMD_AVX2)
+      upsample->upmethod = h2v2_merged_upsample_avx2;
+    else if (jsimd_level() >= JSIMD_SSE2)
+      upsample->upmethod = h2v2_merged_upsample_sse2;
+#endif
     /* Allocate a spare row buffer */
     upsample->spare_row = (JSAMPROW)
       (*cinfo->mem->alloc_large) ((j_common_ptr) cinfo, JPOOL_IMAGE,
@@ -390,6 +614,12 @@ jinit_merged_upsampler (j_decompress_ptr cinfo)
   } else {
     upsample->pub.upsample = merged_1v_upsample;
     upsample->upmethod = h2v1_merged_upsample;
+#ifdef JSIMD_SUPPORTED
+    if (jsimd_level() >= JSIMD_AVX2)
+      upsample->upmethod = h2v1_merged_upsample_avx2;
+    else if (jsimd_level() >= JSIMD_SSE2)
+      upsample->upmethod = h2v1_merged_upsample_sse2;
+#endif
     /* No spare row needed */
     upsample->spare_row = NULL;
   }
@@ -193,6 +193,32 @@ start_pass_phuff_decoder (j_decompress_ptr cinfo)
 }
 
 
+/*
+ * Finish up at the end of a progressive Huffman scan.
+ */
+
+METHODDEF(void)
+finish_pass_phuff_decoder (j_decompress_ptr cinfo)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+
+  /* Throw away any unused bits remaining in bit buffer; */
+  /* include any full bytes in next_marker's count of discarded bytes, */
+  /* unless they are zeroes stuffed in at a premature marker */
+  if (! entropy->bitstate.printed_eod)
+    cinfo->marker->discarded_bytes += entropy->bitstate.bits_left / 8;
+  entropy->bitstate.bits_left = 0;
+
+  /* If we have read up to the marker already, next_marker won't be */
+  /* called to report them; do it here */
+  if (cinfo->unread_marker != 0 && cinfo->marker->discarded_bytes != 0) {
+    WARNMS2(cinfo, JWRN_EXTRANEOUS_DATA, cinfo->marker->discarded_bytes,
+	    cinfo->unread_marker);
+    cinfo->marker->discarded_bytes = 0;
+  }
+}
+
+
 /*
  * Figure F.12: extend sign bit.
  * On some machines, a shift and add will be faster than a table lookup.
@@ -312,12 +338,7 @@ decode_mcu_DC_first (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
     /* Decode a single block's worth of coefficients */
 
     /* Section F.2.2.1: decode the DC coefficient difference */
-    HUFF_DECODE(s, br_state, tbl, return FALSE, label1);
-    if (s) {
-      CHECK_BIT_BUFFER(br_state, s, return FALSE);
-      r = GET_BITS(s);
-      s = HUFF_EXTEND(r, s);
-    }
+    HUFF_DECODE_COEF(r, s, br_state, tbl, return FALSE, label1);
 
     /* Convert DC difference to actual value, update last_dc_val */
     s += state.last_dc_val[ci];
@@ -376,17 +397,13 @@ decode_mcu_AC_first (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
     tbl = entropy->ac_derived_tbl;
 
     for (k = cinfo->Ss; k <= Se; k++) {
-      HUFF_DECODE(s, br_state, tbl, return FALSE, label2);
-      r = s >> 4;
-      s &= 15;
-      if (s) {
-        k += r;
-        CHECK_BIT_BUFFER(br_state, s, return FALSE);
-        r = GET_BITS(s);
-        s = HUFF_EXTEND(r, s);
+      HUFF_DECODE_COEF(r, s, br_state, tbl, return FALSE, label2);
+      if (r & 15) {
+        k += r >> 4;
 	/* Scale and output coefficient in natural (dezigzagged) order */
         (*block)[jpeg_natural_order[k]] = (JCOEF) (s << Al);
       } else {
+        r >>= 4;
         if (r == 15) {		/* ZRL */
           k += 15;		/* skip 15 zeroes in band */
         } else {		/* EOBr, run length is 2^r + appended bits */
@@ -623,6 +640,7 @@ jinit_phuff_decoder (j_decompress_ptr cinfo)
 				SIZEOF(phuff_entropy_decoder));
   cinfo->entropy = (struct jpeg_entropy_decoder *) entropy;
   entropy->pub.start_pass = start_pass_phuff_decoder;
+  entropy->pub.finish_pass = finish_pass_phuff_decoder;
 
   /* Mark derived tables unallocated */
   for (i = 0; i < NUM_HUFF_TBLS; i++) {
@@ -27,6 +27,7 @@
 #include "jinclude.h"
 #include "jpeglib.h"
 #include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"		/* SIMD support */
 
 #ifdef DCT_ISLOW_SUPPORTED
 
@@ -280,4 +281,147 @@ jpeg_fdct_islow (DCTELEM * data)
   }
 }
 
+
+#ifdef JSIMD_SUPPORTED
+
+/*
+ * SSE2 and AVX2 versions of jpeg_fdct_islow.
+ *
+ * FDCT_1D is the body of the loops above with every variable a vector:
+ * each 32-bit lane runs the computation for a different row (pass 1) or
+ * column (pass 2) with the same integer arithmetic, so the results are
+ * identical to the C code's.  (No intermediate value exceeds 32 bits for
+ * 8-bit samples, so 32-bit lanes are as good as INT32.)  Since a lane has
+ * to run across the vectors, the block is transposed before pass 1 and
+ * back again before pass 2.  Each version supplies the vector type VEC
+ * and the ADD, SUB, MUL, SHL and SRA operations.
+ */
+
+#define VDESCALE(x,n)  SRA(ADD(x, SET1(ONE << ((n)-1))), n)
+
+#define PASS1_DC(x)  SHL(x, PASS1_BITS)
+#define PASS2_DC(x)  VDESCALE(x, PASS1_BITS)
+
+#define FDCT_1D(d0,d1,d2,d3,d4,d5,d6,d7,DCSCALE,n)  \
+  { VEC tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7; \
+    VEC tmp10, tmp11, tmp12, tmp13; \
+    VEC z1, z2, z3, z4, z5; \
+    tmp0 = ADD(d0, d7); tmp7 = SUB(d0, d7); \
+    tmp1 = ADD(d1, d6); tmp6 = SUB(d1, d6); \
+    tmp2 = ADD(d2, d5); tmp5 = SUB(d2, d5); \
+    tmp3 = ADD(d3, d4); tmp4 = SUB(d3, d4); \
+    tmp10 = ADD(tmp0, tmp3); tmp13 = SUB(tmp0, tmp3); \
+    tmp11 = ADD(tmp1, tmp2); tmp12 = SUB(tmp1, tmp2); \
+    d0 = DCSCALE(ADD(tmp10, tmp11)); \
+    d4 = DCSCALE(SUB(tmp10, tmp11)); \
+    z1 = MUL(ADD(tmp12, tmp13), FIX_0_541196100); \
+    d2 = VDESCALE(ADD(z1, MUL(tmp13, FIX_0_765366865)), n); \
+    d6 = VDESCALE(ADD(z1, MUL(tmp12, - FIX_1_847759065)), n); \
+    z1 = ADD(tmp4, tmp7); z2 = ADD(tmp5, tmp6); \
+    z3 = ADD(tmp4, tmp6); z4 = ADD(tmp5, tmp7); \
+    z5 = MUL(ADD(z3, z4), FIX_1_175875602); \
+    tmp4 = MUL(tmp4, FIX_0_298631336); tmp5 = MUL(tmp5, FIX_2_053119869); \
+    tmp6 = MUL(tmp6, FIX_3_072711026); tmp7 = MUL(tmp7, FIX_1_501321110); \
+    z1 = MUL(z1, - FIX_0_899976223); z2 = MUL(z2, - FIX_2_562915447); \
+    z3 = MUL(z3, - FIX_1_961570560); z4 = MUL(z4, - FIX_0_390180644); \
+    z3 = ADD(z3, z5); z4 = ADD(z4, z5); \
+    d7 = VDESCALE(ADD(ADD(tmp4, z1), z3), n); \
+    d5 = VDESCALE(ADD(ADD(tmp5, z2), z4), n); \
+    d3 = VDESCALE(ADD(ADD(tmp6, z2), z3), n); \
+    d1 = VDESCALE(ADD(ADD(tmp7, z1), z4), n); }
+
+
+/* SSE2: four lanes; a[] holds the left and b[] the right half of the rows. */
+
+#define VEC		__m128i
+#define SET1(c)		_mm_set1_epi32((int) (c))
+#define ADD(x,y)	_mm_add_epi32(x, y)
+#define SUB(x,y)	_mm_sub_epi32(x, y)
+#define MUL(x,c)	jsimd_mullo_epi32(x, SET1(c))
+#define SHL(x,n)	_mm_slli_epi32(x, n)
+#define SRA(x,n)	_mm_srai_epi32(x, n)
+
+GLOBAL(void)
+jpeg_fdct_islow_sse2 (DCTELEM * data)
+{
+  __m128i a[DCTSIZE], b[DCTSIZE];
+  int i;
+
+  for (i = 0; i < DCTSIZE; i++) {
+    a[i] = _mm_loadu_si128((__m128i *) (data + DCTSIZE*i));
+    b[i] = _mm_loadu_si128((__m128i *) (data + DCTSIZE*i + 4));
+  }
+
+  /* Pass 1: process rows (now a[0..3], b[0..3] for rows 0-3 and
+   * a[4..7], b[4..7] for rows 4-7, indexed by column).
+   */
+  JSIMD_TRANSPOSE4_SSE2(a[0], a[1], a[2], a[3]);
+  JSIMD_TRANSPOSE4_SSE2(b[0], b[1], b[2], b[3]);
+  JSIMD_TRANSPOSE4_SSE2(a[4], a[5], a[6], a[7]);
+  JSIMD_TRANSPOSE4_SSE2(b[4], b[5], b[6], b[7]);
+  FDCT_1D(a[0], a[1], a[2], a[3], b[0], b[1], b[2], b[3],
+	  PASS1_DC, CONST_BITS-PASS1_BITS);
+  FDCT_1D(a[4], a[5], a[6], a[7], b[4], b[5], b[6], b[7],
+	  PASS1_DC, CONST_BITS-PASS1_BITS);
+
+  /* Pass 2: process columns. */
+  JSIMD_TRANSPOSE4_SSE2(a[0], a[1], a[2], a[3]);
+  JSIMD_TRANSPOSE4_SSE2(b[0], b[1], b[2], b[3]);
+  JSIMD_TRANSPOSE4_SSE2(a[4], a[5], a[6], a[7]);
+  JSIMD_TRANSPOSE4_SSE2(b[4], b[5], b[6], b[7]);
+  FDCT_1D(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7],
+	  PASS2_DC, CONST_BITS+PASS1_BITS);
+  FDCT_1D(b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7],
+	  PASS2_DC, CONST_BITS+PASS1_BITS);
+
+  for (i = 0; i < DCTSIZE; i++) {
+    _mm_storeu_si128((__m128i *) (data + DCTSIZE*i), a[i]);
+    _mm_storeu_si128((__m128i *) (data + DCTSIZE*i + 4), b[i]);
+  }
+}
+
+#undef VEC
+#undef SET1
+#undef ADD
+#undef SUB
+#undef MUL
+#undef SHL
+#undef SRA
+
+
+/* AVX2: eight lanes; v[] holds the rows. */
+
+#define VEC		__m256i
+#define SET1(c)		_mm256_set1_epi32((int) (c))
+#define ADD(x,y)	_mm256_add_epi32(x, y)
+#define SUB(x,y)	_mm256_sub_epi32(x, y)
+#define MUL(x,c)	_mm256_mullo_epi32(x, SET1(c))
+#define SHL(x,n)	_mm256_slli_epi32(x, n)
+#define SRA(x,n)	_mm256_srai_epi32(x, n)
+
+JSIMD_AVX2_TARGET GLOBAL(void)
+jpeg_fdct_islow_avx2 (DCTELEM * data)
+{
+  __m256i v[DCTSIZE];
+  int i;
+
+  for (i = 0; i < DCTSIZE; i++)
+    v[i] = _mm256_loadu_si256((__m256i *) (data + DCTSIZE*i));
+
+  /* Pass 1: process rows. */
+  JSIMD_TRANSPOSE8_AVX2(v);
+  FDCT_1D(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+	  PASS1_DC, CONST_BITS-PASS1_BITS);
+
+  /* Pass 2: process columns. */
+  JSIMD_TRANSPOSE8_AVX2(v);
+  FDCT_1D(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+	  PASS2_DC, CONST_BITS+PASS1_BITS);
+
+  for (i = 0; i < DCTSIZE; i++)
+    _mm256_storeu_si256((__m256i *) (data + DCTSIZE*i), v[i]);
+}
+
+#endif /* JSIMD_SUPPORTED */
+
 #endif /* DCT_ISLOW_SUPPORTED */
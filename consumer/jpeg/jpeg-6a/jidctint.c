@@ -29,6 +29,7 @@
 #include "jinclude.h"
 #include "jpeglib.h"
 #include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"		/* SIMD support */
 
 #ifdef DCT_ISLOW_SUPPORTED
 
@@ -385,4 +386,199 @@ jpeg_idct_islow (j_decompress_ptr cinfo, jpeg_component_info * compptr,
   }
 }
 
+
+#ifdef JSIMD_SUPPORTED
+
+/*
+ * SSE2 and AVX2 versions of jpeg_idct_islow.
+ *
+ * IDCT_1D is the body of the loops above with every variable a vector of
+ * 32-bit lanes, one lane per column (pass 1) or row (pass 2).  The block
+ * is transposed between the passes and after pass 2.  The zero-AC
+ * shortcuts are not taken, but they give the same values as the full
+ * computation, so the results are identical to the C code's.
+ *
+ * That holds as long as no intermediate value overflows 32 bits, which
+ * is guaranteed for dequantized coefficients of magnitude up to
+ * SIMD_COEF_LIMIT (the largest sum of absolute weights in pass 2 is about
+ * 1.83e6).  Real images stay below it; a block that doesn't (a corrupt
+ * file, or unusually coarse quantization) goes to the C code, which keeps
+ * its INT32 intermediates.
+ *
+ * Range limiting indexes the table of IDCT_range_limit() with the low 10
+ * bits of the result; that is, it saturates the sign-extended 10-bit value
+ * plus CENTERJSAMPLE to 0..MAXJSAMPLE, which the vector code does with a
+ * shift pair and saturating packs.
+ */
+
+#define SIMD_COEF_LIMIT  1024
+
+#define VDESCALE(x,n)  SRA(ADD(x, SET1(ONE << ((n)-1))), n)
+
+#define IDCT_1D(d0,d1,d2,d3,d4,d5,d6,d7,n)  \
+  { VEC tmp0, tmp1, tmp2, tmp3; \
+    VEC tmp10, tmp11, tmp12, tmp13; \
+    VEC z1, z2, z3, z4, z5; \
+    z1 = MUL(ADD(d2, d6), FIX_0_541196100); \
+    tmp2 = ADD(z1, MUL(d6, - FIX_1_847759065)); \
+    tmp3 = ADD(z1, MUL(d2, FIX_0_765366865)); \
+    tmp0 = SHL(ADD(d0, d4), CONST_BITS); \
+    tmp1 = SHL(SUB(d0, d4), CONST_BITS); \
+    tmp10 = ADD(tmp0, tmp3); tmp13 = SUB(tmp0, tmp3); \
+    tmp11 = ADD(tmp1, tmp2); tmp12 = SUB(tmp1, tmp2); \
+    tmp0 = d7; tmp1 = d5; tmp2 = d3; tmp3 = d1; \
+    z1 = ADD(tmp0, tmp3); z2 = ADD(tmp1, tmp2); \
+    z3 = ADD(tmp0, tmp2); z4 = ADD(tmp1, tmp3); \
+    z5 = MUL(ADD(z3, z4), FIX_1_175875602); \
+    tmp0 = MUL(tmp0, FIX_0_298631336); tmp1 = MUL(tmp1, FIX_2_053119869); \
+    tmp2 = MUL(tmp2, FIX_3_072711026); tmp3 = MUL(tmp3, FIX_1_501321110); \
+    z1 = MUL(z1, - FIX_0_899976223); z2 = MUL(z2, - FIX_2_562915447); \
+    z3 = MUL(z3, - FIX_1_961570560); z4 = MUL(z4, - FIX_0_390180644); \
+    z3 = ADD(z3, z5); z4 = ADD(z4, z5); \
+    tmp0 = ADD(tmp0, ADD(z1, z3)); tmp1 = ADD(tmp1, ADD(z2, z4)); \
+    tmp2 = ADD(tmp2, ADD(z2, z3)); tmp3 = ADD(tmp3, ADD(z1, z4)); \
+    d0 = VDESCALE(ADD(tmp10, tmp3), n); d7 = VDESCALE(SUB(tmp10, tmp3), n); \
+    d1 = VDESCALE(ADD(tmp11, tmp2), n); d6 = VDESCALE(SUB(tmp11, tmp2), n); \
+    d2 = VDESCALE(ADD(tmp12, tmp1), n); d5 = VDESCALE(SUB(tmp12, tmp1), n); \
+    d3 = VDESCALE(ADD(tmp13, tmp0), n); d4 = VDESCALE(SUB(tmp13, tmp0), n); }
+
+/* Sign-extend the low 10 bits (RANGE_MASK) and add CENTERJSAMPLE */
+#define RANGE_WRAP(x)	ADD(SRA(SHL(x, 22), 22), SET1(CENTERJSAMPLE))
+
+
+/* SSE2: four lanes; a[] holds the left and b[] the right half of the rows. */
+
+#define VEC		__m128i
+#define SET1(c)		_mm_set1_epi32((int) (c))
+#define ADD(x,y)	_mm_add_epi32(x, y)
+#define SUB(x,y)	_mm_sub_epi32(x, y)
+#define MUL(x,c)	jsimd_mullo_epi32(x, SET1(c))
+#define SHL(x,n)	_mm_slli_epi32(x, n)
+#define SRA(x,n)	_mm_srai_epi32(x, n)
+
+GLOBAL(void)
+jpeg_idct_islow_sse2 (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		      JCOEFPTR coef_block,
+		      JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  ISLOW_MULT_TYPE * quantptr = (ISLOW_MULT_TYPE *) compptr->dct_table;
+  __m128i a[DCTSIZE], b[DCTSIZE];
+  __m128i c, out, limit = SET1(SIMD_COEF_LIMIT);
+  __m128i over = _mm_setzero_si128();
+  int i;
+
+  /* Dequantize, checking the coefficient range */
+  for (i = 0; i < DCTSIZE; i++) {
+    c = _mm_loadu_si128((__m128i *) (coef_block + DCTSIZE*i));
+    a[i] = jsimd_mullo_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(c, c), 16),
+	     _mm_loadu_si128((__m128i *) (quantptr + DCTSIZE*i)));
+    b[i] = jsimd_mullo_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(c, c), 16),
+	     _mm_loadu_si128((__m128i *) (quantptr + DCTSIZE*i + 4)));
+    over = _mm_or_si128(over, _mm_or_si128(
+	     _mm_or_si128(_mm_cmpgt_epi32(a[i], limit),
+			  _mm_cmplt_epi32(a[i], SUB(_mm_setzero_si128(), limit))),
+	     _mm_or_si128(_mm_cmpgt_epi32(b[i], limit),
+			  _mm_cmplt_epi32(b[i], SUB(_mm_setzero_si128(), limit)))));
+  }
+  if (_mm_movemask_epi8(over)) {
+    jpeg_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+    return;
+  }
+
+  /* Pass 1: process columns. */
+  IDCT_1D(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7],
+	  CONST_BITS-PASS1_BITS);
+  IDCT_1D(b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7],
+	  CONST_BITS-PASS1_BITS);
+
+  /* Pass 2: process rows (a[0..3], b[0..3] hold rows 0-3 and a[4..7],
+   * b[4..7] rows 4-7, indexed by column).
+   */
+  JSIMD_TRANSPOSE4_SSE2(a[0], a[1], a[2], a[3]);
+  JSIMD_TRANSPOSE4_SSE2(b[0], b[1], b[2], b[3]);
+  JSIMD_TRANSPOSE4_SSE2(a[4], a[5], a[6], a[7]);
+  JSIMD_TRANSPOSE4_SSE2(b[4], b[5], b[6], b[7]);
+  IDCT_1D(a[0], a[1], a[2], a[3], b[0], b[1], b[2], b[3],
+	  CONST_BITS+PASS1_BITS+3);
+  IDCT_1D(a[4], a[5], a[6], a[7], b[4], b[5], b[6], b[7],
+	  CONST_BITS+PASS1_BITS+3);
+  JSIMD_TRANSPOSE4_SSE2(a[0], a[1], a[2], a[3]);
+  JSIMD_TRANSPOSE4_SSE2(b[0], b[1], b[2], b[3]);
+  JSIMD_TRANSPOSE4_SSE2(a[4], a[5], a[6], a[7]);
+  JSIMD_TRANSPOSE4_SSE2(b[4], b[5], b[6], b[7]);
+
+  /* Range-limit and store the rows */
+  for (i = 0; i < DCTSIZE; i++) {
+    out = _mm_packs_epi32(RANGE_WRAP(a[i]), RANGE_WRAP(b[i]));
+    _mm_storel_epi64((__m128i *) (output_buf[i] + output_col),
+		     _mm_packus_epi16(out, out));
+  }
+}
+
+#undef VEC
+#undef SET1
+#undef ADD
+#undef SUB
+#undef MUL
+#undef SHL
+#undef SRA
+
+
+/* AVX2: eight lanes; v[] holds the rows. */
+
+#define VEC		__m256i
+#define SET1(c)		_mm256_set1_epi32((int) (c))
+#define ADD(x,y)	_mm256_add_epi32(x, y)
+#define SUB(x,y)	_mm256_sub_epi32(x, y)
+#define MUL(x,c)	_mm256_mullo_epi32(x, SET1(c))
+#define SHL(x,n)	_mm256_slli_epi32(x, n)
+#define SRA(x,n)	_mm256_srai_epi32(x, n)
+
+JSIMD_AVX2_TARGET GLOBAL(void)
+jpeg_idct_islow_avx2 (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		      JCOEFPTR coef_block,
+		      JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  ISLOW_MULT_TYPE * quantptr = (ISLOW_MULT_TYPE *) compptr->dct_table;
+  __m256i v[DCTSIZE];
+  __m256i limit = SET1(SIMD_COEF_LIMIT);
+  __m256i over = _mm256_setzero_si256();
+  __m128i out;
+  int i;
+
+  /* Dequantize, checking the coefficient range */
+  for (i = 0; i < DCTSIZE; i++) {
+    v[i] = _mm256_mullo_epi32(_mm256_cvtepi16_epi32(
+	     _mm_loadu_si128((__m128i *) (coef_block + DCTSIZE*i))),
+	     _mm256_loadu_si256((__m256i *) (quantptr + DCTSIZE*i)));
+    over = _mm256_or_si256(over,
+			   _mm256_cmpgt_epi32(_mm256_abs_epi32(v[i]), limit));
+  }
+  if (! _mm256_testz_si256(over, over)) {
+    jpeg_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+    return;
+  }
+
+  /* Pass 1: process columns. */
+  IDCT_1D(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+	  CONST_BITS-PASS1_BITS);
+
+  /* Pass 2: process rows. */
+  JSIMD_TRANSPOSE8_AVX2(v);
+  IDCT_1D(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+	  CONST_BITS+PASS1_BITS+3);
+  JSIMD_TRANSPOSE8_AVX2(v);
+
+  /* Range-limit and store the rows */
+  for (i = 0; i < DCTSIZE; i++) {
+    v[i] = RANGE_WRAP(v[i]);
+    out = _mm_packs_epi32(_mm256_castsi256_si128(v[i]),
+			  _mm256_extracti128_si256(v[i], 1));
+    _mm_storel_epi64((__m128i *) (output_buf[i] + output_col),
+		     _mm_packus_epi16(out, out));
+  }
+}
+
+#endif /* JSIMD_SUPPORTED */
+
 #endif /* DCT_ISLOW_SUPPORTED */
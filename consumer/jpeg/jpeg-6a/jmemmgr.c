@@ -10,6 +10,7 @@
  * of the system dependencies have been isolated in a separate file.
  * The major functions provided here are:
  *   * pool-based allocation and freeing of memory;
+ *   * recycling of IMAGE-lifetime pools from one image to the next;
  *   * policy decisions about how to divide available memory among the
  *     virtual arrays;
  *   * control logic for swapping virtual arrays between main memory and
@@ -128,6 +129,13 @@ typedef struct {
   jvirt_sarray_ptr virt_sarray_list;
   jvirt_barray_ptr virt_barray_list;
 
+  /* Pools released from the IMAGE class are parked here, emptied, so that
+   * the next image processed with the same object can take them over
+   * instead of going back to jpeg_get_small/large.  See free_pool.
+   */
+  small_pool_ptr small_spare;
+  large_pool_ptr large_spare;
+
   /* This counts total space obtained from jpeg_get_small/large */
   long total_space_allocated;
 
@@ -283,6 +291,25 @@ alloc_small (j_common_ptr cinfo, int pool_id, size_t sizeofobject)
     hdr_ptr = hdr_ptr->hdr.next;
   }
 
+  /* Can a pool left over from the previous image serve? */
+  if (hdr_ptr == NULL) {
+    small_pool_ptr * spare_ptr;
+
+    for (spare_ptr = &mem->small_spare; *spare_ptr != NULL;
+	 spare_ptr = &(*spare_ptr)->hdr.next) {
+      if ((*spare_ptr)->hdr.bytes_left >= sizeofobject) {
+	hdr_ptr = *spare_ptr;
+	*spare_ptr = hdr_ptr->hdr.next;
+	hdr_ptr->hdr.next = NULL;
+	if (prev_hdr_ptr == NULL)
+	  mem->small_list[pool_id] = hdr_ptr;
+	else
+	  prev_hdr_ptr->hdr.next = hdr_ptr;
+	break;
+      }
+    }
+  }
+
   /* Time to make a new pool? */
   if (hdr_ptr == NULL) {
     /* min_request is what we need now, slop is what will be leftover */
@@ -359,19 +386,40 @@ alloc_large (j_common_ptr cinfo, int pool_id, size_t sizeofobject)
   if (pool_id < 0 || pool_id >= JPOOL_NUMPOOLS)
     ERREXIT1(cinfo, JERR_BAD_POOL_ID, pool_id);	/* safety check */
 
-  hdr_ptr = (large_pool_ptr) jpeg_get_large(cinfo, sizeofobject +
-					    SIZEOF(large_pool_hdr));
-  if (hdr_ptr == NULL)
-    out_of_memory(cinfo, 4);	/* jpeg_get_large failed */
-  mem->total_space_allocated += sizeofobject + SIZEOF(large_pool_hdr);
+  /* ... unless the previous image left one big enough.  Take the best fit,
+   * and none that would waste more than it holds.
+   */
+  { large_pool_ptr * spare_ptr;
+    large_pool_ptr * best_ptr = NULL;
+
+    for (spare_ptr = &mem->large_spare; *spare_ptr != NULL;
+	 spare_ptr = &(*spare_ptr)->hdr.next) {
+      size_t space = (*spare_ptr)->hdr.bytes_left;
+
+      if (space >= sizeofobject && space - sizeofobject <= sizeofobject &&
+	  (best_ptr == NULL || space < (*best_ptr)->hdr.bytes_left))
+	best_ptr = spare_ptr;
+    }
+    if (best_ptr != NULL) {
+      hdr_ptr = *best_ptr;
+      *best_ptr = hdr_ptr->hdr.next;
+    } else {
+      hdr_ptr = (large_pool_ptr) jpeg_get_large(cinfo, sizeofobject +
+						SIZEOF(large_pool_hdr));
+      if (hdr_ptr == NULL)
+	out_of_memory(cinfo, 4);	/* jpeg_get_large failed */
+      mem->total_space_allocated += sizeofobject + SIZEOF(large_pool_hdr);
+      hdr_ptr->hdr.bytes_left = sizeofobject;
+    }
+  }
 
-  /* Success, initialize the new pool header and add to list */
+  /* Success, initialize the pool header and add to list */
   hdr_ptr->hdr.next = mem->large_list[pool_id];
   /* We maintain space counts in each pool header for statistical purposes,
    * even though they are not needed for allocation.
    */
   hdr_ptr->hdr.bytes_used = sizeofobject;
-  hdr_ptr->hdr.bytes_left = 0;
+  hdr_ptr->hdr.bytes_left -= sizeofobject;
   mem->large_list[pool_id] = hdr_ptr;
 
   return (void FAR *) (hdr_ptr + 1); /* point to first data byte in pool */
@@ -586,21 +634,31 @@ realize_virt_arrays (j_common_ptr cinfo)
   my_mem_ptr mem = (my_mem_ptr) cinfo->mem;
   long space_per_minheight, maximum_space, avail_mem;
   long minheights, max_minheights;
+  long slab_space, odd_bytes;
+  char FAR * slab;
+  JDIMENSION i;
   jvirt_sarray_ptr sptr;
   jvirt_barray_ptr bptr;
 
   /* Compute the minimum space needed (maxaccess rows in each buffer)
    * and the maximum space needed (full image height in each buffer).
    * These may be of use to the system-dependent jpeg_mem_available routine.
+   * slab_space is the maximum space with each buffer aligned.
    */
   space_per_minheight = 0;
   maximum_space = 0;
+  slab_space = 0;
   for (sptr = mem->virt_sarray_list; sptr != NULL; sptr = sptr->next) {
     if (sptr->mem_buffer == NULL) { /* if not realized yet */
       space_per_minheight += (long) sptr->maxaccess *
 			     (long) sptr->samplesperrow * SIZEOF(JSAMPLE);
       maximum_space += (long) sptr->rows_in_array *
 		       (long) sptr->samplesperrow * SIZEOF(JSAMPLE);
+      slab_space += (long) sptr->rows_in_array *
+		    (long) sptr->samplesperrow * SIZEOF(JSAMPLE);
+      odd_bytes = slab_space % SIZEOF(ALIGN_TYPE);
+      if (odd_bytes > 0)
+	slab_space += SIZEOF(ALIGN_TYPE) - odd_bytes;
     }
   }
   for (bptr = mem->virt_barray_list; bptr != NULL; bptr = bptr->next) {
@@ -609,6 +667,8 @@ realize_virt_arrays (j_common_ptr cinfo)
 			     (long) bptr->blocksperrow * SIZEOF(JBLOCK);
       maximum_space += (long) bptr->rows_in_array *
 		       (long) bptr->blocksperrow * SIZEOF(JBLOCK);
+      slab_space += (long) bptr->rows_in_array *
+		    (long) bptr->blocksperrow * SIZEOF(JBLOCK);
     }
   }
 
@@ -619,6 +679,54 @@ realize_virt_arrays (j_common_ptr cinfo)
   avail_mem = jpeg_mem_available(cinfo, space_per_minheight, maximum_space,
 				 mem->total_space_allocated);
 
+  /* If everything fits in memory and in one allocation chunk, carve all
+   * the buffers, full height, out of a single large object.  That one
+   * slab is what free_pool hands on to the next image, so an object that
+   * processes a series of similar images sets up its arrays for free.
+   */
+  if (avail_mem >= maximum_space &&
+      slab_space <= (long) (MAX_ALLOC_CHUNK-SIZEOF(large_pool_hdr))) {
+    slab = (char FAR *) alloc_large(cinfo, JPOOL_IMAGE, (size_t) slab_space);
+
+    for (sptr = mem->virt_sarray_list; sptr != NULL; sptr = sptr->next) {
+      if (sptr->mem_buffer == NULL) { /* if not realized yet */
+	sptr->rows_in_mem = sptr->rows_in_array;
+	sptr->mem_buffer = (JSAMPARRAY) alloc_small(cinfo, JPOOL_IMAGE,
+			     (size_t) (sptr->rows_in_mem * SIZEOF(JSAMPROW)));
+	for (i = 0; i < sptr->rows_in_mem; i++) {
+	  sptr->mem_buffer[i] = (JSAMPROW) slab;
+	  slab += (size_t) sptr->samplesperrow * SIZEOF(JSAMPLE);
+	}
+	odd_bytes = (long) ((size_t) sptr->rows_in_mem *
+			    (size_t) sptr->samplesperrow * SIZEOF(JSAMPLE)) %
+		    SIZEOF(ALIGN_TYPE);
+	if (odd_bytes > 0)
+	  slab += SIZEOF(ALIGN_TYPE) - odd_bytes;
+	sptr->rowsperchunk = sptr->rows_in_mem;
+	sptr->cur_start_row = 0;
+	sptr->first_undef_row = 0;
+	sptr->dirty = FALSE;
+      }
+    }
+
+    for (bptr = mem->virt_barray_list; bptr != NULL; bptr = bptr->next) {
+      if (bptr->mem_buffer == NULL) { /* if not realized yet */
+	bptr->rows_in_mem = bptr->rows_in_array;
+	bptr->mem_buffer = (JBLOCKARRAY) alloc_small(cinfo, JPOOL_IMAGE,
+			     (size_t) (bptr->rows_in_mem * SIZEOF(JBLOCKROW)));
+	for (i = 0; i < bptr->rows_in_mem; i++) {
+	  bptr->mem_buffer[i] = (JBLOCKROW) slab;
+	  slab += (size_t) bptr->blocksperrow * SIZEOF(JBLOCK);
+	}
+	bptr->rowsperchunk = bptr->rows_in_mem;
+	bptr->cur_start_row = 0;
+	bptr->first_undef_row = 0;
+	bptr->dirty = FALSE;
+      }
+    }
+    return;
+  }
+
   /* If the maximum space needed is available, make all the buffers full
    * height; otherwise parcel it out with the same number of minheights
    * in each buffer.
@@ -922,8 +1030,43 @@ access_virt_barray (j_common_ptr cinfo, jvirt_barray_ptr ptr,
 }
 
 
+/*
+ * Give the spare pools back to the system.
+ */
+
+LOCAL(void)
+release_spare_pools (j_common_ptr cinfo)
+{
+  my_mem_ptr mem = (my_mem_ptr) cinfo->mem;
+  small_pool_ptr shdr_ptr;
+  large_pool_ptr lhdr_ptr;
+  size_t space_freed;
+
+  while ((lhdr_ptr = mem->large_spare) != NULL) {
+    mem->large_spare = lhdr_ptr->hdr.next;
+    space_freed = lhdr_ptr->hdr.bytes_left + SIZEOF(large_pool_hdr);
+    jpeg_free_large(cinfo, (void FAR *) lhdr_ptr, space_freed);
+    mem->total_space_allocated -= space_freed;
+  }
+
+  while ((shdr_ptr = mem->small_spare) != NULL) {
+    mem->small_spare = shdr_ptr->hdr.next;
+    space_freed = shdr_ptr->hdr.bytes_left + SIZEOF(small_pool_hdr);
+    jpeg_free_small(cinfo, (void *) shdr_ptr, space_freed);
+    mem->total_space_allocated -= space_freed;
+  }
+}
+
+
 /*
  * Release all objects belonging to a specified pool.
+ *
+ * The pools of the IMAGE class are not given back to the system but kept
+ * as spares for the next image; whatever spares the image just finished
+ * did not take over are released instead.  So an object holds on to about
+ * one image's worth of memory between images, and a server that runs a
+ * stream of similar images through one object does hardly any allocation
+ * after the first.  jpeg_destroy releases everything.
  */
 
 METHODDEF(void)
@@ -963,6 +1106,29 @@ free_pool (j_common_ptr cinfo, int pool_id)
     mem->virt_barray_list = NULL;
   }
 
+  /* Recycle the pools of an IMAGE class that was actually used */
+  if (pool_id == JPOOL_IMAGE &&
+      (mem->large_list[pool_id] != NULL || mem->small_list[pool_id] != NULL)) {
+    release_spare_pools(cinfo);
+
+    while ((lhdr_ptr = mem->large_list[pool_id]) != NULL) {
+      mem->large_list[pool_id] = lhdr_ptr->hdr.next;
+      lhdr_ptr->hdr.bytes_left += lhdr_ptr->hdr.bytes_used;
+      lhdr_ptr->hdr.bytes_used = 0;
+      lhdr_ptr->hdr.next = mem->large_spare;
+      mem->large_spare = lhdr_ptr;
+    }
+
+    while ((shdr_ptr = mem->small_list[pool_id]) != NULL) {
+      mem->small_list[pool_id] = shdr_ptr->hdr.next;
+      shdr_ptr->hdr.bytes_left += shdr_ptr->hdr.bytes_used;
+      shdr_ptr->hdr.bytes_used = 0;
+      shdr_ptr->hdr.next = mem->small_spare;
+      mem->small_spare = shdr_ptr;
+    }
+    return;
+  }
+
   /* Release large objects */
   lhdr_ptr = mem->large_list[pool_id];
   mem->large_list[pool_id] = NULL;
@@ -1010,6 +1176,7 @@ self_destruct (j_common_ptr cinfo)
   for (pool = JPOOL_NUMPOOLS-1; pool >= JPOOL_PERMANENT; pool--) {
     free_pool(cinfo, pool);
   }
+  release_spare_pools(cinfo);
 
   /* Release the memory manager control block too. */
   jpeg_free_small(cinfo, (void *) cinfo->mem, SIZEOF(my_memory_mgr));
@@ -1085,6 +1252,8 @@ jinit_memory_mgr (j_common_ptr cinfo)
   }
   mem->virt_sarray_list = NULL;
   mem->virt_barray_list = NULL;
+  mem->small_spare = NULL;
+  mem->large_spare = NULL;
 
   mem->total_space_allocated = SIZEOF(my_memory_mgr);
 
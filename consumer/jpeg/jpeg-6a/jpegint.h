@@ -50,6 +50,7 @@ struct jpeg_comp_master {
   /* State variables made visible to other modules */
   boolean call_pass_startup;	/* True if pass_startup must be called */
   boolean is_last_pass;		/* True during last pass */
+  boolean gather_all_scans;	/* True if main pass optimizes every scan */
 };
 
 /* Main buffer control (downsampled-data buffer) */
@@ -114,6 +115,11 @@ struct jpeg_entropy_encoder {
   JMETHOD(void, start_pass, (j_compress_ptr cinfo, boolean gather_statistics));
   JMETHOD(boolean, encode_mcu, (j_compress_ptr cinfo, JBLOCKROW *MCU_data));
   JMETHOD(void, finish_pass, (j_compress_ptr cinfo));
+  /* Statistics for all scans from one iMCU row of the full-image buffer,
+   * used in the main pass instead of encode_mcu if not NULL.
+   */
+  JMETHOD(void, gather_iMCU_row, (j_compress_ptr cinfo, JBLOCKARRAY * buffer,
+				  JDIMENSION iMCU_row));
 };
 
 /* Marker writing */
@@ -212,6 +218,7 @@ struct jpeg_entropy_decoder {
   JMETHOD(void, start_pass, (j_decompress_ptr cinfo));
   JMETHOD(boolean, decode_mcu, (j_decompress_ptr cinfo,
 				JBLOCKROW *MCU_data));
+  JMETHOD(void, finish_pass, (j_decompress_ptr cinfo));
 };
 
 /* Inverse DCT (also performs dequantization) */
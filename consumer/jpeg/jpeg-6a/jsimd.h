@@ -0,0 +1,338 @@
+/*
+ * jsimd.h
+ *
+ * This file is part of the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This include file contains declarations for the SSE2 and AVX2 versions
+ * of the integer DCTs (jfdctint.c, jidctint.c), the RGB<=>YCbCr color
+ * converters (jccolor.c, jdcolor.c) and the merged upsampler (jdmerge.c).
+ * Each SIMD routine sits next to the C routine it replaces and produces
+ * exactly the same output; the module's init routine picks the version
+ * for the level returned by jsimd_level().
+ *
+ * The SIMD code is compiled only by GCC-compatible compilers for x86-64,
+ * where SSE2 is always present and AVX2 is selected at run time, and only
+ * for 8-bit samples, 8x8 DCTs and the default RGB pixel layout.  On other
+ * systems JSIMD_SUPPORTED is left undefined and only the C code is built.
+ */
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#if BITS_IN_JSAMPLE == 8 && DCTSIZE == 8
+#if RGB_RED == 0 && RGB_GREEN == 1 && RGB_BLUE == 2 && RGB_PIXELSIZE == 3
+#define JSIMD_SUPPORTED
+#endif
+#endif
+#endif
+
+/* Values returned by jsimd_level() */
+
+#define JSIMD_NONE	0	/* C code only */
+#define JSIMD_SSE2	1
+#define JSIMD_AVX2	2
+
+
+/* Short forms of external names for systems with brain-damaged linkers. */
+
+#ifdef NEED_SHORT_EXTERNAL_NAMES
+#define jsimd_level		jSIMDLevel
+#endif /* NEED_SHORT_EXTERNAL_NAMES */
+
+EXTERN(int) jsimd_level JPP((void));
+
+
+#ifdef JSIMD_SUPPORTED
+
+#include <immintrin.h>
+
+#define JSIMD_AVX2_TARGET	__attribute__((target("avx2")))
+
+
+/*
+ * Low 32 bits of the products of four pairs of 32-bit lanes.
+ * (PMULLD is SSE4.1; the low half of a product is the same whether
+ * the factors are taken as signed or unsigned.)
+ */
+
+static __inline__ __m128i
+jsimd_mullo_epi32 (__m128i a, __m128i b)
+{
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, 0x08),
+			    _mm_shuffle_epi32(odd, 0x08));
+}
+
+
+/*
+ * In-place transposes of a 4x4 block of 32-bit lanes (rows a..d) and of
+ * an 8x8 block (rows r[0..7]), as used between the passes of the DCTs.
+ */
+
+#define JSIMD_TRANSPOSE4_SSE2(a,b,c,d)  \
+  { __m128i t0_ = _mm_unpacklo_epi32(a, b), t1_ = _mm_unpacklo_epi32(c, d); \
+    __m128i t2_ = _mm_unpackhi_epi32(a, b), t3_ = _mm_unpackhi_epi32(c, d); \
+    a = _mm_unpacklo_epi64(t0_, t1_); b = _mm_unpackhi_epi64(t0_, t1_); \
+    c = _mm_unpacklo_epi64(t2_, t3_); d = _mm_unpackhi_epi64(t2_, t3_); }
+
+#define JSIMD_TRANSPOSE8_AVX2(r)  \
+  { __m256i t0_ = _mm256_unpacklo_epi32(r[0], r[1]); \
+    __m256i t1_ = _mm256_unpackhi_epi32(r[0], r[1]); \
+    __m256i t2_ = _mm256_unpacklo_epi32(r[2], r[3]); \
+    __m256i t3_ = _mm256_unpackhi_epi32(r[2], r[3]); \
+    __m256i t4_ = _mm256_unpacklo_epi32(r[4], r[5]); \
+    __m256i t5_ = _mm256_unpackhi_epi32(r[4], r[5]); \
+    __m256i t6_ = _mm256_unpacklo_epi32(r[6], r[7]); \
+    __m256i t7_ = _mm256_unpackhi_epi32(r[6], r[7]); \
+    __m256i u0_ = _mm256_unpacklo_epi64(t0_, t2_); \
+    __m256i u1_ = _mm256_unpackhi_epi64(t0_, t2_); \
+    __m256i u2_ = _mm256_unpacklo_epi64(t1_, t3_); \
+    __m256i u3_ = _mm256_unpackhi_epi64(t1_, t3_); \
+    __m256i u4_ = _mm256_unpacklo_epi64(t4_, t6_); \
+    __m256i u5_ = _mm256_unpackhi_epi64(t4_, t6_); \
+    __m256i u6_ = _mm256_unpacklo_epi64(t5_, t7_); \
+    __m256i u7_ = _mm256_unpackhi_epi64(t5_, t7_); \
+    r[0] = _mm256_permute2x128_si256(u0_, u4_, 0x20); \
+    r[1] = _mm256_permute2x128_si256(u1_, u5_, 0x20); \
+    r[2] = _mm256_permute2x128_si256(u2_, u6_, 0x20); \
+    r[3] = _mm256_permute2x128_si256(u3_, u7_, 0x20); \
+    r[4] = _mm256_permute2x128_si256(u0_, u4_, 0x31); \
+    r[5] = _mm256_permute2x128_si256(u1_, u5_, 0x31); \
+    r[6] = _mm256_permute2x128_si256(u2_, u6_, 0x31); \
+    r[7] = _mm256_permute2x128_si256(u3_, u7_, 0x31); }
+
+
+/*
+ * Exact 32-bit products x * c of unsigned 16-bit lanes x and a constant
+ * 0 <= c < 65536.  The products of lanes 0-3 are returned in *lo and those
+ * of lanes 4-7 in *hi (for AVX2, in each 128-bit half); _mm_packs_epi32
+ * puts results computed from *lo and *hi back in lane order.
+ */
+
+static __inline__ void
+jsimd_mulu16_sse2 (__m128i x, int c, __m128i * lo, __m128i * hi)
+{
+  __m128i k = _mm_set1_epi16((short) c);
+  __m128i l = _mm_mullo_epi16(x, k);
+  __m128i h = _mm_mulhi_epu16(x, k);
+
+  *lo = _mm_unpacklo_epi16(l, h);
+  *hi = _mm_unpackhi_epi16(l, h);
+}
+
+JSIMD_AVX2_TARGET static __inline__ void
+jsimd_mulu16_avx2 (__m256i x, int c, __m256i * lo, __m256i * hi)
+{
+  __m256i k = _mm256_set1_epi16((short) c);
+  __m256i l = _mm256_mullo_epi16(x, k);
+  __m256i h = _mm256_mulhi_epu16(x, k);
+
+  *lo = _mm256_unpacklo_epi16(l, h);
+  *hi = _mm256_unpackhi_epi16(l, h);
+}
+
+
+/*
+ * Chroma terms of the YCbCr=>RGB conversion, as computed from the tables
+ * of jdcolor.c and jdmerge.c:
+ *	cred   = (1.40200 * (Cr-128)) rounded
+ *	cgreen = (-0.34414 * (Cb-128) - 0.71414 * (Cr-128)) rounded
+ *	cblue  = (1.77200 * (Cb-128)) rounded
+ * all with the tables' 16-bit fixed-point constants and rounding, so
+ * that R = Y + cred etc. exactly as in the C code.  Cb and Cr come in as
+ * unsigned 16-bit lanes, the results go out as signed 16-bit lanes.
+ * Constants of 65536 and up are split as (x << 16) + x * (c - 65536).
+ */
+
+#define JSIMD_FIX(x)	((INT32) ((x) * (1L<<16) + 0.5))
+
+#define JSIMD_CR_R	JSIMD_FIX(1.40200)
+#define JSIMD_CB_B	JSIMD_FIX(1.77200)
+#define JSIMD_CB_G	JSIMD_FIX(0.34414)
+#define JSIMD_CR_G	JSIMD_FIX(0.71414)
+
+static __inline__ void
+jsimd_ycc_chroma_sse2 (__m128i cb, __m128i cr,
+		       __m128i * cred, __m128i * cgreen, __m128i * cblue)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo, hi, lo2, hi2, k;
+
+  /* cred = (Cr * 1.402 + 0.5 - 128 * 1.402) >> 16 */
+  k = _mm_set1_epi32((int) ((1L<<15) - 128 * JSIMD_CR_R));
+  jsimd_mulu16_sse2(cr, (int) (JSIMD_CR_R - 65536), &lo, &hi);
+  lo = _mm_add_epi32(_mm_add_epi32(lo, _mm_unpacklo_epi16(zero, cr)), k);
+  hi = _mm_add_epi32(_mm_add_epi32(hi, _mm_unpackhi_epi16(zero, cr)), k);
+  *cred = _mm_packs_epi32(_mm_srai_epi32(lo, 16), _mm_srai_epi32(hi, 16));
+
+  /* cblue = (Cb * 1.772 + 0.5 - 128 * 1.772) >> 16 */
+  k = _mm_set1_epi32((int) ((1L<<15) - 128 * JSIMD_CB_B));
+  jsimd_mulu16_sse2(cb, (int) (JSIMD_CB_B - 65536), &lo, &hi);
+  lo = _mm_add_epi32(_mm_add_epi32(lo, _mm_unpacklo_epi16(zero, cb)), k);
+  hi = _mm_add_epi32(_mm_add_epi32(hi, _mm_unpackhi_epi16(zero, cb)), k);
+  *cblue = _mm_packs_epi32(_mm_srai_epi32(lo, 16), _mm_srai_epi32(hi, 16));
+
+  /* cgreen = (0.5 + 128 * (0.34414 + 0.71414) - Cb * 0.34414
+   *	       - Cr * 0.71414) >> 16
+   */
+  k = _mm_set1_epi32((int) ((1L<<15) + 128 * (JSIMD_CB_G + JSIMD_CR_G)));
+  jsimd_mulu16_sse2(cb, (int) JSIMD_CB_G, &lo, &hi);
+  jsimd_mulu16_sse2(cr, (int) JSIMD_CR_G, &lo2, &hi2);
+  lo = _mm_sub_epi32(_mm_sub_epi32(k, lo), lo2);
+  hi = _mm_sub_epi32(_mm_sub_epi32(k, hi), hi2);
+  *cgreen = _mm_packs_epi32(_mm_srai_epi32(lo, 16), _mm_srai_epi32(hi, 16));
+}
+
+JSIMD_AVX2_TARGET static __inline__ void
+jsimd_ycc_chroma_avx2 (__m256i cb, __m256i cr,
+		       __m256i * cred, __m256i * cgreen, __m256i * cblue)
+{
+  __m256i zero = _mm256_setzero_si256();
+  __m256i lo, hi, lo2, hi2, k;
+
+  k = _mm256_set1_epi32((int) ((1L<<15) - 128 * JSIMD_CR_R));
+  jsimd_mulu16_avx2(cr, (int) (JSIMD_CR_R - 65536), &lo, &hi);
+  lo = _mm256_add_epi32(_mm256_add_epi32(lo, _mm256_unpacklo_epi16(zero, cr)),
+			k);
+  hi = _mm256_add_epi32(_mm256_add_epi32(hi, _mm256_unpackhi_epi16(zero, cr)),
+			k);
+  *cred = _mm256_packs_epi32(_mm256_srai_epi32(lo, 16),
+			     _mm256_srai_epi32(hi, 16));
+
+  k = _mm256_set1_epi32((int) ((1L<<15) - 128 * JSIMD_CB_B));
+  jsimd_mulu16_avx2(cb, (int) (JSIMD_CB_B - 65536), &lo, &hi);
+  lo = _mm256_add_epi32(_mm256_add_epi32(lo, _mm256_unpacklo_epi16(zero, cb)),
+			k);
+  hi = _mm256_add_epi32(_mm256_add_epi32(hi, _mm256_unpackhi_epi16(zero, cb)),
+			k);
+  *cblue = _mm256_packs_epi32(_mm256_srai_epi32(lo, 16),
+			      _mm256_srai_epi32(hi, 16));
+
+  k = _mm256_set1_epi32((int) ((1L<<15) + 128 * (JSIMD_CB_G + JSIMD_CR_G)));
+  jsimd_mulu16_avx2(cb, (int) JSIMD_CB_G, &lo, &hi);
+  jsimd_mulu16_avx2(cr, (int) JSIMD_CR_G, &lo2, &hi2);
+  lo = _mm256_sub_epi32(_mm256_sub_epi32(k, lo), lo2);
+  hi = _mm256_sub_epi32(_mm256_sub_epi32(k, hi), hi2);
+  *cgreen = _mm256_packs_epi32(_mm256_srai_epi32(lo, 16),
+			       _mm256_srai_epi32(hi, 16));
+}
+
+
+/* Saturate the 16 16-bit lanes of an AVX2 vector to samples */
+
+#define JSIMD_PACK16_AVX2(v)  \
+  _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1))
+
+
+/*
+ * Conversion between 16 interleaved RGB pixels (48 bytes) and three
+ * vectors of 16 R, G and B samples, with byte shuffles (SSSE3, which
+ * every AVX2 processor has).
+ */
+
+#define JSIMD_Z		(-1)	/* shuffle index that yields a zero byte */
+
+JSIMD_AVX2_TARGET static __inline__ void
+jsimd_load_rgb_avx2 (JSAMPROW inptr, __m128i * r, __m128i * g, __m128i * b)
+{
+  __m128i in0 = _mm_loadu_si128((const __m128i *) inptr);
+  __m128i in1 = _mm_loadu_si128((const __m128i *) (inptr + 16));
+  __m128i in2 = _mm_loadu_si128((const __m128i *) (inptr + 32));
+
+  *r = _mm_or_si128(_mm_or_si128(
+	 _mm_shuffle_epi8(in0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z)),
+	 _mm_shuffle_epi8(in1, _mm_setr_epi8(JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z, 2, 5, 8, 11, 14, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z))),
+	 _mm_shuffle_epi8(in2, _mm_setr_epi8(JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, 1, 4, 7, 10, 13)));
+  *g = _mm_or_si128(_mm_or_si128(
+	 _mm_shuffle_epi8(in0, _mm_setr_epi8(1, 4, 7, 10, 13, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z)),
+	 _mm_shuffle_epi8(in1, _mm_setr_epi8(JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, 0, 3, 6, 9, 12, 15, JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z))),
+	 _mm_shuffle_epi8(in2, _mm_setr_epi8(JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, 2, 5, 8, 11, 14)));
+  *b = _mm_or_si128(_mm_or_si128(
+	 _mm_shuffle_epi8(in0, _mm_setr_epi8(2, 5, 8, 11, 14, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z)),
+	 _mm_shuffle_epi8(in1, _mm_setr_epi8(JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, 1, 4, 7, 10, 13, JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z))),
+	 _mm_shuffle_epi8(in2, _mm_setr_epi8(JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z, JSIMD_Z,
+	   0, 3, 6, 9, 12, 15)));
+}
+
+JSIMD_AVX2_TARGET static __inline__ void
+jsimd_store_rgb_avx2 (JSAMPROW outptr, __m128i r, __m128i g, __m128i b)
+{
+  __m128i out;
+
+  out = _mm_or_si128(_mm_or_si128(
+	  _mm_shuffle_epi8(r, _mm_setr_epi8(0, JSIMD_Z, JSIMD_Z, 1, JSIMD_Z,
+	    JSIMD_Z, 2, JSIMD_Z, JSIMD_Z, 3, JSIMD_Z, JSIMD_Z, 4, JSIMD_Z,
+	    JSIMD_Z, 5)),
+	  _mm_shuffle_epi8(g, _mm_setr_epi8(JSIMD_Z, 0, JSIMD_Z, JSIMD_Z, 1,
+	    JSIMD_Z, JSIMD_Z, 2, JSIMD_Z, JSIMD_Z, 3, JSIMD_Z, JSIMD_Z, 4,
+	    JSIMD_Z, JSIMD_Z))),
+	  _mm_shuffle_epi8(b, _mm_setr_epi8(JSIMD_Z, JSIMD_Z, 0, JSIMD_Z,
+	    JSIMD_Z, 1, JSIMD_Z, JSIMD_Z, 2, JSIMD_Z, JSIMD_Z, 3, JSIMD_Z,
+	    JSIMD_Z, 4, JSIMD_Z)));
+  _mm_storeu_si128((__m128i *) outptr, out);
+  out = _mm_or_si128(_mm_or_si128(
+	  _mm_shuffle_epi8(r, _mm_setr_epi8(JSIMD_Z, JSIMD_Z, 6, JSIMD_Z,
+	    JSIMD_Z, 7, JSIMD_Z, JSIMD_Z, 8, JSIMD_Z, JSIMD_Z, 9, JSIMD_Z,
+	    JSIMD_Z, 10, JSIMD_Z)),
+	  _mm_shuffle_epi8(g, _mm_setr_epi8(5, JSIMD_Z, JSIMD_Z, 6, JSIMD_Z,
+	    JSIMD_Z, 7, JSIMD_Z, JSIMD_Z, 8, JSIMD_Z, JSIMD_Z, 9, JSIMD_Z,
+	    JSIMD_Z, 10))),
+	  _mm_shuffle_epi8(b, _mm_setr_epi8(JSIMD_Z, 5, JSIMD_Z, JSIMD_Z, 6,
+	    JSIMD_Z, JSIMD_Z, 7, JSIMD_Z, JSIMD_Z, 8, JSIMD_Z, JSIMD_Z, 9,
+	    JSIMD_Z, JSIMD_Z)));
+  _mm_storeu_si128((__m128i *) (outptr + 16), out);
+  out = _mm_or_si128(_mm_or_si128(
+	  _mm_shuffle_epi8(r, _mm_setr_epi8(JSIMD_Z, 11, JSIMD_Z, JSIMD_Z, 12,
+	    JSIMD_Z, JSIMD_Z, 13, JSIMD_Z, JSIMD_Z, 14, JSIMD_Z, JSIMD_Z, 15,
+	    JSIMD_Z, JSIMD_Z)),
+	  _mm_shuffle_epi8(g, _mm_setr_epi8(JSIMD_Z, JSIMD_Z, 11, JSIMD_Z,
+	    JSIMD_Z, 12, JSIMD_Z, JSIMD_Z, 13, JSIMD_Z, JSIMD_Z, 14, JSIMD_Z,
+	    JSIMD_Z, 15, JSIMD_Z))),
+	  _mm_shuffle_epi8(b, _mm_setr_epi8(10, JSIMD_Z, JSIMD_Z, 11, JSIMD_Z,
+	    JSIMD_Z, 12, JSIMD_Z, JSIMD_Z, 13, JSIMD_Z, JSIMD_Z, 14, JSIMD_Z,
+	    JSIMD_Z, 15)));
+  _mm_storeu_si128((__m128i *) (outptr + 32), out);
+}
+
+
+/*
+ * SSE2 has no byte shuffle; the SSE2 converters interleave and
+ * deinterleave pixels with scalar code through these buffers.
+ */
+
+static __inline__ void
+jsimd_store_rgb_sse2 (JSAMPROW outptr, __m128i r, __m128i g, __m128i b)
+{
+  JSAMPLE rs[16], gs[16], bs[16];
+  int i;
+
+  _mm_storeu_si128((__m128i *) rs, r);
+  _mm_storeu_si128((__m128i *) gs, g);
+  _mm_storeu_si128((__m128i *) bs, b);
+  for (i = 0; i < 16; i++) {
+    outptr[RGB_RED] = rs[i];
+    outptr[RGB_GREEN] = gs[i];
+    outptr[RGB_BLUE] = bs[i];
+    outptr += RGB_PIXELSIZE;
+  }
+}
+
+#endif /* JSIMD_SUPPORTED */
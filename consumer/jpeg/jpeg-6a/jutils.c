@@ -14,6 +14,13 @@
 #define JPEG_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jsimd.h"
+
+#ifndef NO_GETENV
+#ifndef HAVE_STDLIB_H		/* <stdlib.h> should declare getenv() */
+extern char * getenv JPP((const char * name));
+#endif
+#endif
 
 
 /*
@@ -177,3 +184,38 @@ jzero_far (void FAR * target, size_t bytestozero)
   }
 #endif
 }
+
+
+/*
+ * SIMD support
+ */
+
+GLOBAL(int)
+jsimd_level (void)
+/* Return the widest instruction set the SIMD routines may use: JSIMD_AVX2
+ * if the CPU has AVX2, else JSIMD_SSE2 where SIMD support is compiled in,
+ * else JSIMD_NONE.  An environment variable JPEGSIMD=0 or JPEGSIMD=1 caps
+ * the level, to test or time the C code and the SSE2 code on any machine.
+ */
+{
+#ifdef JSIMD_SUPPORTED
+  static int level = -1;	/* not yet determined */
+  int l;
+
+  if (level < 0) {
+    __builtin_cpu_init();
+    l = __builtin_cpu_supports("avx2") ? JSIMD_AVX2 : JSIMD_SSE2;
+#ifndef NO_GETENV
+    { char * simdenv;
+
+      if ((simdenv = getenv("JPEGSIMD")) != NULL && atoi(simdenv) < l)
+	l = (atoi(simdenv) < JSIMD_NONE) ? JSIMD_NONE : atoi(simdenv);
+    }
+#endif
+    level = l;
+  }
+  return level;
+#else
+  return JSIMD_NONE;
+#endif
+}
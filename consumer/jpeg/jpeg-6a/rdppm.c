@@ -75,8 +75,14 @@ typedef struct {
   JSAMPROW pixrow;		/* FAR pointer to same */
   size_t buffer_width;		/* width of I/O buffer */
   JSAMPLE *rescale;		/* => maxval-remapping array, or NULL */
+  JOCTET *map;			/* input file mapped into memory, or NULL */
+  size_t map_size;
+  JOCTET *next_row;		/* next row in the mapped file */
+  JDIMENSION rows_left;		/* rows not yet returned from it */
 } ppm_source_struct;
 
+#define MAPPED_ROWS  16		/* rows returned per call from a mapped file */
+
 typedef ppm_source_struct * ppm_source_ptr;
 
 
@@ -234,6 +240,29 @@ get_raw_row (j_compress_ptr cinfo, cjpeg_source_ptr sinfo)
 }
 
 
+METHODDEF(JDIMENSION)
+get_mapped_rows (j_compress_ptr cinfo, cjpeg_source_ptr sinfo)
+/* This version is for raw-byte-format files with maxval = MAXJSAMPLE that
+ * are mapped into memory.  Nothing is read or copied at all: we return
+ * pointers to the rows where they lie in the file.
+ * Note that same code works for PPM and PGM files.
+ */
+{
+  ppm_source_ptr source = (ppm_source_ptr) sinfo;
+  JDIMENSION row, nrows;
+
+  nrows = source->pub.buffer_height;
+  if (nrows > source->rows_left)
+    nrows = source->rows_left;
+  for (row = 0; row < nrows; row++) {
+    source->pub.buffer[row] = (JSAMPROW) source->next_row;
+    source->next_row += source->buffer_width;
+  }
+  source->rows_left -= nrows;
+  return nrows;
+}
+
+
 METHODDEF(JDIMENSION)
 get_word_gray_row (j_compress_ptr cinfo, cjpeg_source_ptr sinfo)
 /* This version is for reading raw-word-format PGM files with any maxval */
@@ -299,6 +328,7 @@ start_input_ppm (j_compress_ptr cinfo, cjpeg_source_ptr sinfo)
   int c;
   unsigned int w, h, maxval;
   boolean need_iobuffer, use_raw_buffer, need_rescale;
+  size_t map_offset;
 
   if (getc(source->pub.input_file) != 'P')
     ERREXIT(cinfo, JERR_PPM_NOT);
@@ -374,6 +404,27 @@ start_input_ppm (j_compress_ptr cinfo, cjpeg_source_ptr sinfo)
     break;
   }
 
+  /* Raw data that needs no rescaling can be used in place if the file
+   * can be mapped into memory (and holds the whole image).
+   */
+  if (use_raw_buffer) {
+    source->map = map_input_file(source->pub.input_file, &map_offset,
+				 &source->map_size);
+    source->buffer_width = (size_t) w * cinfo->input_components;
+    if (source->map != NULL &&
+	(source->map_size - map_offset) / source->buffer_width < (size_t) h) {
+      unmap_input_file(source->map, source->map_size);
+      source->map = NULL;		/* short file: let get_raw_row complain */
+    }
+    if (source->map != NULL) {
+      source->pub.get_pixel_rows = get_mapped_rows;
+      source->next_row = source->map + map_offset;
+      source->rows_left = (JDIMENSION) h;
+      need_iobuffer = FALSE;
+      use_raw_buffer = FALSE;
+    }
+  }
+
   /* Allocate space for I/O buffer: 1 or 3 bytes or words/pixel. */
   if (need_iobuffer) {
     source->buffer_width = (size_t) w * cinfo->input_components *
@@ -384,7 +435,13 @@ start_input_ppm (j_compress_ptr cinfo, cjpeg_source_ptr sinfo)
   }
 
   /* Create compressor input buffer. */
-  if (use_raw_buffer) {
+  if (source->map != NULL) {
+    /* Just an array of row pointers, to be aimed into the mapped file. */
+    source->pub.buffer = (JSAMPARRAY)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				  MAPPED_ROWS * SIZEOF(JSAMPROW));
+    source->pub.buffer_height = MAPPED_ROWS;
+  } else if (use_raw_buffer) {
     /* For unscaled raw-input case, we can just map it onto the I/O buffer. */
     /* Synthesize a JSAMPARRAY pointer structure */
     /* Cast here implies near->far pointer conversion on PCs */
@@ -423,7 +480,12 @@ start_input_ppm (j_compress_ptr cinfo, cjpeg_source_ptr sinfo)
 METHODDEF(void)
 finish_input_ppm (j_compress_ptr cinfo, cjpeg_source_ptr sinfo)
 {
-  /* no work */
+  ppm_source_ptr source = (ppm_source_ptr) sinfo;
+
+  if (source->map != NULL) {
+    unmap_input_file(source->map, source->map_size);
+    source->map = NULL;
+  }
 }
 
 
@@ -443,6 +505,7 @@ jinit_read_ppm (j_compress_ptr cinfo)
   /* Fill in method ptrs, except get_pixel_rows which start_input sets */
   source->pub.start_input = start_input_ppm;
   source->pub.finish_input = finish_input_ppm;
+  source->map = NULL;
 
   return (cjpeg_source_ptr) source;
 }
@@ -335,6 +335,247 @@ void fft_long(
 }
 
 
+#ifdef LAME_SIMD
+/*
+ * The FFTs of both channels at once, for stereo.  The samples of the
+ * channels are interleaved, (ch 0, ch 1) pairs, and a vector holds two
+ * consecutive pairs.  Every lane does the operations of fft_long(),
+ * fft_short() and fht() in the same order, so the spectra are the same
+ * bit for bit.
+ */
+static FLOAT zbuf[2 * BLKSIZE] __attribute__ ((aligned (16)));
+
+/* c1, s1, c2, s2 of step i of each pass of fht(), as its trig
+ * generator computes them */
+static FLOAT fht_tw[TRI_SIZE][4][BLKSIZE / 8];
+
+#define LOAD2(p)	_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *) (p))
+#define STORE2(p, v)	_mm_storel_pi((__m64 *) (p), v)
+#define SWAP(v)		_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2))
+
+/* pcm samples i and i + 1 of both channels */
+static INLINE __m128 pcm_pairs(const short *b0, const short *b1, int i)
+{
+    int l0, l1;
+    __m128i v;
+
+    memcpy(&l0, b0 + i, sizeof(l0));
+    memcpy(&l1, b1 + i, sizeof(l1));
+    v = _mm_unpacklo_epi16(_mm_cvtsi32_si128(l0), _mm_cvtsi32_si128(l1));
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+
+/* w[0], w[0], w[1], w[1] */
+static INLINE __m128 dup_up(const FLOAT *w)
+{
+    __m128 t = LOAD2(w);
+    return _mm_unpacklo_ps(t, t);
+}
+
+/* w[1], w[1], w[0], w[0] */
+static INLINE __m128 dup_down(const FLOAT *w)
+{
+    __m128 t = LOAD2(w);
+    return _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 1, 1));
+}
+
+/* the windowing and the first radix 4 pass of fft_long() (n = BLKSIZE)
+ * and fft_short() (n = BLKSIZE_s), into z */
+static void fft_window2(FLOAT *z, const FLOAT *win, int n,
+			const short *b0, const short *b1)
+{
+    int j, q = n / 4;
+    FLOAT *x = z + n;
+
+    for (j = n / 8 - 1; j >= 0; j--) {
+	int i = rv_tbl[j * (BLKSIZE / n)];
+	__m128 f0, f1, f2, f3, w, t;
+
+	f0 = _mm_mul_ps(dup_up(win + i), pcm_pairs(b0, b1, i));
+	w  = _mm_mul_ps(dup_down(win + 2 * q - 2 - i), pcm_pairs(b0, b1, i + 2 * q));
+	f1 = _mm_sub_ps(f0, w);
+	f0 = _mm_add_ps(f0, w);
+	f2 = _mm_mul_ps(dup_up(win + i + q), pcm_pairs(b0, b1, i + q));
+	w  = _mm_mul_ps(dup_down(win + q - 2 - i), pcm_pairs(b0, b1, i + 3 * q));
+	f3 = _mm_sub_ps(f2, w);
+	f2 = _mm_add_ps(f2, w);
+
+	/* lanes 0, 1 (sample i) go to x[0..3], lanes 2, 3 (sample i + 1)
+	 * to x[n / 2 + 0..3] */
+	x -= 8;
+	t  = _mm_add_ps(f0, f2);
+	w  = _mm_add_ps(f1, f3);
+	_mm_store_ps(x, _mm_movelh_ps(t, w));
+	_mm_store_ps(x + n, _mm_movehl_ps(w, t));
+	t  = _mm_sub_ps(f0, f2);
+	w  = _mm_sub_ps(f1, f3);
+	_mm_store_ps(x + 4, _mm_movelh_ps(t, w));
+	_mm_store_ps(x + n + 4, _mm_movehl_ps(w, t));
+    }
+}
+
+/* one radix 4 butterfly step of fht(): f[] at fi[0], fi[k1], fi[k2],
+ * fi[k3], g[] at gi[...] */
+static INLINE void fht2_step(__m128 f[4], __m128 g[4],
+			     __m128 c1, __m128 s1, __m128 c2, __m128 s2)
+{
+    __m128 a, b, f0, f1, f2, f3, g0, g1, g2, g3;
+
+    b  = _mm_sub_ps(_mm_mul_ps(s2, f[1]), _mm_mul_ps(c2, g[1]));
+    a  = _mm_add_ps(_mm_mul_ps(c2, f[1]), _mm_mul_ps(s2, g[1]));
+    f1 = _mm_sub_ps(f[0], a);
+    f0 = _mm_add_ps(f[0], a);
+    g1 = _mm_sub_ps(g[0], b);
+    g0 = _mm_add_ps(g[0], b);
+    b  = _mm_sub_ps(_mm_mul_ps(s2, f[3]), _mm_mul_ps(c2, g[3]));
+    a  = _mm_add_ps(_mm_mul_ps(c2, f[3]), _mm_mul_ps(s2, g[3]));
+    f3 = _mm_sub_ps(f[2], a);
+    f2 = _mm_add_ps(f[2], a);
+    g3 = _mm_sub_ps(g[2], b);
+    g2 = _mm_add_ps(g[2], b);
+    b  = _mm_sub_ps(_mm_mul_ps(s1, f2), _mm_mul_ps(c1, g3));
+    a  = _mm_add_ps(_mm_mul_ps(c1, f2), _mm_mul_ps(s1, g3));
+    f[2] = _mm_sub_ps(f0, a);
+    f[0] = _mm_add_ps(f0, a);
+    g[3] = _mm_sub_ps(g1, b);
+    g[1] = _mm_add_ps(g1, b);
+    b  = _mm_sub_ps(_mm_mul_ps(c1, g2), _mm_mul_ps(s1, f3));
+    a  = _mm_add_ps(_mm_mul_ps(s1, g2), _mm_mul_ps(c1, f3));
+    g[2] = _mm_sub_ps(g0, a);
+    g[0] = _mm_add_ps(g0, a);
+    f[3] = _mm_sub_ps(f1, b);
+    f[1] = _mm_add_ps(f1, b);
+}
+
+/* fht() of the n interleaved pairs at fz.  Steps i and i + 1 of a pass
+ * are done together; a lone step, and the step i = 0, in the lower half
+ * of a vector */
+static void fht2(FLOAT *fz, int n)
+{
+    FLOAT *fn = fz + 2 * n, *fi, *gi;
+    int k1, k2, k3, k4, kx, i, m, pass = 0;
+    const __m128d sqrt2 = _mm_set1_pd(SQRT2);
+
+    k4 = 4;
+    do {
+	kx = k4 >> 1;
+	k1 = 2 * k4;		/* in FLOATs */
+	k2 = 2 * k1;
+	k3 = k2 + k1;
+	k4 = k2;		/* the pass, in pairs */
+	for (fi = fz; fi < fn; fi += 2 * k4) {
+	    __m128 f0, f1, f2, f3;
+	    gi = fi + 2 * kx;
+	    f1 = _mm_sub_ps(LOAD2(fi), LOAD2(fi + k1));
+	    f0 = _mm_add_ps(LOAD2(fi), LOAD2(fi + k1));
+	    f3 = _mm_sub_ps(LOAD2(fi + k2), LOAD2(fi + k3));
+	    f2 = _mm_add_ps(LOAD2(fi + k2), LOAD2(fi + k3));
+	    STORE2(fi + k2, _mm_sub_ps(f0, f2));
+	    STORE2(fi     , _mm_add_ps(f0, f2));
+	    STORE2(fi + k3, _mm_sub_ps(f1, f3));
+	    STORE2(fi + k1, _mm_add_ps(f1, f3));
+	    f1 = _mm_sub_ps(LOAD2(gi), LOAD2(gi + k1));
+	    f0 = _mm_add_ps(LOAD2(gi), LOAD2(gi + k1));
+	    f3 = _mm_cvtpd_ps(_mm_mul_pd(sqrt2, _mm_cvtps_pd(LOAD2(gi + k3))));
+	    f2 = _mm_cvtpd_ps(_mm_mul_pd(sqrt2, _mm_cvtps_pd(LOAD2(gi + k2))));
+	    STORE2(gi + k2, _mm_sub_ps(f0, f2));
+	    STORE2(gi     , _mm_add_ps(f0, f2));
+	    STORE2(gi + k3, _mm_sub_ps(f1, f3));
+	    STORE2(gi + k1, _mm_add_ps(f1, f3));
+	}
+	for (i = 1; i < kx; i += 2) {
+	    const FLOAT *tw = &fht_tw[pass][0][i];
+	    __m128 c1, s1, c2, s2, f[4], g[4];
+
+	    if (i + 1 < kx) {
+		/* g lanes: pair k1 - i in 0, 1, k1 - i - 1 in 2, 3 */
+		c1 = dup_up(tw);
+		s1 = dup_up(tw + BLKSIZE / 8);
+		c2 = dup_up(tw + 2 * BLKSIZE / 8);
+		s2 = dup_up(tw + 3 * BLKSIZE / 8);
+		for (fi = fz + 2 * i, gi = fz + k1 - 2 * i - 2; fi < fn;
+		     fi += 2 * k4, gi += 2 * k4) {
+		    for (m = 0; m < 4; m++) {
+			f[m] = _mm_loadu_ps(fi + m * k1);
+			g[m] = SWAP(_mm_loadu_ps(gi + m * k1));
+		    }
+		    fht2_step(f, g, c1, s1, c2, s2);
+		    for (m = 0; m < 4; m++) {
+			_mm_storeu_ps(fi + m * k1, f[m]);
+			_mm_storeu_ps(gi + m * k1, SWAP(g[m]));
+		    }
+		}
+	    } else {
+		c1 = _mm_set1_ps(tw[0]);
+		s1 = _mm_set1_ps(tw[BLKSIZE / 8]);
+		c2 = _mm_set1_ps(tw[2 * BLKSIZE / 8]);
+		s2 = _mm_set1_ps(tw[3 * BLKSIZE / 8]);
+		for (fi = fz + 2 * i, gi = fz + k1 - 2 * i; fi < fn;
+		     fi += 2 * k4, gi += 2 * k4) {
+		    for (m = 0; m < 4; m++) {
+			f[m] = LOAD2(fi + m * k1);
+			g[m] = LOAD2(gi + m * k1);
+		    }
+		    fht2_step(f, g, c1, s1, c2, s2);
+		    for (m = 0; m < 4; m++) {
+			STORE2(fi + m * k1, f[m]);
+			STORE2(gi + m * k1, g[m]);
+		    }
+		}
+	    }
+	}
+	pass++;
+    } while (k4 < n);
+}
+
+/* the interleaved pairs at z back to x0[] and x1[] */
+static void fft_split2(const FLOAT *z, int n, FLOAT *x0, FLOAT *x1)
+{
+    int j;
+    for (j = 0; j < n; j += 4) {
+	__m128 a = _mm_load_ps(z + 2 * j), b = _mm_load_ps(z + 2 * j + 4);
+	_mm_storeu_ps(x0 + j, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+	_mm_storeu_ps(x1 + j, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+}
+#endif
+
+
+/* fft_long() of both channels */
+void fft_long2(FLOAT x[2][BLKSIZE], short *buffer[2])
+{
+#ifdef LAME_SIMD
+    if (lame_simd_level() >= SIMD_SSE2) {
+	fft_window2(zbuf, window, BLKSIZE, buffer[0], buffer[1]);
+	fht2(zbuf, BLKSIZE);
+	fft_split2(zbuf, BLKSIZE, x[0], x[1]);
+	return;
+    }
+#endif
+    fft_long(x[0], 0, buffer);
+    fft_long(x[1], 1, buffer);
+}
+
+/* fft_short() of both channels */
+void fft_short2(FLOAT x[2][3][BLKSIZE_s], short *buffer[2])
+{
+    int b;
+#ifdef LAME_SIMD
+    if (lame_simd_level() >= SIMD_SSE2) {
+	for (b = 0; b < 3; b++) {
+	    int k = (576 / 3) * (b + 1);
+	    fft_window2(zbuf, window_s, BLKSIZE_s, buffer[0] + k, buffer[1] + k);
+	    fht2(zbuf, BLKSIZE_s);
+	    fft_split2(zbuf, BLKSIZE_s, x[0][b], x[1][b]);
+	}
+	return;
+    }
+#endif
+    for (b = 0; b < 2; b++)
+	fft_short(x[b], b, buffer);
+}
+
+
 void init_fft(void)
 {
     int i;
@@ -345,6 +586,27 @@ void init_fft(void)
 	costab[i*2+1] = sin(r);
 	r *= 0.25;
     }
+#ifdef LAME_SIMD
+    for (i = 0; i < TRI_SIZE; i++) {
+	FLOAT *tri = &costab[i*2];
+	FLOAT s1, c1, c2, s2;
+	int kx, k;
+	kx = 2 << (2*i);
+	c1 = tri[0];
+	s1 = tri[1];
+	for (k = 1; k < kx; k++) {
+	    c2 = 1 - (2*s1)*s1;
+	    s2 = (2*s1)*c1;
+	    fht_tw[i][0][k] = c1;
+	    fht_tw[i][1][k] = s1;
+	    fht_tw[i][2][k] = c2;
+	    fht_tw[i][3][k] = s2;
+	    c2 = c1;
+	    c1 = c2 * tri[0] - s1 * tri[1];
+	    s1 = c2 * tri[1] + s1 * tri[0];
+	}
+    }
+#endif
 
     /*
      * calculate HANN window coefficients 
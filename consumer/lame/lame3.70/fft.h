@@ -5,6 +5,8 @@
 
 void fft_long(FLOAT x_real[BLKSIZE], int, short **);
 void fft_short(FLOAT x_real[3][BLKSIZE_s], int, short **);
+void fft_long2(FLOAT x_real[2][BLKSIZE], short **);
+void fft_short2(FLOAT x_real[2][3][BLKSIZE_s], short **);
 void init_fft(void);
 
 #endif
@@ -232,6 +232,13 @@ static SNDFILE*	gs_pSndFileIn=NULL;
 static SF_INFO	gs_wfInfo;
 
 
+int lame_seek_infile(lame_global_flags *gfp,unsigned long sample)
+{
+  /* not supported with libsndfile */
+  return -1;
+}
+
+
 unsigned long GetSndSamples(void)
 {
        return gs_wfInfo.samples;
@@ -457,6 +464,8 @@ int read_samples_pcm(lame_global_flags *gfp,short sample_buffer[2304],int frame_
  ************************************************************************
  ************************************************************************/
 
+static long data_start;       /* file offset of the first sample, or -1 */
+
 /* Replacement for forward fseek(,,SEEK_CUR), because fseek() fails on pipes */
 int fskip(FILE *sf,long num_bytes,int dummy)
 {
@@ -481,6 +490,21 @@ void CloseSndFile(lame_global_flags *gfp)
 }
 
 
+/* position the input file at sample 'sample' (in each channel) and
+ * shorten it accordingly.  Only possible for pcm input from a file */
+int lame_seek_infile(lame_global_flags *gfp,unsigned long sample)
+{
+  if (data_start < 0 || gfp->input_format == sf_mp3 ||
+      num_samples == MAX_U_32_NUM || sample > num_samples)
+    return -1;
+  if (fseek(musicin,data_start+(long)sample*2*num_channels,SEEK_SET))
+    return -1;
+  num_samples -= sample;
+  gfp->num_samples = num_samples;
+  return 0;
+}
+
+
 unsigned long GetSndSamples(void)
 {
        return num_samples;
@@ -554,6 +578,7 @@ int default_channels)
    }
  }
     
+  data_start = (musicin == stdin) ? -1 : ftell(musicin);
   if (num_samples==MAX_U_32_NUM && musicin != stdin) {
     /* try to figure out num_samples */
     if (0==stat(inPath,&sb)) {  
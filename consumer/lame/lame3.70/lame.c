@@ -45,6 +45,9 @@
 #ifdef __riscos__
 #include "asmstuff.h"
 #endif
+#ifdef LAME_THREADS
+#include <pthread.h>
+#endif
 
 
 /* Global variable definitions for lame.c */
@@ -600,30 +603,35 @@ FFT's                    <---------1024---------->
     FFT starts at 576-224-MDCTDELAY (304)  = 576-FFTOFFSET
 
 */
-int lame_encode_frame(lame_global_flags *gfp,
-short int inbuf_l[],short int inbuf_r[],
-int mf_size,char *mp3buf, int mp3buf_size)
-{
-  static unsigned long frameBits;
-  static unsigned long bitsPerSlot;
-  static FLOAT8 frac_SpF;
-  static FLOAT8 slot_lag;
-  static unsigned long sentBits = 0;
+/* Everything the quantization and bitstream formatting of one frame
+ * needs from the psychoacoustic model and the MDCT.  With --threads,
+ * a few of these are in flight between the two threads. */
+typedef struct {
+  lame_global_flags gf;                 /* flags as seen by the analysis */
   FLOAT8 xr[2][2][576];
-  int l3_enc[2][2][576];
-  int mp3count;
+  III_psy_ratio masking[2][2];          /* LR or MS ratios, see mode_ext */
+  FLOAT8 pe[2][2];
+  FLOAT8 ms_ratio[2];
+  int block_type[2][2];
+  int mp3count;                         /* output of the frame... */
+  char mp3buf[LAME_MAXMP3BUFFER];       /* ...and the bytes themselves */
+} lame_frame_t;
+
+
+/* psychoacoustics, block type decision, polyphase filtering / mdct
+ * and the ms_stereo decision.  Uses only the state of psymodel.c and
+ * newmdct.c, so it can run ahead of encode_frame_output(). */
+static void encode_frame_analysis(lame_global_flags *gfp,
+short int *inbuf[2],int mf_size,lame_frame_t *fr)
+{
   III_psy_ratio masking_ratio[2][2];    /*LR ratios */
   III_psy_ratio masking_MS_ratio[2][2]; /*MS ratios */
-  III_psy_ratio (*masking)[2][2];  /*LR ratios and MS ratios*/
-  III_scalefac_t scalefac[2][2];
-  short int *inbuf[2];
+  III_side_info_t side;                 /* block types for mdct_sub48 */
 
   typedef FLOAT8 pedata[2][2];
   pedata pe,pe_MS;
-  pedata *pe_use;
 
-  int ch,gr,mean_bits;
-  int bitsPerFrame;
+  int ch,gr;
 
   int check_ms_stereo;
   static FLOAT8 ms_ratio[2]={0,0};
@@ -633,28 +641,10 @@ int mf_size,char *mp3buf, int mp3buf_size)
 
   memset((char *) masking_ratio, 0, sizeof(masking_ratio));
   memset((char *) masking_MS_ratio, 0, sizeof(masking_MS_ratio));
-  memset((char *) scalefac, 0, sizeof(scalefac));
-  inbuf[0]=inbuf_l;
-  inbuf[1]=inbuf_r;
 
   gfp->mode_ext = MPG_MD_LR_LR;
 
   if (gfp->frameNum==0 )  {
-    /* Figure average number of 'slots' per frame. */
-    FLOAT8 avg_slots_per_frame;
-    FLOAT8 sampfreq =   gfp->out_samplerate/1000.0;
-    int bit_rate = gfp->brate;
-    sentBits = 0;
-    bitsPerSlot = 8;
-    avg_slots_per_frame = (bit_rate*gfp->framesize) /
-           (sampfreq* bitsPerSlot);
-    /* -f fast-math option causes some strange rounding here, be carefull: */
-    frac_SpF  = avg_slots_per_frame - floor(avg_slots_per_frame + 1e-9);
-    if (fabs(frac_SpF) < 1e-9) frac_SpF = 0;
-
-    slot_lag  = -frac_SpF;
-    gfp->padding = 1;
-    if (frac_SpF==0) gfp->padding = 0;
     /* check FFT will not use a negative starting offset */
     assert(576>=FFTOFFSET);
     /* check if we have enough data for FFT */
@@ -662,55 +652,6 @@ int mf_size,char *mp3buf, int mp3buf_size)
   }
 
 
-  /********************** padding *****************************/
-  switch (gfp->padding_type) {
-  case 0:
-    gfp->padding=0;
-    break;
-  case 1:
-    gfp->padding=1;
-    break;
-  case 2:
-  default:
-    if (gfp->VBR) {
-      gfp->padding=0;
-    } else {
-      if (gfp->disable_reservoir) {
-	gfp->padding = 0;
-	/* if the user specified --nores, dont very gfp->padding either */
-	/* tiny changes in frac_SpF rounding will cause file differences */
-      }else{
-	if (frac_SpF != 0) {
-	  if (slot_lag > (frac_SpF-1.0) ) {
-	    slot_lag -= frac_SpF;
-	    gfp->padding = 0;
-	  }
-	  else {
-	    gfp->padding = 1;
-	    slot_lag += (1-frac_SpF);
-	  }
-	}
-      }
-    }
-  }
-
-
-  /********************** status display  *****************************/
-  if (!gfp->gtkflag && !gfp->silent) {
-    int mod = gfp->version == 0 ? 200 : 50;
-    if (gfp->frameNum%mod==0) {
-      timestatus(gfp->out_samplerate,gfp->frameNum,gfp->totalframes,gfp->framesize);
-#ifdef BRHIST
-      if (disp_brhist)
-	{
-	  brhist_add_count();
-	  brhist_disp();
-	}
-#endif
-    }
-  }
-
-
   if (gfp->psymodel) {
     /* psychoacoustic model
      * psy model has a 1 granule (576) delay that we must compensate for
@@ -731,40 +672,35 @@ int mf_size,char *mp3buf, int mp3buf_size)
 		     pe[gr],pe_MS[gr],blocktype);
 
       for ( ch = 0; ch < gfp->stereo; ch++ )
-	l3_side.gr[gr].ch[ch].tt.block_type=blocktype[ch];
+	fr->block_type[gr][ch]=blocktype[ch];
 
     }
   }else{
     for (gr=0; gr < gfp->mode_gr ; gr++)
       for ( ch = 0; ch < gfp->stereo; ch++ ) {
-	l3_side.gr[gr].ch[ch].tt.block_type=NORM_TYPE;
+	fr->block_type[gr][ch]=NORM_TYPE;
 	pe[gr][ch]=700;
       }
   }
 
 
-  /* block type flags */
-  for( gr = 0; gr < gfp->mode_gr; gr++ ) {
+  /* block types, as mdct_sub48 reads them */
+  for( gr = 0; gr < gfp->mode_gr; gr++ )
     for ( ch = 0; ch < gfp->stereo; ch++ ) {
-      gr_info *cod_info = &l3_side.gr[gr].ch[ch].tt;
-      cod_info->mixed_block_flag = 0;     /* never used by this model */
-      if (cod_info->block_type == NORM_TYPE )
-	cod_info->window_switching_flag = 0;
-      else
-	cod_info->window_switching_flag = 1;
+      side.gr[gr].ch[ch].tt.block_type = fr->block_type[gr][ch];
+      side.gr[gr].ch[ch].tt.mixed_block_flag = 0;
     }
-  }
 
   /* polyphase filtering / mdct */
-  mdct_sub48(gfp,inbuf[0], inbuf[1], xr, &l3_side);
+  mdct_sub48(gfp,inbuf[0], inbuf[1], fr->xr, &side);
 
   /* use m/s gfp->stereo? */
   check_ms_stereo =  (gfp->mode == MPG_MD_JOINT_STEREO);
   if (check_ms_stereo) {
     /* make sure block type is the same in each channel */
     check_ms_stereo =
-      (l3_side.gr[0].ch[0].tt.block_type==l3_side.gr[0].ch[1].tt.block_type) &&
-      (l3_side.gr[1].ch[0].tt.block_type==l3_side.gr[1].ch[1].tt.block_type);
+      (fr->block_type[0][0]==fr->block_type[0][1]) &&
+      (fr->block_type[1][0]==fr->block_type[1][1]);
   }
   if (check_ms_stereo) {
     /* ms_ratio = is like the ratio of side_energy/total_energy */
@@ -785,9 +721,8 @@ int mf_size,char *mp3buf, int mp3buf_size)
       for ( ch = 0; ch < gfp->stereo; ch++ ) {
 	pinfo->ms_ratio[gr]=ms_ratio[gr];
 	pinfo->ms_ener_ratio[gr]=ms_ener_ratio[gr];
-	pinfo->blocktype[gr][ch]=
-	  l3_side.gr[gr].ch[ch].tt.block_type;
-	for ( j = 0; j < 576; j++ ) pinfo->xr[gr][ch][j]=xr[gr][ch][j];
+	pinfo->blocktype[gr][ch]=fr->block_type[gr][ch];
+	for ( j = 0; j < 576; j++ ) pinfo->xr[gr][ch][j]=fr->xr[gr][ch][j];
 	/* if MS stereo, switch to MS psy data */
 	if (gfp->mode_ext==MPG_MD_MS_LR) {
 	  pinfo->pe[gr][ch]=pinfo->pe[gr][ch+2];
@@ -801,15 +736,127 @@ int mf_size,char *mp3buf, int mp3buf_size)
 #endif
 
 
-
-
-  /* bit and noise allocation */
+  /* keep the masking data the bit and noise allocation will use */
   if (MPG_MD_MS_LR == gfp->mode_ext) {
-    masking = &masking_MS_ratio;    /* use MS masking */
-    pe_use=&pe_MS;
+    memcpy(fr->masking, masking_MS_ratio, sizeof(fr->masking));    /* use MS masking */
+    memcpy(fr->pe, pe_MS, sizeof(fr->pe));
   } else {
-    masking = &masking_ratio;    /* use LR masking */
-    pe_use=&pe;
+    memcpy(fr->masking, masking_ratio, sizeof(fr->masking));    /* use LR masking */
+    memcpy(fr->pe, pe, sizeof(fr->pe));
+  }
+  fr->ms_ratio[0] = ms_ratio[0];
+  fr->ms_ratio[1] = ms_ratio[1];
+}
+
+
+/* padding, bit and noise allocation and bitstream formatting of a frame
+ * analysed by encode_frame_analysis().  Uses the state of the quantizer,
+ * the bit reservoir and the bitstream formatter. */
+static int encode_frame_output(lame_global_flags *gfp,lame_frame_t *fr,
+char *mp3buf, int mp3buf_size)
+{
+  static unsigned long frameBits;
+  static unsigned long bitsPerSlot;
+  static FLOAT8 frac_SpF;
+  static FLOAT8 slot_lag;
+  static unsigned long sentBits = 0;
+  int l3_enc[2][2][576];
+  int mp3count;
+  III_scalefac_t scalefac[2][2];
+
+  int ch,gr,mean_bits,i;
+  int bitsPerFrame;
+
+  memset((char *) scalefac, 0, sizeof(scalefac));
+
+  if (gfp->frameNum==0 )  {
+    /* Figure average number of 'slots' per frame. */
+    FLOAT8 avg_slots_per_frame;
+    FLOAT8 sampfreq =   gfp->out_samplerate/1000.0;
+    int bit_rate = gfp->brate;
+    sentBits = 0;
+    bitsPerSlot = 8;
+    avg_slots_per_frame = (bit_rate*gfp->framesize) /
+           (sampfreq* bitsPerSlot);
+    /* -f fast-math option causes some strange rounding here, be carefull: */
+    frac_SpF  = avg_slots_per_frame - floor(avg_slots_per_frame + 1e-9);
+    if (fabs(frac_SpF) < 1e-9) frac_SpF = 0;
+
+    slot_lag  = -frac_SpF;
+    gfp->padding = 1;
+    if (frac_SpF==0) gfp->padding = 0;
+
+    /* a part of a longer stream goes on with the padding of the frames
+     * before it, as adjusted below */
+    for (i = 0; i < gfp->padding_start_frame; i++) {
+      if (slot_lag > (frac_SpF-1.0) )
+	slot_lag -= frac_SpF;
+      else
+	slot_lag += (1-frac_SpF);
+    }
+  }
+
+
+  /********************** padding *****************************/
+  switch (gfp->padding_type) {
+  case 0:
+    gfp->padding=0;
+    break;
+  case 1:
+    gfp->padding=1;
+    break;
+  case 2:
+  default:
+    if (gfp->VBR) {
+      gfp->padding=0;
+    } else {
+      if (gfp->disable_reservoir) {
+	gfp->padding = 0;
+	/* if the user specified --nores, dont very gfp->padding either */
+	/* tiny changes in frac_SpF rounding will cause file differences */
+      }else{
+	if (frac_SpF != 0) {
+	  if (slot_lag > (frac_SpF-1.0) ) {
+	    slot_lag -= frac_SpF;
+	    gfp->padding = 0;
+	  }
+	  else {
+	    gfp->padding = 1;
+	    slot_lag += (1-frac_SpF);
+	  }
+	}
+      }
+    }
+  }
+
+
+  /********************** status display  *****************************/
+  if (!gfp->gtkflag && !gfp->silent) {
+    int mod = gfp->version == 0 ? 200 : 50;
+    if (gfp->frameNum%mod==0) {
+      timestatus(gfp->out_samplerate,gfp->frameNum,gfp->totalframes,gfp->framesize);
+#ifdef BRHIST
+      if (disp_brhist)
+	{
+	  brhist_add_count();
+	  brhist_disp();
+	}
+#endif
+    }
+  }
+
+
+  /* block type flags */
+  for( gr = 0; gr < gfp->mode_gr; gr++ ) {
+    for ( ch = 0; ch < gfp->stereo; ch++ ) {
+      gr_info *cod_info = &l3_side.gr[gr].ch[ch].tt;
+      cod_info->block_type = fr->block_type[gr][ch];
+      cod_info->mixed_block_flag = 0;     /* never used by this model */
+      if (cod_info->block_type == NORM_TYPE )
+	cod_info->window_switching_flag = 0;
+      else
+	cod_info->window_switching_flag = 1;
+    }
   }
 
 
@@ -820,10 +867,10 @@ int mf_size,char *mp3buf, int mp3buf_size)
 
 
   if (gfp->VBR) {
-    VBR_iteration_loop( gfp,*pe_use, ms_ratio, xr, *masking, &l3_side, l3_enc,
+    VBR_iteration_loop( gfp,fr->pe, fr->ms_ratio, fr->xr, fr->masking, &l3_side, l3_enc,
 			scalefac);
   }else{
-    iteration_loop( gfp,*pe_use, ms_ratio, xr, *masking, &l3_side, l3_enc,
+    iteration_loop( gfp,fr->pe, fr->ms_ratio, fr->xr, fr->masking, &l3_side, l3_enc,
 		    scalefac);
   }
 
@@ -855,9 +902,217 @@ int mf_size,char *mp3buf, int mp3buf_size)
 
   if (gfp->bWriteVbrTag) AddVbrFrame((int)(sentBits/8));
 
+  return mp3count;
+}
+
+
+
+#ifdef LAME_THREADS
+/************************************************************************
+*
+* Pipelined encoding (--threads)
+*
+* encode_frame_analysis() runs on the calling thread, and
+* encode_frame_output() on a second thread, up to PIPE_FRAMES-1 frames
+* behind.  The two only share the lame_frame_t handed from one to the
+* other: psymodel.c and newmdct.c belong to the first thread, the
+* quantizer, the reservoir and the bitstream to the second, and the
+* second works on the copy of the flags taken with each frame.  The
+* only flags it changes, padding and bitrate_index, are carried from
+* frame to frame in the pipe instead.  Frames are formatted in order,
+* so the mp3 data is the same as without threads, just returned by
+* lame_encode_buffer() a few frames later.
+*
+************************************************************************/
+#define PIPE_FRAMES 4
+
+enum { PIPE_FREE, PIPE_READY, PIPE_DONE };
+
+static struct {
+  int active;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  lame_frame_t *frames;
+  int state[PIPE_FRAMES];
+  int next_in;          /* next frame to analyse */
+  int next_out;         /* next frame to hand back */
+  int quit;
+  int padding;          /* flags owned by encode_frame_output() */
+  int bitrate_index;
+} pipeline;
+
+
+static void *pipe_worker(void *arg)
+{
+  int n = 0;
+  lame_frame_t *fr;
+
+  for (;;) {
+    pthread_mutex_lock(&pipeline.lock);
+    while (pipeline.state[n] != PIPE_READY && !pipeline.quit)
+      pthread_cond_wait(&pipeline.cond, &pipeline.lock);
+    if (pipeline.state[n] != PIPE_READY) {
+      pthread_mutex_unlock(&pipeline.lock);
+      break;
+    }
+    pthread_mutex_unlock(&pipeline.lock);
+
+    fr = &pipeline.frames[n];
+    fr->gf.padding = pipeline.padding;
+    fr->gf.bitrate_index = pipeline.bitrate_index;
+    fr->mp3count = encode_frame_output(&fr->gf, fr, fr->mp3buf,
+				       (int)sizeof(fr->mp3buf));
+    pipeline.padding = fr->gf.padding;
+    pipeline.bitrate_index = fr->gf.bitrate_index;
+
+    pthread_mutex_lock(&pipeline.lock);
+    pipeline.state[n] = PIPE_DONE;
+    pthread_cond_broadcast(&pipeline.cond);
+    pthread_mutex_unlock(&pipeline.lock);
+    n = (n + 1) % PIPE_FRAMES;
+  }
+  return NULL;
+}
+
+
+static void pipe_start(lame_global_flags *gfp)
+{
+  int i;
+  pipeline.frames = (lame_frame_t *) malloc(PIPE_FRAMES * sizeof(lame_frame_t));
+  if (pipeline.frames == NULL) {
+    fprintf(stderr,"Error: can't allocate the frame pipeline\n");
+    exit(1);
+  }
+  for (i = 0; i < PIPE_FRAMES; i++) pipeline.state[i] = PIPE_FREE;
+  pipeline.next_in = pipeline.next_out = 0;
+  pipeline.quit = 0;
+  pipeline.padding = gfp->padding;
+  pipeline.bitrate_index = gfp->bitrate_index;
+  pthread_mutex_init(&pipeline.lock, NULL);
+  pthread_cond_init(&pipeline.cond, NULL);
+  if (pthread_create(&pipeline.thread, NULL, pipe_worker, NULL) != 0) {
+    fprintf(stderr,"Error: can't create the encoding thread\n");
+    exit(1);
+  }
+  pipeline.active = 1;
+}
+
+
+/* hand back the mp3 data of the oldest frame if it is done, or, if
+ * 'wait', once it is done.  Returns the number of bytes, or -1 if mp3buf
+ * is too small, and sets *got if a frame was handed back. */
+static int pipe_collect(char *mp3buf, int mp3buf_size, int wait, int *got)
+{
+  int n = pipeline.next_out, state;
+  lame_frame_t *fr = &pipeline.frames[n];
+
+  pthread_mutex_lock(&pipeline.lock);
+  while (wait && pipeline.state[n] == PIPE_READY)
+    pthread_cond_wait(&pipeline.cond, &pipeline.lock);
+  state = pipeline.state[n];
+  pthread_mutex_unlock(&pipeline.lock);
+
+  *got = 0;
+  if (state != PIPE_DONE) return 0;
+  if (fr->mp3count == -1 || (mp3buf_size != 0 && fr->mp3count > mp3buf_size))
+    return -1;
+  memcpy(mp3buf, fr->mp3buf, fr->mp3count);
+  pipeline.state[n] = PIPE_FREE;     /* the worker is done with it */
+  pipeline.next_out = (n + 1) % PIPE_FRAMES;
+  *got = 1;
+  return fr->mp3count;
+}
+
+
+/* hand back the mp3 data of all frames in the pipe, then stop the
+ * second thread.  Returns the number of bytes or -1 as above. */
+static int pipe_finish(lame_global_flags *gfp, char *mp3buf, int mp3buf_size)
+{
+  int ret, got, mp3count = 0;
+
+  if (!pipeline.active) return 0;
+  do {
+    ret = pipe_collect(mp3buf, mp3buf_size == 0 ? 0 : mp3buf_size - mp3count,
+		       1, &got);
+    if (ret == -1) { mp3count = -1; break; }
+    mp3buf += ret;
+    mp3count += ret;
+  } while (got);
+
+  pthread_mutex_lock(&pipeline.lock);
+  pipeline.quit = 1;
+  pthread_cond_broadcast(&pipeline.cond);
+  pthread_mutex_unlock(&pipeline.lock);
+  pthread_join(pipeline.thread, NULL);
+  pthread_mutex_destroy(&pipeline.lock);
+  pthread_cond_destroy(&pipeline.cond);
+  free(pipeline.frames);
+  pipeline.active = 0;
+
+  gfp->padding = pipeline.padding;
+  gfp->bitrate_index = pipeline.bitrate_index;
+  return mp3count;
+}
+
+
+static int pipe_encode_frame(lame_global_flags *gfp, short int *inbuf[2],
+int mf_size, char *mp3buf, int mp3buf_size)
+{
+  int ret, got, mp3count = 0;
+  lame_frame_t *fr;
+
+  if (!pipeline.active) pipe_start(gfp);
+
+  /* hand back what is done, waiting for the oldest frame if the pipe is
+   * full (only this thread frees frames, so that test needs no lock) */
+  do {
+    ret = pipe_collect(mp3buf, mp3buf_size == 0 ? 0 : mp3buf_size - mp3count,
+		       pipeline.next_out == pipeline.next_in, &got);
+    if (ret == -1) return -1;
+    mp3buf += ret;
+    mp3count += ret;
+  } while (got && pipeline.next_out != pipeline.next_in);
+
+  fr = &pipeline.frames[pipeline.next_in];
+  encode_frame_analysis(gfp, inbuf, mf_size, fr);
+  fr->gf = *gfp;
+
+  pthread_mutex_lock(&pipeline.lock);
+  pipeline.state[pipeline.next_in] = PIPE_READY;
+  pthread_cond_broadcast(&pipeline.cond);
+  pthread_mutex_unlock(&pipeline.lock);
+  pipeline.next_in = (pipeline.next_in + 1) % PIPE_FRAMES;
+
+  gfp->frameNum++;
+  return mp3count;
+}
+#endif /* LAME_THREADS */
+
+
+
+int lame_encode_frame(lame_global_flags *gfp,
+short int inbuf_l[],short int inbuf_r[],
+int mf_size,char *mp3buf, int mp3buf_size)
+{
+  static lame_frame_t frame;
+  int mp3count;
+  short int *inbuf[2];
+
+  inbuf[0]=inbuf_l;
+  inbuf[1]=inbuf_r;
+
+#ifdef LAME_THREADS
+  if (gfp->num_threads > 1 && !gfp->gtkflag)
+    return pipe_encode_frame(gfp, inbuf, mf_size, mp3buf, mp3buf_size);
+#endif
+
+  encode_frame_analysis(gfp, inbuf, mf_size, &frame);
+  mp3count = encode_frame_output(gfp, &frame, mp3buf, mp3buf_size);
+
 #ifdef HAVEGTK
   if (gfp->gtkflag) {
-    int j;
+    int j,ch;
     for ( ch = 0; ch < gfp->stereo; ch++ ) {
       for ( j = 0; j < FFTOFFSET; j++ )
 	pinfo->pcmdata[ch][j] = pinfo->pcmdata[ch][j+gfp->framesize];
@@ -872,8 +1127,6 @@ int mf_size,char *mp3buf, int mp3buf_size)
   return mp3count;
 }
 
-
-
 int fill_buffer_resample(lame_global_flags *gfp,short int *outbuf,int desired_len,
         short int *inbuf,int len,int *num_used,int ch) {
 
@@ -1279,6 +1532,10 @@ void lame_init(lame_global_flags *gfp)
   gfp->bWriteVbrTag=1;
   gfp->cwlimit=0;
   gfp->disable_reservoir=0;
+  gfp->reservoir_start_frame=0;
+  gfp->padding_start_frame=0;
+  gfp->num_threads=1;
+  gfp->segments=1;
   gfp->experimentalX = 0;
   gfp->experimentalY = 0;
   gfp->experimentalZ = 0;
@@ -1364,6 +1621,20 @@ int lame_encode_finish(lame_global_flags *gfp,char *mp3buffer, int mp3buffer_siz
     mf_samples_to_encode -= gfp->framesize;
   }
 
+#ifdef LAME_THREADS
+  /* the last frames may still be in the pipeline */
+  mp3buffer_size_remaining = mp3buffer_size - mp3count;
+  if (mp3buffer_size == 0) mp3buffer_size_remaining=0;  
+  imp3=pipe_finish(gfp,mp3buffer,mp3buffer_size_remaining);
+  if (imp3 == -1) {
+    /* fatel error: mp3buffer too small */
+    desalloc_buffer(&bs);    /* Deallocate all buffers */
+    return -1;
+  }
+  mp3buffer += imp3;
+  mp3count += imp3;
+#endif
+
 
   gfp->frameNum--;
   if (!gfp->gtkflag && !gfp->silent) {
@@ -61,16 +61,24 @@ typedef struct  {
   int mode_fixed;                 /* use specified the mode, do not use lame's opinion of the best mode */
   int force_ms;                   /* force M/S mode.  requires mode=1 */
   int brate;                      /* bitrate */
+  int num_threads;                /* >1: quantize on a second thread. default=1 */
+  int segments;                   /* frontend: encode this many parts of the
+                                     input in parallel. default=1 */
 
   /* frame params */
   int copyright;                  /* mark as copyright. default=0 */
   int original;                   /* mark as original. default=1 */
   int error_protection;           /* use 2 bytes per frame for a CRC checksum. default=0*/
   int padding_type;               /* 0=no padding, 1=always pad, 2=adjust padding */
+  int padding_start_frame;        /* adjust padding as if this many frames
+                                     had been coded before. default=0 */
   int extension;                  /* the MP3 'private extension' bit.  meaningless */
 
   /* quantization/noise shaping */
   int disable_reservoir;          /* use bit reservoir? */
+  int reservoir_start_frame;      /* no bits are saved for later frames before
+                                     this one, so the stream can be cut
+                                     there. default=0 */
   int experimentalX;            
   int experimentalY;
   int experimentalZ;
@@ -309,6 +317,17 @@ int lame_readframe(lame_global_flags *,short int Buffer[2][1152]);
 /* OPTIONAL: close the sound input file if lame_init_infile() was used */
 void lame_close_infile(lame_global_flags *);
 
+/* OPTIONAL: skip the first 'sample' samples of the input file opened by
+ * lame_init_infile.  Only for wav, aiff or raw pcm files (not stdin).
+ * returns 0, or -1 if the input can not be positioned */
+int lame_seek_infile(lame_global_flags *,unsigned long sample);
+
+/* OPTIONAL: encode the whole input file opened by lame_init_infile to
+ * outf, in gfp->segments parts encoded in parallel (needs LAME_THREADS).
+ * returns 0, or -1 (nothing done) if the input or options do not allow
+ * it, in which case encode the input as usual */
+int lame_encode_segments(lame_global_flags *,FILE *outf);
+
 
 
 
@@ -107,6 +107,22 @@ typedef double FLOAT8;
 #endif
 
 
+/* SIMD kernels for the filterbank, the MDCT, the FFTs of the psycho
+   acoustic model, the quantization and the bit counting, compiled
+   with GCC-compatible compilers for x86-64 (which always has SSE2).
+   The AVX2 kernels are compiled with a target attribute and called
+   only if lame_simd_level() finds AVX2 at run time.  They must give
+   bit for bit the results of the C code, so no FMA: do not add
+   "fma" to LAME_AVX2 */
+#if (defined(__GNUC__) && defined(__x86_64__))
+#	define LAME_SIMD
+#	include <immintrin.h>
+#	define LAME_AVX2 __attribute__((target("avx2")))
+#endif
+
+#define SIMD_NONE 0
+#define SIMD_SSE2 1
+#define SIMD_AVX2 2
 
 
 #endif
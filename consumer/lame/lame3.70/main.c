@@ -97,6 +97,16 @@ int main(int argc, char **argv)
   lame_init_params(&gf);
   lame_print_config(&gf);   /* print usefull information about options being used */
 
+#ifdef LAME_THREADS
+  /* encode parts of the input file in parallel, if asked for and possible */
+  if (gf.segments > 1 && !gf.gtkflag && lame_encode_segments(&gf,outf)==0) {
+    fclose(outf);
+    lame_close_infile(&gf);
+    lame_mp3_tags(&gf);
+    return 0;
+  }
+#endif
+
 
 
 
@@ -216,6 +216,240 @@ static void window_subband(short *xk, FLOAT8 d[SBLIMIT], FLOAT8 *in)
 }
 
 
+#ifdef LAME_SIMD
+/*
+ * window_subband() of two (SSE2) or four (AVX2) blocks of 32 samples at
+ * once, one block per lane.  The samples are read from a lane-interleaved
+ * copy of the pcm data, sample n of all lanes at xk[n * lanes], and each
+ * lane does the operations of window_subband() in the same order, so the
+ * subband samples are the same bit for bit.
+ */
+#define XS_LEN (17 * 32 + 511)	/* samples read by the 18 blocks of a granule */
+static FLOAT8 xs[4 * XS_LEN] __attribute__ ((aligned (32)));
+
+static void window_subband_sse2(const FLOAT8 *xk, FLOAT8 *d0, FLOAT8 *d1)
+{
+    __m128d in[31], s, t, w;
+    const FLOAT8 *wp = enwindow;
+    int i, j;
+
+#define X(n)		_mm_load_pd(xk + 2 * (n))
+#define MAC(a, x)	a = _mm_add_pd(a, _mm_mul_pd(x, w))
+#define MSC(a, x)	a = _mm_sub_pd(a, _mm_mul_pd(x, w))
+#define W()		w = _mm_set1_pd(*wp++)
+#define X1(n)		X((n) + i)
+#define X2(n)		X((n) - i)
+    t = X(255);
+    W(); MAC(t, _mm_sub_pd(X(223), X(287)));
+    W(); MAC(t, _mm_add_pd(X(191), X(319)));
+    W(); MAC(t, _mm_sub_pd(X(159), X(351)));
+    W(); MAC(t, _mm_add_pd(X(127), X(383)));
+    W(); MAC(t, _mm_sub_pd(X( 95), X(415)));
+    W(); MAC(t, _mm_add_pd(X( 63), X(447)));
+    W(); MAC(t, _mm_sub_pd(X( 31), X(479)));
+    in[15] = t;
+
+    for (i = 14; i >= 0; --i) {
+	s = X2(270); t = X1(240);
+	W(); MAC(s, X2(334)); MAC(t, X1(176));
+	W(); MAC(s, X2(398)); MAC(t, X1(112));
+	W(); MAC(s, X2(462)); MAC(t, X1( 48));
+	W(); MAC(s, X2( 14)); MAC(t, X1(496));
+	W(); MAC(s, X2( 78)); MAC(t, X1(432));
+	W(); MAC(s, X2(142)); MAC(t, X1(368));
+	W(); MAC(s, X2(206)); MAC(t, X1(304));
+
+	W(); MAC(s, X1( 16)); MSC(t, X2(494));
+	W(); MAC(s, X1( 80)); MSC(t, X2(430));
+	W(); MAC(s, X1(144)); MSC(t, X2(366));
+	W(); MAC(s, X1(208)); MSC(t, X2(302));
+	W(); MSC(s, X1(272)); MAC(t, X2(238));
+	W(); MSC(s, X1(336)); MAC(t, X2(174));
+	W(); MSC(s, X1(400)); MAC(t, X2(110));
+	W(); MSC(s, X1(464)); MAC(t, X2( 46));
+
+	in[30 - i] = s;
+	in[i] = t;
+    }
+
+    s = X(239);
+    W(); MAC(s, X(175));
+    W(); MAC(s, X(111));
+    W(); MAC(s, X( 47));
+    W(); MSC(s, X(303));
+    W(); MSC(s, X(367));
+    W(); MSC(s, X(431));
+    W(); MSC(s, X(495));
+
+    wp = &mm[0][0];
+    for (i = 15; i >= 0; --i) {
+	__m128d s0 = s, s1;
+	W(); s1 = _mm_mul_pd(t, w);
+	for (j = 1; j < 31; j += 2) {
+	    W(); MAC(s0, in[j]);
+	    W(); MAC(s1, in[j + 1]);
+	}
+	w = _mm_add_pd(s0, s1);
+	_mm_storel_pd(d0 + i, w);
+	_mm_storeh_pd(d1 + i, w);
+	w = _mm_sub_pd(s0, s1);
+	_mm_storel_pd(d0 + 31 - i, w);
+	_mm_storeh_pd(d1 + 31 - i, w);
+    }
+}
+
+LAME_AVX2 static void window_subband_avx2(const FLOAT8 *xk, FLOAT8 *d0, FLOAT8 *d1,
+					   FLOAT8 *d2, FLOAT8 *d3)
+{
+    __m256d in[31], s, t, w;
+    const FLOAT8 *wp = enwindow;
+    int i, j;
+
+#undef X
+#undef MAC
+#undef MSC
+#undef W
+#define X(n)		_mm256_load_pd(xk + 4 * (n))
+#define MAC(a, x)	a = _mm256_add_pd(a, _mm256_mul_pd(x, w))
+#define MSC(a, x)	a = _mm256_sub_pd(a, _mm256_mul_pd(x, w))
+#define W()		w = _mm256_set1_pd(*wp++)
+    t = X(255);
+    W(); MAC(t, _mm256_sub_pd(X(223), X(287)));
+    W(); MAC(t, _mm256_add_pd(X(191), X(319)));
+    W(); MAC(t, _mm256_sub_pd(X(159), X(351)));
+    W(); MAC(t, _mm256_add_pd(X(127), X(383)));
+    W(); MAC(t, _mm256_sub_pd(X( 95), X(415)));
+    W(); MAC(t, _mm256_add_pd(X( 63), X(447)));
+    W(); MAC(t, _mm256_sub_pd(X( 31), X(479)));
+    in[15] = t;
+
+    for (i = 14; i >= 0; --i) {
+	s = X2(270); t = X1(240);
+	W(); MAC(s, X2(334)); MAC(t, X1(176));
+	W(); MAC(s, X2(398)); MAC(t, X1(112));
+	W(); MAC(s, X2(462)); MAC(t, X1( 48));
+	W(); MAC(s, X2( 14)); MAC(t, X1(496));
+	W(); MAC(s, X2( 78)); MAC(t, X1(432));
+	W(); MAC(s, X2(142)); MAC(t, X1(368));
+	W(); MAC(s, X2(206)); MAC(t, X1(304));
+
+	W(); MAC(s, X1( 16)); MSC(t, X2(494));
+	W(); MAC(s, X1( 80)); MSC(t, X2(430));
+	W(); MAC(s, X1(144)); MSC(t, X2(366));
+	W(); MAC(s, X1(208)); MSC(t, X2(302));
+	W(); MSC(s, X1(272)); MAC(t, X2(238));
+	W(); MSC(s, X1(336)); MAC(t, X2(174));
+	W(); MSC(s, X1(400)); MAC(t, X2(110));
+	W(); MSC(s, X1(464)); MAC(t, X2( 46));
+
+	in[30 - i] = s;
+	in[i] = t;
+    }
+
+    s = X(239);
+    W(); MAC(s, X(175));
+    W(); MAC(s, X(111));
+    W(); MAC(s, X( 47));
+    W(); MSC(s, X(303));
+    W(); MSC(s, X(367));
+    W(); MSC(s, X(431));
+    W(); MSC(s, X(495));
+
+    wp = &mm[0][0];
+    for (i = 15; i >= 0; --i) {
+	__m256d s0 = s, s1;
+	__m128d lo, hi;
+	W(); s1 = _mm256_mul_pd(t, w);
+	for (j = 1; j < 31; j += 2) {
+	    W(); MAC(s0, in[j]);
+	    W(); MAC(s1, in[j + 1]);
+	}
+	w = _mm256_add_pd(s0, s1);
+	lo = _mm256_castpd256_pd128(w);
+	hi = _mm256_extractf128_pd(w, 1);
+	_mm_storel_pd(d0 + i, lo);
+	_mm_storeh_pd(d1 + i, lo);
+	_mm_storel_pd(d2 + i, hi);
+	_mm_storeh_pd(d3 + i, hi);
+	w = _mm256_sub_pd(s0, s1);
+	lo = _mm256_castpd256_pd128(w);
+	hi = _mm256_extractf128_pd(w, 1);
+	_mm_storel_pd(d0 + 31 - i, lo);
+	_mm_storeh_pd(d1 + 31 - i, lo);
+	_mm_storel_pd(d2 + 31 - i, hi);
+	_mm_storeh_pd(d3 + 31 - i, hi);
+    }
+#undef X
+#undef X1
+#undef X2
+#undef MAC
+#undef MSC
+#undef W
+}
+#endif
+
+
+/*
+ * polyphase filter the 18 blocks of 32 samples of granule gr of all
+ * channels into sb_sample[ch][1 - gr].  With SIMD the channels of a
+ * stereo granule are filtered together, in the lanes of a vector
+ */
+static void window_subband_granule(int stereo, short *x0, short *x1, int gr)
+{
+    FLOAT8 *samp0 = sb_sample[0][1 - gr][0];
+    FLOAT8 *samp1 = sb_sample[1][1 - gr][0];
+    int ch, k, n, band;
+#ifdef LAME_SIMD
+    int simd = lame_simd_level();
+
+    if (simd == SIMD_AVX2 && stereo == 2) {
+	/* lanes: block k and k + 1 of both channels */
+	for (n = 0; n < XS_LEN - 32; n++) {
+	    xs[4 * n    ] = x0[n];
+	    xs[4 * n + 1] = x1[n];
+	    xs[4 * n + 2] = x0[n + 32];
+	    xs[4 * n + 3] = x1[n + 32];
+	}
+	for (k = 0; k < 18 * 32; k += 64)
+	    window_subband_avx2(xs + 4 * k, samp0 + k, samp1 + k,
+				samp0 + k + 32, samp1 + k + 32);
+    } else if (simd >= SIMD_SSE2 && stereo == 2) {
+	/* lanes: block k of both channels */
+	for (n = 0; n < XS_LEN; n++) {
+	    xs[2 * n    ] = x0[n];
+	    xs[2 * n + 1] = x1[n];
+	}
+	for (k = 0; k < 18 * 32; k += 32)
+	    window_subband_sse2(xs + 2 * k, samp0 + k, samp1 + k);
+    } else if (simd >= SIMD_SSE2) {
+	/* lanes: block k and k + 1 */
+	for (n = 0; n < XS_LEN - 32; n++) {
+	    xs[2 * n    ] = x0[n];
+	    xs[2 * n + 1] = x0[n + 32];
+	}
+	for (k = 0; k < 18 * 32; k += 64)
+	    window_subband_sse2(xs + 2 * k, samp0 + k, samp0 + k + 32);
+    } else
+#endif
+    for (ch = 0; ch < stereo; ch++) {
+	short *wk = ch ? x1 : x0;
+	FLOAT8 *samp = ch ? samp1 : samp0;
+	for (k = 0; k < 18 * 32; k += 32)
+	    window_subband(wk + k, samp + k, work);
+    }
+
+    /*
+     * Compensate for inversion in the analysis filter
+     */
+    for (ch = 0; ch < stereo; ch++) {
+	FLOAT8 *samp = ch ? samp1 : samp0;
+	for (k = 32; k < 18 * 32; k += 64)
+	    for (band = 1; band < 32; band += 2)
+		samp[k + band] *= -1.0;
+    }
+}
+
+
 /*-------------------------------------------------------------------*/
 /*                                                                   */
 /*   Function: Calculation of the MDCT                               */
@@ -324,14 +558,143 @@ static void mdct_long(FLOAT8 *out, FLOAT8 *in)
 }
 
 
+/* windowed samples of the long blocks of a granule, and where their
+ * mdct goes.  With SIMD, groups of 2 or 4 blocks are interleaved, one
+ * block per lane */
+#ifdef LAME_SIMD
+static FLOAT8 mdct_in[2 * 32 * 18] __attribute__ ((aligned (32)));
+#else
+static FLOAT8 mdct_in[2 * 32 * 18];
+#endif
+static FLOAT8 *mdct_out[2 * 32];
+
+#ifdef LAME_SIMD
+static FLOAT8 mdct_dummy[18];	/* output of the unused lanes */
+
+/*
+ * mdct_long() of two or four blocks, one per lane, with the operations
+ * of the C code in the same order
+ */
+static void mdct_long_sse2(FLOAT8 **out, const FLOAT8 *in)
+{
+    __m128d s0, s1, s2, s3, s4, s5, a;
+    int j = sizeof(all) / sizeof(int) - 1;
+    const FLOAT8 *cos_l0 = cos_l;
+
+#define IN(k)		_mm_load_pd(in + 2 * (k))
+#define MUL(x, k)	_mm_mul_pd(x, _mm_set1_pd(cos_l0[k]))
+#define OUT(i, x)	(_mm_storel_pd(out[0] + (i), x), _mm_storeh_pd(out[1] + (i), x))
+    do {
+	int k;
+	a = MUL(IN(0), 0);
+	for (k = 1; k < 18; k++)
+	    a = _mm_add_pd(a, MUL(IN(k), k));
+	OUT(all[j], a);
+	cos_l0 += 18;
+    } while (--j >= 0);
+
+    s0 = _mm_add_pd(_mm_add_pd(IN(0), IN( 5)), IN(15));
+    s1 = _mm_add_pd(_mm_add_pd(IN(1), IN( 4)), IN(16));
+    s2 = _mm_add_pd(_mm_add_pd(IN(2), IN( 3)), IN(17));
+    s3 = _mm_add_pd(_mm_sub_pd(IN(6), IN( 9)), IN(14));
+    s4 = _mm_add_pd(_mm_sub_pd(IN(7), IN(10)), IN(13));
+    s5 = _mm_add_pd(_mm_sub_pd(IN(8), IN(11)), IN(12));
+
+#define OUT6(i)	a = MUL(s0, 0);					\
+		a = _mm_add_pd(a, MUL(s1, 1));			\
+		a = _mm_add_pd(a, MUL(s2, 2));			\
+		a = _mm_add_pd(a, MUL(s3, 3));			\
+		a = _mm_add_pd(a, MUL(s4, 4));			\
+		a = _mm_add_pd(a, MUL(s5, 5));			\
+		OUT(i, a);					\
+		cos_l0 += 6
+    OUT6(16);
+    OUT6(10);
+    OUT6(7);
+    OUT6(1);
+
+    s0 = _mm_add_pd(_mm_sub_pd(s0, s1), s5);
+    s2 = _mm_sub_pd(_mm_sub_pd(s2, s3), s4);
+    OUT(13, _mm_add_pd(MUL(s0, 0), MUL(s2, 1)));
+    OUT(4, _mm_add_pd(MUL(s0, 2), MUL(s2, 3)));
+#undef IN
+#undef MUL
+#undef OUT
+}
+
+LAME_AVX2 static void mdct_store4(FLOAT8 **out, int i, __m256d x)
+{
+    __m128d lo = _mm256_castpd256_pd128(x), hi = _mm256_extractf128_pd(x, 1);
+    _mm_storel_pd(out[0] + i, lo);
+    _mm_storeh_pd(out[1] + i, lo);
+    _mm_storel_pd(out[2] + i, hi);
+    _mm_storeh_pd(out[3] + i, hi);
+}
+
+LAME_AVX2 static void mdct_long_avx2(FLOAT8 **out, const FLOAT8 *in)
+{
+    __m256d s0, s1, s2, s3, s4, s5, a;
+    int j = sizeof(all) / sizeof(int) - 1;
+    const FLOAT8 *cos_l0 = cos_l;
+
+#define IN(k)		_mm256_load_pd(in + 4 * (k))
+#define MUL(x, k)	_mm256_mul_pd(x, _mm256_set1_pd(cos_l0[k]))
+#define OUT(i, x)	mdct_store4(out, i, x)
+    do {
+	int k;
+	a = MUL(IN(0), 0);
+	for (k = 1; k < 18; k++)
+	    a = _mm256_add_pd(a, MUL(IN(k), k));
+	OUT(all[j], a);
+	cos_l0 += 18;
+    } while (--j >= 0);
+
+    s0 = _mm256_add_pd(_mm256_add_pd(IN(0), IN( 5)), IN(15));
+    s1 = _mm256_add_pd(_mm256_add_pd(IN(1), IN( 4)), IN(16));
+    s2 = _mm256_add_pd(_mm256_add_pd(IN(2), IN( 3)), IN(17));
+    s3 = _mm256_add_pd(_mm256_sub_pd(IN(6), IN( 9)), IN(14));
+    s4 = _mm256_add_pd(_mm256_sub_pd(IN(7), IN(10)), IN(13));
+    s5 = _mm256_add_pd(_mm256_sub_pd(IN(8), IN(11)), IN(12));
+
+#undef OUT6
+#define OUT6(i)	a = MUL(s0, 0);					\
+		a = _mm256_add_pd(a, MUL(s1, 1));		\
+		a = _mm256_add_pd(a, MUL(s2, 2));		\
+		a = _mm256_add_pd(a, MUL(s3, 3));		\
+		a = _mm256_add_pd(a, MUL(s4, 4));		\
+		a = _mm256_add_pd(a, MUL(s5, 5));		\
+		OUT(i, a);					\
+		cos_l0 += 6
+    OUT6(16);
+    OUT6(10);
+    OUT6(7);
+    OUT6(1);
+
+    s0 = _mm256_add_pd(_mm256_sub_pd(s0, s1), s5);
+    s2 = _mm256_sub_pd(_mm256_sub_pd(s2, s3), s4);
+    OUT(13, _mm256_add_pd(MUL(s0, 0), MUL(s2, 1)));
+    OUT(4, _mm256_add_pd(MUL(s0, 2), MUL(s2, 3)));
+#undef IN
+#undef MUL
+#undef OUT
+#undef OUT6
+}
+#endif
+
+
 void mdct_sub48(lame_global_flags *gfp,
     short *w0, short *w1,
     FLOAT8 mdct_freq[2][2][576],
     III_side_info_t *l3_side)
 {
     int gr, k, ch;
-    short *wk;
     static int init = 0;
+#ifdef LAME_SIMD
+    int simd = lame_simd_level();
+    int lanes = simd == SIMD_AVX2 ? 4 : simd == SIMD_SSE2 ? 2 : 1;
+#else
+    int lanes = 1;
+#endif
 
     if ( init == 0 ) {
         void mdct_init48(void);
@@ -339,27 +702,17 @@ void mdct_sub48(lame_global_flags *gfp,
 	init++;
     }
 
-    wk = w0;
-    /* thinking cache performance, ch->gr loop is better than gr->ch loop */
-    for (ch = 0; ch < gfp->stereo; ch++) {
-	for (gr = 0; gr < gfp->mode_gr; gr++) {
+    /* gr->ch loop, so that the channels of a granule can be filtered
+     * and transformed together */
+    for (gr = 0; gr < gfp->mode_gr; gr++) {
+	int nlong = 0;
+
+	window_subband_granule(gfp->stereo, w0 + 576 * gr, w1 + 576 * gr, gr);
+
+	for (ch = 0; ch < gfp->stereo; ch++) {
 	    int	band;
 	    FLOAT8 *mdct_enc = mdct_freq[gr][ch];
 	    gr_info *gi = &(l3_side->gr[gr].ch[ch].tt);
-	    FLOAT8 *samp = sb_sample[ch][1 - gr][0];
-
-	    for (k = 0; k < 18 / 2; k++) {
-		window_subband(wk, samp, work);
-		window_subband(wk + 32, samp + 32, work);
-		/*
-		 * Compensate for inversion in the analysis filter
-		 */
-		for (band = 1; band < 32; band += 2)
-		    samp[band + 32] *= -1.0;
-		samp += 64;
-		wk += 64;
-	    }
-
 
 	    /* apply filters on the polyphase filterbank outputs */
 	    /* bands <= gfp->highpass_band will be zeroed out below */
@@ -385,7 +738,8 @@ void mdct_sub48(lame_global_flags *gfp,
 
 	    /*
 	     * Perform imdct of 18 previous subband samples
-	     * + 18 current subband samples
+	     * + 18 current subband samples.  The windowed samples of the
+	     * long blocks are collected in mdct_in and transformed below
 	     */
 	    for (band = 0; band < 32; band++, mdct_enc += 18) 
               {
@@ -423,26 +777,55 @@ void mdct_sub48(lame_global_flags *gfp,
 		    }
 		    mdct_short(mdct_enc, work);
 		  } else {
+		    /* lane nlong % lanes of group nlong / lanes */
+		    FLOAT8 *in = mdct_in + nlong / lanes * 18 * lanes + nlong % lanes;
 		    for (k = 8; k >= 0; --k) {
-		      work[k] =
+		      in[k * lanes] =
 			win[type][k  ] * sb_sample[ch][gr][k   ][band]
 			- win[type][k+9] * sb_sample[ch][gr][17-k][band];
 		      
-		      work[9+k] =
+		      in[(9+k) * lanes] =
 			win[type][k+18] * sb_sample[ch][1-gr][k   ][band]
 			+ win[type][k+27] * sb_sample[ch][1-gr][17-k][band];
 		    }
-		    mdct_long(mdct_enc, work);
+		    mdct_out[nlong++] = mdct_enc;
 		  }
 		}
-		
-		
-		/*
-		  Perform aliasing reduction butterfly
-		*/
+	      }
+	}
+
+	/* the long blocks of all channels, a group of 'lanes' at a time */
+#ifdef LAME_SIMD
+	if (lanes > 1) {
+	    for (k = nlong; k % lanes; k++)
+		mdct_out[k] = mdct_dummy;
+	    for (k = 0; k < nlong; k += lanes) {
+		if (lanes == 4)
+		    mdct_long_avx2(mdct_out + k, mdct_in + k * 18);
+		else
+		    mdct_long_sse2(mdct_out + k, mdct_in + k * 18);
+	    }
+	} else
+#endif
+	for (k = 0; k < nlong; k++)
+	    mdct_long(mdct_out[k], mdct_in + k * 18);
+
+	/*
+	  Perform aliasing reduction butterfly
+	*/
+	for (ch = 0; ch < gfp->stereo; ch++) {
+	    int	band;
+	    FLOAT8 *mdct_enc = mdct_freq[gr][ch];
+	    gr_info *gi = &(l3_side->gr[gr].ch[ch].tt);
+
+	    for (band = 1; band < 32; band++) {
+		int type = gi->block_type;
+#ifdef ALLOW_MIXED
+		if (gi->mixed_block_flag && band < 2)
+		    type = 0;
+#endif
+		mdct_enc += 18;
 		if (type != SHORT_TYPE) {
-		  if (band == 0)
-		    continue;
 		  for (k = 7; k >= 0; --k) {
 		    FLOAT8 bu,bd;
 		    bu = mdct_enc[k] * ca[k] + mdct_enc[-1-k] * cs[k];
@@ -452,12 +835,12 @@ void mdct_sub48(lame_global_flags *gfp,
 		    mdct_enc[k]    = bd;
 		  }
 		}
-	      }
+	    }
 	}
-	wk = w1;
-	if (gfp->mode_gr == 1) {
+    }
+    if (gfp->mode_gr == 1) {
+	for (ch = 0; ch < gfp->stereo; ch++)
 	    memcpy(sb_sample[ch][0], sb_sample[ch][1], 576 * sizeof(FLOAT8));
-	}
     }
 }
 
@@ -77,6 +77,11 @@ void lame_help(lame_global_flags *gfp,char *name)  /* print syntax & exit */
   fprintf(stdout,"    --voice         experimental voice mode\n");
   fprintf(stdout,"    --preset type   type must be phone, voice, fm, tape, hifi, cd or studio\n");
   fprintf(stdout,"                    help gives some more infos on these\n");
+#ifdef LAME_THREADS
+  fprintf(stdout,"    --threads n     n>1: quantize on a second thread, same output\n");
+  fprintf(stdout,"    --segments n    encode n parts of a wav/aiff/raw input file in parallel\n");
+  fprintf(stdout,"                    (CBR only; the bit reservoir is emptied at the joins)\n");
+#endif
   fprintf(stdout,"\n");
   fprintf(stdout,"  CBR (constant bitrate, the default) options:\n");
   fprintf(stdout,"    -h              higher quality, but a little slower.  Recommended.\n");
@@ -295,6 +300,22 @@ void lame_parse_args(lame_global_flags *gfp,int argc, char **argv)
 	else if (strcmp(token, "athonly")==0) {
 	  gfp->ATHonly=1;
 	}
+	else if (strcmp(token, "threads")==0) {
+	  argUsed=1;
+	  gfp->num_threads = atoi( nextArg );
+	  if (gfp->num_threads < 1) {
+	    fprintf(stderr,"Must specify number of threads with --threads n, n >= 1\n");
+	    exit(1);
+	  }
+	}
+	else if (strcmp(token, "segments")==0) {
+	  argUsed=1;
+	  gfp->segments = atoi( nextArg );
+	  if (gfp->segments < 1) {
+	    fprintf(stderr,"Must specify number of segments with --segments n, n >= 1\n");
+	    exit(1);
+	  }
+	}
 	else if (strcmp(token, "nohist")==0) {
 #ifdef BRHIST
 	  disp_brhist = 0;
@@ -337,8 +337,16 @@ void L3psycho_anal( lame_global_flags *gfp,
       /**********************************************************************
        *  compute FFTs
        **********************************************************************/
-      fft_long ( *wsamp_l, chn, buffer);
-      fft_short( *wsamp_s, chn, buffer); 
+      if (gfp->stereo == 2) {
+	/* both channels at once */
+	if (chn == 0) {
+	  fft_long2 ( wsamp_L, buffer);
+	  fft_short2( wsamp_S, buffer);
+	}
+      } else {
+	fft_long ( *wsamp_l, chn, buffer);
+	fft_short( *wsamp_s, chn, buffer); 
+      }
       
       /* LR maskings  */
       percep_entropy[chn] = pe[chn]; 
@@ -159,6 +159,7 @@ iteration_init( lame_global_flags *gfp,III_side_info_t *l3_side, int l3_enc[2][2
 
     l3_side->main_data_begin = 0;
     compute_ath(gfp,ATH_l,ATH_s);
+    huffman_init();
 
     for(i=0;i<PRECALC_SIZE;i++)
         pow43[i] = pow((FLOAT8)i, 4.0/3.0);
@@ -968,6 +969,80 @@ bin_search_StepSize2 (lame_global_flags *gfp,int desired_rate, int start, int *i
  *    Takehiro Tominaga <tominaga@isoternet.org> 11/1999
  *********************************************************************/
 
+#ifdef LAME_SIMD
+/*********************************************************************
+ * SSE2 and AVX2 versions of the generic C code of quantize_xrpow()
+ * and quantize_xrpow_ISO().  Each lane does the same double precision
+ * operations as the C code, so ix[] comes out the same.
+ *********************************************************************/
+static void quantize_xrpow_sse2(FLOAT8 xr[576], int ix[576], FLOAT8 istep)
+{
+  const __m128d step = _mm_set1_pd(istep);
+  int j, rx[4];
+
+  for (j = 0; j < 576; j += 4) {
+    __m128d x0 = _mm_mul_pd(_mm_loadu_pd(xr + j), step);
+    __m128d x1 = _mm_mul_pd(_mm_loadu_pd(xr + j + 2), step);
+    _mm_storeu_si128((__m128i *) rx,
+		     _mm_unpacklo_epi64(_mm_cvttpd_epi32(x0), _mm_cvttpd_epi32(x1)));
+    x0 = _mm_add_pd(x0, _mm_set_pd(QUANTFAC(rx[1]), QUANTFAC(rx[0])));
+    x1 = _mm_add_pd(x1, _mm_set_pd(QUANTFAC(rx[3]), QUANTFAC(rx[2])));
+    _mm_storeu_si128((__m128i *) (ix + j),
+		     _mm_unpacklo_epi64(_mm_cvttpd_epi32(x0), _mm_cvttpd_epi32(x1)));
+  }
+}
+
+LAME_AVX2 static void quantize_xrpow_avx2(FLOAT8 xr[576], int ix[576], FLOAT8 istep)
+{
+  const __m256d step = _mm256_set1_pd(istep);
+  int j;
+
+  for (j = 0; j < 576; j += 4) {
+    __m256d x = _mm256_mul_pd(_mm256_loadu_pd(xr + j), step);
+    x = _mm256_add_pd(x, _mm256_i32gather_pd(adj43, _mm256_cvttpd_epi32(x), 8));
+    _mm_storeu_si128((__m128i *) (ix + j), _mm256_cvttpd_epi32(x));
+  }
+}
+
+static void quantize_xrpow_ISO_sse2(FLOAT8 xr[576], int ix[576], FLOAT8 istep,
+				    FLOAT8 compareval0)
+{
+  const __m128d step = _mm_set1_pd(istep);
+  const __m128d round = _mm_set1_pd(ROUNDFAC);
+  const __m128d cmp = _mm_set1_pd(compareval0);
+  int j;
+
+  for (j = 0; j < 576; j += 4) {
+    __m128d x0 = _mm_loadu_pd(xr + j);
+    __m128d x1 = _mm_loadu_pd(xr + j + 2);
+    /* 0 where compareval0 > xr */
+    __m128d q0 = _mm_andnot_pd(_mm_cmpgt_pd(cmp, x0),
+			       _mm_add_pd(_mm_mul_pd(step, x0), round));
+    __m128d q1 = _mm_andnot_pd(_mm_cmpgt_pd(cmp, x1),
+			       _mm_add_pd(_mm_mul_pd(step, x1), round));
+    _mm_storeu_si128((__m128i *) (ix + j),
+		     _mm_unpacklo_epi64(_mm_cvttpd_epi32(q0), _mm_cvttpd_epi32(q1)));
+  }
+}
+
+LAME_AVX2 static void quantize_xrpow_ISO_avx2(FLOAT8 xr[576], int ix[576],
+					      FLOAT8 istep, FLOAT8 compareval0)
+{
+  const __m256d step = _mm256_set1_pd(istep);
+  const __m256d round = _mm256_set1_pd(ROUNDFAC);
+  const __m256d cmp = _mm256_set1_pd(compareval0);
+  int j;
+
+  for (j = 0; j < 576; j += 4) {
+    __m256d x = _mm256_loadu_pd(xr + j);
+    __m256d q = _mm256_andnot_pd(_mm256_cmp_pd(cmp, x, _CMP_GT_OQ),
+				 _mm256_add_pd(_mm256_mul_pd(step, x), round));
+    _mm_storeu_si128((__m128i *) (ix + j), _mm256_cvttpd_epi32(q));
+  }
+}
+#endif
+
+
 void quantize_xrpow(FLOAT8 xr[576], int ix[576], gr_info *cod_info) {
   /* quantize on xr^(3/4) instead of xr */
   const FLOAT8 istep = IPOW20(cod_info->global_gain);
@@ -1099,6 +1174,12 @@ void quantize_xrpow(FLOAT8 xr[576], int ix[576], gr_info *cod_info) {
       }
   }
 #else
+#ifdef LAME_SIMD
+  switch (lame_simd_level()) {
+  case SIMD_AVX2: quantize_xrpow_avx2(xr, ix, istep); return;
+  case SIMD_SSE2: quantize_xrpow_sse2(xr, ix, istep); return;
+  }
+#endif
 #if 0
   {   /* generic code if you write ASM for XRPOW_FTOI() */
       FLOAT8 x;
@@ -1292,6 +1373,12 @@ void quantize_xrpow_ISO( FLOAT8 xr[576], int ix[576], gr_info *cod_info )
   {
       register int j;
       const FLOAT8 compareval0 = (1.0 - 0.4054)/istep;
+#ifdef LAME_SIMD
+      switch (lame_simd_level()) {
+      case SIMD_AVX2: quantize_xrpow_ISO_avx2(xr, ix, istep, compareval0); return;
+      case SIMD_SSE2: quantize_xrpow_ISO_sse2(xr, ix, istep, compareval0); return;
+      }
+#endif
       /* depending on architecture, it may be worth calculating a few more compareval's.
          eg.  compareval1 = (2.0 - 0.4054/istep); 
               .. and then after the first compare do this ...
@@ -96,6 +96,7 @@ new_choose_table( int ix[576],
 int bin_search_StepSize2(lame_global_flags *gfp,int desired_rate, int start, int ix[576],
                          FLOAT8 xrspow[576], gr_info * cod_info);
 int count_bits(lame_global_flags *gfp,int  *ix, FLOAT8 xr[576], gr_info *cod_info);
+void huffman_init(void);
 
 
 int quant_compare(int type,
@@ -914,6 +914,61 @@ void outer_loop(
 /*************************************************************************/
 /*            calc_noise                                                 */
 /*************************************************************************/
+#if (defined(LAME_SIMD) && !defined(MAXNOISE) && !defined(RH_ATH))
+/* noise of one long block scalefactor band: the sum over its lines of
+ * (|xr| - ix^(4/3) * step)^2, with SSE2 or AVX2.  The squares are
+ * added one at a time in the order of the C loop in calc_noise1(), so
+ * the sum is the same to the last bit */
+static FLOAT8 calc_sfb_noise_sse2(FLOAT8 *xr, int *ix, int n, FLOAT8 step)
+{
+    const __m128d absmask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+    const __m128d vstep = _mm_set1_pd(step);
+    __m128d sum = _mm_setzero_pd();
+    int l;
+
+    for (l = 0; l + 2 <= n; l += 2) {
+	__m128d t = _mm_sub_pd(_mm_and_pd(_mm_loadu_pd(xr + l), absmask),
+			       _mm_mul_pd(_mm_set_pd(pow43[ix[l + 1]], pow43[ix[l]]),
+					  vstep));
+	t = _mm_mul_pd(t, t);
+	sum = _mm_add_sd(sum, t);
+	sum = _mm_add_sd(sum, _mm_unpackhi_pd(t, t));
+    }
+    for (; l < n; l++) {
+	FLOAT8 temp = fabs(xr[l]) - pow43[ix[l]] * step;
+	sum = _mm_add_sd(sum, _mm_set_sd(temp * temp));
+    }
+    return _mm_cvtsd_f64(sum);
+}
+
+LAME_AVX2 static FLOAT8 calc_sfb_noise_avx2(FLOAT8 *xr, int *ix, int n, FLOAT8 step)
+{
+    const __m256d absmask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    const __m256d vstep = _mm256_set1_pd(step);
+    __m128d sum = _mm_setzero_pd();
+    int l;
+
+    for (l = 0; l + 4 <= n; l += 4) {
+	__m256d q = _mm256_i32gather_pd(pow43, _mm_loadu_si128((__m128i *) (ix + l)), 8);
+	__m256d t = _mm256_sub_pd(_mm256_and_pd(_mm256_loadu_pd(xr + l), absmask),
+				  _mm256_mul_pd(q, vstep));
+	__m128d lo, hi;
+	t = _mm256_mul_pd(t, t);
+	lo = _mm256_castpd256_pd128(t);
+	hi = _mm256_extractf128_pd(t, 1);
+	sum = _mm_add_sd(sum, lo);
+	sum = _mm_add_sd(sum, _mm_unpackhi_pd(lo, lo));
+	sum = _mm_add_sd(sum, hi);
+	sum = _mm_add_sd(sum, _mm_unpackhi_pd(hi, hi));
+    }
+    for (; l < n; l++) {
+	FLOAT8 temp = fabs(xr[l]) - pow43[ix[l]] * step;
+	sum = _mm_add_sd(sum, _mm_set_sd(temp * temp));
+    }
+    return _mm_cvtsd_f64(sum);
+}
+#endif
+
 /*  mt 5/99:  Function: Improved calc_noise for a single channel   */
 int calc_noise1( FLOAT8 xr[576], int ix[576], gr_info *cod_info,
 		 FLOAT8 xfsf[4][SBPSY_l], FLOAT8 distort[4][SBPSY_l],
@@ -930,6 +985,9 @@ int calc_noise1( FLOAT8 xr[576], int ix[576], gr_info *cod_info,
 
     int count=0;
     FLOAT8 noise;
+#if (defined(LAME_SIMD) && !defined(MAXNOISE) && !defined(RH_ATH))
+    int simd = lame_simd_level();
+#endif
     *over_noise=0;
     *tot_noise=0;
     *max_noise = -999;
@@ -952,6 +1010,13 @@ int calc_noise1( FLOAT8 xr[576], int ix[576], gr_info *cod_info,
 
 #ifdef RH_ATH
         ath_max = 0;
+#endif
+#if (defined(LAME_SIMD) && !defined(MAXNOISE) && !defined(RH_ATH))
+	if (simd == SIMD_AVX2)
+	    sum = calc_sfb_noise_avx2(xr + start, ix + start, end - start, step);
+	else if (simd == SIMD_SSE2)
+	    sum = calc_sfb_noise_sse2(xr + start, ix + start, end - start, step);
+	else
 #endif
         for ( sum = 0.0, l = start; l < end; l++ )
         {
@@ -77,6 +77,9 @@ ResvFrameBegin(lame_global_flags *gfp,III_side_info_t *l3_side, int mean_bits, i
     else
 	ResvMax = 7680 - frameLength;
     if (gfp->disable_reservoir) ResvMax=0;
+    /* empty the reservoir before a cut point, so the frame after it
+     * does not need any bits of the frames before it */
+    if (gfp->frameNum < gfp->reservoir_start_frame) ResvMax=0;
 
 
     /*
@@ -0,0 +1,188 @@
+/*
+ *	Segment-parallel encoding (--segments)
+ *
+ * The input file is cut into gfp->segments runs of whole frames, and each
+ * run is encoded by a process of its own (LAME keeps its state in static
+ * variables, so one encoder per process).  The state carried from frame
+ * to frame that shows in the stream is the bit reservoir, as a frame may
+ * start its main data in the bytes of the frames before it, and the
+ * padding byte added to some frames to keep the bitrate exact.  So every
+ * segment after the first is encoded from a few frames earlier, to warm
+ * up the filterbank and the psycho acoustic model, with the reservoir
+ * emptied before its first frame (reservoir_start_frame) and the padding
+ * taken up where the serial encoder would have it (padding_start_frame).
+ * Its warm-up frames are then dropped, and the frames of all segments are
+ * written one after the other.  The result is a valid stream of as many
+ * frames as the serial encoder's, each of the same length but the last,
+ * which is cut short where its main data ends.  The frames next to a join
+ * can differ a little, as the reservoir has to start empty there, and so
+ * can the end of the last frame.
+ */
+#ifdef LAME_THREADS
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "util.h"
+#include "get_audio.h"
+
+#define MAX_SEGMENTS	64
+#define PREROLL_FRAMES	4	/* encoded and dropped before each join */
+
+
+/* length in bytes of the Layer III frame with header h, or 0 */
+static int frame_length(unsigned char h[4])
+{
+  static const int freq[2][3] = {{22050, 24000, 16000}, {44100, 48000, 32000}};
+  int version, bitrate, sr;
+
+  if (h[0] != 0xff || (h[1] & 0xf6) != 0xf2) return 0;
+  version = (h[1] >> 3) & 1;
+  bitrate = bitrate_table[version][h[2] >> 4];
+  sr = (h[2] >> 2) & 3;
+  if (bitrate == 0 || sr == 3) return 0;
+  return (version ? 144000 : 72000) * bitrate / freq[version][sr]
+    + ((h[2] >> 1) & 1);
+}
+
+
+/* copy frames first..last-1 of the mp3 stream in 'in' to 'out'.  The
+ * last frame of a stream is cut short where its main data ends, and is
+ * copied as it is */
+static int copy_frames(FILE *in, FILE *out, long first, long last)
+{
+  unsigned char frame[2*1441+4];
+  long n;
+  int len;
+
+  for (n = 0; n < last; n++) {
+    if (fread(frame, 1, 4, in) != 4) break;
+    len = frame_length(frame);
+    if (len == 0) {
+      fprintf(stderr,"Error: bad frame %ld in encoded segment\n", n);
+      return -1;
+    }
+    len = 4 + fread(frame+4, 1, len-4, in);
+    if (n >= first && fwrite(frame, 1, len, out) != (size_t)len) {
+      fprintf(stderr,"Error writing mp3 output\n");
+      return -1;
+    }
+  }
+  return 0;
+}
+
+
+/* encode frames first..last-1 of the input (in the numbering of the
+ * serial encoder) and the warm-up frames before them to 'out' */
+static int encode_segment(lame_global_flags *gfp, long first, long last,
+FILE *out)
+{
+  char mp3buffer[LAME_MAXMP3BUFFER];
+  short int Buffer[2][1152];
+  unsigned long remaining;
+  long start;
+  int iread, imp3;
+
+  start = Max(first - PREROLL_FRAMES, 0);
+  gfp->reservoir_start_frame = first - start;
+  gfp->padding_start_frame = start;
+  gfp->silent = 1;
+
+  /* the input is open in the parent, and its file offset shared by all
+   * children: open it again */
+  lame_close_infile(gfp);
+  lame_init_infile(gfp);
+  if (start > 0 && lame_seek_infile(gfp, (unsigned long)start*gfp->framesize))
+    return -1;
+
+  /* the last frame looks ahead BLKSIZE samples beyond its end */
+  remaining = (last - start)*gfp->framesize + BLKSIZE;
+  if (gfp->num_samples < remaining)
+    remaining = gfp->num_samples;
+
+  do {
+    iread = lame_readframe(gfp,Buffer);
+    if ((unsigned long)iread > remaining) iread = remaining;
+    remaining -= iread;
+    imp3 = lame_encode_buffer(gfp,Buffer[0],Buffer[1],iread,
+			      mp3buffer,(int)sizeof(mp3buffer));
+    if (imp3 == -1 || fwrite(mp3buffer,1,imp3,out) != (size_t)imp3)
+      return -1;
+  } while (iread && remaining);
+
+  imp3 = lame_encode_finish(gfp,mp3buffer,(int)sizeof(mp3buffer));
+  if (imp3 == -1 || fwrite(mp3buffer,1,imp3,out) != (size_t)imp3)
+    return -1;
+  return fflush(out) ? -1 : 0;
+}
+
+
+int lame_encode_segments(lame_global_flags *gfp, FILE *outf)
+{
+  FILE *part[MAX_SEGMENTS];
+  pid_t pid[MAX_SEGMENTS];
+  long first[MAX_SEGMENTS+1], totalframes;
+  int nseg, i, status, ret = 0;
+
+  if (gfp->segments < 2) return -1;
+  if (gfp->VBR || gfp->gtkflag || gfp->resample_ratio != 1 ||
+      gfp->num_samples == MAX_U_32_NUM || lame_seek_infile(gfp, 0)) {
+    if (!gfp->silent)
+      fprintf(stderr,"--segments: needs CBR and a seekable wav, aiff or raw input file, encoding in one piece\n");
+    return -1;
+  }
+
+  /* the serial encoder pads the input with ENCDELAY samples in front and
+   * 288 behind, and codes whole frames */
+  totalframes = (gfp->num_samples + ENCDELAY + 288 + gfp->framesize - 1)
+    / gfp->framesize;
+  nseg = Min(gfp->segments, MAX_SEGMENTS);
+  nseg = Min(nseg, totalframes / (4*PREROLL_FRAMES));
+  if (nseg < 2) return -1;
+  for (i = 0; i <= nseg; i++)
+    first[i] = totalframes * i / nseg;
+
+  if (!gfp->silent)
+    fprintf(stderr,"Encoding %ld frames in %d segments\n", totalframes, nseg);
+
+  /* the children must not flush our buffers again */
+  fflush(NULL);
+  for (i = 0; i < nseg; i++) {
+    if ((part[i] = tmpfile()) == NULL) {
+      fprintf(stderr,"Error: can't create temporary file for segment\n");
+      exit(1);
+    }
+    pid[i] = fork();
+    if (pid[i] == -1) {
+      fprintf(stderr,"Error: can't start process for segment\n");
+      exit(1);
+    }
+    if (pid[i] == 0) {
+      /* the last segment runs to the end of the input */
+      _exit(encode_segment(gfp, first[i],
+			   i == nseg-1 ? totalframes + 1 : first[i+1],
+			   part[i]) ? 1 : 0);
+    }
+  }
+
+  for (i = 0; i < nseg; i++) {
+    if (waitpid(pid[i], &status, 0) == -1 ||
+	!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr,"Error encoding segment %d\n", i);
+      ret = 1;
+    }
+  }
+  if (ret) exit(1);
+
+  for (i = 0; i < nseg; i++) {
+    long start = Max(first[i] - PREROLL_FRAMES, 0);
+    rewind(part[i]);
+    if (copy_frames(part[i], outf, first[i] - start,
+		    i == nseg-1 ? totalframes + 1 - start : first[i+1] - start))
+      exit(1);
+    fclose(part[i]);
+  }
+  return 0;
+}
+
+#endif /* LAME_THREADS */
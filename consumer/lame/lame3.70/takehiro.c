@@ -68,6 +68,21 @@ struct
 {
     int max = 0;
 
+#ifdef LAME_SIMD
+    if (lame_simd_level() >= SIMD_SSE2 && end - ix >= 8) {
+	int m[4];
+	__m128i vmax = _mm_setzero_si128();
+	do {
+	    __m128i x = _mm_loadu_si128((__m128i *) ix);
+	    __m128i gt = _mm_cmpgt_epi32(x, vmax);
+	    vmax = _mm_or_si128(_mm_and_si128(gt, x), _mm_andnot_si128(gt, vmax));
+	    ix += 4;
+	} while (ix + 4 <= end);
+	_mm_storeu_si128((__m128i *) m, vmax);
+	max = Max(Max(m[0], m[1]), Max(m[2], m[3]));
+    }
+#endif
+
     while (ix < end) {
 	int x =	 *ix++;
 	if (max < x) 
@@ -87,119 +102,123 @@ struct
 
 /*
  Function: Count the number of bits necessary to code the subregion. 
+
+ The Huffman tables tried against each other for the same largest value
+ have their code lengths packed 16 bits per table into one word of
+ hlen_pack[], so that one pass over the pairs counts the bits for all of
+ them: the lengths of at most 288 pairs add up to less than 2^16.
 */
 
-static int cb_esc_buf[288];
-static int cb_esc_sign;
-static int *cb_esc_end;
-static const int huf_tbl_noESC[15] = {
-    1, 2, 5, 7, 7,10,10,13,13,13,13,13,13,13,13
+#define PACK_ESC 6		/* group of the tables with linbits */
+
+static const int pack_tables[7][3] = {
+    { 1, 0, 0}, { 2, 3, 0}, { 5, 6, 0}, { 7, 8, 9}, {10,11,12}, {13,15, 0},
+    {16,24, 0}
+};
+/* group of tables for the largest values 1..15 */
+static const int pack_group[15] = {
+    0, 1, 2, 3, 3, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5
 };
+static unsigned long long hlen_pack[7][16*16];
 
- static int
-count_bit_ESC(int *ix, int *end, int t1, int t2, int *s)
+void huffman_init(void)
 {
-    /* ESC-table is used */
-    int linbits1 = ht[t1].xlen;
-    int linbits2 = ht[t2].xlen;
-    int	sum = 0;
-    int	sum1 = 0;
-    int	sum2 = 0;
+    int g, k, x, y, t, xlen;
+
+    memset(hlen_pack, 0, sizeof(hlen_pack));
+    for (g = 0; g < 7; g++) {
+	for (k = 0; k < 3 && (t = pack_tables[g][k]) != 0; k++) {
+	    /* the xlen of the tables with linbits is the number of linbits */
+	    xlen = (g == PACK_ESC) ? 16 : (int)ht[t].xlen;
+	    for (x = 0; x < xlen; x++) {
+		for (y = 0; y < xlen; y++) {
+		    hlen_pack[g][x*16+y] |=
+			(unsigned long long)ht[t].hlen[x*16+y] << (16*k);
+		}
+	    }
+	}
+    }
+}
+
+
+/*
+  Add up the packed code lengths tbl[x*16+y] of every pair of values
+  (x, y), with values above 14 limited to 15 (the escape).  Returns the
+  sum, the number of nonzero values in *nz and the number of escapes in
+  *esc.  In long blocks the pairs are the neighbours ix[2k], ix[2k+1].
+*/
+ static unsigned long long
+count_pairs(int *ix, int *end, const unsigned long long *tbl, int *nz, int *esc)
+{
+    unsigned long long sum = 0;
+    int n = 0, e = 0;
+
+#ifdef LAME_SIMD
+    if (lame_simd_level() >= SIMD_SSE2) {
+	const __m128i c14 = _mm_set1_epi32(14);
+	const __m128i c15 = _mm_set1_epi32(15);
+	const __m128i zero = _mm_setzero_si128();
+	int p[4];
+
+	for (; ix + 8 <= end; ix += 8) {
+	    __m128i a = _mm_loadu_si128((__m128i *) ix);
+	    __m128i b = _mm_loadu_si128((__m128i *) (ix + 4));
+	    __m128i ea = _mm_cmpgt_epi32(a, c14);
+	    __m128i eb = _mm_cmpgt_epi32(b, c14);
+	    __m128 x, y;
+
+	    n += 8 - __builtin_popcount(
+		_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, zero))) |
+		_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(b, zero))) << 4);
+	    e += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(ea)) |
+				    _mm_movemask_ps(_mm_castsi128_ps(eb)) << 4);
+	    a = _mm_or_si128(_mm_and_si128(ea, c15), _mm_andnot_si128(ea, a));
+	    b = _mm_or_si128(_mm_and_si128(eb, c15), _mm_andnot_si128(eb, b));
+	    x = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b),
+			       _MM_SHUFFLE(2, 0, 2, 0));
+	    y = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b),
+			       _MM_SHUFFLE(3, 1, 3, 1));
+	    _mm_storeu_si128((__m128i *) p,
+			     _mm_add_epi32(_mm_slli_epi32(_mm_castps_si128(x), 4),
+					   _mm_castps_si128(y)));
+	    sum += tbl[p[0]] + tbl[p[1]] + tbl[p[2]] + tbl[p[3]];
+	}
+    }
+#endif
 
     while (ix < end) {
 	int x = *ix++;
 	int y = *ix++;
 
 	if (x != 0) {
-	    sum++;
+	    n++;
 	    if (x > 14) {
 		x = 15;
-		sum1 += linbits1;
-		sum2 += linbits2;
+		e++;
 	    }
-	    x *= 16;
 	}
-
 	if (y != 0) {
-	    sum++;
+	    n++;
 	    if (y > 14) {
 		y = 15;
-		sum1 += linbits1;
-		sum2 += linbits2;
+		e++;
 	    }
-	    x += y;
 	}
-
-	sum1 += ht[16].hlen[x];
-	sum2 += ht[24].hlen[x];
-    }
-
-    if (sum1 > sum2)  {
-	sum1 = sum2;
-	t1 = t2;
+	sum += tbl[x * 16 + y];
     }
 
-    *s += sum + sum1;
-    return t1;
-}
-
- static int
-count_bit_noESC(int *ix, int *end, unsigned int table) 
-{
-    /* No ESC-words */
-    int	sum = 0, sign = 0;
-    unsigned char *hlen = ht[table].hlen;
-    int *p = cb_esc_buf;
-
-    do {
-	int x = *ix++;
-	int y = *ix++;
-	if (x != 0) {
-	    sign++;
-	    x *= 16;
-	}
-
-	if (y != 0) {
-	    sign++;
-	    x += y;
-	}
-
-	*p++ = x;
-	sum += hlen[x];
-    } while (ix < end);
-
-    cb_esc_sign = sign;
-    cb_esc_end = p;
-    return sum + sign;
-}
-
-
-
- static int
-count_bit_noESC2(unsigned int table) 
-{
-    /* No ESC-words */
-    int	sum = cb_esc_sign;
-    int *p = cb_esc_buf;
-
-    do {
-	sum += ht[table].hlen[*p++];
-    } while (p < cb_esc_end);
-
+    *nz = n;
+    *esc = e;
     return sum;
 }
 
-
-
- static int
-count_bit_short_ESC(int *ix, int *end, int t1, int t2, int *s)
+/* the same for short blocks, where the pairs are ix[i], ix[i+3] of each
+   group of six values */
+ static unsigned long long
+count_pairs_short(int *ix, int *end, const unsigned long long *tbl, int *nz, int *esc)
 {
-    /* ESC-table is used */
-    int linbits1 = ht[t1].xlen;
-    int linbits2 = ht[t2].xlen;
-    int	sum = 0;
-    int	sum1 = 0;
-    int	sum2 = 0;
+    unsigned long long sum = 0;
+    int n = 0, e = 0;
 
     do {
 	int i;
@@ -208,76 +227,86 @@ count_bit_short_ESC(int *ix, int *end, int t1, int t2, int *s)
 	    int x = *ix++;
 
 	    if (x != 0) {
-		sum++;
+		n++;
 		if (x > 14) {
 		    x = 15;
-		    sum1 += linbits1;
-		    sum2 += linbits2;
+		    e++;
 		}
-		x *= 16;
 	    }
-
 	    if (y != 0) {
-		sum++;
+		n++;
 		if (y > 14) {
 		    y = 15;
-		    sum1 += linbits1;
-		    sum2 += linbits2;
+		    e++;
 		}
-		x += y;
 	    }
-
-	    sum1 += ht[16].hlen[x];
-	    sum2 += ht[24].hlen[x];
+	    sum += tbl[x * 16 + y];
 	}
 	ix += 3;
     } while (ix < end);
 
-    if (sum1 > sum2)  {
-	sum1 = sum2;
-	t1 = t2;
-    }
-
-    *s += sum + sum1;
-    return t1;
+    *nz = n;
+    *esc = e;
+    return sum;
 }
 
 
+/*
+  Choose the Huffman table that codes the values with largest value max
+  with the fewest bits, from the packed bit counts sum of the tables of
+  group g, and add the bits to *s.  The first of two tables giving the
+  same number of bits is taken.
 
+  Note: This code contains knowledge about the sizes and characteristics
+  of the Huffman tables as defined in the IS (Table B.7), and will not work
+  with any arbitrary tables.
+*/
  static int
-count_bit_short_noESC(int *ix, int *end, unsigned int table) 
+count_bit(unsigned long long sum, int g, int nz, int esc, int max, int *s)
 {
-    /* No ESC-words */
-    int	sum = 0, sign = 0;
-    unsigned char *hlen = ht[table].hlen;
-    int *p = cb_esc_buf;
-
-    do {
-	int i;
-	for (i = 0; i < 3; i++) {
-	    int y = *(ix + 3);
-	    int x = *ix++;
-	    if (x != 0) {
-		sign++;
-		x *= 16;
+    int k, bits, choice0, choice1, sum0, sum1;
+
+    if (g != PACK_ESC)  {
+	/* tables with no linbits */
+	choice0 = pack_tables[g][0];
+	sum0 = (int)(sum & 0xffff);
+	for (k = 1; k < 3 && pack_tables[g][k] != 0; k++) {
+	    bits = (int)(sum >> (16*k)) & 0xffff;
+	    if (sum0 > bits) {
+		sum0 = bits;
+		choice0 = pack_tables[g][k];
 	    }
+	}
+	*s += nz + sum0;
+	return choice0;
+    }
 
-	    if (y != 0) {
-		sign++;
-		x += y;
-	    }
+    /* try tables with linbits */
+    max -= 15;
 
-	    *p++ = x;
-	    sum += hlen[x];
+    for (choice1 = 24; choice1 < 32; choice1++) {
+	if ((int)ht[choice1].linmax >= max) {
+	    break;
 	}
-	ix += 3;
-    } while (ix < end);
+    }
 
-    cb_esc_sign = sign;
-    cb_esc_end = p;
-    return sum + sign;
-}
+    for (choice0 = choice1 - 8; choice0 < 24; choice0++) {
+	if ((int)ht[choice0].linmax >= max) {
+	    break;
+	}
+    }
 
+    sum0 = (int)(sum & 0xffff) + esc * ht[choice0].xlen;
+    sum1 = (int)(sum >> 16) + esc * ht[choice1].xlen;
+
+    if (sum0 > sum1)  {
+	sum0 = sum1;
+	choice0 = choice1;
+    }
+
+    *s += nz + sum0;
+    return choice0;
+}
 
 
 /*************************************************************************/
@@ -287,17 +316,12 @@ count_bit_short_noESC(int *ix, int *end, unsigned int table)
 /*
   Choose the Huffman table that will encode ix[begin..end] with
   the fewest bits.
-
-  Note: This code contains knowledge about the sizes and characteristics
-  of the Huffman tables as defined in the IS (Table B.7), and will not work
-  with any arbitrary tables.
 */
 
 static int choose_table(int *ix, int *end, int *s)
 {
-    int max;
-    int choice0, sum0;
-    int choice1, sum1;
+    unsigned long long sum;
+    int max, g, nz, esc;
 
     max = ix_max(ix, end);
 
@@ -305,76 +329,19 @@ static int choose_table(int *ix, int *end, int *s)
         *s = 100000;
         return -1;
     }
-
-    if (max <= 15)  {
-	if (max == 0) {
-	    return 0;
-	}
-	/* try tables with no linbits */
-	choice0 = huf_tbl_noESC[max - 1];
-	sum0 = count_bit_noESC(ix, end, choice0);
-	choice1 = choice0;
-
-	switch (choice0) {
-	case 7:
-	case 10:
-	    choice1++;
-	    sum1 = count_bit_noESC2(choice1);
-	    if (sum0 > sum1) {
-		sum0 = sum1;
-		choice0 = choice1;
-	    }
-	    /*fall*/
-	case 2:
-	case 5:
-	    choice1++;
-	    sum1 = count_bit_noESC2(choice1);
-	    if (sum0 > sum1) {
-		sum0 = sum1;
-		choice0 = choice1;
-	    }
-	    break;
-
-	case 13:
-	    choice1 += 2;
-	    sum1 = count_bit_noESC2(choice1);
-	    if (sum0 > sum1) {
-		sum0 = sum1;
-		choice0 = choice1;
-	    }
-	    break;
-
-	default:
-	    break;
-	}
-	*s += sum0;
-    } else {
-	/* try tables with linbits */
-	max -= 15;
-
-	for (choice1 = 24; choice1 < 32; choice1++) {
-	    if ((int)ht[choice1].linmax >= max) {
-		break;
-	    }
-	}
-
-	for (choice0 = choice1 - 8; choice0 < 24; choice0++) {
-	    if ((int)ht[choice0].linmax >= max) {
-		break;
-	    }
-	}
-
-	choice0 = count_bit_ESC(ix, end, choice0, choice1, s);
+    if (max == 0) {
+	return 0;
     }
 
-    return choice0;
+    g = (max <= 15) ? pack_group[max - 1] : PACK_ESC;
+    sum = count_pairs(ix, end, hlen_pack[g], &nz, &esc);
+    return count_bit(sum, g, nz, esc, max, s);
 }
 
 static int choose_table_short(int *ix, int *end, int * s)
 {
-    int max;
-    int choice0, sum0;
-    int choice1, sum1;
+    unsigned long long sum;
+    int max, g, nz, esc;
 
     max = ix_max(ix, end);
 
@@ -382,67 +349,13 @@ static int choose_table_short(int *ix, int *end, int * s)
         *s = 100000;
         return -1;
     }
-
-    if (max <= 15)  {
-	if (max == 0) {
-	    return 0;
-	}
-	/* try tables with no linbits */
-	choice0 = huf_tbl_noESC[max - 1];
-	sum0 = count_bit_short_noESC(ix, end, choice0);
-	choice1 = choice0;
-
-	switch (choice0) {
-	case 7:
-	case 10:
-	    choice1++;
-	    sum1 = count_bit_noESC2(choice1);
-	    if (sum0 > sum1) {
-		sum0 = sum1;
-		choice0 = choice1;
-	    }
-	    /*fall*/
-	case 2:
-	case 5:
-	    choice1++;
-	    sum1 = count_bit_noESC2(choice1);
-	    if (sum0 > sum1) {
-		sum0 = sum1;
-		choice0 = choice1;
-	    }
-	    break;
-
-	case 13:
-	    choice1 += 2;
-	    sum1 = count_bit_noESC2(choice1);
-	    if (sum0 > sum1) {
-		sum0 = sum1;
-		choice0 = choice1;
-	    }
-	    break;
-
-	default:
-	    break;
-	}
-	*s += sum0;
-    } else {
-	/* try tables with linbits */
-	max -= 15;
-	for (choice1 = 24; choice1 < 32; choice1++) {
-	    if ((int)ht[choice1].linmax >= max) {
-		break;
-	    }
-	}
-
-	for (choice0 = choice1 - 8; choice0 < 24; choice0++) {
-	    if ((int)ht[choice0].linmax >= max) {
-		break;
-	}
-	}
-	choice0 = count_bit_short_ESC(ix, end, choice0, choice1, s);
+    if (max == 0) {
+	return 0;
     }
 
-    return choice0;
+    g = (max <= 15) ? pack_group[max - 1] : PACK_ESC;
+    sum = count_pairs_short(ix, end, hlen_pack[g], &nz, &esc);
+    return count_bit(sum, g, nz, esc, max, s);
 }
 
 
@@ -548,6 +461,17 @@ int count_bits(lame_global_flags *gfp,int *ix, FLOAT8 *xr, gr_info *cod_info)
   int bits=0,i;
   /* since quantize_xrpow uses table lookup, we need to check this first: */
   FLOAT8 w = (IXMAX_VAL) / IPOW20(cod_info->global_gain);
+#ifdef LAME_SIMD
+  if (lame_simd_level() >= SIMD_SSE2) {
+    __m128d m0 = _mm_loadu_pd(xr), m1 = _mm_loadu_pd(xr + 2);
+    for ( i = 4; i < 576; i += 4 )  {
+      m0 = _mm_max_pd(m0, _mm_loadu_pd(xr + i));
+      m1 = _mm_max_pd(m1, _mm_loadu_pd(xr + i + 2));
+    }
+    if (_mm_movemask_pd(_mm_cmpgt_pd(_mm_max_pd(m0, m1), _mm_set1_pd(w))))
+      return 100000;
+  } else
+#endif
   for ( i = 0; i < 576; i++ )  {
     if (xr[i] > w)
       return 100000;
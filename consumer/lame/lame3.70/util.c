@@ -221,6 +221,38 @@ void SwapBytesInWords( short *loc, int words )
 
 
 
+/*****************************************************************************
+*
+*  Which SIMD kernels may be used: SIMD_AVX2 if the CPU has AVX2, else
+*  SIMD_SSE2 where they are compiled in (LAME_SIMD), else SIMD_NONE.
+*  The environment variable LAMESIMD=0 or 1 caps the level, to test or
+*  time the C code and the SSE2 code on any machine.
+*
+*****************************************************************************/
+
+int lame_simd_level(void)
+{
+#ifdef LAME_SIMD
+    static int level = -1;
+    char *env;
+    int l;
+
+    if (level < 0) {
+	__builtin_cpu_init();
+	l = __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE2;
+	if ((env = getenv("LAMESIMD")) != NULL && atoi(env) < l)
+	    l = atoi(env) < SIMD_NONE ? SIMD_NONE : atoi(env);
+	level = l;
+    }
+    return level;
+#else
+    return SIMD_NONE;
+#endif
+}
+
+
+
+
 
 
 /*****************************************************************************
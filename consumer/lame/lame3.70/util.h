@@ -151,6 +151,7 @@ extern void           putbits(Bit_stream_struc*, unsigned int, int);
 
 extern enum byte_order DetermineByteOrder(void);
 extern void SwapBytesInWords( short *loc, int words );
+extern int  lame_simd_level(void);
 
 extern void 
 getframebits(lame_global_flags *gfp,int *bitsPerFrame, int *mean_bits);
@@ -0,0 +1,600 @@
+/*
+ * mad - MPEG audio decoder
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * $Id$
+ */
+
+# ifdef HAVE_CONFIG_H
+#  include "config.h"
+# endif
+
+# include "global.h"
+
+# include <stdlib.h>
+# include <string.h>
+# include <pthread.h>
+
+# include "mad.h"
+# include "batch.h"
+
+struct job {
+  struct batch_stream *stream;
+  int fed;
+};
+
+struct pool {
+  struct batch_stream *streams;
+  unsigned int count;
+
+  pthread_mutex_t lock;
+  unsigned int next;
+};
+
+/*
+ * NAME:	input()
+ * DESCRIPTION:	hand the whole stream to the decoder once
+ */
+static
+enum mad_flow input(void *data, struct mad_stream *stream)
+{
+  struct job *job = data;
+
+  if (job->fed)
+    return MAD_FLOW_STOP;
+
+  mad_stream_buffer(stream, job->stream->start, job->stream->length);
+  job->fed = 1;
+
+  return MAD_FLOW_CONTINUE;
+}
+
+/*
+ * NAME:	output()
+ * DESCRIPTION:	account for a decoded frame and pass its PCM on
+ */
+static
+enum mad_flow output(void *data, struct mad_header const *header,
+		     struct mad_pcm *pcm)
+{
+  struct batch_stream *stream = ((struct job *) data)->stream;
+
+  ++stream->frames;
+  mad_timer_add(&stream->duration, header->duration);
+
+  if (stream->output)
+    return stream->output(stream->data, header, pcm);
+
+  return MAD_FLOW_CONTINUE;
+}
+
+/*
+ * NAME:	error()
+ * DESCRIPTION:	skip recoverable errors, as madplay does
+ */
+static
+enum mad_flow error(void *data, struct mad_stream *stream,
+		    struct mad_frame *frame)
+{
+  ++((struct job *) data)->stream->errors;
+
+  return MAD_RECOVERABLE(stream->error) ? MAD_FLOW_CONTINUE : MAD_FLOW_BREAK;
+}
+
+/*
+ * NAME:	decode()
+ * DESCRIPTION:	decode a single stream of the batch
+ */
+static
+void decode(struct batch_stream *stream)
+{
+  struct job job;
+  struct mad_decoder decoder;
+
+  job.stream = stream;
+  job.fed    = 0;
+
+  stream->frames = 0;
+  stream->errors = 0;
+  mad_timer_reset(&stream->duration);
+
+  mad_decoder_init(&decoder, &job, input, 0 /* header */, 0 /* filter */,
+		   output, error, 0 /* message */);
+
+  stream->result = mad_decoder_run(&decoder, MAD_DECODER_MODE_SYNC);
+
+  mad_decoder_finish(&decoder);
+}
+
+/*
+ * NAME:	worker()
+ * DESCRIPTION:	take streams off the batch until none is left
+ */
+static
+void *worker(void *arg)
+{
+  struct pool *pool = arg;
+
+  while (1) {
+    unsigned int index;
+
+    pthread_mutex_lock(&pool->lock);
+    index = pool->next++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (index >= pool->count)
+      break;
+
+    decode(&pool->streams[index]);
+  }
+
+  return 0;
+}
+
+/*
+ * NAME:	batch_decode()
+ * DESCRIPTION:	decode count streams on up to nthreads threads; return the
+ *		number of streams whose decoding failed, or -1 on error
+ */
+int batch_decode(struct batch_stream *streams, unsigned int count,
+		 unsigned int nthreads)
+{
+  struct pool pool;
+  pthread_t *threads;
+  unsigned int i, started;
+  int failed;
+
+  pool.streams = streams;
+  pool.count   = count;
+  pool.next    = 0;
+
+  if (nthreads > count)
+    nthreads = count;
+
+  pthread_mutex_init(&pool.lock, 0);
+
+  if (nthreads <= 1)
+    worker(&pool);
+  else {
+    threads = malloc(nthreads * sizeof(*threads));
+    if (threads == 0) {
+      pthread_mutex_destroy(&pool.lock);
+      return -1;
+    }
+
+    for (started = 0; started < nthreads; ++started) {
+      if (pthread_create(&threads[started], 0, worker, &pool) != 0)
+	break;
+    }
+
+    /* the calling thread takes part if not all threads could be started */
+
+    if (started < nthreads)
+      worker(&pool);
+
+    for (i = 0; i < started; ++i)
+      pthread_join(threads[i], 0);
+
+    free(threads);
+  }
+
+  pthread_mutex_destroy(&pool.lock);
+
+  failed = 0;
+  for (i = 0; i < count; ++i) {
+    if (streams[i].result != 0)
+      ++failed;
+  }
+
+  return failed;
+}
+
+/* frames per range of batch_decode_parallel(); each range costs a preroll
+   of two to five frames, and keeps its decoded PCM until it is output */
+
+# define RANGE_FRAMES	128
+
+struct range {
+  int ready;				/* decoded, waiting for output */
+  unsigned long number;			/* which range */
+
+  int result;				/* -1 on an unrecoverable error */
+  enum mad_flow flow;			/* of the filter, if it stopped */
+
+  unsigned long count, allocated;	/* frames decoded */
+  struct mad_header *headers;
+  struct mad_pcm *pcm;
+};
+
+struct parallel {
+  unsigned char const *start;
+  unsigned long length;
+  int options;
+
+  enum mad_flow (*filter)(void *, struct mad_stream const *,
+			  struct mad_frame *);
+  void *data;
+
+  struct mad_index index;
+  unsigned long first, last;		/* frames to decode */
+  unsigned long nranges;
+
+  pthread_mutex_t lock;
+  pthread_cond_t decoded, output;
+
+  unsigned long next;			/* next range to decode */
+  unsigned long done;			/* ranges output so far */
+  int abort;
+
+  unsigned int nslots;
+  struct range *slots;
+};
+
+/*
+ * NAME:	range_add()
+ * DESCRIPTION:	keep the header and PCM of a decoded frame
+ */
+static
+int range_add(struct range *range, struct mad_header const *header,
+	      struct mad_pcm const *pcm)
+{
+  if (range->count == range->allocated) {
+    unsigned long allocated;
+    struct mad_header *headers;
+    struct mad_pcm *samples;
+
+    allocated = range->allocated ? 2 * range->allocated : RANGE_FRAMES;
+
+    headers = realloc(range->headers, allocated * sizeof(*headers));
+    if (headers == 0)
+      return -1;
+    range->headers = headers;
+
+    samples = realloc(range->pcm, allocated * sizeof(*samples));
+    if (samples == 0)
+      return -1;
+    range->pcm = samples;
+
+    range->allocated = allocated;
+  }
+
+  range->headers[range->count] = *header;
+  range->pcm[range->count]     = *pcm;
+  ++range->count;
+
+  return 0;
+}
+
+/*
+ * NAME:	decode_range()
+ * DESCRIPTION:	decode one range of frames of a parallel decode
+ */
+static
+void decode_range(struct parallel *parallel, unsigned long number,
+		  struct range *range, struct mad_stream *stream,
+		  struct mad_frame *frame, struct mad_synth *synth)
+{
+  struct mad_index const *index = &parallel->index;
+  unsigned long first, last, preroll;
+  unsigned char const *begin, *end = 0;
+  unsigned char *tail = 0;
+  int bad_last_frame = 0;
+
+  range->number = number;
+  range->result = 0;
+  range->flow   = MAD_FLOW_CONTINUE;
+  range->count  = 0;
+
+  first = parallel->first + number * RANGE_FRAMES;
+  last  = first + RANGE_FRAMES;
+
+  if (last > parallel->last)
+    last = parallel->last;
+
+  if (last < index->count)
+    end = parallel->start + index->entries[last].offset;
+
+  /*
+   * Start a few frames early, as mad_index_seek() does, but run the filter
+   * on those frames too: the synthesis history must be built from the same
+   * subband samples as in a decode from the beginning.
+   */
+
+  mad_stream_options(stream, parallel->options);
+
+  if (first == 0) {
+    begin = parallel->start;
+    mad_stream_buffer(stream, parallel->start, parallel->length);
+    synth->phase = 0;
+  }
+  else {
+    begin   = parallel->start + index->entries[first].offset;
+    preroll = mad_index_preroll(index, first);
+
+    mad_stream_buffer(stream,
+		      parallel->start + index->entries[preroll].offset,
+		      parallel->length - index->entries[preroll].offset);
+    synth->phase = (index->entries[preroll].sample / 32) % 16;
+  }
+
+  stream->md_len = 0;
+
+  mad_frame_mute(frame);
+  mad_synth_mute(synth);
+
+  while (end == 0 || stream->next_frame < end) {
+    if (mad_frame_decode(frame, stream) == -1) {
+      if (stream->error == MAD_ERROR_BUFLEN && end == 0 && tail == 0) {
+	unsigned long left;
+
+	/* end of stream; append MAD_BUFFER_GUARD zero bytes, like madplay */
+
+	left = stream->bufend - stream->next_frame;
+
+	tail = malloc(left + MAD_BUFFER_GUARD);
+	if (tail == 0) {
+	  range->result = -1;
+	  break;
+	}
+
+	memcpy(tail, stream->next_frame, left);
+	memset(tail + left, 0, MAD_BUFFER_GUARD);
+
+	mad_stream_buffer(stream, tail, left + MAD_BUFFER_GUARD);
+	continue;
+      }
+
+      if (!MAD_RECOVERABLE(stream->error)) {
+	if (stream->error != MAD_ERROR_BUFLEN)
+	  range->result = -1;
+	break;
+      }
+
+      /* as the default error handler of mad_decoder_run() */
+
+      if (stream->error != MAD_ERROR_BADCRC)
+	continue;
+
+      if (bad_last_frame)
+	mad_frame_mute(frame);
+      else
+	bad_last_frame = 1;
+    }
+    else
+      bad_last_frame = 0;
+
+    if (parallel->filter) {
+      enum mad_flow flow;
+
+      flow = parallel->filter(parallel->data, stream, frame);
+      if (flow == MAD_FLOW_IGNORE)
+	continue;
+      if (flow != MAD_FLOW_CONTINUE) {
+	range->flow = flow;
+	break;
+      }
+    }
+
+    mad_synth_frame(synth, frame);
+
+    /* the tail only ever holds the last frame, which is never primed */
+
+    if (tail == 0 && stream->this_frame < begin)
+      continue;
+
+    if (range_add(range, &frame->header, &synth->pcm) == -1) {
+      range->result = -1;
+      break;
+    }
+  }
+
+  if (tail)
+    free(tail);
+}
+
+/*
+ * NAME:	parallel_worker()
+ * DESCRIPTION:	decode ranges while there are free slots for them
+ */
+static
+void *parallel_worker(void *arg)
+{
+  struct parallel *parallel = arg;
+  struct mad_stream stream;
+  struct mad_frame frame;
+  struct mad_synth synth;
+
+  mad_stream_init(&stream);
+  mad_frame_init(&frame);
+  mad_synth_init(&synth);
+
+  pthread_mutex_lock(&parallel->lock);
+
+  while (1) {
+    unsigned long number;
+    struct range *range;
+
+    while (!parallel->abort && parallel->next < parallel->nranges &&
+	   parallel->next >= parallel->done + parallel->nslots)
+      pthread_cond_wait(&parallel->output, &parallel->lock);
+
+    if (parallel->abort || parallel->next == parallel->nranges)
+      break;
+
+    number = parallel->next++;
+    range  = &parallel->slots[number % parallel->nslots];
+
+    pthread_mutex_unlock(&parallel->lock);
+
+    decode_range(parallel, number, range, &stream, &frame, &synth);
+
+    pthread_mutex_lock(&parallel->lock);
+
+    range->ready = 1;
+    pthread_cond_broadcast(&parallel->decoded);
+  }
+
+  pthread_mutex_unlock(&parallel->lock);
+
+  mad_synth_finish(&synth);
+  mad_frame_finish(&frame);
+  mad_stream_finish(&stream);
+
+  return 0;
+}
+
+/*
+ * NAME:	batch_decode_parallel()
+ * DESCRIPTION:	decode frames [first, last) of a stream on up to nthreads
+ *		threads; return 0 or -1 as mad_decoder_run() does
+ */
+int batch_decode_parallel(unsigned char const *start, unsigned long length,
+			  unsigned long first, unsigned long last,
+			  unsigned int nthreads, int options,
+			  enum mad_flow (*filter)(void *,
+						  struct mad_stream const *,
+						  struct mad_frame *),
+			  enum mad_flow (*output)(void *,
+						  struct mad_header const *,
+						  struct mad_pcm *),
+			  void *data)
+{
+  struct parallel parallel;
+  pthread_t *threads;
+  unsigned long number;
+  unsigned int i, started;
+  int result = 0;
+
+  if (nthreads == 0)
+    nthreads = 1;
+
+  parallel.start   = start;
+  parallel.length  = length;
+  parallel.options = options;
+  parallel.filter  = filter;
+  parallel.data    = data;
+
+  mad_index_init(&parallel.index);
+  if (mad_index_build(&parallel.index, start, length) == -1) {
+    mad_index_finish(&parallel.index);
+    return -1;
+  }
+
+  if (last > parallel.index.count)
+    last = parallel.index.count;
+  if (first > last)
+    first = last;
+
+  parallel.first = first;
+  parallel.last  = last;
+
+  parallel.nranges = (last - first + RANGE_FRAMES - 1) / RANGE_FRAMES;
+
+  /* a stream too short to index still has its tail decoded by range 0 */
+
+  if (parallel.index.count == 0)
+    parallel.nranges = 1;
+
+  parallel.next  = 0;
+  parallel.done  = 0;
+  parallel.abort = 0;
+
+  parallel.nslots = 2 * nthreads;
+  parallel.slots  = calloc(parallel.nslots, sizeof(*parallel.slots));
+  threads = malloc(nthreads * sizeof(*threads));
+
+  if (parallel.slots == 0 || threads == 0) {
+    free(parallel.slots);
+    free(threads);
+    mad_index_finish(&parallel.index);
+    return -1;
+  }
+
+  pthread_mutex_init(&parallel.lock, 0);
+  pthread_cond_init(&parallel.decoded, 0);
+  pthread_cond_init(&parallel.output, 0);
+
+  for (started = 0; started < nthreads; ++started) {
+    if (pthread_create(&threads[started], 0, parallel_worker, &parallel) != 0)
+      break;
+  }
+
+  if (started == 0)
+    result = -1;
+
+  /* output the ranges in order as they are decoded */
+
+  for (number = 0; started && number < parallel.nranges; ++number) {
+    struct range *range = &parallel.slots[number % parallel.nslots];
+    enum mad_flow flow = MAD_FLOW_CONTINUE;
+    unsigned long f;
+
+    pthread_mutex_lock(&parallel.lock);
+    while (!(range->ready && range->number == number))
+      pthread_cond_wait(&parallel.decoded, &parallel.lock);
+    pthread_mutex_unlock(&parallel.lock);
+
+    for (f = 0; output && f < range->count; ++f) {
+      flow = output(data, &range->headers[f], &range->pcm[f]);
+      if (flow == MAD_FLOW_STOP || flow == MAD_FLOW_BREAK)
+	break;
+
+      flow = MAD_FLOW_CONTINUE;
+    }
+
+    if (flow == MAD_FLOW_CONTINUE) {
+      if (range->result == -1)
+	flow = MAD_FLOW_BREAK;
+      else
+	flow = range->flow;
+    }
+
+    pthread_mutex_lock(&parallel.lock);
+    range->ready = 0;
+    ++parallel.done;
+    pthread_cond_broadcast(&parallel.output);
+    pthread_mutex_unlock(&parallel.lock);
+
+    if (flow == MAD_FLOW_BREAK)
+      result = -1;
+    if (flow != MAD_FLOW_CONTINUE)
+      break;
+  }
+
+  pthread_mutex_lock(&parallel.lock);
+  parallel.abort = 1;
+  pthread_cond_broadcast(&parallel.output);
+  pthread_mutex_unlock(&parallel.lock);
+
+  for (i = 0; i < started; ++i)
+    pthread_join(threads[i], 0);
+
+  pthread_cond_destroy(&parallel.output);
+  pthread_cond_destroy(&parallel.decoded);
+  pthread_mutex_destroy(&parallel.lock);
+
+  for (i = 0; i < parallel.nslots; ++i) {
+    free(parallel.slots[i].headers);
+    free(parallel.slots[i].pcm);
+  }
+
+  free(parallel.slots);
+  free(threads);
+  mad_index_finish(&parallel.index);
+
+  return result;
+}
@@ -0,0 +1,73 @@
+/*
+ * mad - MPEG audio decoder
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * $Id$
+ */
+
+# ifndef BATCH_H
+# define BATCH_H
+
+# include "mad.h"
+
+/*
+ * A batch is a set of independent streams, each held whole in memory,
+ * which are decoded by a pool of threads. Every stream has a decoder of
+ * its own, so the only state the threads share is the index of the next
+ * stream to take; libmad itself needs no locking.
+ */
+
+struct batch_stream {
+  unsigned char const *start;		/* encoded stream */
+  unsigned long length;
+
+  enum mad_flow (*output)(void *, struct mad_header const *,
+			  struct mad_pcm *);
+  void *data;				/* passed to output, may be 0 */
+
+  /* filled in by batch_decode() */
+
+  int result;				/* of mad_decoder_run() */
+  unsigned long frames;			/* frames decoded */
+  unsigned long errors;			/* recoverable errors skipped */
+  mad_timer_t duration;			/* playing time decoded */
+};
+
+int batch_decode(struct batch_stream *, unsigned int, unsigned int);
+
+/*
+ * batch_decode_parallel() decodes a single stream, held whole in memory, on
+ * several threads. The stream is indexed and frames first up to but not
+ * including last (as numbered by mad_index_build(); ULONG_MAX for the end)
+ * are cut into ranges; each range is decoded by one thread, which first
+ * decodes and filters the few frames before it to rebuild the bit
+ * reservoir, the IMDCT overlap and the filterbank history (see
+ * mad_index_seek()). The filter callback runs on the decoding threads and
+ * must not depend on the frames before; the output callback runs on the
+ * calling thread, in stream order, and sees the same PCM as with
+ * mad_decoder_run().
+ */
+
+int batch_decode_parallel(unsigned char const *, unsigned long,
+			  unsigned long, unsigned long, unsigned int, int,
+			  enum mad_flow (*)(void *, struct mad_stream const *,
+					    struct mad_frame *),
+			  enum mad_flow (*)(void *, struct mad_header const *,
+					    struct mad_pcm *),
+			  void *);
+
+# endif
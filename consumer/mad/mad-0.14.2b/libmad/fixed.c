@@ -25,6 +25,8 @@
 
 # include "global.h"
 
+# include <stdlib.h>
+
 # include "fixed.h"
 
 /*
@@ -35,3 +37,30 @@ mad_fixed_t mad_f_abs(mad_fixed_t x)
 {
   return x < 0 ? -x : x;
 }
+
+/*
+ * NAME:	simd->level()
+ * DESCRIPTION:	return the SIMD kernels used by the synthesis and IMDCT
+ */
+enum mad_simd mad_simd_level(void)
+{
+# if defined(USE_SIMD)
+  static int level = -1;
+  char const *env;
+  int l;
+
+  /* MADSIMD=0 forces the C code, MADSIMD=1 limits the kernels to SSE2 */
+
+  if (level < 0) {
+    __builtin_cpu_init();
+    l = __builtin_cpu_supports("avx2") ? MAD_SIMD_AVX2 : MAD_SIMD_SSE2;
+    if ((env = getenv("MADSIMD")) && atoi(env) < l)
+      l = atoi(env) < MAD_SIMD_NONE ? MAD_SIMD_NONE : atoi(env);
+    level = l;
+  }
+
+  return level;
+# else
+  return MAD_SIMD_NONE;
+# endif
+}
@@ -473,4 +473,14 @@ mad_fixed_t mad_f_mul_inline(mad_fixed_t x, mad_fixed_t y)
 
 mad_fixed_t mad_f_abs(mad_fixed_t);
 
+/* SIMD support of the synthesis and IMDCT kernels */
+
+enum mad_simd {
+  MAD_SIMD_NONE = 0,
+  MAD_SIMD_SSE2 = 1,
+  MAD_SIMD_AVX2 = 2
+};
+
+enum mad_simd mad_simd_level(void);
+
 # endif
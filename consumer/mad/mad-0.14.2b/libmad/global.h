@@ -47,6 +47,24 @@
 #  define USE_ASYNC
 # endif
 
+/*
+ * SIMD kernels for the subband synthesis and the long block IMDCT, for
+ * GCC-compatible compilers on x86-64 (which always has SSE2). They are
+ * only used with FPM_DEFAULT, whose 32-bit products wrap the same way in
+ * vector lanes as in the C code, so they give the same PCM bit for bit.
+ * The AVX2 kernels are compiled with a target attribute and called only if
+ * mad_simd_level() finds AVX2 at run time.
+ */
+
+# if defined(__GNUC__) && defined(__x86_64__) && defined(FPM_DEFAULT)
+#  define USE_SIMD
+#  include <immintrin.h>
+#  define SIMD_AVX2	__attribute__((target("avx2")))
+
+typedef int v4si __attribute__((vector_size(16)));
+typedef int v8si __attribute__((vector_size(32)));
+# endif
+
 # if !defined(HAVE_ASSERT_H)
 #  if defined(NDEBUG)
 #   define assert(x)	/* nothing */
@@ -0,0 +1,296 @@
+/*
+ * libmad - MPEG audio decoder library
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * $Id$
+ */
+
+# ifdef HAVE_CONFIG_H
+#  include "config.h"
+# endif
+
+# include "global.h"
+
+# include <stdlib.h>
+
+# include "bit.h"
+# include "timer.h"
+# include "stream.h"
+# include "frame.h"
+# include "synth.h"
+# include "index.h"
+
+/*
+ * A frame index lets a stream be decoded from any frame instead of from
+ * its beginning. It is built in one pass over the frame headers, reading
+ * only the main_data_begin field of the Layer III side information.
+ *
+ * To give the same PCM as a decode from the start, a seek must restore
+ * three pieces of state: the Layer III bit reservoir, the IMDCT overlap of
+ * the previous granule, and the history of the synthesis filterbank. Two
+ * frames decoded before the target frame restore the last two, provided
+ * their own main_data can be found; so decoding starts at the frame that
+ * holds the first main_data byte of the frame two before the target, and
+ * the frames before the target are decoded but not returned.
+ */
+
+# define PREROLL_FRAMES	2
+
+/* main_data_begin reaches back at most 511 bytes, and a Layer III frame at
+   any valid bitrate holds at least one byte of main_data */
+
+# define REGION_RING	512
+
+/*
+ * NAME:	index->init()
+ * DESCRIPTION:	initialize an empty frame index
+ */
+void mad_index_init(struct mad_index *index)
+{
+  index->entries   = 0;
+  index->count     = 0;
+  index->allocated = 0;
+
+  index->samplerate = 0;
+  index->samples    = 0;
+  index->duration   = mad_timer_zero;
+}
+
+/*
+ * NAME:	index->finish()
+ * DESCRIPTION:	release the memory held by a frame index
+ */
+void mad_index_finish(struct mad_index *index)
+{
+  free(index->entries);
+
+  mad_index_init(index);
+}
+
+/*
+ * NAME:	index->build()
+ * DESCRIPTION:	index all frames of a stream held whole in memory
+ */
+int mad_index_build(struct mad_index *index,
+		    unsigned char const *buffer, unsigned long length)
+{
+  struct mad_stream stream;
+  struct mad_header header;
+  unsigned short region[REGION_RING];
+  int result = 0;
+
+  index->count      = 0;
+  index->samplerate = 0;
+  index->samples    = 0;
+  index->duration   = mad_timer_zero;
+
+  mad_stream_init(&stream);
+  mad_header_init(&header);
+
+  mad_stream_buffer(&stream, buffer, length);
+
+  while (1) {
+    struct mad_index_entry *entry;
+    unsigned char const *data;
+
+    if (mad_header_decode(&header, &stream) == -1) {
+      if (MAD_RECOVERABLE(stream.error))
+	continue;
+
+      if (stream.error != MAD_ERROR_BUFLEN)
+	result = -1;
+
+      break;
+    }
+
+    if (index->count == index->allocated) {
+      unsigned long allocated;
+
+      allocated = index->allocated ? 2 * index->allocated : 1024;
+      entry = realloc(index->entries, allocated * sizeof(*entry));
+      if (entry == 0) {
+	result = -1;
+	break;
+      }
+
+      index->entries   = entry;
+      index->allocated = allocated;
+    }
+
+    entry = &index->entries[index->count];
+
+    entry->offset          = stream.this_frame - buffer;
+    entry->sample          = index->samples;
+    entry->data_frame      = index->count;
+    entry->main_data_begin = 0;
+
+    region[index->count % REGION_RING] = 0;
+
+    if (header.layer == MAD_LAYER_III) {
+      struct mad_bitptr peek;
+      unsigned int lsf, si_len, need;
+      unsigned long frame;
+
+      lsf    = header.flags & MAD_FLAG_LSF_EXT;
+      si_len = lsf ? (MAD_NCHANNELS(&header) == 1 ? 9 : 17) :
+		     (MAD_NCHANNELS(&header) == 1 ? 17 : 32);
+
+      peek = stream.ptr;
+      entry->main_data_begin = mad_bit_read(&peek, lsf ? 8 : 9);
+
+      /* main_data of this frame follows its side information */
+
+      data = mad_bit_nextbyte(&stream.ptr) + si_len;
+      if (data < stream.next_frame)
+	region[index->count % REGION_RING] = stream.next_frame - data;
+
+      /* find the frame holding the first byte of main_data */
+
+      need  = entry->main_data_begin;
+      frame = index->count;
+
+      while (need && frame > 0 && index->count - frame < REGION_RING - 1) {
+	unsigned long size;
+
+	size = region[--frame % REGION_RING];
+	if (need <= size)
+	  break;
+
+	need -= size;
+      }
+
+      entry->data_frame = frame;
+    }
+
+    if (index->count == 0)
+      index->samplerate = header.samplerate;
+
+    index->samples += 32 * MAD_NSBSAMPLES(&header);
+    mad_timer_add(&index->duration, header.duration);
+
+    ++index->count;
+  }
+
+  mad_header_finish(&header);
+  mad_stream_finish(&stream);
+
+  return result;
+}
+
+/*
+ * NAME:	index->find()
+ * DESCRIPTION:	return the frame playing at the given time
+ */
+unsigned long mad_index_find(struct mad_index const *index, mad_timer_t time)
+{
+  unsigned long sample, low, high;
+
+  if (index->count == 0 || mad_timer_sign(time) <= 0)
+    return 0;
+
+  sample = mad_timer_count(time, (enum mad_units) index->samplerate);
+  if (sample >= index->samples)
+    return index->count;
+
+  /* last frame starting at or before sample */
+
+  low  = 0;
+  high = index->count;
+
+  while (high - low > 1) {
+    unsigned long mid = low + (high - low) / 2;
+
+    if (index->entries[mid].sample <= sample)
+      low = mid;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+/*
+ * NAME:	index->preroll()
+ * DESCRIPTION:	return the frame a seek to the given frame starts decoding at
+ */
+unsigned long mad_index_preroll(struct mad_index const *index,
+				unsigned long frame)
+{
+  if (frame > index->count)
+    frame = index->count;
+
+  if (frame < PREROLL_FRAMES)
+    return 0;
+
+  return index->entries[frame - PREROLL_FRAMES].data_frame;
+}
+
+/*
+ * NAME:	index->seek()
+ * DESCRIPTION:	prepare stream, frame and synth so that the next call of
+ *		mad_frame_decode() decodes the given frame as it would be
+ *		decoded in a pass over the whole stream
+ */
+int mad_index_seek(struct mad_index const *index, unsigned long frame,
+		   unsigned char const *buffer, unsigned long length,
+		   struct mad_stream *stream, struct mad_frame *pframe,
+		   struct mad_synth *synth)
+{
+  unsigned char const *target;
+  unsigned long first;
+
+  if (frame > index->count) {
+    stream->error = MAD_ERROR_BUFLEN;
+    return -1;
+  }
+
+  if (frame == index->count) {
+    mad_stream_buffer(stream, buffer + length, 0);
+    return 0;
+  }
+
+  first = mad_index_preroll(index, frame);
+
+  mad_stream_buffer(stream, buffer + index->entries[first].offset,
+		    length - index->entries[first].offset);
+  stream->skiplen = 0;
+  stream->md_len  = 0;
+
+  mad_frame_mute(pframe);
+  mad_synth_mute(synth);
+
+  /* keep the filterbank phase of a decode from the start */
+
+  synth->phase = (index->entries[first].sample / 32) % 16;
+
+  target = buffer + index->entries[frame].offset;
+
+  while (stream->next_frame < target) {
+    if (mad_frame_decode(pframe, stream) == -1) {
+      if (!MAD_RECOVERABLE(stream->error))
+	return -1;
+
+      /* e.g. main_data from before the first frame is missing */
+
+      continue;
+    }
+
+    mad_synth_frame(synth, pframe);
+  }
+
+  return 0;
+}
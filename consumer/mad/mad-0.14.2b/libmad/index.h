@@ -0,0 +1,60 @@
+/*
+ * libmad - MPEG audio decoder library
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * $Id$
+ */
+
+# ifndef LIBMAD_INDEX_H
+# define LIBMAD_INDEX_H
+
+# include "timer.h"
+# include "stream.h"
+# include "frame.h"
+# include "synth.h"
+
+struct mad_index_entry {
+  unsigned long offset;			/* byte offset of the frame header */
+  unsigned long sample;			/* first PCM sample of the frame */
+  unsigned long data_frame;		/* frame holding its first main_data
+					   byte (Layer III), else itself */
+  unsigned short main_data_begin;	/* Layer III main_data_begin */
+};
+
+struct mad_index {
+  struct mad_index_entry *entries;	/* one per frame, in stream order */
+  unsigned long count;			/* number of frames */
+  unsigned long allocated;		/* room in entries */
+
+  unsigned int samplerate;		/* of the first frame (Hz) */
+  unsigned long samples;		/* PCM samples per channel, in all */
+  mad_timer_t duration;			/* playing time, in all */
+};
+
+void mad_index_init(struct mad_index *);
+void mad_index_finish(struct mad_index *);
+
+int mad_index_build(struct mad_index *, unsigned char const *, unsigned long);
+
+unsigned long mad_index_find(struct mad_index const *, mad_timer_t);
+unsigned long mad_index_preroll(struct mad_index const *, unsigned long);
+
+int mad_index_seek(struct mad_index const *, unsigned long,
+		   unsigned char const *, unsigned long,
+		   struct mad_stream *, struct mad_frame *, struct mad_synth *);
+
+# endif
@@ -1587,283 +1587,7 @@ void imdct36(mad_fixed_t const X[18], mad_fixed_t x[36])
   register mad_fixed64hi_t hi;
   register mad_fixed64lo_t lo;
 
-  MAD_F_ML0(hi, lo, X[4],  MAD_F(0x0ec835e8));
-  MAD_F_MLA(hi, lo, X[13], MAD_F(0x061f78aa));
-
-  t6 = MAD_F_MLZ(hi, lo);
-
-  MAD_F_MLA(hi, lo, (t14 = X[1] - X[10]), -MAD_F(0x061f78aa));
-  MAD_F_MLA(hi, lo, (t15 = X[7] + X[16]), -MAD_F(0x0ec835e8));
-
-  t0 = MAD_F_MLZ(hi, lo);
-
-  MAD_F_MLA(hi, lo, (t8  = X[0] - X[11] - X[12]),  MAD_F(0x0216a2a2));
-  MAD_F_MLA(hi, lo, (t9  = X[2] - X[9]  - X[14]),  MAD_F(0x09bd7ca0));
-  MAD_F_MLA(hi, lo, (t10 = X[3] - X[8]  - X[15]), -MAD_F(0x0cb19346));
-  MAD_F_MLA(hi, lo, (t11 = X[5] - X[6]  - X[17]), -MAD_F(0x0fdcf549));
-
-  x[7]  = MAD_F_MLZ(hi, lo);
-  x[10] = -x[7];
-
-  MAD_F_ML0(hi, lo, t8,  -MAD_F(0x0cb19346));
-  MAD_F_MLA(hi, lo, t9,   MAD_F(0x0fdcf549));
-  MAD_F_MLA(hi, lo, t10,  MAD_F(0x0216a2a2));
-  MAD_F_MLA(hi, lo, t11, -MAD_F(0x09bd7ca0));
-
-  x[19] = x[34] = MAD_F_MLZ(hi, lo) - t0;
-
-  t12 = X[0] - X[3] + X[8] - X[11] - X[12] + X[15];
-  t13 = X[2] + X[5] - X[6] - X[9]  - X[14] - X[17];
-
-  MAD_F_ML0(hi, lo, t12, -MAD_F(0x0ec835e8));
-  MAD_F_MLA(hi, lo, t13,  MAD_F(0x061f78aa));
-
-  x[22] = x[31] = MAD_F_MLZ(hi, lo) + t0;
-
-  MAD_F_ML0(hi, lo, X[1],  -MAD_F(0x09bd7ca0));
-  MAD_F_MLA(hi, lo, X[7],   MAD_F(0x0216a2a2));
-  MAD_F_MLA(hi, lo, X[10], -MAD_F(0x0fdcf549));
-  MAD_F_MLA(hi, lo, X[16],  MAD_F(0x0cb19346));
-
-  t1 = MAD_F_MLZ(hi, lo) + t6;
-
-  MAD_F_ML0(hi, lo, X[0],   MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[2],   MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[3],  -MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[5],  -MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[6],   MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[8],  -MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[9],   MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[11],  MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[12], -MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[14],  MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[15], -MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[17], -MAD_F(0x0f9ee890));
-
-  x[6]  = MAD_F_MLZ(hi, lo) + t1;
-  x[11] = -x[6];
-
-  MAD_F_ML0(hi, lo, X[0],  -MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[2],  -MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[3],   MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[5],   MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[6],   MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[8],  -MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[9],  -MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[11], -MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[12], -MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[14],  MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[15],  MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[17],  MAD_F(0x04cfb0e2));
-
-  x[23] = x[30] = MAD_F_MLZ(hi, lo) + t1;
-
-  MAD_F_ML0(hi, lo, X[0],  -MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[2],   MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[3],  -MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[5],   MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[6],   MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[8],  -MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[9],  -MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[11],  MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[12], -MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[14],  MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[15],  MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[17], -MAD_F(0x0acf37ad));
-
-  x[18] = x[35] = MAD_F_MLZ(hi, lo) - t1;
-
-  MAD_F_ML0(hi, lo, X[4],   MAD_F(0x061f78aa));
-  MAD_F_MLA(hi, lo, X[13], -MAD_F(0x0ec835e8));
-
-  t7 = MAD_F_MLZ(hi, lo);
-
-  MAD_F_MLA(hi, lo, X[1],  -MAD_F(0x0cb19346));
-  MAD_F_MLA(hi, lo, X[7],   MAD_F(0x0fdcf549));
-  MAD_F_MLA(hi, lo, X[10],  MAD_F(0x0216a2a2));
-  MAD_F_MLA(hi, lo, X[16], -MAD_F(0x09bd7ca0));
-
-  t2 = MAD_F_MLZ(hi, lo);
-
-  MAD_F_MLA(hi, lo, X[0],   MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[2],   MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[3],  -MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[5],   MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[6],  -MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[8],  -MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[9],   MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[11], -MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[12],  MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[14],  MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[15],  MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[17],  MAD_F(0x0f426cb5));
-
-  x[5]  = MAD_F_MLZ(hi, lo);
-  x[12] = -x[5];
-
-  MAD_F_ML0(hi, lo, X[0],   MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[2],  -MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[3],   MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[5],  -MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[6],  -MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[8],   MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[9],  -MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[11],  MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[12], -MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[14],  MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[15],  MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[17], -MAD_F(0x0bcbe352));
-
-  x[0]  = MAD_F_MLZ(hi, lo) + t2;
-  x[17] = -x[0];
-
-  MAD_F_ML0(hi, lo, X[0],  -MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[2],  -MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[3],  -MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[5],   MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[6],   MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[8],   MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[9],   MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[11], -MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[12], -MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[14], -MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[15], -MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[17], -MAD_F(0x03768962));
-
-  x[24] = x[29] = MAD_F_MLZ(hi, lo) + t2;
-
-  MAD_F_ML0(hi, lo, X[1],  -MAD_F(0x0216a2a2));
-  MAD_F_MLA(hi, lo, X[7],  -MAD_F(0x09bd7ca0));
-  MAD_F_MLA(hi, lo, X[10],  MAD_F(0x0cb19346));
-  MAD_F_MLA(hi, lo, X[16],  MAD_F(0x0fdcf549));
-
-  t3 = MAD_F_MLZ(hi, lo) + t7;
-
-  MAD_F_ML0(hi, lo, X[0],   MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[2],   MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[3],  -MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[5],  -MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[6],   MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[8],   MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[9],  -MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[11], -MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[12],  MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[14],  MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[15], -MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[17], -MAD_F(0x0ffc19fd));
-
-  x[8] = MAD_F_MLZ(hi, lo) + t3;
-  x[9] = -x[8];
-
-  MAD_F_ML0(hi, lo, X[0],  -MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[2],   MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[3],   MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[5],  -MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[6],  -MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[8],   MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[9],   MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[11], -MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[12], -MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[14], -MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[15],  MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[17],  MAD_F(0x07635284));
-
-  x[21] = x[32] = MAD_F_MLZ(hi, lo) + t3;
-
-  MAD_F_ML0(hi, lo, X[0],  -MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[2],   MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[3],   MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[5],  -MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[6],  -MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[8],   MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[9],   MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[11], -MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[12],  MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[14],  MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[15], -MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[17], -MAD_F(0x0898c779));
-
-  x[20] = x[33] = MAD_F_MLZ(hi, lo) - t3;
-
-  MAD_F_ML0(hi, lo, t14, -MAD_F(0x0ec835e8));
-  MAD_F_MLA(hi, lo, t15,  MAD_F(0x061f78aa));
-
-  t4 = MAD_F_MLZ(hi, lo) - t7;
-
-  MAD_F_ML0(hi, lo, t12, MAD_F(0x061f78aa));
-  MAD_F_MLA(hi, lo, t13, MAD_F(0x0ec835e8));
-
-  x[4]  = MAD_F_MLZ(hi, lo) + t4;
-  x[13] = -x[4];
-
-  MAD_F_ML0(hi, lo, t8,   MAD_F(0x09bd7ca0));
-  MAD_F_MLA(hi, lo, t9,  -MAD_F(0x0216a2a2));
-  MAD_F_MLA(hi, lo, t10,  MAD_F(0x0fdcf549));
-  MAD_F_MLA(hi, lo, t11, -MAD_F(0x0cb19346));
-
-  x[1]  = MAD_F_MLZ(hi, lo) + t4;
-  x[16] = -x[1];
-
-  MAD_F_ML0(hi, lo, t8,  -MAD_F(0x0fdcf549));
-  MAD_F_MLA(hi, lo, t9,  -MAD_F(0x0cb19346));
-  MAD_F_MLA(hi, lo, t10, -MAD_F(0x09bd7ca0));
-  MAD_F_MLA(hi, lo, t11, -MAD_F(0x0216a2a2));
-
-  x[25] = x[28] = MAD_F_MLZ(hi, lo) + t4;
-
-  MAD_F_ML0(hi, lo, X[1],  -MAD_F(0x0fdcf549));
-  MAD_F_MLA(hi, lo, X[7],  -MAD_F(0x0cb19346));
-  MAD_F_MLA(hi, lo, X[10], -MAD_F(0x09bd7ca0));
-  MAD_F_MLA(hi, lo, X[16], -MAD_F(0x0216a2a2));
-
-  t5 = MAD_F_MLZ(hi, lo) - t6;
-
-  MAD_F_ML0(hi, lo, X[0],   MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[2],   MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[3],   MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[5],   MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[6],   MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[8],  -MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[9],   MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[11], -MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[12],  MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[14], -MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[15],  MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[17], -MAD_F(0x0d7e8807));
-
-  x[2]  = MAD_F_MLZ(hi, lo) + t5;
-  x[15] = -x[2];
-
-  MAD_F_ML0(hi, lo, X[0],   MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[2],   MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[3],   MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[5],   MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[6],  -MAD_F(0x00b2aa3e));
-  MAD_F_MLA(hi, lo, X[8],   MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[9],  -MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[11],  MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[12], -MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[14],  MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[15], -MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[17],  MAD_F(0x0e313245));
-
-  x[3]  = MAD_F_MLZ(hi, lo) + t5;
-  x[14] = -x[3];
-
-  MAD_F_ML0(hi, lo, X[0],  -MAD_F(0x0ffc19fd));
-  MAD_F_MLA(hi, lo, X[2],  -MAD_F(0x0f9ee890));
-  MAD_F_MLA(hi, lo, X[3],  -MAD_F(0x0f426cb5));
-  MAD_F_MLA(hi, lo, X[5],  -MAD_F(0x0e313245));
-  MAD_F_MLA(hi, lo, X[6],  -MAD_F(0x0d7e8807));
-  MAD_F_MLA(hi, lo, X[8],  -MAD_F(0x0bcbe352));
-  MAD_F_MLA(hi, lo, X[9],  -MAD_F(0x0acf37ad));
-  MAD_F_MLA(hi, lo, X[11], -MAD_F(0x0898c779));
-  MAD_F_MLA(hi, lo, X[12], -MAD_F(0x07635284));
-  MAD_F_MLA(hi, lo, X[14], -MAD_F(0x04cfb0e2));
-  MAD_F_MLA(hi, lo, X[15], -MAD_F(0x03768962));
-  MAD_F_MLA(hi, lo, X[17], -MAD_F(0x00b2aa3e));
-
-  x[26] = x[27] = MAD_F_MLZ(hi, lo) + t5;
+# include "imdct36.dat"
 }
 
 /*
@@ -1943,6 +1667,134 @@ void III_imdct_l(mad_fixed_t const X[18], mad_fixed_t z[36],
     break;
   }
 }
+
+# if defined(USE_SIMD)
+/*
+ * NAME:	imdct36_sse2(), imdct36_avx2()
+ * DESCRIPTION:	perform the IMDCT of 4 or 8 consecutive subbands at once
+ */
+#  pragma push_macro("MAD_F_MLZ")
+#  undef  MAD_F_MLZ
+#  define MAD_F_MLZ(hi, lo)	((void) (hi), (lo))
+
+static
+void imdct36_sse2(v4si const X[18], v4si x[36])
+{
+  v4si t0, t1, t2,  t3,  t4,  t5,  t6,  t7;
+  v4si t8, t9, t10, t11, t12, t13, t14, t15;
+  v4si hi, lo;
+
+# include "imdct36.dat"
+}
+
+static SIMD_AVX2
+void imdct36_avx2(v8si const X[18], v8si x[36])
+{
+  v8si t0, t1, t2,  t3,  t4,  t5,  t6,  t7;
+  v8si t8, t9, t10, t11, t12, t13, t14, t15;
+  v8si hi, lo;
+
+# include "imdct36.dat"
+}
+
+#  pragma pop_macro("MAD_F_MLZ")
+
+/*
+ * NAME:	III_imdct_l_sse2(), III_imdct_l_avx2()
+ * DESCRIPTION:	perform IMDCT and windowing for up to 4 or 8 long blocks
+ */
+# define IMDCT_L_WINDOW(v, set1)  \
+  switch (block_type) {  \
+  case 0:  /* normal window */  \
+    for (i =  0; i < 36; ++i) out[i] = mad_f_mul(out[i], (v) set1(window_l[i]));  \
+    break;  \
+  \
+  case 1:  /* start block */  \
+    for (i =  0; i < 18; ++i) out[i] = mad_f_mul(out[i], (v) set1(window_l[i]));  \
+    for (i = 24; i < 30; ++i) out[i] = mad_f_mul(out[i], (v) set1(window_s[i - 18]));  \
+    for (i = 30; i < 36; ++i) out[i] = (v) set1(0);  \
+    break;  \
+  \
+  case 3:  /* stop block */  \
+    for (i =  0; i <  6; ++i) out[i] = (v) set1(0);  \
+    for (i =  6; i < 12; ++i) out[i] = mad_f_mul(out[i], (v) set1(window_s[i - 6]));  \
+    for (i = 18; i < 36; ++i) out[i] = mad_f_mul(out[i], (v) set1(window_l[i]));  \
+    break;  \
+  }
+
+static
+void III_imdct_l_sse2(mad_fixed_t const X[][18], mad_fixed_t z[][36],
+		      unsigned int n, unsigned int block_type)
+{
+  mad_fixed_t buf[36][4] __attribute__((aligned(16)));
+  v4si in[18], out[36];
+  unsigned int i, j;
+
+  for (i = 0; i < 18; ++i) {
+    for (j = 0; j < 4; ++j)
+      buf[i][j] = j < n ? X[j][i] : 0;
+    in[i] = (v4si) _mm_load_si128((__m128i const *) buf[i]);
+  }
+
+  imdct36_sse2(in, out);
+
+  IMDCT_L_WINDOW(v4si, _mm_set1_epi32)
+
+  for (i = 0; i < 36; ++i) {
+    _mm_store_si128((__m128i *) buf[i], (__m128i) out[i]);
+    for (j = 0; j < n; ++j)
+      z[j][i] = buf[i][j];
+  }
+}
+
+static SIMD_AVX2
+void III_imdct_l_avx2(mad_fixed_t const X[][18], mad_fixed_t z[][36],
+		      unsigned int n, unsigned int block_type)
+{
+  mad_fixed_t buf[36][8] __attribute__((aligned(32)));
+  v8si in[18], out[36];
+  unsigned int i, j;
+
+  for (i = 0; i < 18; ++i) {
+    for (j = 0; j < 8; ++j)
+      buf[i][j] = j < n ? X[j][i] : 0;
+    in[i] = (v8si) _mm256_load_si256((__m256i const *) buf[i]);
+  }
+
+  imdct36_avx2(in, out);
+
+  IMDCT_L_WINDOW(v8si, _mm256_set1_epi32)
+
+  for (i = 0; i < 36; ++i) {
+    _mm256_store_si256((__m256i *) buf[i], (__m256i) out[i]);
+    for (j = 0; j < n; ++j)
+      z[j][i] = buf[i][j];
+  }
+}
+
+/*
+ * NAME:	III_imdct_l_simd()
+ * DESCRIPTION:	perform IMDCT and windowing for as many of count long blocks
+ *		as one call of the SIMD kernel takes; return that number
+ */
+static
+unsigned int III_imdct_l_simd(mad_fixed_t const X[][18], mad_fixed_t z[][36],
+			      unsigned int count, unsigned int block_type)
+{
+  unsigned int n;
+
+  if (mad_simd_level() >= MAD_SIMD_AVX2) {
+    n = count < 8 ? count : 8;
+    III_imdct_l_avx2(X, z, n, block_type);
+  }
+  else {
+    n = count < 4 ? count : 4;
+    III_imdct_l_sse2(X, z, n, block_type);
+  }
+
+  return n;
+}
+# endif  /* USE_SIMD */
 # endif  /* ASO_IMDCT */
 
 /*
@@ -2278,6 +2130,27 @@ enum mad_error III_decode(struct mad_bitptr *ptr, struct mad_frame *frame,
 
       sblimit = 32 - (576 - i) / 18;
 
+# if defined(USE_SIMD) && !defined(ASO_IMDCT)
+      if (channel->block_type != 2 && mad_simd_level() != MAD_SIMD_NONE) {
+	/* long blocks, several subbands per call */
+	mad_fixed_t outputs[8][36];
+	unsigned int n, j;
+
+	for (sb = 2; sb < sblimit; sb += n, l += 18 * n) {
+	  n = III_imdct_l_simd((mad_fixed_t const (*)[18]) &xr[ch][l],
+			       outputs, sblimit - sb, channel->block_type);
+
+	  for (j = 0; j < n; ++j) {
+	    III_overlap(outputs[j], (*frame->overlap)[ch][sb + j],
+			sample, sb + j);
+
+	    if ((sb + j) & 1)
+	      III_freqinver(sample, sb + j);
+	  }
+	}
+      }
+      else
+# endif
       if (channel->block_type != 2) {
 	/* long blocks */
 	for (sb = 2; sb < sblimit; ++sb, l += 18) {
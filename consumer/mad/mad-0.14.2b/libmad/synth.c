@@ -147,369 +147,80 @@ void dct32(mad_fixed_t const in[32], unsigned int slot,
   mad_fixed_t t168, t169, t170, t171, t172, t173, t174, t175;
   mad_fixed_t t176;
 
-  /* costab[i] = cos(PI / (2 * 32) * i) */
-
-# if defined(OPT_DCTO)
-#  define costab1	MAD_F(0x7fd8878e)
-#  define costab2	MAD_F(0x7f62368f)
-#  define costab3	MAD_F(0x7e9d55fc)
-#  define costab4	MAD_F(0x7d8a5f40)
-#  define costab5	MAD_F(0x7c29fbee)
-#  define costab6	MAD_F(0x7a7d055b)
-#  define costab7	MAD_F(0x78848414)
-#  define costab8	MAD_F(0x7641af3d)
-#  define costab9	MAD_F(0x73b5ebd1)
-#  define costab10	MAD_F(0x70e2cbc6)
-#  define costab11	MAD_F(0x6dca0d14)
-#  define costab12	MAD_F(0x6a6d98a4)
-#  define costab13	MAD_F(0x66cf8120)
-#  define costab14	MAD_F(0x62f201ac)
-#  define costab15	MAD_F(0x5ed77c8a)
-#  define costab16	MAD_F(0x5a82799a)
-#  define costab17	MAD_F(0x55f5a4d2)
-#  define costab18	MAD_F(0x5133cc94)
-#  define costab19	MAD_F(0x4c3fdff4)
-#  define costab20	MAD_F(0x471cece7)
-#  define costab21	MAD_F(0x41ce1e65)
-#  define costab22	MAD_F(0x3c56ba70)
-#  define costab23	MAD_F(0x36ba2014)
-#  define costab24	MAD_F(0x30fbc54d)
-#  define costab25	MAD_F(0x2b1f34eb)
-#  define costab26	MAD_F(0x25280c5e)
-#  define costab27	MAD_F(0x1f19f97b)
-#  define costab28	MAD_F(0x18f8b83c)
-#  define costab29	MAD_F(0x12c8106f)
-#  define costab30	MAD_F(0x0c8bd35e)
-#  define costab31	MAD_F(0x0647d97c)
-# else
-#  define costab1	MAD_F(0x0ffb10f2)  /* 0.998795456 */
-#  define costab2	MAD_F(0x0fec46d2)  /* 0.995184727 */
-#  define costab3	MAD_F(0x0fd3aac0)  /* 0.989176510 */
-#  define costab4	MAD_F(0x0fb14be8)  /* 0.980785280 */
-#  define costab5	MAD_F(0x0f853f7e)  /* 0.970031253 */
-#  define costab6	MAD_F(0x0f4fa0ab)  /* 0.956940336 */
-#  define costab7	MAD_F(0x0f109082)  /* 0.941544065 */
-#  define costab8	MAD_F(0x0ec835e8)  /* 0.923879533 */
-#  define costab9	MAD_F(0x0e76bd7a)  /* 0.903989293 */
-#  define costab10	MAD_F(0x0e1c5979)  /* 0.881921264 */
-#  define costab11	MAD_F(0x0db941a3)  /* 0.857728610 */
-#  define costab12	MAD_F(0x0d4db315)  /* 0.831469612 */
-#  define costab13	MAD_F(0x0cd9f024)  /* 0.803207531 */
-#  define costab14	MAD_F(0x0c5e4036)  /* 0.773010453 */
-#  define costab15	MAD_F(0x0bdaef91)  /* 0.740951125 */
-#  define costab16	MAD_F(0x0b504f33)  /* 0.707106781 */
-#  define costab17	MAD_F(0x0abeb49a)  /* 0.671558955 */
-#  define costab18	MAD_F(0x0a267993)  /* 0.634393284 */
-#  define costab19	MAD_F(0x0987fbfe)  /* 0.595699304 */
-#  define costab20	MAD_F(0x08e39d9d)  /* 0.555570233 */
-#  define costab21	MAD_F(0x0839c3cd)  /* 0.514102744 */
-#  define costab22	MAD_F(0x078ad74e)  /* 0.471396737 */
-#  define costab23	MAD_F(0x06d74402)  /* 0.427555093 */
-#  define costab24	MAD_F(0x061f78aa)  /* 0.382683432 */
-#  define costab25	MAD_F(0x0563e69d)  /* 0.336889853 */
-#  define costab26	MAD_F(0x04a5018c)  /* 0.290284677 */
-#  define costab27	MAD_F(0x03e33f2f)  /* 0.242980180 */
-#  define costab28	MAD_F(0x031f1708)  /* 0.195090322 */
-#  define costab29	MAD_F(0x0259020e)  /* 0.146730474 */
-#  define costab30	MAD_F(0x01917a6c)  /* 0.098017140 */
-#  define costab31	MAD_F(0x00c8fb30)  /* 0.049067674 */
-# endif
-
-  t0   = in[0]  + in[31];  t16  = MUL(in[0]  - in[31], costab1);
-  t1   = in[15] + in[16];  t17  = MUL(in[15] - in[16], costab31);
-
-  t41  = t16 + t17;
-  t59  = MUL(t16 - t17, costab2);
-  t33  = t0  + t1;
-  t50  = MUL(t0  - t1,  costab2);
-
-  t2   = in[7]  + in[24];  t18  = MUL(in[7]  - in[24], costab15);
-  t3   = in[8]  + in[23];  t19  = MUL(in[8]  - in[23], costab17);
-
-  t42  = t18 + t19;
-  t60  = MUL(t18 - t19, costab30);
-  t34  = t2  + t3;
-  t51  = MUL(t2  - t3,  costab30);
-
-  t4   = in[3]  + in[28];  t20  = MUL(in[3]  - in[28], costab7);
-  t5   = in[12] + in[19];  t21  = MUL(in[12] - in[19], costab25);
-
-  t43  = t20 + t21;
-  t61  = MUL(t20 - t21, costab14);
-  t35  = t4  + t5;
-  t52  = MUL(t4  - t5,  costab14);
-
-  t6   = in[4]  + in[27];  t22  = MUL(in[4]  - in[27], costab9);
-  t7   = in[11] + in[20];  t23  = MUL(in[11] - in[20], costab23);
-
-  t44  = t22 + t23;
-  t62  = MUL(t22 - t23, costab18);
-  t36  = t6  + t7;
-  t53  = MUL(t6  - t7,  costab18);
-
-  t8   = in[1]  + in[30];  t24  = MUL(in[1]  - in[30], costab3);
-  t9   = in[14] + in[17];  t25  = MUL(in[14] - in[17], costab29);
-
-  t45  = t24 + t25;
-  t63  = MUL(t24 - t25, costab6);
-  t37  = t8  + t9;
-  t54  = MUL(t8  - t9,  costab6);
-
-  t10  = in[6]  + in[25];  t26  = MUL(in[6]  - in[25], costab13);
-  t11  = in[9]  + in[22];  t27  = MUL(in[9]  - in[22], costab19);
-
-  t46  = t26 + t27;
-  t64  = MUL(t26 - t27, costab26);
-  t38  = t10 + t11;
-  t55  = MUL(t10 - t11, costab26);
-
-  t12  = in[2]  + in[29];  t28  = MUL(in[2]  - in[29], costab5);
-  t13  = in[13] + in[18];  t29  = MUL(in[13] - in[18], costab27);
-
-  t47  = t28 + t29;
-  t65  = MUL(t28 - t29, costab10);
-  t39  = t12 + t13;
-  t56  = MUL(t12 - t13, costab10);
-
-  t14  = in[5]  + in[26];  t30  = MUL(in[5]  - in[26], costab11);
-  t15  = in[10] + in[21];  t31  = MUL(in[10] - in[21], costab21);
-
-  t48  = t30 + t31;
-  t66  = MUL(t30 - t31, costab22);
-  t40  = t14 + t15;
-  t57  = MUL(t14 - t15, costab22);
-
-  t69  = t33 + t34;  t89  = MUL(t33 - t34, costab4);
-  t70  = t35 + t36;  t90  = MUL(t35 - t36, costab28);
-  t71  = t37 + t38;  t91  = MUL(t37 - t38, costab12);
-  t72  = t39 + t40;  t92  = MUL(t39 - t40, costab20);
-  t73  = t41 + t42;  t94  = MUL(t41 - t42, costab4);
-  t74  = t43 + t44;  t95  = MUL(t43 - t44, costab28);
-  t75  = t45 + t46;  t96  = MUL(t45 - t46, costab12);
-  t76  = t47 + t48;  t97  = MUL(t47 - t48, costab20);
-
-  t78  = t50 + t51;  t100 = MUL(t50 - t51, costab4);
-  t79  = t52 + t53;  t101 = MUL(t52 - t53, costab28);
-  t80  = t54 + t55;  t102 = MUL(t54 - t55, costab12);
-  t81  = t56 + t57;  t103 = MUL(t56 - t57, costab20);
-
-  t83  = t59 + t60;  t106 = MUL(t59 - t60, costab4);
-  t84  = t61 + t62;  t107 = MUL(t61 - t62, costab28);
-  t85  = t63 + t64;  t108 = MUL(t63 - t64, costab12);
-  t86  = t65 + t66;  t109 = MUL(t65 - t66, costab20);
-
-  t113 = t69  + t70;
-  t114 = t71  + t72;
-
-  /*  0 */ hi[15][slot] = SHIFT(t113 + t114);
-  /* 16 */ lo[ 0][slot] = SHIFT(MUL(t113 - t114, costab16));
-
-  t115 = t73  + t74;
-  t116 = t75  + t76;
-
-  t32  = t115 + t116;
-
-  /*  1 */ hi[14][slot] = SHIFT(t32);
-
-  t118 = t78  + t79;
-  t119 = t80  + t81;
-
-  t58  = t118 + t119;
-
-  /*  2 */ hi[13][slot] = SHIFT(t58);
-
-  t121 = t83  + t84;
-  t122 = t85  + t86;
-
-  t67  = t121 + t122;
-
-  t49  = (t67 * 2) - t32;
-
-  /*  3 */ hi[12][slot] = SHIFT(t49);
-
-  t125 = t89  + t90;
-  t126 = t91  + t92;
-
-  t93  = t125 + t126;
-
-  /*  4 */ hi[11][slot] = SHIFT(t93);
-
-  t128 = t94  + t95;
-  t129 = t96  + t97;
-
-  t98  = t128 + t129;
-
-  t68  = (t98 * 2) - t49;
-
-  /*  5 */ hi[10][slot] = SHIFT(t68);
-
-  t132 = t100 + t101;
-  t133 = t102 + t103;
-
-  t104 = t132 + t133;
-
-  t82  = (t104 * 2) - t58;
-
-  /*  6 */ hi[ 9][slot] = SHIFT(t82);
-
-  t136 = t106 + t107;
-  t137 = t108 + t109;
-
-  t110 = t136 + t137;
-
-  t87  = (t110 * 2) - t67;
-
-  t77  = (t87 * 2) - t68;
-
-  /*  7 */ hi[ 8][slot] = SHIFT(t77);
-
-  t141 = MUL(t69 - t70, costab8);
-  t142 = MUL(t71 - t72, costab24);
-  t143 = t141 + t142;
-
-  /*  8 */ hi[ 7][slot] = SHIFT(t143);
-  /* 24 */ lo[ 8][slot] =
-	     SHIFT((MUL(t141 - t142, costab16) * 2) - t143);
-
-  t144 = MUL(t73 - t74, costab8);
-  t145 = MUL(t75 - t76, costab24);
-  t146 = t144 + t145;
-
-  t88  = (t146 * 2) - t77;
-
-  /*  9 */ hi[ 6][slot] = SHIFT(t88);
-
-  t148 = MUL(t78 - t79, costab8);
-  t149 = MUL(t80 - t81, costab24);
-  t150 = t148 + t149;
-
-  t105 = (t150 * 2) - t82;
-
-  /* 10 */ hi[ 5][slot] = SHIFT(t105);
-
-  t152 = MUL(t83 - t84, costab8);
-  t153 = MUL(t85 - t86, costab24);
-  t154 = t152 + t153;
-
-  t111 = (t154 * 2) - t87;
-
-  t99  = (t111 * 2) - t88;
-
-  /* 11 */ hi[ 4][slot] = SHIFT(t99);
-
-  t157 = MUL(t89 - t90, costab8);
-  t158 = MUL(t91 - t92, costab24);
-  t159 = t157 + t158;
-
-  t127 = (t159 * 2) - t93;
-
-  /* 12 */ hi[ 3][slot] = SHIFT(t127);
-
-  t160 = (MUL(t125 - t126, costab16) * 2) - t127;
-
-  /* 20 */ lo[ 4][slot] = SHIFT(t160);
-  /* 28 */ lo[12][slot] =
-	     SHIFT((((MUL(t157 - t158, costab16) * 2) - t159) * 2) - t160);
-
-  t161 = MUL(t94 - t95, costab8);
-  t162 = MUL(t96 - t97, costab24);
-  t163 = t161 + t162;
-
-  t130 = (t163 * 2) - t98;
-
-  t112 = (t130 * 2) - t99;
-
-  /* 13 */ hi[ 2][slot] = SHIFT(t112);
-
-  t164 = (MUL(t128 - t129, costab16) * 2) - t130;
-
-  t166 = MUL(t100 - t101, costab8);
-  t167 = MUL(t102 - t103, costab24);
-  t168 = t166 + t167;
-
-  t134 = (t168 * 2) - t104;
-
-  t120 = (t134 * 2) - t105;
-
-  /* 14 */ hi[ 1][slot] = SHIFT(t120);
-
-  t135 = (MUL(t118 - t119, costab16) * 2) - t120;
-
-  /* 18 */ lo[ 2][slot] = SHIFT(t135);
-
-  t169 = (MUL(t132 - t133, costab16) * 2) - t134;
-
-  t151 = (t169 * 2) - t135;
-
-  /* 22 */ lo[ 6][slot] = SHIFT(t151);
-
-  t170 = (((MUL(t148 - t149, costab16) * 2) - t150) * 2) - t151;
-
-  /* 26 */ lo[10][slot] = SHIFT(t170);
-  /* 30 */ lo[14][slot] =
-	     SHIFT((((((MUL(t166 - t167, costab16) * 2) -
-		       t168) * 2) - t169) * 2) - t170);
-
-  t171 = MUL(t106 - t107, costab8);
-  t172 = MUL(t108 - t109, costab24);
-  t173 = t171 + t172;
-
-  t138 = (t173 * 2) - t110;
-
-  t123 = (t138 * 2) - t111;
-
-  t139 = (MUL(t121 - t122, costab16) * 2) - t123;
-
-  t117 = (t123 * 2) - t112;
-
-  /* 15 */ hi[ 0][slot] = SHIFT(t117);
-
-  t124 = (MUL(t115 - t116, costab16) * 2) - t117;
-
-  /* 17 */ lo[ 1][slot] = SHIFT(t124);
-
-  t131 = (t139 * 2) - t124;
-
-  /* 19 */ lo[ 3][slot] = SHIFT(t131);
-
-  t140 = (t164 * 2) - t131;
-
-  /* 21 */ lo[ 5][slot] = SHIFT(t140);
-
-  t174 = (MUL(t136 - t137, costab16) * 2) - t138;
-
-  t155 = (t174 * 2) - t139;
-
-  t147 = (t155 * 2) - t140;
-
-  /* 23 */ lo[ 7][slot] = SHIFT(t147);
-
-  t156 = (((MUL(t144 - t145, costab16) * 2) - t146) * 2) - t147;
-
-  /* 25 */ lo[ 9][slot] = SHIFT(t156);
-
-  t175 = (((MUL(t152 - t153, costab16) * 2) - t154) * 2) - t155;
-
-  t165 = (t175 * 2) - t156;
-
-  /* 27 */ lo[11][slot] = SHIFT(t165);
-
-  t176 = (((((MUL(t161 - t162, costab16) * 2) -
-	     t163) * 2) - t164) * 2) - t165;
+# include "dct32.dat"
+}
 
-  /* 29 */ lo[13][slot] = SHIFT(t176);
-  /* 31 */ lo[15][slot] =
-	     SHIFT((((((((MUL(t171 - t172, costab16) * 2) -
-			 t173) * 2) - t174) * 2) - t175) * 2) - t176);
+# if defined(USE_SIMD)
+/*
+ * NAME:	dct32_sse2(), dct32_avx2()
+ * DESCRIPTION:	perform the DCT of 4 or 8 consecutive time slots at once
+ *
+ * One time slot per lane. The lanes wrap at 32 bits where dct32() rounds a
+ * few outputs from 64-bit intermediates; both agree as long as the outputs
+ * stay inside the fixed-point range.
+ */
+static
+void dct32_sse2(v4si const in[32], v4si lo[16][1], v4si hi[16][1])
+{
+  unsigned int const slot = 0;
+  v4si t0,   t1,   t2,   t3,   t4,   t5,   t6,   t7;
+  v4si t8,   t9,   t10,  t11,  t12,  t13,  t14,  t15;
+  v4si t16,  t17,  t18,  t19,  t20,  t21,  t22,  t23;
+  v4si t24,  t25,  t26,  t27,  t28,  t29,  t30,  t31;
+  v4si t32,  t33,  t34,  t35,  t36,  t37,  t38,  t39;
+  v4si t40,  t41,  t42,  t43,  t44,  t45,  t46,  t47;
+  v4si t48,  t49,  t50,  t51,  t52,  t53,  t54,  t55;
+  v4si t56,  t57,  t58,  t59,  t60,  t61,  t62,  t63;
+  v4si t64,  t65,  t66,  t67,  t68,  t69,  t70,  t71;
+  v4si t72,  t73,  t74,  t75,  t76,  t77,  t78,  t79;
+  v4si t80,  t81,  t82,  t83,  t84,  t85,  t86,  t87;
+  v4si t88,  t89,  t90,  t91,  t92,  t93,  t94,  t95;
+  v4si t96,  t97,  t98,  t99,  t100, t101, t102, t103;
+  v4si t104, t105, t106, t107, t108, t109, t110, t111;
+  v4si t112, t113, t114, t115, t116, t117, t118, t119;
+  v4si t120, t121, t122, t123, t124, t125, t126, t127;
+  v4si t128, t129, t130, t131, t132, t133, t134, t135;
+  v4si t136, t137, t138, t139, t140, t141, t142, t143;
+  v4si t144, t145, t146, t147, t148, t149, t150, t151;
+  v4si t152, t153, t154, t155, t156, t157, t158, t159;
+  v4si t160, t161, t162, t163, t164, t165, t166, t167;
+  v4si t168, t169, t170, t171, t172, t173, t174, t175;
+  v4si t176;
+
+# include "dct32.dat"
+}
 
-  /*
-   * Totals:
-   *  80 multiplies
-   *  80 additions
-   * 119 subtractions
-   *  49 shifts (not counting SSO)
-   */
+static SIMD_AVX2
+void dct32_avx2(v8si const in[32], v8si lo[16][1], v8si hi[16][1])
+{
+  unsigned int const slot = 0;
+  v8si t0,   t1,   t2,   t3,   t4,   t5,   t6,   t7;
+  v8si t8,   t9,   t10,  t11,  t12,  t13,  t14,  t15;
+  v8si t16,  t17,  t18,  t19,  t20,  t21,  t22,  t23;
+  v8si t24,  t25,  t26,  t27,  t28,  t29,  t30,  t31;
+  v8si t32,  t33,  t34,  t35,  t36,  t37,  t38,  t39;
+  v8si t40,  t41,  t42,  t43,  t44,  t45,  t46,  t47;
+  v8si t48,  t49,  t50,  t51,  t52,  t53,  t54,  t55;
+  v8si t56,  t57,  t58,  t59,  t60,  t61,  t62,  t63;
+  v8si t64,  t65,  t66,  t67,  t68,  t69,  t70,  t71;
+  v8si t72,  t73,  t74,  t75,  t76,  t77,  t78,  t79;
+  v8si t80,  t81,  t82,  t83,  t84,  t85,  t86,  t87;
+  v8si t88,  t89,  t90,  t91,  t92,  t93,  t94,  t95;
+  v8si t96,  t97,  t98,  t99,  t100, t101, t102, t103;
+  v8si t104, t105, t106, t107, t108, t109, t110, t111;
+  v8si t112, t113, t114, t115, t116, t117, t118, t119;
+  v8si t120, t121, t122, t123, t124, t125, t126, t127;
+  v8si t128, t129, t130, t131, t132, t133, t134, t135;
+  v8si t136, t137, t138, t139, t140, t141, t142, t143;
+  v8si t144, t145, t146, t147, t148, t149, t150, t151;
+  v8si t152, t153, t154, t155, t156, t157, t158, t159;
+  v8si t160, t161, t162, t163, t164, t165, t166, t167;
+  v8si t168, t169, t170, t171, t172, t173, t174, t175;
+  v8si t176;
+
+# include "dct32.dat"
 }
+# endif
 
 # undef MUL
 # undef SHIFT
@@ -687,6 +398,357 @@ void synth_full(struct mad_synth *synth, struct mad_frame const *frame,
 }
 # endif
 
+# if defined(USE_SIMD)
+/*
+ * The SIMD synthesis runs dct32_sse2() or dct32_avx2() on 4 or 8 time
+ * slots, then computes the 32 samples of each slot as dot products of the
+ * 8-value filter rows with rows of D[] gathered in the matching order:
+ *
+ *   Dsimd_pe[pe / 2][sb][0][k] = D[sb][pe + o[k]]        (samples 0-15)
+ *   Dsimd_pe[pe / 2][sb][1][k] = D[sb][15 + 2 * k - pe]  (samples 17-31)
+ *
+ * with o[] = { 0, 14, 12, 10, 8, 6, 4, 2 }, and the same for po in
+ * Dsimd_po[]. With OPT_SSO all products and sums are taken modulo 2^32, so
+ * summing them in another order gives exactly the C results.
+ */
+
+static mad_fixed_t Dsimd_pe[8][17][2][8] __attribute__((aligned(32)));
+static mad_fixed_t Dsimd_po[8][17][2][8] __attribute__((aligned(32)));
+
+/*
+ * NAME:	simd_tables()
+ * DESCRIPTION:	fill Dsimd_pe[] and Dsimd_po[] once
+ */
+static
+void simd_tables(void)
+{
+  static int state;  /* 0: empty, 1: being filled, 2: ready */
+  int empty = 0;
+  unsigned int p, sb, k, o;
+
+  if (__atomic_load_n(&state, __ATOMIC_ACQUIRE) == 2)
+    return;
+
+  if (!__atomic_compare_exchange_n(&state, &empty, 1, 0,
+				   __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+    while (__atomic_load_n(&state, __ATOMIC_ACQUIRE) != 2)
+      ;
+    return;
+  }
+
+  for (p = 0; p < 8; ++p) {
+    for (sb = 0; sb < 17; ++sb) {
+      for (k = 0; k < 8; ++k) {
+	o = k ? 16 - 2 * k : 0;
+
+	Dsimd_pe[p][sb][0][k] = D[sb][2 * p + o];
+	Dsimd_pe[p][sb][1][k] = D[sb][15 + 2 * k - 2 * p];
+	Dsimd_po[p][sb][0][k] = D[sb][2 * p + 1 + o];
+	Dsimd_po[p][sb][1][k] = D[sb][15 + 2 * k - (2 * p + 1)];
+      }
+    }
+  }
+
+  __atomic_store_n(&state, 2, __ATOMIC_RELEASE);
+}
+
+/*
+ * products modulo 2^32 of the 32-bit lanes of x with D[] coefficients d,
+ * which fit in 16 bits after PRESHIFT(): if c is the carry out of the low
+ * half of x + 0x8000, x * d = (signed) low(x) * d + ((high(x) + c) * d << 16)
+ */
+
+static inline
+__m128i mul16_sse2(__m128i x, __m128i d)
+{
+  __m128i lo, hi;
+
+  lo = _mm_madd_epi16(x, _mm_and_si128(d, _mm_set1_epi32(0xffff)));
+  hi = _mm_mullo_epi16(_mm_add_epi32(x, _mm_set1_epi32(0x8000)),
+		       _mm_slli_epi32(d, 16));
+
+  return _mm_add_epi32(lo, hi);
+}
+
+/* sums of a, b, c and d in lanes 0, 1, 2 and 3 */
+
+static inline
+__m128i hsum4_sse2(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+  __m128i ab, cd;
+
+  ab = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+  cd = _mm_add_epi32(_mm_unpacklo_epi32(c, d), _mm_unpackhi_epi32(c, d));
+
+  return _mm_add_epi32(_mm_unpacklo_epi64(ab, cd),
+		       _mm_unpackhi_epi64(ab, cd));
+}
+
+/* sums of v[0]..v[7] in lanes 0..7 */
+
+static inline SIMD_AVX2
+__m256i hsum8_avx2(__m256i const v[8])
+{
+  __m256i a, b;
+
+  a = _mm256_hadd_epi32(_mm256_hadd_epi32(v[0], v[1]),
+			_mm256_hadd_epi32(v[2], v[3]));
+  b = _mm256_hadd_epi32(_mm256_hadd_epi32(v[4], v[5]),
+			_mm256_hadd_epi32(v[6], v[7]));
+
+  return _mm256_add_epi32(_mm256_permute2x128_si256(a, b, 0x20),
+			  _mm256_permute2x128_si256(a, b, 0x31));
+}
+
+static mad_fixed_t const zero[32];
+
+/*
+ * NAME:	transpose_sse2(), transpose_avx2()
+ * DESCRIPTION:	load 4 or 8 time slots into the lanes of in[]
+ */
+static inline
+void transpose_sse2(v4si in[32], mad_fixed_t const *row[4])
+{
+  __m128i r0, r1, r2, r3, t0, t1, t2, t3;
+  unsigned int i;
+
+  for (i = 0; i < 32; i += 4) {
+    r0 = _mm_loadu_si128((__m128i const *) &row[0][i]);
+    r1 = _mm_loadu_si128((__m128i const *) &row[1][i]);
+    r2 = _mm_loadu_si128((__m128i const *) &row[2][i]);
+    r3 = _mm_loadu_si128((__m128i const *) &row[3][i]);
+
+    t0 = _mm_unpacklo_epi32(r0, r1);
+    t1 = _mm_unpacklo_epi32(r2, r3);
+    t2 = _mm_unpackhi_epi32(r0, r1);
+    t3 = _mm_unpackhi_epi32(r2, r3);
+
+    in[i + 0] = (v4si) _mm_unpacklo_epi64(t0, t1);
+    in[i + 1] = (v4si) _mm_unpackhi_epi64(t0, t1);
+    in[i + 2] = (v4si) _mm_unpacklo_epi64(t2, t3);
+    in[i + 3] = (v4si) _mm_unpackhi_epi64(t2, t3);
+  }
+}
+
+static inline SIMD_AVX2
+void transpose_avx2(v8si in[32], mad_fixed_t const *row[8])
+{
+  __m256i r[8], t[8], u[8];
+  unsigned int i, j;
+
+  for (i = 0; i < 32; i += 8) {
+    for (j = 0; j < 8; ++j)
+      r[j] = _mm256_loadu_si256((__m256i const *) &row[j][i]);
+
+    for (j = 0; j < 8; j += 4) {
+      t[j + 0] = _mm256_unpacklo_epi32(r[j + 0], r[j + 1]);
+      t[j + 1] = _mm256_unpackhi_epi32(r[j + 0], r[j + 1]);
+      t[j + 2] = _mm256_unpacklo_epi32(r[j + 2], r[j + 3]);
+      t[j + 3] = _mm256_unpackhi_epi32(r[j + 2], r[j + 3]);
+
+      u[j + 0] = _mm256_unpacklo_epi64(t[j + 0], t[j + 2]);
+      u[j + 1] = _mm256_unpackhi_epi64(t[j + 0], t[j + 2]);
+      u[j + 2] = _mm256_unpacklo_epi64(t[j + 1], t[j + 3]);
+      u[j + 3] = _mm256_unpackhi_epi64(t[j + 1], t[j + 3]);
+    }
+
+    for (j = 0; j < 4; ++j) {
+      in[i + j]     = (v8si) _mm256_permute2x128_si256(u[j], u[j + 4], 0x20);
+      in[i + j + 4] = (v8si) _mm256_permute2x128_si256(u[j], u[j + 4], 0x31);
+    }
+  }
+}
+
+/*
+ * NAME:	window_sse2(), window_avx2()
+ * DESCRIPTION:	calculate the 32 samples of one time slot
+ */
+static
+void window_sse2(mad_fixed_t (*filter)[2][2][16][8], unsigned int phase,
+		 mad_fixed_t *pcm)
+{
+  mad_fixed_t (*fe)[8], (*fx)[8], (*fo)[8];
+  mad_fixed_t const (*Dpe)[2][8], (*Dpo)[2][8];
+  __m128i v[32], e0, e1, o0, o1;
+  unsigned int sb;
+
+  fe = &(*filter)[0][ phase & 1][0];
+  fx = &(*filter)[0][~phase & 1][0];
+  fo = &(*filter)[1][~phase & 1][0];
+
+  Dpe = Dsimd_pe[phase >> 1];
+  Dpo = Dsimd_po[(((phase - 1) & 0xf) | 1) >> 1];
+
+# define ROW(x, D)  \
+    _mm_add_epi32(mul16_sse2(x##0, _mm_load_si128((__m128i const *) &(D)[0])),  \
+		  mul16_sse2(x##1, _mm_load_si128((__m128i const *) &(D)[4])))
+
+  /* v[i] holds the products of sample i, to be summed across lanes */
+
+  for (sb = 0; sb < 16; ++sb) {
+    e0 = _mm_loadu_si128((__m128i const *) &fe[sb][0]);
+    e1 = _mm_loadu_si128((__m128i const *) &fe[sb][4]);
+    o0 = _mm_loadu_si128((__m128i const *) (sb ? &fo[sb - 1][0] : &fx[0][0]));
+    o1 = _mm_loadu_si128((__m128i const *) (sb ? &fo[sb - 1][4] : &fx[0][4]));
+
+    v[sb] = _mm_sub_epi32(ROW(e, Dpe[sb][0]), ROW(o, Dpo[sb][0]));
+    if (sb)
+      v[32 - sb] = _mm_add_epi32(ROW(e, Dpe[sb][1]), ROW(o, Dpo[sb][1]));
+  }
+
+  o0 = _mm_loadu_si128((__m128i const *) &fo[15][0]);
+  o1 = _mm_loadu_si128((__m128i const *) &fo[15][4]);
+
+  v[16] = _mm_sub_epi32(_mm_setzero_si128(), ROW(o, Dpo[16][0]));
+
+# undef ROW
+
+  for (sb = 0; sb < 32; sb += 4) {
+    _mm_storeu_si128((__m128i *) &pcm[sb],
+		     _mm_srai_epi32(hsum4_sse2(v[sb + 0], v[sb + 1],
+					       v[sb + 2], v[sb + 3]), 2));
+  }
+}
+
+static SIMD_AVX2
+void window_avx2(mad_fixed_t (*filter)[2][2][16][8], unsigned int phase,
+		 mad_fixed_t *pcm)
+{
+  mad_fixed_t (*fe)[8], (*fx)[8], (*fo)[8];
+  mad_fixed_t const (*Dpe)[2][8], (*Dpo)[2][8];
+  __m256i v[32], e, o;
+  unsigned int sb;
+
+  fe = &(*filter)[0][ phase & 1][0];
+  fx = &(*filter)[0][~phase & 1][0];
+  fo = &(*filter)[1][~phase & 1][0];
+
+  Dpe = Dsimd_pe[phase >> 1];
+  Dpo = Dsimd_po[(((phase - 1) & 0xf) | 1) >> 1];
+
+# define ROW(x, D)  \
+    _mm256_mullo_epi32(x, _mm256_load_si256((__m256i const *) &(D)[0]))
+
+  for (sb = 0; sb < 16; ++sb) {
+    e = _mm256_loadu_si256((__m256i const *) fe[sb]);
+    o = _mm256_loadu_si256((__m256i const *) (sb ? fo[sb - 1] : fx[0]));
+
+    v[sb] = _mm256_sub_epi32(ROW(e, Dpe[sb][0]), ROW(o, Dpo[sb][0]));
+    if (sb)
+      v[32 - sb] = _mm256_add_epi32(ROW(e, Dpe[sb][1]), ROW(o, Dpo[sb][1]));
+  }
+
+  o = _mm256_loadu_si256((__m256i const *) fo[15]);
+
+  v[16] = _mm256_sub_epi32(_mm256_setzero_si256(), ROW(o, Dpo[16][0]));
+
+# undef ROW
+
+  for (sb = 0; sb < 32; sb += 8) {
+    _mm256_storeu_si256((__m256i *) &pcm[sb],
+			_mm256_srai_epi32(hsum8_avx2(&v[sb]), 2));
+  }
+}
+
+/*
+ * NAME:	synth->full_sse2(), synth->full_avx2()
+ * DESCRIPTION:	perform full frequency PCM synthesis with SIMD kernels
+ */
+static
+void synth_full_sse2(struct mad_synth *synth, struct mad_frame const *frame,
+		     unsigned int nch, unsigned int ns)
+{
+  unsigned int phase, ch, s, n, j, sb;
+  mad_fixed_t *pcm, (*filter)[2][2][16][8];
+  mad_fixed_t const (*sbsample)[36][32];
+  mad_fixed_t const *row[4];
+  mad_fixed_t buf[32][4] __attribute__((aligned(16)));
+  v4si in[32], lo[16][1], hi[16][1];
+
+  for (ch = 0; ch < nch; ++ch) {
+    sbsample = &frame->sbsample[ch];
+    filter   = &synth->filter[ch];
+    phase    = synth->phase;
+    pcm      = synth->pcm.samples[ch];
+
+    for (s = 0; s < ns; s += n) {
+      n = ns - s < 4 ? ns - s : 4;
+
+      for (j = 0; j < 4; ++j)
+	row[j] = j < n ? (*sbsample)[s + j] : zero;
+
+      transpose_sse2(in, row);
+
+      dct32_sse2(in, lo, hi);
+
+      for (sb = 0; sb < 16; ++sb) {
+	_mm_store_si128((__m128i *) buf[sb],      (__m128i) lo[sb][0]);
+	_mm_store_si128((__m128i *) buf[sb + 16], (__m128i) hi[sb][0]);
+      }
+
+      for (j = 0; j < n; ++j) {
+	for (sb = 0; sb < 16; ++sb) {
+	  (*filter)[0][phase & 1][sb][phase >> 1] = buf[sb][j];
+	  (*filter)[1][phase & 1][sb][phase >> 1] = buf[sb + 16][j];
+	}
+
+	window_sse2(filter, phase, pcm);
+
+	pcm  += 32;
+	phase = (phase + 1) % 16;
+      }
+    }
+  }
+}
+
+static SIMD_AVX2
+void synth_full_avx2(struct mad_synth *synth, struct mad_frame const *frame,
+		     unsigned int nch, unsigned int ns)
+{
+  unsigned int phase, ch, s, n, j, sb;
+  mad_fixed_t *pcm, (*filter)[2][2][16][8];
+  mad_fixed_t const (*sbsample)[36][32];
+  mad_fixed_t const *row[8];
+  mad_fixed_t buf[32][8] __attribute__((aligned(32)));
+  v8si in[32], lo[16][1], hi[16][1];
+
+  for (ch = 0; ch < nch; ++ch) {
+    sbsample = &frame->sbsample[ch];
+    filter   = &synth->filter[ch];
+    phase    = synth->phase;
+    pcm      = synth->pcm.samples[ch];
+
+    for (s = 0; s < ns; s += n) {
+      n = ns - s < 8 ? ns - s : 8;
+
+      for (j = 0; j < 8; ++j)
+	row[j] = j < n ? (*sbsample)[s + j] : zero;
+
+      transpose_avx2(in, row);
+
+      dct32_avx2(in, lo, hi);
+
+      for (sb = 0; sb < 16; ++sb) {
+	_mm256_store_si256((__m256i *) buf[sb],      (__m256i) lo[sb][0]);
+	_mm256_store_si256((__m256i *) buf[sb + 16], (__m256i) hi[sb][0]);
+      }
+
+      for (j = 0; j < n; ++j) {
+	for (sb = 0; sb < 16; ++sb) {
+	  (*filter)[0][phase & 1][sb][phase >> 1] = buf[sb][j];
+	  (*filter)[1][phase & 1][sb][phase >> 1] = buf[sb + 16][j];
+	}
+
+	window_avx2(filter, phase, pcm);
+
+	pcm  += 32;
+	phase = (phase + 1) % 16;
+      }
+    }
+  }
+}
+# endif
+
 /*
  * NAME:	synth->half()
  * DESCRIPTION:	perform half frequency PCM synthesis
@@ -844,6 +906,23 @@ void mad_synth_frame(struct mad_synth *synth, struct mad_frame const *frame)
 
   synth_frame = synth_full;
 
+# if defined(USE_SIMD)
+  switch (mad_simd_level()) {
+  case MAD_SIMD_AVX2:
+    simd_tables();
+    synth_frame = synth_full_avx2;
+    break;
+
+  case MAD_SIMD_SSE2:
+    simd_tables();
+    synth_frame = synth_full_sse2;
+    break;
+
+  default:
+    break;
+  }
+# endif
+
   if (frame->options & MAD_OPTION_HALFSAMPLERATE) {
     synth->pcm.samplerate /= 2;
     synth->pcm.length     /= 2;
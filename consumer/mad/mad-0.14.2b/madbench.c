@@ -0,0 +1,205 @@
+/*
+ * mad - MPEG audio decoder
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * $Id$
+ */
+
+# ifdef HAVE_CONFIG_H
+#  include "config.h"
+# endif
+
+# include "global.h"
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+# include <sys/time.h>
+
+# include "mad.h"
+# include "batch.h"
+
+/*
+ * madbench decodes one file as many independent streams at once with
+ * batch_decode() and reports how many times faster than real time the
+ * decoder runs, for a single stream and per thread of the batch. The PCM
+ * of every stream is summed up so that the streams can be checked against
+ * each other, and against the serial decode.
+ */
+
+static
+enum mad_flow checksum(void *data, struct mad_header const *header,
+		       struct mad_pcm *pcm)
+{
+  unsigned long *sum = data;
+  unsigned int ch, s;
+
+  for (ch = 0; ch < pcm->channels; ++ch) {
+    for (s = 0; s < pcm->length; ++s)
+      *sum = *sum * 31 + (unsigned long) pcm->samples[ch][s];
+  }
+
+  return MAD_FLOW_CONTINUE;
+}
+
+static
+double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, 0);
+
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static
+unsigned char *load(char const *path, unsigned long *length)
+{
+  FILE *file;
+  unsigned char *data = 0;
+  long size;
+
+  file = fopen(path, "rb");
+  if (file == 0)
+    return 0;
+
+  if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0 &&
+      fseek(file, 0, SEEK_SET) == 0 && (data = malloc(size)) != 0) {
+    if (fread(data, size, 1, file) != 1) {
+      free(data);
+      data = 0;
+    }
+    else
+      *length = size;
+  }
+
+  fclose(file);
+
+  return data;
+}
+
+static
+void usage(char const *argv0)
+{
+  fprintf(stderr, "Usage: %s [-j threads] [-n streams] file\n", argv0);
+  exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+  static char const *const simd[] = { "none", "SSE2", "AVX2" };
+  unsigned char *data;
+  unsigned long length, serial_sum, *sums;
+  struct batch_stream *streams;
+  unsigned int nthreads = 0, nstreams = 0, i, mismatch;
+  double seconds, start, serial, elapsed;
+  int argi, failed;
+
+  for (argi = 1; argi < argc - 1; argi += 2) {
+    if (strcmp(argv[argi], "-j") == 0)
+      nthreads = atoi(argv[argi + 1]);
+    else if (strcmp(argv[argi], "-n") == 0)
+      nstreams = atoi(argv[argi + 1]);
+    else
+      usage(argv[0]);
+  }
+
+  if (argi != argc - 1)
+    usage(argv[0]);
+
+  if (nthreads == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    nthreads = online > 0 ? online : 1;
+  }
+
+  if (nstreams == 0)
+    nstreams = 4 * nthreads;
+  if (nthreads > nstreams)
+    nthreads = nstreams;
+
+  data = load(argv[argi], &length);
+  if (data == 0) {
+    perror(argv[argi]);
+    return 1;
+  }
+
+  streams = calloc(nstreams + 1, sizeof(*streams));
+  sums    = calloc(nstreams + 1, sizeof(*sums));
+  if (streams == 0 || sums == 0) {
+    fprintf(stderr, "%s: not enough memory\n", argv[0]);
+    return 1;
+  }
+
+  for (i = 0; i <= nstreams; ++i) {
+    streams[i].start  = data;
+    streams[i].length = length;
+    streams[i].output = checksum;
+    streams[i].data   = &sums[i];
+  }
+
+  /* one stream on its own, as a reference */
+
+  start  = now();
+  failed = batch_decode(&streams[nstreams], 1, 1);
+  serial = now() - start;
+
+  if (failed != 0 || streams[nstreams].frames == 0) {
+    fprintf(stderr, "%s: %s: cannot decode\n", argv[0], argv[argi]);
+    return 1;
+  }
+
+  serial_sum = sums[nstreams];
+  seconds = mad_timer_count(streams[nstreams].duration,
+			    MAD_UNITS_MILLISECONDS) / 1000.0;
+
+  /* the batch */
+
+  start   = now();
+  failed  = batch_decode(streams, nstreams, nthreads);
+  elapsed = now() - start;
+
+  mismatch = 0;
+  for (i = 0; i < nstreams; ++i) {
+    if (streams[i].result != 0 || sums[i] != serial_sum ||
+	streams[i].frames != streams[nstreams].frames)
+      ++mismatch;
+  }
+
+  printf("file:          %s (%lu frames, %.2f s)\n",
+	 argv[argi], streams[nstreams].frames, seconds);
+  printf("simd:          %s\n", simd[mad_simd_level()]);
+  printf("1 stream:      %.3f s, %.1fx realtime\n",
+	 serial, seconds / serial);
+  printf("%u streams:    %.3f s on %u threads, %.1fx realtime, "
+	 "%.1fx realtime per thread\n",
+	 nstreams, elapsed, nthreads, nstreams * seconds / elapsed,
+	 nstreams * seconds / elapsed / nthreads);
+
+  if (failed != 0 || mismatch != 0) {
+    fprintf(stderr, "%s: %u of %u streams differ from the serial decode\n",
+	    argv[0], failed < 0 ? nstreams : mismatch, nstreams);
+    return 1;
+  }
+
+  free(sums);
+  free(streams);
+  free(data);
+
+  return 0;
+}
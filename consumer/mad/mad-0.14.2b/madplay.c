@@ -67,6 +67,7 @@ struct option const options[] = {
   { "fade-in",		optional_argument, 0,		-'i' },
   { "help",		no_argument,	   0,		 'h' },
   { "ignore-crc",	no_argument,	   0,		 'i' },
+  { "jobs",		required_argument, 0,		 'j' },
   { "left",		no_argument,	   0,		 '1' },
   { "license",		no_argument,	   0,		-'l' },
   { "mono",		no_argument,	   0,		 'm' },
@@ -128,6 +129,7 @@ void show_usage(int verbose)
   EPUTS(_("\nDecoding:\n"));
   EPUTS(_("      --downsample           reduce output sample rate 2:1\n"));
   EPUTS(_("  -i, --ignore-crc           ignore CRC errors\n"));
+  EPUTS(_("  -j, --jobs=N               decode each file on N threads\n"));
 
   EPUTS(_("\nAudio output:\n"));
   EPUTS(_("  -o, --output=[TYPE:]PATH   send output to PATH with format TYPE"
@@ -410,7 +412,7 @@ void get_options(int argc, char *argv[], struct player *player)
 
   while ((opt = getopt_long(argc, argv,
 			    "vqQ"	/* verbosity options */
-			    "i"		/* decoding options */
+			    "ij:"	/* decoding options */
 			    "o:b:da:"	/* audio output options */
 # if 0
 			    "g:x"
@@ -479,6 +481,14 @@ void get_options(int argc, char *argv[], struct player *player)
       player->options |= PLAYER_OPTION_IGNORECRC;
       break;
 
+    case 'j':
+      opt = atoi(optarg);
+      if (opt <= 0)
+	die(_("invalid number of threads \"%s\""), optarg);
+
+      player->threads = opt;
+      break;
+
     case -'i':
       player->fade_in = get_time(optarg ? optarg : FADE_DEFAULT, 1,
 				 _("fade-in time"));
@@ -0,0 +1,246 @@
+/*
+ * mad - MPEG audio decoder
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * $Id$
+ */
+
+# ifdef HAVE_CONFIG_H
+#  include "config.h"
+# endif
+
+# include "global.h"
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+
+# include "mad.h"
+
+/*
+ * madseek checks mad_index_seek() against a full decode. The file is
+ * decoded once from the beginning, keeping a checksum of the PCM of every
+ * frame; then it is indexed, and for every frame in turn the decoder is
+ * made to seek to it and decode a few frames, which must give the same PCM.
+ * The exit status is 1 if any seek differs.
+ */
+
+struct reference {
+  int decoded;
+  unsigned long sum;
+};
+
+static
+unsigned long checksum(struct mad_pcm const *pcm)
+{
+  unsigned long sum = 0;
+  unsigned int ch, s;
+
+  for (ch = 0; ch < pcm->channels; ++ch) {
+    for (s = 0; s < pcm->length; ++s)
+      sum = sum * 31 + (unsigned long) pcm->samples[ch][s];
+  }
+
+  return sum;
+}
+
+static
+unsigned char *load(char const *path, unsigned long *length)
+{
+  FILE *file;
+  unsigned char *data = 0;
+  long size;
+
+  file = fopen(path, "rb");
+  if (file == 0)
+    return 0;
+
+  /* append MAD_BUFFER_GUARD zero bytes so the last frame decodes */
+
+  if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0 &&
+      fseek(file, 0, SEEK_SET) == 0 &&
+      (data = calloc(size + MAD_BUFFER_GUARD, 1)) != 0) {
+    if (fread(data, size, 1, file) != 1) {
+      free(data);
+      data = 0;
+    }
+    else
+      *length = size + MAD_BUFFER_GUARD;
+  }
+
+  fclose(file);
+
+  return data;
+}
+
+/* the number of the frame with its header at offset, or count if none */
+
+static
+unsigned long frame_at(struct mad_index const *index, unsigned long offset)
+{
+  unsigned long low = 0, high = index->count;
+
+  while (low < high) {
+    unsigned long mid = low + (high - low) / 2;
+
+    if (index->entries[mid].offset < offset)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  if (low < index->count && index->entries[low].offset != offset)
+    low = index->count;
+
+  return low;
+}
+
+static
+void usage(char const *argv0)
+{
+  fprintf(stderr, "Usage: %s [-n frames] file\n", argv0);
+  exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned char *data;
+  unsigned long length, target, number, preroll, max_preroll, mismatch;
+  unsigned int nframes = 4, checked;
+  struct mad_index index;
+  struct mad_stream stream;
+  struct mad_frame frame;
+  struct mad_synth synth;
+  struct reference *reference;
+  int argi;
+
+  for (argi = 1; argi < argc - 1; argi += 2) {
+    if (strcmp(argv[argi], "-n") == 0 && atoi(argv[argi + 1]) > 0)
+      nframes = atoi(argv[argi + 1]);
+    else
+      usage(argv[0]);
+  }
+
+  if (argi != argc - 1)
+    usage(argv[0]);
+
+  data = load(argv[argi], &length);
+  if (data == 0) {
+    perror(argv[argi]);
+    return 1;
+  }
+
+  mad_index_init(&index);
+
+  if (mad_index_build(&index, data, length) == -1 || index.count == 0) {
+    fprintf(stderr, "%s: %s: cannot index\n", argv[0], argv[argi]);
+    return 1;
+  }
+
+  reference = calloc(index.count, sizeof(*reference));
+  if (reference == 0) {
+    fprintf(stderr, "%s: not enough memory\n", argv[0]);
+    return 1;
+  }
+
+  mad_stream_init(&stream);
+  mad_frame_init(&frame);
+  mad_synth_init(&synth);
+
+  /* the full decode */
+
+  mad_stream_buffer(&stream, data, length);
+
+  while (1) {
+    if (mad_frame_decode(&frame, &stream) == -1) {
+      if (MAD_RECOVERABLE(stream.error))
+	continue;
+
+      break;
+    }
+
+    mad_synth_frame(&synth, &frame);
+
+    number = frame_at(&index, stream.this_frame - data);
+    if (number < index.count) {
+      reference[number].decoded = 1;
+      reference[number].sum     = checksum(&synth.pcm);
+    }
+  }
+
+  /* a seek to every frame */
+
+  max_preroll = 0;
+  mismatch    = 0;
+
+  for (target = 0; target < index.count; ++target) {
+    preroll = target - mad_index_preroll(&index, target);
+    if (preroll > max_preroll)
+      max_preroll = preroll;
+
+    if (mad_index_seek(&index, target, data, length,
+		       &stream, &frame, &synth) == -1) {
+      ++mismatch;
+      continue;
+    }
+
+    checked = 0;
+
+    while (checked < nframes) {
+      if (mad_frame_decode(&frame, &stream) == -1) {
+	if (MAD_RECOVERABLE(stream.error))
+	  continue;
+
+	break;
+      }
+
+      mad_synth_frame(&synth, &frame);
+
+      number = frame_at(&index, stream.this_frame - data);
+
+      if ((checked == 0 && number != target && reference[target].decoded) ||
+	  number == index.count || !reference[number].decoded ||
+	  reference[number].sum != checksum(&synth.pcm)) {
+	if (mismatch == 0)
+	  fprintf(stderr, "%s: seek to frame %lu differs at frame %lu\n",
+		  argv[0], target, number);
+	++mismatch;
+	break;
+      }
+
+      ++checked;
+    }
+  }
+
+  printf("file:          %s (%lu frames)\n", argv[argi], index.count);
+  printf("seeks:         %lu, %u frames each, at most %lu frames preroll\n",
+	 index.count, nframes, max_preroll);
+
+  if (mismatch != 0)
+    fprintf(stderr, "%s: %lu of %lu seeks differ from the full decode\n",
+	    argv[0], mismatch, index.count);
+
+  mad_synth_finish(&synth);
+  mad_frame_finish(&frame);
+  mad_stream_finish(&stream);
+
+  free(reference);
+  mad_index_finish(&index);
+  free(data);
+
+  return mismatch != 0;
+}
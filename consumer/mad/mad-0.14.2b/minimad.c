@@ -20,11 +20,15 @@
  */
 
 # include <stdio.h>
+# include <stdlib.h>
+# include <limits.h>
+# include <string.h>
 # include <unistd.h>
 # include <sys/stat.h>
 # include <sys/mman.h>
 
 # include "mad.h"
+# include "batch.h"
 
 /*
  * This is perhaps the simplest example use of the MAD high-level API.
@@ -33,16 +37,23 @@
  * callback converts MAD's high-resolution PCM samples to 16 bits, then
  * writes them to standard output in little-endian, stereo-interleaved
  * format.
+ *
+ * With -j N, the mapped stream is instead cut into ranges of frames which
+ * are decoded by N threads (see batch.c), and the output callback is
+ * called in stream order with the same PCM.
  */
 
-static int decode(unsigned char const *, unsigned long);
+static int decode(unsigned char const *, unsigned long, unsigned int);
 
 int main(int argc, char *argv[])
 {
   struct stat stat;
   void *fdm;
+  unsigned int nthreads = 1;
 
-  if (argc != 1)
+  if (argc == 3 && strcmp(argv[1], "-j") == 0 && atoi(argv[2]) > 0)
+    nthreads = atoi(argv[2]);
+  else if (argc != 1)
     return 1;
 
   if (fstat(STDIN_FILENO, &stat) == -1 ||
@@ -53,7 +64,7 @@ int main(int argc, char *argv[])
   if (fdm == MAP_FAILED)
     return 3;
 
-  decode(fdm, stat.st_size);
+  decode(fdm, stat.st_size, nthreads);
 
   if (munmap(fdm, stat.st_size) == -1)
     return 4;
@@ -70,6 +81,8 @@ int main(int argc, char *argv[])
 struct buffer {
   unsigned char const *start;
   unsigned long length;
+  unsigned char *guard;
+  unsigned long guard_offset;
 };
 
 /*
@@ -77,7 +90,10 @@ struct buffer {
  * the stream buffer which is to be decoded. In this example, an entire file
  * has been mapped into memory, so we just call mad_stream_buffer() with the
  * address and length of the mapping. When this callback is called a second
- * time, we are finished decoding.
+ * time, the decoder has reached the end of the mapping; the last frame can
+ * only be decoded with MAD_BUFFER_GUARD bytes after it, so the rest of the
+ * mapping is copied with that many zero bytes appended. When this callback
+ * is called a third time, we are finished decoding.
  */
 
 static
@@ -85,13 +101,27 @@ enum mad_flow input(void *data,
 		    struct mad_stream *stream)
 {
   struct buffer *buffer = data;
+  unsigned long left;
 
-  if (!buffer->length)
+  if (buffer->guard)
     return MAD_FLOW_STOP;
 
-  mad_stream_buffer(stream, buffer->start, buffer->length);
+  if (stream->next_frame == 0) {
+    mad_stream_buffer(stream, buffer->start, buffer->length);
+    return MAD_FLOW_CONTINUE;
+  }
+
+  buffer->guard_offset = stream->next_frame - buffer->start;
+  left = buffer->length - buffer->guard_offset;
+
+  buffer->guard = malloc(left + MAD_BUFFER_GUARD);
+  if (buffer->guard == 0)
+    return MAD_FLOW_BREAK;
+
+  memcpy(buffer->guard, stream->next_frame, left);
+  memset(buffer->guard + left, 0, MAD_BUFFER_GUARD);
 
-  buffer->length = 0;
+  mad_stream_buffer(stream, buffer->guard, left + MAD_BUFFER_GUARD);
 
   return MAD_FLOW_CONTINUE;
 }
@@ -174,9 +204,17 @@ enum mad_flow error(void *data,
 {
   struct buffer *buffer = data;
 
-  fprintf(stderr, "decoding error 0x%04x (%s) at byte offset %u\n",
+  /* trailing bytes after the last frame, such as the zero bytes appended
+     by the input callback, are not an error */
+
+  if (stream->error == MAD_ERROR_LOSTSYNC && buffer->guard)
+    return MAD_FLOW_CONTINUE;
+
+  fprintf(stderr, "decoding error 0x%04x (%s) at byte offset %lu\n",
 	  stream->error, mad_stream_errorstr(stream),
-	  stream->this_frame - buffer->start);
+	  buffer->guard ?
+	  buffer->guard_offset + (stream->this_frame - buffer->guard) :
+	  (unsigned long) (stream->this_frame - buffer->start));
 
   return MAD_FLOW_BREAK;
 }
@@ -187,20 +225,27 @@ enum mad_flow error(void *data,
  * input, output, and error callback functions above. A single call to
  * mad_decoder_run() continues until a callback function returns
  * MAD_FLOW_STOP (to stop decoding) or MAD_FLOW_BREAK (to stop decoding and
- * signal an error).
+ * signal an error). With more than one thread, batch_decode_parallel()
+ * calls the same output function instead.
  */
 
 static
-int decode(unsigned char const *start, unsigned long length)
+int decode(unsigned char const *start, unsigned long length,
+	   unsigned int nthreads)
 {
   struct buffer buffer;
   struct mad_decoder decoder;
   int result;
 
+  if (nthreads > 1)
+    return batch_decode_parallel(start, length, 0, ULONG_MAX, nthreads, 0,
+				 0 /* filter */, output, 0);
+
   /* initialize our private message structure */
 
   buffer.start  = start;
   buffer.length = length;
+  buffer.guard  = 0;
 
   /* configure input, output, and error functions */
 
@@ -216,5 +261,8 @@ int decode(unsigned char const *start, unsigned long length)
 
   mad_decoder_finish(&decoder);
 
+  if (buffer.guard)
+    free(buffer.guard);
+
   return result;
 }
@@ -28,6 +28,7 @@
 # include <stdio.h>
 # include <stdarg.h>
 # include <stdlib.h>
+# include <limits.h>
 
 # ifdef HAVE_SYS_TYPES_H
 #  include <sys/types.h>
@@ -82,6 +83,7 @@
 # include "id3tag.h"
 # include "filter.h"
 # include "equalizer.h"
+# include "batch.h"
 
 # define MPEG_BUFSZ	40000	/* 2.5 s at 128 kbps; 1 s at 320 kbps */
 # define FREQ_TOLERANCE	6	/* percent sampling frequency tolerance */
@@ -118,6 +120,7 @@ void player_init(struct player *player)
 
   player->options  = 0;
   player->repeat   = 1;
+  player->threads  = 1;
 
   player->control = PLAYER_CONTROL_DEFAULT;
 
@@ -140,6 +143,12 @@ void player_init(struct player *player)
   player->input.data        = 0;
   player->input.length      = 0;
   player->input.eof         = 0;
+  player->input.decoder     = 0;
+  player->input.seek        = 0;
+  player->input.prime       = 0;
+  player->input.priming     = 0;
+
+  mad_index_init(&player->input.index);
 
   xing_init(&player->input.xing);
 
@@ -375,6 +384,17 @@ enum mad_flow decode_input_mmap(void *data, struct mad_stream *stream)
 
   /* first call */
 
+  if (input->seek) {
+    struct mad_decoder *decoder = input->decoder;
+
+    if (mad_index_seek(&input->index, input->seek,
+		       input->fdm, input->length, stream,
+		       &decoder->sync->frame, &decoder->sync->synth) == -1)
+      return MAD_FLOW_BREAK;
+
+    return MAD_FLOW_CONTINUE;
+  }
+
   mad_stream_buffer(stream, input->fdm, input->length);
 
   return MAD_FLOW_CONTINUE;
@@ -424,6 +444,28 @@ enum mad_flow decode_input_read(void *data, struct mad_stream *stream)
   return MAD_FLOW_CONTINUE;
 }
 
+/*
+ * NAME:	count_frame()
+ * DESCRIPTION:	add a frame to the playing statistics; tell whether it is
+ *		to be skipped
+ */
+static
+enum mad_flow count_frame(struct player *player, mad_timer_t duration)
+{
+  ++player->stats.absolute_framecount;
+  mad_timer_add(&player->stats.absolute_timer, duration);
+
+  ++player->stats.global_framecount;
+  mad_timer_add(&player->stats.global_timer, duration);
+
+  if ((player->options & PLAYER_OPTION_SKIP) &&
+      mad_timer_compare(player->stats.global_timer,
+			player->global_start) < 0)
+    return MAD_FLOW_IGNORE;
+
+  return MAD_FLOW_CONTINUE;
+}
+
 /*
  * NAME:	decode->header()
  * DESCRIPTION:	decide whether to continue decoding based on header
@@ -433,24 +475,22 @@ enum mad_flow decode_header(void *data, struct mad_header const *header)
 {
   struct player *player = data;
 
+  /* decode the frames just before a seek target, but do not play them */
+
+  player->input.priming = (player->input.prime > 0);
+  if (player->input.priming) {
+    --player->input.prime;
+    return MAD_FLOW_CONTINUE;
+  }
+
   if ((player->options & PLAYER_OPTION_TIMED) &&
       mad_timer_compare(player->stats.global_timer, player->global_stop) > 0)
     return MAD_FLOW_STOP;
 
-  if (player->stats.absolute_framecount) {
-    /* delay counting first frame */
+  /* delay counting first frame */
 
-    ++player->stats.absolute_framecount;
-    mad_timer_add(&player->stats.absolute_timer, header->duration);
-
-    ++player->stats.global_framecount;
-    mad_timer_add(&player->stats.global_timer, header->duration);
-
-    if ((player->options & PLAYER_OPTION_SKIP) &&
-	mad_timer_compare(player->stats.global_timer,
-			  player->global_start) < 0)
-      return MAD_FLOW_IGNORE;
-  }
+  if (player->stats.absolute_framecount)
+    return count_frame(player, header->duration);
 
   return MAD_FLOW_CONTINUE;
 }
@@ -465,7 +505,7 @@ enum mad_flow decode_filter(void *data, struct mad_stream const *stream,
 {
   struct player *player = data;
 
-  if (player->stats.absolute_framecount == 0) {
+  if (player->stats.absolute_framecount == 0 && !player->input.priming) {
     /* first frame */
 
     if (xing_parse(&player->input.xing,
@@ -482,15 +522,7 @@ enum mad_flow decode_filter(void *data, struct mad_stream const *stream,
       return MAD_FLOW_IGNORE;
     }
 
-    ++player->stats.absolute_framecount;
-    mad_timer_add(&player->stats.absolute_timer, frame->header.duration);
-
-    ++player->stats.global_framecount;
-    mad_timer_add(&player->stats.global_timer, frame->header.duration);
-
-    if ((player->options & PLAYER_OPTION_SKIP) &&
-	mad_timer_compare(player->stats.global_timer,
-			  player->global_start) < 0)
+    if (count_frame(player, frame->header.duration) == MAD_FLOW_IGNORE)
       return MAD_FLOW_IGNORE;
   }
 
@@ -775,6 +807,9 @@ enum mad_flow decode_output(void *data, struct mad_header const *header,
   unsigned int nchannels;
   union audio_control control;
 
+  if (player->input.priming)
+    return MAD_FLOW_CONTINUE;
+
   ch1 = pcm->samples[0];
   ch2 = pcm->samples[1];
 
@@ -1079,6 +1114,182 @@ enum mad_flow decode_error(void *data, struct mad_stream *stream,
   return MAD_FLOW_CONTINUE;
 }
 
+# if defined(HAVE_MMAP)
+struct parallel_player {
+  struct player *player;
+  unsigned char const *xing_frame;
+};
+
+/*
+ * NAME:	decode->filter_parallel()
+ * DESCRIPTION:	perform filtering on a decoded frame, on a decoding thread
+ */
+static
+enum mad_flow decode_filter_parallel(void *data,
+				     struct mad_stream const *stream,
+				     struct mad_frame *frame)
+{
+  struct parallel_player *parallel = data;
+
+  if (stream->this_frame == parallel->xing_frame)
+    return MAD_FLOW_IGNORE;
+
+  return filter_run(parallel->player->output.filters, frame);
+}
+
+/*
+ * NAME:	decode->output_parallel()
+ * DESCRIPTION:	count and output a decoded frame, in stream order
+ */
+static
+enum mad_flow decode_output_parallel(void *data,
+				     struct mad_header const *header,
+				     struct mad_pcm *pcm)
+{
+  struct player *player = ((struct parallel_player *) data)->player;
+
+  if ((player->options & PLAYER_OPTION_TIMED) &&
+      mad_timer_compare(player->stats.global_timer, player->global_stop) > 0)
+    return MAD_FLOW_STOP;
+
+  if (count_frame(player, header->duration) == MAD_FLOW_IGNORE)
+    return MAD_FLOW_CONTINUE;
+
+  return decode_output(player, header, pcm);
+}
+
+/*
+ * NAME:	find_xing()
+ * DESCRIPTION:	look for a Xing header in the first frame of a mapped file,
+ *		as decode_filter() does; return the frame holding it, or 0
+ */
+static
+unsigned char const *find_xing(struct player *player, int options)
+{
+  struct mad_stream stream;
+  struct mad_frame frame;
+  unsigned char const *xing_frame = 0;
+  int result;
+
+  mad_stream_init(&stream);
+  mad_frame_init(&frame);
+
+  mad_stream_options(&stream, options);
+  mad_stream_buffer(&stream, player->input.fdm, player->input.length);
+
+  while ((result = mad_frame_decode(&frame, &stream)) == -1 &&
+	 MAD_RECOVERABLE(stream.error))
+    ;
+
+  if (result == 0 &&
+      xing_parse(&player->input.xing, stream.anc_ptr, stream.anc_bitlen) == 0) {
+    if (player->input.xing.flags & XING_FRAMES) {
+      player->stats.total_time = frame.header.duration;
+      mad_timer_multiply(&player->stats.total_time,
+			 player->input.xing.frames);
+    }
+
+    if (player->stats.total_bytes >= stream.next_frame - stream.this_frame)
+      player->stats.total_bytes -= stream.next_frame - stream.this_frame;
+
+    xing_frame = stream.this_frame;
+  }
+
+  mad_frame_finish(&frame);
+  mad_stream_finish(&stream);
+
+  return xing_frame;
+}
+
+/*
+ * NAME:	find_frames()
+ * DESCRIPTION:	index a mapped file and find the frames to decode for the
+ *		start and stop times; count the frames before the start as
+ *		played
+ */
+static
+void find_frames(struct player *player, unsigned char const *xing_frame,
+		 unsigned long *first, unsigned long *last)
+{
+  struct input *input = &player->input;
+  struct mad_index *index = &input->index;
+  unsigned long base = 0, samples;
+  mad_timer_t offset, played, time;
+
+  *first = 0;
+  *last  = ULONG_MAX;
+
+  if (mad_index_build(index, input->fdm, input->length) == -1 ||
+      index->count == 0)
+    return;
+
+  /* the playing statistics leave out a Xing frame, which the index has */
+
+  if (xing_frame == input->fdm + index->entries[0].offset &&
+      index->count > 1)
+    base = 1;
+
+  mad_timer_set(&offset, 0, index->entries[base].sample, index->samplerate);
+
+  /* the start and stop times count from the beginning of the first file */
+
+  played = player->stats.global_timer;
+  mad_timer_negate(&played);
+
+  if (player->options & PLAYER_OPTION_TIMED) {
+    time = player->global_stop;
+    mad_timer_add(&time, played);
+    mad_timer_add(&time, offset);
+
+    *last = mad_index_find(index, time) + 1;
+  }
+
+  if (player->options & PLAYER_OPTION_SKIP) {
+    time = player->global_start;
+    mad_timer_add(&time, played);
+
+    if (mad_timer_sign(time) > 0) {
+      mad_timer_add(&time, offset);
+      *first = mad_index_find(index, time);
+    }
+  }
+
+  if (*first < base)
+    *first = base;
+
+  samples = (*first < index->count) ?
+    index->entries[*first].sample : index->samples;
+  mad_timer_set(&time, 0, samples - index->entries[base].sample,
+		index->samplerate);
+
+  player->stats.absolute_framecount += *first - base;
+  mad_timer_add(&player->stats.absolute_timer, time);
+
+  player->stats.global_framecount += *first - base;
+  mad_timer_add(&player->stats.global_timer, time);
+}
+
+/*
+ * NAME:	decode_parallel()
+ * DESCRIPTION:	decode and output audio for a mapped file on several threads
+ */
+static
+int decode_parallel(struct player *player, int options,
+		    unsigned char const *xing_frame,
+		    unsigned long first, unsigned long last)
+{
+  struct parallel_player parallel;
+
+  parallel.player     = player;
+  parallel.xing_frame = xing_frame;
+
+  return batch_decode_parallel(player->input.fdm, player->input.length,
+			       first, last, player->threads, options,
+			       decode_filter_parallel, decode_output_parallel,
+			       &parallel);
+}
+# endif
+
 /*
  * NAME:	decode()
  * DESCRIPTION:	decode and output audio for an open file
@@ -1089,6 +1300,10 @@ int decode(struct player *player)
   struct stat stat;
   struct mad_decoder decoder;
   int options, result;
+# if defined(HAVE_MMAP)
+  unsigned char const *xing_frame = 0;
+  unsigned long first = 0, last = ULONG_MAX;
+# endif
 
   if (fstat(player->input.fd, &stat) == -1) {
     error("decode", ":fstat");
@@ -1140,28 +1355,85 @@ int decode(struct player *player)
   player->stats.audio.peak_clipping   = 0;
   player->stats.audio.peak_sample     = 0;
 
-  mad_decoder_init(&decoder, player,
-# if defined(HAVE_MMAP)
-		   player->input.fdm ? decode_input_mmap :
-# endif
-		   decode_input_read,
-		   decode_header, decode_filter,
-		   player->output.command ? decode_output : 0,
-		   decode_error, 0);
-
   options = 0;
   if (player->options & PLAYER_OPTION_DOWNSAMPLE)
     options |= MAD_OPTION_HALFSAMPLERATE;
   if (player->options & PLAYER_OPTION_IGNORECRC)
     options |= MAD_OPTION_IGNORECRC;
 
-  mad_decoder_options(&decoder, options);
+# if defined(HAVE_MMAP)
+  /* fade-in and keyboard control depend on the frames played before */
+
+  if (player->threads > 1 &&
+      (player->options & (PLAYER_OPTION_FADEIN | PLAYER_OPTION_TTYCONTROL))) {
+    if (player->verbosity >= 0)
+      error("decode", _("fade-in and tty control need a single thread"));
 
-  result = mad_decoder_run(&decoder, MAD_DECODER_MODE_SYNC);
+    player->threads = 1;
+  }
+
+  /*
+   * A mapped file is indexed to start decoding a few frames before the
+   * start time, instead of counting every frame up to it, and to decode on
+   * several threads only the frames before the stop time.
+   */
 
-  mad_decoder_finish(&decoder);
+  if (player->input.fdm && player->output.command) {
+    int parallel = player->threads > 1;
+
+    if (parallel || (player->options & PLAYER_OPTION_SKIP))
+      xing_frame = find_xing(player, options);
+
+    if (player->options & (PLAYER_OPTION_SKIP |
+			   (parallel ? PLAYER_OPTION_TIMED : 0)))
+      find_frames(player, xing_frame, &first, &last);
+  }
+
+  if (first && first == player->input.index.count)
+    result = 0;
+  else if (player->threads > 1 && player->input.fdm && player->output.command)
+    result = decode_parallel(player, options, xing_frame, first, last);
+  else
+# endif
+  {
+    mad_decoder_init(&decoder, player,
+# if defined(HAVE_MMAP)
+		     player->input.fdm ? decode_input_mmap :
+# endif
+		     decode_input_read,
+		     decode_header, decode_filter,
+		     player->output.command ? decode_output : 0,
+		     decode_error, 0);
+
+    mad_decoder_options(&decoder, options);
+
+# if defined(HAVE_MMAP)
+    /*
+     * Seek to a few frames before the first frame, and run the filters on
+     * those too, so the synthesis history is built from the same subband
+     * samples as in a decode from the beginning.
+     */
+
+    if (first) {
+      player->input.decoder = &decoder;
+      player->input.seek    = mad_index_preroll(&player->input.index, first);
+      player->input.prime   = first - player->input.seek;
+    }
+# endif
+
+    result = mad_decoder_run(&decoder, MAD_DECODER_MODE_SYNC);
+
+    player->input.decoder = 0;
+    player->input.seek    = 0;
+    player->input.prime   = 0;
+    player->input.priming = 0;
+
+    mad_decoder_finish(&decoder);
+  }
 
 # if defined(HAVE_MMAP)
+  mad_index_finish(&player->input.index);
+
   if (player->input.fdm) {
     if (unmap_file(player->input.fdm, player->input.length) == -1) {
       error("decode", ":munmap");
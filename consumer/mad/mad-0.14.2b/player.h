@@ -80,6 +80,7 @@ struct player {
 
   int options;
   int repeat;
+  unsigned int threads;
 
   enum player_control control;
 
@@ -109,6 +110,12 @@ struct player {
 
     int eof;
 
+    struct mad_index index;		/* of a mapped file, for seeking */
+    struct mad_decoder *decoder;	/* whose state a seek sets up */
+    unsigned long seek;			/* frame to start decoding at */
+    unsigned long prime;		/* frames then decoded, not played */
+    int priming;			/* the current frame is one of them */
+
     struct xing xing;
   } input;
 
@@ -30,6 +30,7 @@
  * Auxiliary Support Routines.
  */
 #include "tiffiop.h"
+#include "tif_simd.h"
 
 #ifdef COLORIMETRY_SUPPORT
 #include <math.h>
@@ -201,3 +202,34 @@ TIFFGetFieldDefaulted(TIFF* tif, ttag_t tag, ...)
 	va_end(ap);
 	return (ok);
 }
+
+/*
+ * Return the SIMD level to use for the inner loops that
+ * have vector versions: TIFF_SIMD_AVX2 when the processor
+ * has AVX2, TIFF_SIMD_SSE2 on any other x86-64 processor,
+ * and TIFF_SIMD_NONE elsewhere.  The environment variable
+ * TIFFSIMD (0 or 1) caps the level, so that the C and the
+ * SSE2 code can be tested or timed on any machine.
+ */
+int
+_TIFFSIMDLevel(void)
+{
+#ifdef TIFF_SIMD_SUPPORTED
+	static int level = -1;		/* not yet determined */
+	char* cp;
+	int l;
+
+	if (level < 0) {
+		__builtin_cpu_init();
+		l = __builtin_cpu_supports("avx2") ?
+		    TIFF_SIMD_AVX2 : TIFF_SIMD_SSE2;
+		if ((cp = getenv("TIFFSIMD")) != NULL && atoi(cp) < l)
+			l = atoi(cp) < TIFF_SIMD_NONE ?
+			    TIFF_SIMD_NONE : atoi(cp);
+		level = l;
+	}
+	return (level);
+#else
+	return (TIFF_SIMD_NONE);
+#endif
+}
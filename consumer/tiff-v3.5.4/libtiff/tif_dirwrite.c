@@ -30,6 +30,7 @@
  * Directory Write Support Routines.
  */
 #include "tiffiop.h"
+#include <stddef.h>
 
 #if HAVE_IEEEFP
 #define	TIFFCvtNativeToIEEEFloat(tif, n, fp)
@@ -983,7 +984,7 @@ TIFFLinkDirectory(TIFF* tif)
 		 * First directory, overwrite offset in header.
 		 */
 		tif->tif_header.tiff_diroff = (uint32) tif->tif_diroff;
-#define	HDROFF(f)	((toff_t) &(((TIFFHeader*) 0)->f))
+#define	HDROFF(f)	((toff_t) offsetof(TIFFHeader, f))
 		(void) TIFFSeekFile(tif, HDROFF(tiff_diroff), SEEK_SET);
 		if (!WriteOK(tif, &diroff, sizeof (diroff))) {
 			TIFFError(tif->tif_name, "Error writing TIFF header");
@@ -190,6 +190,7 @@ TIFFRGBAImageBegin(TIFFRGBAImage* img, TIFF* tif, int stop, char emsg[1024])
     /* Initialize to normal values */
     img->row_offset = 0;
     img->col_offset = 0;
+    img->req_orientation = ORIENTATION_BOTLEFT;
     img->redcmap = NULL;
     img->greencmap = NULL;
     img->bluecmap = NULL;
@@ -392,11 +393,15 @@ TIFFReadRGBAImage(TIFF* tif,
     return (ok);
 }
 
-static uint32
-setorientation(TIFFRGBAImage* img, uint32 h)
+/*
+ * Return 1 if the rows of the image go into the raster
+ * from the bottom up: the raster origin (req_orientation)
+ * is not the corner that the image starts at.
+ */
+static int
+setorientation(TIFFRGBAImage* img)
 {
     TIFF* tif = img->tif;
-    uint32 y;
 
     switch (img->orientation) {
     case ORIENTATION_BOTRIGHT:
@@ -406,7 +411,6 @@ setorientation(TIFFRGBAImage* img, uint32 h)
 	img->orientation = ORIENTATION_BOTLEFT;
 	/* fall thru... */
     case ORIENTATION_BOTLEFT:
-	y = 0;
 	break;
     case ORIENTATION_TOPRIGHT:
     case ORIENTATION_RIGHTTOP:	/* XXX */
@@ -416,10 +420,10 @@ setorientation(TIFFRGBAImage* img, uint32 h)
 	img->orientation = ORIENTATION_TOPLEFT;
 	/* fall thru... */
     case ORIENTATION_TOPLEFT:
-	y = h-1;
 	break;
     }
-    return (y);
+    return (img->orientation != (img->req_orientation == ORIENTATION_TOPLEFT ?
+	ORIENTATION_TOPLEFT : ORIENTATION_BOTLEFT));
 }
 
 /*
@@ -427,18 +431,24 @@ setorientation(TIFFRGBAImage* img, uint32 h)
  *	PlanarConfiguration contiguous if SamplesPerPixel > 1
  * or
  *	SamplesPerPixel == 1
+ *
+ * The raster may start on any row of a tile (see row_offset),
+ * but col_offset must fall on a tile boundary.  Packed YCbCr
+ * data can only be read from the top of a tile.
  */	
 static int
 gtTileContig(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
 {
     TIFF* tif = img->tif;
     tileContigRoutine put = img->put.contig;
-    uint16 orientation;
+    int flip;
     uint32 col, row, y;
     uint32 tw, th;
     u_char* buf;
+    u_char* data;
+    tsize_t rowsize;
     int32 fromskew, toskew;
-    uint32 nrow;
+    uint32 nrow, skip;
 
     buf = (u_char*) _TIFFmalloc(TIFFTileSize(tif));
     if (buf == 0) {
@@ -447,11 +457,21 @@ gtTileContig(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
     }
     TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tw);
     TIFFGetField(tif, TIFFTAG_TILELENGTH, &th);
-    y = setorientation(img, h);
-    orientation = img->orientation;
-    toskew = -(int32) (orientation == ORIENTATION_TOPLEFT ? tw+w : tw-w);
-    for (row = 0; row < h; row += th) {
-	nrow = (row + th > h ? h - row : th);
+    flip = setorientation(img);
+    y = (flip ? h-1 : 0);
+    toskew = -(int32) (flip ? tw+w : tw-w);
+    rowsize = TIFFTileRowSize(tif);
+    for (row = 0; row < h; row += nrow) {
+	skip = (row + img->row_offset) % th;
+	nrow = (row + th - skip > h ? h - row : th - skip);
+	if (skip != 0 && TIFFVTileSize(tif, 1) != rowsize) {
+	    TIFFError(TIFFFileName(tif),
+		"Can not read packed YCbCr data from row %lu of a tile",
+		(u_long) skip);
+	    _TIFFfree(buf);
+	    return (0);
+	}
+	data = buf + skip*rowsize;
 	for (col = 0; col < w; col += tw) {
 	    if (TIFFReadTile(tif, buf, col+img->col_offset,
                              row+img->row_offset, 0, 0) < 0 && img->stoponerr)
@@ -464,13 +484,12 @@ gtTileContig(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
 		uint32 npix = w - col;
 		fromskew = tw - npix;
 		(*put)(img, raster+y*w+col, col, y,
-		    npix, nrow, fromskew, toskew + fromskew, buf);
+		    npix, nrow, fromskew, toskew + fromskew, data);
 	    } else {
-		(*put)(img, raster+y*w+col, col, y, tw, nrow, 0, toskew, buf);
+		(*put)(img, raster+y*w+col, col, y, tw, nrow, 0, toskew, data);
 	    }
 	}
-	y += (orientation == ORIENTATION_TOPLEFT ?
-	    -(int32) nrow : (int32) nrow);
+	y += (flip ? -(int32) nrow : (int32) nrow);
     }
     _TIFFfree(buf);
     return (1);
@@ -481,13 +500,15 @@ gtTileContig(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
  *	 SamplesPerPixel > 1
  *	 PlanarConfiguration separated
  * We assume that all such images are RGB.
+ *
+ * As above, the raster may start on any row of a tile.
  */	
 static int
 gtTileSeparate(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
 {
     TIFF* tif = img->tif;
     tileSeparateRoutine put = img->put.separate;
-    uint16 orientation;
+    int flip;
     uint32 col, row, y;
     uint32 tw, th;
     u_char* buf;
@@ -498,7 +519,8 @@ gtTileSeparate(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
     tsize_t tilesize;
     int32 fromskew, toskew;
     int alpha = img->alpha;
-    uint32 nrow;
+    uint32 nrow, skip;
+    tsize_t pos;
 
     tilesize = TIFFTileSize(tif);
     buf = (u_char*) _TIFFmalloc(4*tilesize);
@@ -514,11 +536,13 @@ gtTileSeparate(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
 	memset(a, 0xff, tilesize);
     TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tw);
     TIFFGetField(tif, TIFFTAG_TILELENGTH, &th);
-    y = setorientation(img, h);
-    orientation = img->orientation;
-    toskew = -(int32) (orientation == ORIENTATION_TOPLEFT ? tw+w : tw-w);
-    for (row = 0; row < h; row += th) {
-	nrow = (row + th > h ? h - row : th);
+    flip = setorientation(img);
+    y = (flip ? h-1 : 0);
+    toskew = -(int32) (flip ? tw+w : tw-w);
+    for (row = 0; row < h; row += nrow) {
+	skip = (row + img->row_offset) % th;
+	nrow = (row + th - skip > h ? h - row : th - skip);
+	pos = skip * TIFFTileRowSize(tif);
 	for (col = 0; col < w; col += tw) {
 	    if (TIFFReadTile(tif, r, col+img->col_offset,
                              row+img->row_offset,0,0) < 0 && img->stoponerr)
@@ -540,14 +564,14 @@ gtTileSeparate(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
 		uint32 npix = w - col;
 		fromskew = tw - npix;
 		(*put)(img, raster+y*w+col, col, y,
-		    npix, nrow, fromskew, toskew + fromskew, r, g, b, a);
+		    npix, nrow, fromskew, toskew + fromskew,
+		    r + pos, g + pos, b + pos, a + pos);
 	    } else {
 		(*put)(img, raster+y*w+col, col, y,
-		    tw, nrow, 0, toskew, r, g, b, a);
+		    tw, nrow, 0, toskew, r + pos, g + pos, b + pos, a + pos);
 	    }
 	}
-	y += (orientation == ORIENTATION_TOPLEFT ?
-	    -(int32) nrow : (int32) nrow);
+	y += (flip ? -(int32) nrow : (int32) nrow);
     }
     _TIFFfree(buf);
     return (1);
@@ -558,41 +582,71 @@ gtTileSeparate(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
  *	PlanarConfiguration contiguous if SamplesPerPixel > 1
  * or
  *	SamplesPerPixel == 1
+ *
+ * The raster may start and end anywhere in a strip (see
+ * row_offset).  Whole strips are decoded in one go; rows
+ * from part of a strip are read a scanline at a time, so
+ * the buffer holds no more rows than the raster and calls
+ * for successive rows walk down a large strip in order.
+ * Packed YCbCr data come in blocks of rows and can only
+ * be read from the start of a strip.
  */	
 static int
 gtStripContig(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
 {
     TIFF* tif = img->tif;
     tileContigRoutine put = img->put.contig;
-    uint16 orientation;
-    uint32 row, y, nrow;
+    uint32 row, y, nrow, skip, i;
     u_char* buf;
-    uint32 rowsperstrip;
+    uint32 rowsperstrip, offset_row;
     uint32 imagewidth = img->width;
-    tsize_t scanline;
+    tsize_t scanline, bufsize;
     int32 fromskew, toskew;
+    int flip, packed;
 
-    buf = (u_char*) _TIFFmalloc(TIFFStripSize(tif));
+    TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);
+    scanline = TIFFScanlineSize(tif);
+    packed = (TIFFVStripSize(tif, 1) != scanline);
+    bufsize = TIFFStripSize(tif);
+    if (!packed && h < rowsperstrip && (tsize_t) (h*scanline) < bufsize)
+	bufsize = h*scanline;
+    buf = (u_char*) _TIFFmalloc(bufsize);
     if (buf == 0) {
 	TIFFError(TIFFFileName(tif), "No space for strip buffer");
 	return (0);
     }
-    y = setorientation(img, h);
-    orientation = img->orientation;
-    toskew = -(int32) (orientation == ORIENTATION_TOPLEFT ? w+w : w-w);
-    TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);
-    scanline = TIFFScanlineSize(tif);
+    flip = setorientation(img);
+    y = (flip ? h-1 : 0);
+    toskew = -(int32) (flip ? w+w : w-w);
     fromskew = (w < imagewidth ? imagewidth - w : 0);
-    for (row = 0; row < h; row += rowsperstrip) {
-	nrow = (row + rowsperstrip > h ? h - row : rowsperstrip);
-	if (TIFFReadEncodedStrip(tif,
-                                 TIFFComputeStrip(tif,row+img->row_offset, 0),
-                                 buf, nrow*scanline) < 0
-            && img->stoponerr)
+    for (row = 0; row < h; row += nrow) {
+	offset_row = row + img->row_offset;
+	skip = offset_row % rowsperstrip;
+	nrow = (row + rowsperstrip - skip > h ? h - row : rowsperstrip - skip);
+	if (skip == 0 && (packed || nrow == rowsperstrip ||
+	    offset_row + nrow == img->height)) {
+	    if (TIFFReadEncodedStrip(tif,
+		TIFFComputeStrip(tif, offset_row, 0),
+		buf, nrow*scanline) < 0 && img->stoponerr)
 		break;
+	    /* the scanline reader must start this strip over */
+	    tif->tif_curstrip = (tstrip_t) -1;
+	} else if (!packed) {
+	    for (i = 0; i < nrow; i++)
+		if (TIFFReadScanline(tif, buf + i*scanline,
+		    offset_row + i, 0) < 0 && img->stoponerr)
+		    break;
+	    if (i < nrow)
+		break;
+	} else {
+	    TIFFError(TIFFFileName(tif),
+		"Can not read packed YCbCr data from row %lu of a strip",
+		(u_long) skip);
+	    _TIFFfree(buf);
+	    return (0);
+	}
 	(*put)(img, raster+y*w, 0, y, w, nrow, fromskew, toskew, buf);
-	y += (orientation == ORIENTATION_TOPLEFT ?
-	    -(int32) nrow : (int32) nrow);
+	y += (flip ? -(int32) nrow : (int32) nrow);
     }
     _TIFFfree(buf);
     return (1);
@@ -603,22 +657,25 @@ gtStripContig(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
  *	 SamplesPerPixel > 1
  *	 PlanarConfiguration separated
  * We assume that all such images are RGB.
+ *
+ * Rows from part of a strip are decoded from the start
+ * of the strip; the samples before them are skipped.
  */
 static int
 gtStripSeparate(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
 {
     TIFF* tif = img->tif;
     tileSeparateRoutine put = img->put.separate;
-    uint16 orientation;
     u_char *buf;
     u_char *r, *g, *b, *a;
-    uint32 row, y, nrow;
-    tsize_t scanline;
+    uint32 row, y, nrow, skip;
+    tsize_t scanline, size;
     uint32 rowsperstrip, offset_row;
     uint32 imagewidth = img->width;
     tsize_t stripsize;
     int32 fromskew, toskew;
     int alpha = img->alpha;
+    int flip;
 
     stripsize = TIFFStripSize(tif);
     r = buf = (u_char *)_TIFFmalloc(4*stripsize);
@@ -631,31 +688,35 @@ gtStripSeparate(TIFFRGBAImage* img, uint32* raster, uint32 w, uint32 h)
     a = b + stripsize;
     if (!alpha)
 	memset(a, 0xff, stripsize);
-    y = setorientation(img, h);
-    orientation = img->orientation;
-    toskew = -(int32) (orientation == ORIENTATION_TOPLEFT ? w+w : w-w);
+    flip = setorientation(img);
+    y = (flip ? h-1 : 0);
+    toskew = -(int32) (flip ? w+w : w-w);
     TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);
     scanline = TIFFScanlineSize(tif);
     fromskew = (w < imagewidth ? imagewidth - w : 0);
-    for (row = 0; row < h; row += rowsperstrip) {
-	nrow = (row + rowsperstrip > h ? h - row : rowsperstrip);
+    for (row = 0; row < h; row += nrow) {
         offset_row = row + img->row_offset;
+	skip = offset_row % rowsperstrip;
+	nrow = (row + rowsperstrip - skip > h ? h - row : rowsperstrip - skip);
+	size = (skip + nrow) * scanline;
 	if (TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, offset_row, 0),
-	    r, nrow*scanline) < 0 && img->stoponerr)
+	    r, size) < 0 && img->stoponerr)
 	    break;
 	if (TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, offset_row, 1),
-	    g, nrow*scanline) < 0 && img->stoponerr)
+	    g, size) < 0 && img->stoponerr)
 	    break;
 	if (TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, offset_row, 2),
-	    b, nrow*scanline) < 0 && img->stoponerr)
+	    b, size) < 0 && img->stoponerr)
 	    break;
 	if (alpha &&
 	    (TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, offset_row, 3),
-	    a, nrow*scanline) < 0 && img->stoponerr))
+	    a, size) < 0 && img->stoponerr))
 	    break;
-	(*put)(img, raster+y*w, 0, y, w, nrow, fromskew, toskew, r, g, b, a);
-	y += (orientation == ORIENTATION_TOPLEFT ?
-	    -(int32) nrow : (int32) nrow);
+	tif->tif_curstrip = (tstrip_t) -1;
+	(*put)(img, raster+y*w, 0, y, w, nrow, fromskew, toskew,
+	    r + skip*scanline, g + skip*scanline, b + skip*scanline,
+	    a + skip*scanline);
+	y += (flip ? -(int32) nrow : (int32) nrow);
     }
     _TIFFfree(buf);
     return (1);
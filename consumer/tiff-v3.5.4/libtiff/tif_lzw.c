@@ -75,8 +75,8 @@
 #define	CODE_EOI	257		/* end-of-information code */
 #define CODE_FIRST	258		/* first free code entry */
 #define	CODE_MAX	MAXCODE(BITS_MAX)
-#define	HSIZE		9001L		/* 91% occupancy */
-#define	HSHIFT		(13-8)
+#define	HBITS		13		/* log2 of encoder hash table size */
+#define	HSIZE		(1L<<HBITS)	/* 50% occupancy */
 #ifdef LZW_COMPAT
 /* NB: +1024 is for compatibility with old files */
 #define	CSIZE		(MAXCODE(BITS_MAX)+1024L)
@@ -107,12 +107,21 @@ typedef	struct {
 
 /*
  * Decoding-specific state.
+ *
+ * The string for a code is the string of the code before it
+ * plus one character, and was put out in one piece, so besides
+ * the chain back through its prefixes each entry records where
+ * in the strip its string was last put out.  LZWDecode copies
+ * strings from there in a block rather than walking the chain
+ * a byte at a time; the output since the last CODE_CLEAR that
+ * precedes the current call is kept in dec_hist for this.
  */
 typedef struct code_ent {
 	struct code_ent *next;
 	u_short	length;			/* string len, including this token */
 	u_char	value;			/* data value */
 	u_char	firstchar;		/* first token of string */
+	long	offset;			/* strip offset of a copy of string */
 } code_t;
 
 typedef	int (*decodeFunc)(TIFF*, tidata_t, tsize_t, tsample_t);
@@ -130,16 +139,28 @@ typedef struct {
 	code_t*	dec_free_entp;		/* next free entry */
 	code_t*	dec_maxcodep;		/* max available entry */
 	code_t*	dec_codetab;		/* kept separate for small machines */
+	long	dec_outpos;		/* strip offset of next output byte */
+	long	dec_oldpos;		/* strip offset of previous string */
+	long	dec_histbase;		/* strip offset of dec_hist[0] */
+	long	dec_histsize;		/* allocated size of dec_hist */
+	char*	dec_hist;		/* output since CODE_CLEAR */
 } LZWDecodeState;
 
 /*
  * Encoding-specific state.
+ *
+ * The string table is kept in an open-addressed hash table with
+ * linear probing.  Each slot holds the prefix code and the next
+ * character of a string together with its code, packed in one
+ * word (code 0 is never assigned, so a zero slot is empty); the
+ * table is a power of 2 in size, half full at most, and small
+ * enough to stay in the data cache.
  */
 typedef uint16 hcode_t;			/* codes fit in 16 bits */
-typedef struct {
-	long	hash;
-	hcode_t	code;
-} hash_t;
+typedef uint32 hash_t;			/* (char<<12|prefix)<<12 | code */
+
+#define	HashKey(c, ent)	(((long)(c) << BITS_MAX) | (ent))
+#define	HashSlot(c, ent) (((c) << (HBITS-8)) ^ (ent))	/* xor hashing */
 
 typedef struct {
 	LZWBaseState base;
@@ -156,6 +177,9 @@ typedef struct {
 #define	LZWState(tif)		((LZWBaseState*) (tif)->tif_data)
 #define	DecoderState(tif)	((LZWDecodeState*) LZWState(tif))
 #define	EncoderState(tif)	((LZWEncodeState*) LZWState(tif))
+#define	LZWStateSize \
+	(sizeof (LZWDecodeState) > sizeof (LZWEncodeState) ? \
+	    sizeof (LZWDecodeState) : sizeof (LZWEncodeState))
 
 static	int LZWDecode(TIFF*, tidata_t, tsize_t, tsample_t);
 #ifdef LZW_COMPAT
@@ -202,7 +226,8 @@ LZWSetupDecode(TIFF* tif)
 			return (0);
 		}
 		/*
-		 * Pre-load the table.
+		 * Pre-load the table.  CODE_CLEAR stands for the
+		 * (empty) string before the first code of a strip.
 		 */
 		for (code = 255; code >= 0; code--) {
 			sp->dec_codetab[code].value = code;
@@ -210,6 +235,8 @@ LZWSetupDecode(TIFF* tif)
 			sp->dec_codetab[code].length = 1;
 			sp->dec_codetab[code].next = NULL;
 		}
+		_TIFFmemset(&sp->dec_codetab[CODE_CLEAR], 0,
+		    (CODE_FIRST-CODE_CLEAR)*sizeof (code_t));
 	}
 	return (1);
 }
@@ -273,16 +300,25 @@ LZWPreDecode(TIFF* tif, tsample_t s)
 	sp->dec_bitsleft = tif->tif_rawcc << 3;
 #endif
 	sp->dec_free_entp = sp->dec_codetab + CODE_FIRST;
-	/*
-	 * Zero entries that are not yet filled in.  We do
-	 * this to guard against bogus input data that causes
-	 * us to index into undefined entries.  If you can
-	 * come up with a way to safely bounds-check input codes
-	 * while decoding then you can remove this operation.
-	 */
-	_TIFFmemset(sp->dec_free_entp, 0, (CSIZE-CODE_FIRST)*sizeof (code_t));
-	sp->dec_oldcodep = &sp->dec_codetab[-1];
 	sp->dec_maxcodep = &sp->dec_codetab[sp->dec_nbitsmask-1];
+	sp->dec_outpos = 0;
+	sp->dec_oldpos = 0;
+	sp->dec_histbase = 0;
+#ifdef LZW_COMPAT
+	if (sp->dec_decode == LZWDecodeCompat) {
+		/*
+		 * Zero entries that are not yet filled in.  We do
+		 * this to guard against bogus input data that causes
+		 * us to index into undefined entries.  LZWDecode
+		 * bounds-checks its input codes instead.
+		 */
+		_TIFFmemset(sp->dec_free_entp, 0,
+		    (CSIZE-CODE_FIRST)*sizeof (code_t));
+		sp->dec_oldcodep = &sp->dec_codetab[-1];
+		return (1);
+	}
+#endif
+	sp->dec_oldcodep = &sp->dec_codetab[CODE_CLEAR];
 	return (1);
 }
 
@@ -301,68 +337,120 @@ LZWPreDecode(TIFF* tif, tsample_t s)
 }
 
 static void
-codeLoop(TIFF* tif)
+badCode(TIFF* tif)
 {
 	TIFFError(tif->tif_name,
-	    "LZWDecode: Bogus encoding, loop in the code table; scanline %d",
+	    "LZWDecode: Bogus encoding, code not in the code table; scanline %d",
 	    tif->tif_row);
 }
 
+/*
+ * Copy len bytes of the strip starting at offset pos to op.
+ * The part ahead of start, the strip offset of op0, comes from
+ * the history; the rest was put out by this call, and may run
+ * into op when a string repeats itself (KwKwK), so it is copied
+ * forward a byte at a time.
+ */
+static void
+LZWCopyString(LZWDecodeState* sp, char* op, long pos, long len,
+    char* op0, long start)
+{
+	char *tp;
+
+	if (pos < start) {
+		long n = start - pos;
+
+		assert(pos >= sp->dec_histbase);
+		if (n > len)
+			n = len;
+		tp = sp->dec_hist + (pos - sp->dec_histbase);
+		pos += n, len -= n;
+		if (n > 16) {
+			_TIFFmemcpy(op, tp, n);
+			op += n;
+		} else {
+			do
+				*op++ = *tp++;
+			while (--n);
+		}
+	}
+	for (tp = op0 + (pos - start); len > 0; len--)
+		*op++ = *tp++;
+}
+
+/*
+ * Append the output of a call, from op0 (at strip offset
+ * start) up to strip offset end, to the history.  Only the
+ * output since the last CODE_CLEAR is kept.
+ */
+static int
+LZWSaveHistory(TIFF* tif, char* op0, long start, long end)
+{
+	LZWDecodeState *sp = DecoderState(tif);
+	long from = sp->dec_histbase > start ? sp->dec_histbase : start;
+
+	if (end <= from)
+		return (1);
+	if (end - sp->dec_histbase > sp->dec_histsize) {
+		long size = sp->dec_histsize ? sp->dec_histsize : 8192;
+		char* hist;
+
+		while (size < end - sp->dec_histbase)
+			size *= 2;
+		hist = (char*) _TIFFrealloc(sp->dec_hist, size);
+		if (hist == NULL) {
+			TIFFError(tif->tif_name, "No space for LZW history");
+			return (0);
+		}
+		sp->dec_hist = hist;
+		sp->dec_histsize = size;
+	}
+	_TIFFmemcpy(sp->dec_hist + (from - sp->dec_histbase),
+	    op0 + (from - start), end - from);
+	return (1);
+}
+
 static int
 LZWDecode(TIFF* tif, tidata_t op0, tsize_t occ0, tsample_t s)
 {
 	LZWDecodeState *sp = DecoderState(tif);
 	char *op = (char*) op0;
 	long occ = (long) occ0;
-	char *tp;
+	char *tp, *ep;
 	u_char *bp;
 	hcode_t code;
-	int len;
+	long len, start, oldpos;
 	long nbits, nextbits, nextdata, nbitsmask;
 	code_t *codep, *free_entp, *maxcodep, *oldcodep;
 
 	(void) s;
 	assert(sp != NULL);
+	start = sp->dec_outpos;
 	/*
 	 * Restart interrupted output operation.
 	 */
 	if (sp->dec_restart) {
-		long residue;
-
 		codep = sp->dec_codep;
-		residue = codep->length - sp->dec_restart;
-		if (residue > occ) {
+		len = codep->length - sp->dec_restart;
+		if (len > occ) {
 			/*
 			 * Residue from previous decode is sufficient
-			 * to satisfy decode request.  Skip to the
-			 * start of the decoded string, place decoded
-			 * values in the output buffer, and return.
+			 * to satisfy decode request.
 			 */
+			LZWCopyString(sp, op, codep->offset + sp->dec_restart,
+			    occ, (char*) op0, start);
 			sp->dec_restart += occ;
-			do {
-				codep = codep->next;
-			} while (--residue > occ && codep);
-			if (codep) {
-				tp = op + occ;
-				do {
-					*--tp = codep->value;
-					codep = codep->next;
-				} while (--occ && codep);
-			}
-			return (1);
+			op += occ;
+			sp->dec_outpos = start + occ;
+			return (LZWSaveHistory(tif, (char*) op0, start,
+			    sp->dec_outpos));
 		}
 		/*
 		 * Residue satisfies only part of the decode request.
 		 */
-		op += residue, occ -= residue;
-		tp = op;
-		do {
-			int t;
-			--tp;
-			t = codep->value;
-			codep = codep->next;
-			*tp = t;
-		} while (--residue && codep);
+		LZWCopyString(sp, op, codep->offset + sp->dec_restart,
+		    len, (char*) op0, start);
+		op += len, occ -= len;
 		sp->dec_restart = 0;
 	}
 
@@ -372,6 +460,7 @@ LZWDecode(TIFF* tif, tidata_t op0, tsize_t occ0, tsample_t s)
 	nextbits = sp->lzw_nextbits;
 	nbitsmask = sp->dec_nbitsmask;
 	oldcodep = sp->dec_oldcodep;
+	oldpos = sp->dec_oldpos;
 	free_entp = sp->dec_free_entp;
 	maxcodep = sp->dec_maxcodep;
 
@@ -387,70 +476,91 @@ LZWDecode(TIFF* tif, tidata_t op0, tsize_t occ0, tsample_t s)
 			NextCode(tif, sp, bp, code, GetNextCode);
 			if (code == CODE_EOI)
 				break;
-			*op++ = (char) code, occ--;
+			if (code >= 256) {
+				badCode(tif);
+				break;
+			}
 			oldcodep = sp->dec_codetab + code;
+			oldpos = start + (op - (char*) op0);
+			/*
+			 * No string before this point is used again.
+			 */
+			sp->dec_histbase = oldpos;
+			*op++ = (char) code, occ--;
 			continue;
 		}
 		codep = sp->dec_codetab + code;
+		if (codep > free_entp) {
+			badCode(tif);
+			break;
+		}
 
 		/*
-	 	 * Add the new entry to the code table.
+	 	 * Add the new entry to the code table: the previous
+		 * string plus the first token of this one, which
+		 * directly follow one another in the output.
 	 	 */
-		assert(&sp->dec_codetab[0] <= free_entp && free_entp < &sp->dec_codetab[CSIZE]);
 		free_entp->next = oldcodep;
-		free_entp->firstchar = free_entp->next->firstchar;
-		free_entp->length = free_entp->next->length+1;
+		free_entp->firstchar = oldcodep->firstchar;
+		free_entp->length = oldcodep->length+1;
 		free_entp->value = (codep < free_entp) ?
 		    codep->firstchar : free_entp->firstchar;
+		free_entp->offset = oldpos;
 		if (++free_entp > maxcodep) {
 			if (++nbits > BITS_MAX)		/* should not happen */
 				nbits = BITS_MAX;
 			nbitsmask = MAXCODE(nbits);
 			maxcodep = sp->dec_codetab + nbitsmask-1;
+			if (free_entp == &sp->dec_codetab[CSIZE]) {
+				badCode(tif);
+				break;
+			}
 		}
 		oldcodep = codep;
+		oldpos = start + (op - (char*) op0);
 		if (code >= 256) {
 			/*
-		 	 * Code maps to a string, copy string
-			 * value to output (written in reverse).
+		 	 * Code maps to a string, copy it from where
+			 * it was put out before.
 		 	 */
-			if (codep->length > occ) {
+			len = codep->length;
+			if (len > occ) {
 				/*
 				 * String is too long for decode buffer,
-				 * locate portion that will fit, copy to
-				 * the decode buffer, and setup restart
-				 * logic for the next decoding call.
+				 * copy the portion that will fit and setup
+				 * restart logic for the next decoding call.
 				 */
+				LZWCopyString(sp, op, codep->offset, occ,
+				    (char*) op0, start);
 				sp->dec_codep = codep;
-				do {
-					codep = codep->next;
-				} while (codep && codep->length > occ);
-				if (codep) {
-					sp->dec_restart = occ;
-					tp = op + occ;
-					do  {
-						*--tp = codep->value;
-						codep = codep->next;
-					}  while (--occ && codep);
-					if (codep)
-						codeLoop(tif);
-				}
+				sp->dec_restart = occ;
+				op += occ, occ = 0;
 				break;
 			}
-			len = codep->length;
-			tp = op + len;
-			do {
-				int t;
-				--tp;
-				t = codep->value;
-				codep = codep->next;
-				*tp = t;
-			} while (codep && tp > op);
-			if (codep) {
-			    codeLoop(tif);
-			    break;
-			}
-			op += len, occ -= len;
+			ep = op + len;
+			if (codep->offset >= start) {
+				tp = (char*) op0 + (codep->offset - start);
+				if (len > 16 && tp + len <= op)
+					_TIFFmemcpy(op, tp, len);
+				else {
+					do
+						*op++ = *tp++;
+					while (op < ep);
+				}
+			} else if (codep->offset + len <= start) {
+				tp = sp->dec_hist +
+				    (codep->offset - sp->dec_histbase);
+				if (len > 16)
+					_TIFFmemcpy(op, tp, len);
+				else {
+					do
+						*op++ = *tp++;
+					while (op < ep);
+				}
+			} else
+				LZWCopyString(sp, op, codep->offset, len,
+				    (char*) op0, start);
+			op = ep, occ -= len;
 		} else
 			*op++ = (char) code, occ--;
 	}
@@ -461,8 +571,12 @@ LZWDecode(TIFF* tif, tidata_t op0, tsize_t occ0, tsample_t s)
 	sp->lzw_nextbits = nextbits;
 	sp->dec_nbitsmask = nbitsmask;
 	sp->dec_oldcodep = oldcodep;
+	sp->dec_oldpos = oldpos;
 	sp->dec_free_entp = free_entp;
 	sp->dec_maxcodep = maxcodep;
+	sp->dec_outpos = start + (op - (char*) op0);
+	if (!LZWSaveHistory(tif, (char*) op0, start, sp->dec_outpos))
+		return (0);
 
 	if (occ > 0) {
 		TIFFError(tif->tif_name,
@@ -634,17 +748,260 @@ LZWDecodeCompat(TIFF* tif, tidata_t op0, tsize_t occ0, tsample_t s)
 	}
 	return (1);
 }
-static int _LZWtrue(TIFF* tif) { (void) tif; return (1); }
 #endif /* LZW_COMPAT */
 
 /*
  * LZW Encoding.
- * 
- * LZW Encoding Removed 11/22/99 due to Unisys's control of patent,
- * and their demand for payment even from software developers. 
- * 
  */
 
+static int
+LZWSetupEncode(TIFF* tif)
+{
+	LZWEncodeState* sp = EncoderState(tif);
+	static const char module[] = "LZWSetupEncode";
+
+	assert(sp != NULL);
+	if (sp->enc_hashtab == NULL) {
+		sp->enc_hashtab = (hash_t*) _TIFFmalloc(HSIZE*sizeof (hash_t));
+		if (sp->enc_hashtab == NULL) {
+			TIFFError(module, "No space for LZW hash table");
+			return (0);
+		}
+	}
+	return (1);
+}
+
+/*
+ * Reset encoding state at the start of a strip.
+ */
+static int
+LZWPreEncode(TIFF* tif, tsample_t s)
+{
+	LZWEncodeState *sp = EncoderState(tif);
+
+	(void) s;
+	assert(sp != NULL);
+	sp->lzw_nbits = BITS_MIN;
+	sp->lzw_maxcode = MAXCODE(BITS_MIN);
+	sp->lzw_free_ent = CODE_FIRST;
+	sp->lzw_nextbits = 0;
+	sp->lzw_nextdata = 0;
+	sp->enc_checkpoint = CHECK_GAP;
+	sp->enc_ratio = 0;
+	sp->enc_incount = 0;
+	sp->enc_outcount = 0;
+	/*
+	 * The 4 here insures there is space for 2 max-sized
+	 * codes in LZWEncode and LZWPostDecode.
+	 */
+	sp->enc_rawlimit = tif->tif_rawdata + tif->tif_rawdatasize-1 - 4;
+	cl_hash(sp);		/* clear hash table */
+	sp->enc_oldcode = (hcode_t) -1;	/* generates CODE_CLEAR in LZWEncode */
+	return (1);
+}
+
+#define	CALCRATIO(sp, rat) {					\
+	if (incount > 0x007fffff) { /* NB: shift will overflow */\
+		rat = outcount >> 8;				\
+		rat = (rat == 0 ? 0x7fffffff : incount/rat);	\
+	} else							\
+		rat = (incount<<8) / outcount;			\
+}
+#define	PutNextCode(op, c) {					\
+	nextdata = (nextdata << nbits) | c;			\
+	nextbits += nbits;					\
+	*op++ = (u_char)(nextdata >> (nextbits-8));		\
+	nextbits -= 8;						\
+	if (nextbits >= 8) {					\
+		*op++ = (u_char)(nextdata >> (nextbits-8));	\
+		nextbits -= 8;					\
+	}							\
+	outcount += nbits;					\
+}
+
+/*
+ * Encode a chunk of pixels.
+ *
+ * The string table is looked up by xor hashing the prefix code/next
+ * character combination, with linear probing; since the table is
+ * never more than half full a probe almost always ends at the first
+ * or second slot, and the slots tried for strings with neighbouring
+ * prefixes are close together.  Also do block compression with an
+ * adaptive reset, whereby the code table is cleared when the
+ * compression ratio decreases, but after the table fills.  The
+ * variable-length output codes are re-sized at this point, and a
+ * CODE_CLEAR is generated for the decoder.
+ */
+static int
+LZWEncode(TIFF* tif, tidata_t bp, tsize_t cc, tsample_t s)
+{
+	register LZWEncodeState *sp = EncoderState(tif);
+	register long fcode;
+	register hash_t *hp;
+	register int h, c;
+	hcode_t ent;
+	long incount, outcount, checkpoint;
+	long nextdata, nextbits;
+	int free_ent, maxcode, nbits;
+	tidata_t op, limit;
+
+	(void) s;
+	if (sp == NULL)
+		return (0);
+	/*
+	 * Load local state.
+	 */
+	incount = sp->enc_incount;
+	outcount = sp->enc_outcount;
+	checkpoint = sp->enc_checkpoint;
+	nextdata = sp->lzw_nextdata;
+	nextbits = sp->lzw_nextbits;
+	free_ent = sp->lzw_free_ent;
+	maxcode = sp->lzw_maxcode;
+	nbits = sp->lzw_nbits;
+	op = tif->tif_rawcp;
+	limit = sp->enc_rawlimit;
+	ent = sp->enc_oldcode;
+
+	if (ent == (hcode_t) -1 && cc > 0) {
+		/*
+		 * NB: This is safe because it can only happen
+		 *     at the start of a strip where we know there
+		 *     is space in the data buffer.
+		 */
+		PutNextCode(op, CODE_CLEAR);
+		ent = *bp++; cc--; incount++;
+	}
+	while (cc > 0) {
+		c = *bp++; cc--; incount++;
+		fcode = HashKey(c, ent);
+		h = HashSlot(c, ent);
+		for (;;) {
+			hp = &sp->enc_hashtab[h];
+			if (*hp == 0 || (long)(*hp >> BITS_MAX) == fcode)
+				break;
+			h = (h+1) & (HSIZE-1);
+		}
+		if (*hp != 0) {
+			ent = (hcode_t)(*hp & CODE_MAX);
+			continue;
+		}
+		/*
+		 * New entry, emit code and add to table.
+		 */
+		/*
+		 * Verify there is space in the buffer for the code
+		 * and any potential Clear code that might be emitted
+		 * below.  The value of limit is setup so that there
+		 * are at least 4 bytes free--room for 2 codes.
+		 */
+		if (op > limit) {
+			tif->tif_rawcc = (tsize_t)(op - tif->tif_rawdata);
+			TIFFFlushData1(tif);
+			op = tif->tif_rawdata;
+		}
+		PutNextCode(op, ent);
+		ent = c;
+		*hp = ((hash_t) fcode << BITS_MAX) | free_ent++;
+		if (free_ent == CODE_MAX-1) {
+			/* table is full, emit clear code and reset */
+			cl_hash(sp);
+			sp->enc_ratio = 0;
+			incount = 0;
+			outcount = 0;
+			free_ent = CODE_FIRST;
+			PutNextCode(op, CODE_CLEAR);
+			nbits = BITS_MIN;
+			maxcode = MAXCODE(BITS_MIN);
+		} else {
+			/*
+			 * If the next entry is going to be too big for
+			 * the code size, then increase it, if possible.
+			 */
+			if (free_ent > maxcode) {
+				nbits++;
+				assert(nbits <= BITS_MAX);
+				maxcode = (int) MAXCODE(nbits);
+			} else if (incount >= checkpoint) {
+				long rat;
+				/*
+				 * Check compression ratio and, if things seem
+				 * to be slipping, clear the hash table and
+				 * reset state.  The compression ratio is a
+				 * 24+8-bit fractional number.
+				 */
+				checkpoint = incount+CHECK_GAP;
+				CALCRATIO(sp, rat);
+				if (rat <= sp->enc_ratio) {
+					cl_hash(sp);
+					sp->enc_ratio = 0;
+					incount = 0;
+					outcount = 0;
+					free_ent = CODE_FIRST;
+					PutNextCode(op, CODE_CLEAR);
+					nbits = BITS_MIN;
+					maxcode = MAXCODE(BITS_MIN);
+				} else
+					sp->enc_ratio = rat;
+			}
+		}
+	}
+
+	/*
+	 * Restore global state.
+	 */
+	sp->enc_incount = incount;
+	sp->enc_outcount = outcount;
+	sp->enc_checkpoint = checkpoint;
+	sp->enc_oldcode = ent;
+	sp->lzw_nextdata = nextdata;
+	sp->lzw_nextbits = nextbits;
+	sp->lzw_free_ent = free_ent;
+	sp->lzw_maxcode = maxcode;
+	sp->lzw_nbits = nbits;
+	tif->tif_rawcp = op;
+	return (1);
+}
+
+/*
+ * Finish off an encoded strip by flushing the last
+ * string and tacking on an End Of Information code.
+ */
+static int
+LZWPostEncode(TIFF* tif)
+{
+	register LZWEncodeState *sp = EncoderState(tif);
+	tidata_t op = tif->tif_rawcp;
+	long nextbits = sp->lzw_nextbits;
+	long nextdata = sp->lzw_nextdata;
+	long outcount = sp->enc_outcount;
+	int nbits = sp->lzw_nbits;
+
+	if (op > sp->enc_rawlimit) {
+		tif->tif_rawcc = (tsize_t)(op - tif->tif_rawdata);
+		TIFFFlushData1(tif);
+		op = tif->tif_rawdata;
+	}
+	if (sp->enc_oldcode != (hcode_t) -1) {
+		PutNextCode(op, sp->enc_oldcode);
+		sp->enc_oldcode = (hcode_t) -1;
+	}
+	PutNextCode(op, CODE_EOI);
+	if (nextbits > 0) 
+		*op++ = (u_char)(nextdata << (8-nextbits));
+	tif->tif_rawcc = (tsize_t)(op - tif->tif_rawdata);
+	return (1);
+}
+
+/*
+ * Reset encoding hash table.
+ */
+static void
+cl_hash(LZWEncodeState* sp)
+{
+	_TIFFmemset(sp->enc_hashtab, 0, HSIZE*sizeof (hash_t));
+}
+
 static void
 LZWCleanup(TIFF* tif)
 {
@@ -652,7 +1009,12 @@ LZWCleanup(TIFF* tif)
 		if (tif->tif_mode == O_RDONLY) {
 			if (DecoderState(tif)->dec_codetab)
 				_TIFFfree(DecoderState(tif)->dec_codetab);
-		} 
+			if (DecoderState(tif)->dec_hist)
+				_TIFFfree(DecoderState(tif)->dec_hist);
+		} else {
+			if (EncoderState(tif)->enc_hashtab)
+				_TIFFfree(EncoderState(tif)->enc_hashtab);
+		}
 		_TIFFfree(tif->tif_data);
 		tif->tif_data = NULL;
 	}
@@ -665,13 +1027,16 @@ TIFFInitLZW(TIFF* tif, int scheme)
 	/*
 	 * Allocate state block so tag methods have storage to record values.
 	 */
-	tif->tif_data = (tidata_t) _TIFFmalloc(sizeof (LZWDecodeState));
+	tif->tif_data = (tidata_t) _TIFFmalloc(LZWStateSize);
 	if (tif->tif_data == NULL)
-	  goto bad;
+		goto bad;
 	if (tif->tif_mode == O_RDONLY) {
-	  DecoderState(tif)->dec_codetab = NULL;
-	  DecoderState(tif)->dec_decode = NULL;
-	} 
+		DecoderState(tif)->dec_codetab = NULL;
+		DecoderState(tif)->dec_decode = NULL;
+		DecoderState(tif)->dec_hist = NULL;
+		DecoderState(tif)->dec_histsize = 0;
+	} else
+		EncoderState(tif)->enc_hashtab = NULL;
 	/*
 	 * Install codec methods.
 	 */
@@ -680,12 +1045,12 @@ TIFFInitLZW(TIFF* tif, int scheme)
 	tif->tif_decoderow = LZWDecode;
 	tif->tif_decodestrip = LZWDecode;
 	tif->tif_decodetile = LZWDecode;
-	tif->tif_setupencode = _LZWtrue; 
-	tif->tif_preencode = _TIFFNoPreCode;
-	tif->tif_postencode = _LZWtrue;
-	tif->tif_encoderow = _TIFFNoRowEncode; 
-	tif->tif_encodestrip = _TIFFNoStripEncode; 
-	tif->tif_encodetile = _TIFFNoTileEncode; 
+	tif->tif_setupencode = LZWSetupEncode;
+	tif->tif_preencode = LZWPreEncode;
+	tif->tif_postencode = LZWPostEncode;
+	tif->tif_encoderow = LZWEncode;
+	tif->tif_encodestrip = LZWEncode;
+	tif->tif_encodetile = LZWEncode;
 	tif->tif_cleanup = LZWCleanup;
 	/*
 	 * Setup predictor setup.
@@ -697,7 +1062,6 @@ bad:
 	return (0);
 }
 
-
 /*
  * Copyright (c) 1985, 1986 The Regents of the University of California.
  * All rights reserved.
@@ -33,18 +33,20 @@
  */
 #include <assert.h>
 #include <stdio.h>
+#include <stdint.h>
 
 static int
 PackBitsPreEncode(TIFF* tif, tsample_t s)
 {
 	(void) s;
 	/*
-	 * Calculate the scanline/tile-width size in bytes.
+	 * Calculate the scanline/tile-width size in bytes;
+	 * it is kept in tif_data, which PackBits has no other use for.
 	 */
 	if (isTiled(tif))
-		tif->tif_data = (tidata_t) TIFFTileRowSize(tif);
+		tif->tif_data = (tidata_t) (intptr_t) TIFFTileRowSize(tif);
 	else
-		tif->tif_data = (tidata_t) TIFFScanlineSize(tif);
+		tif->tif_data = (tidata_t) (intptr_t) TIFFScanlineSize(tif);
 	return (1);
 }
 
@@ -188,7 +190,7 @@ PackBitsEncode(TIFF* tif, tidata_t buf, tsize_t cc, tsample_t s)
 static int
 PackBitsEncodeChunk(TIFF* tif, tidata_t bp, tsize_t cc, tsample_t s)
 {
-	tsize_t rowsize = (tsize_t) tif->tif_data;
+	tsize_t rowsize = (tsize_t) (intptr_t) tif->tif_data;
 
 	assert(rowsize > 0);
 	while ((long)cc > 0) {
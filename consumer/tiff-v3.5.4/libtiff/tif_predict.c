@@ -31,6 +31,7 @@
  */
 #include "tiffiop.h"
 #include "tif_predict.h"
+#include "tif_simd.h"
 
 #include <assert.h>
 
@@ -41,6 +42,15 @@ static	void horAcc16(TIFF*, tidata_t, tsize_t);
 static	void swabHorAcc16(TIFF*, tidata_t, tsize_t);
 static	void horDiff8(TIFF*, tidata_t, tsize_t);
 static	void horDiff16(TIFF*, tidata_t, tsize_t);
+#ifdef TIFF_SIMD_SUPPORTED
+static	void horAcc8SSE2(TIFF*, tidata_t, tsize_t);
+static	void horAcc16SSE2(TIFF*, tidata_t, tsize_t);
+static	void swabHorAcc16SSE2(TIFF*, tidata_t, tsize_t);
+static	void horDiff8SSE2(TIFF*, tidata_t, tsize_t);
+static	void horDiff16SSE2(TIFF*, tidata_t, tsize_t);
+static	void horDiff8AVX2(TIFF*, tidata_t, tsize_t);
+static	void horDiff16AVX2(TIFF*, tidata_t, tsize_t);
+#endif
 static	int PredictorDecodeRow(TIFF*, tidata_t, tsize_t, tsample_t);
 static	int PredictorDecodeTile(TIFF*, tidata_t, tsize_t, tsample_t);
 static	int PredictorEncodeRow(TIFF*, tidata_t, tsize_t, tsample_t);
@@ -90,6 +100,15 @@ PredictorSetupDecode(TIFF* tif)
 		case 8:  sp->pfunc = horAcc8; break;
 		case 16: sp->pfunc = horAcc16; break;
 		}
+#ifdef TIFF_SIMD_SUPPORTED
+		/*
+		 * The vector prefix sums handle up to 4
+		 * samples/pixel, which covers nearly all images.
+		 */
+		if (sp->stride <= 4 && _TIFFSIMDLevel() >= TIFF_SIMD_SSE2)
+			sp->pfunc = (sp->pfunc == horAcc8 ?
+			    horAcc8SSE2 : horAcc16SSE2);
+#endif
 		/*
 		 * Override default decoding method with
 		 * one that does the predictor stuff.
@@ -113,7 +132,14 @@ PredictorSetupDecode(TIFF* tif)
 			if (sp->pfunc == horAcc16) {
 				sp->pfunc = swabHorAcc16;
 				tif->tif_postdecode = _TIFFNoPostDecode;
-			} /* else handle 32-bit case... */
+			}
+#ifdef TIFF_SIMD_SUPPORTED
+			else if (sp->pfunc == horAcc16SSE2) {
+				sp->pfunc = swabHorAcc16SSE2;
+				tif->tif_postdecode = _TIFFNoPostDecode;
+			}
+#endif
+			/* else handle 32-bit case... */
 		}
 	}
 	return (1);
@@ -132,6 +158,18 @@ PredictorSetupEncode(TIFF* tif)
 		case 8:  sp->pfunc = horDiff8; break;
 		case 16: sp->pfunc = horDiff16; break;
 		}
+#ifdef TIFF_SIMD_SUPPORTED
+		switch (_TIFFSIMDLevel()) {
+		case TIFF_SIMD_AVX2:
+			sp->pfunc = (sp->pfunc == horDiff8 ?
+			    horDiff8AVX2 : horDiff16AVX2);
+			break;
+		case TIFF_SIMD_SSE2:
+			sp->pfunc = (sp->pfunc == horDiff8 ?
+			    horDiff8SSE2 : horDiff16SSE2);
+			break;
+		}
+#endif
 		/*
 		 * Override default encoding method with
 		 * one that does the predictor stuff.
@@ -342,6 +380,194 @@ horDiff16(TIFF* tif, tidata_t cp0, tsize_t cc)
 	}
 }
 
+#ifdef TIFF_SIMD_SUPPORTED
+/*
+ * Vector versions of the predictor routines.
+ *
+ * Accumulation is a prefix sum over the samples of each
+ * channel.  A 16-byte block is summed in place with
+ * log2(16/bpp) shifted adds, where bpp is the number of
+ * bytes per pixel; then the last pixel of the block before,
+ * repeated across the vector, is added in.  Only that last
+ * add depends on the block before, so the blocks overlap
+ * in the processor.  Pixels of 3 and 6 bytes do not divide
+ * the vector; the pattern is made with shifts, since SSE2
+ * has no byte shuffle.
+ */
+#define	ACC_SCAN(x, bpp, add) {					\
+	x = add(x, _mm_slli_si128(x, bpp));			\
+	if (2*(bpp) < 16)					\
+		x = add(x, _mm_slli_si128(x, (2*(bpp))&15));	\
+	if (4*(bpp) < 16)					\
+		x = add(x, _mm_slli_si128(x, (4*(bpp))&15));	\
+	if (8*(bpp) < 16)					\
+		x = add(x, _mm_slli_si128(x, (8*(bpp))&15));	\
+}
+#define	ACC_CARRY(c, x, bpp) {					\
+	switch (bpp) {						\
+	case 1:							\
+		c = _mm_unpackhi_epi8(x, x);			\
+		c = _mm_shufflehi_epi16(c, 0xff);		\
+		c = _mm_unpackhi_epi64(c, c);			\
+		break;						\
+	case 2:							\
+		c = _mm_shufflehi_epi16(x, 0xff);		\
+		c = _mm_unpackhi_epi64(c, c);			\
+		break;						\
+	case 4:							\
+		c = _mm_shuffle_epi32(x, 0xff);			\
+		break;						\
+	case 8:							\
+		c = _mm_unpackhi_epi64(x, x);			\
+		break;						\
+	default:						\
+		c = _mm_srli_si128(x, (16-(bpp))&15);		\
+		c = _mm_or_si128(c, _mm_slli_si128(c, bpp));	\
+		c = _mm_or_si128(c, _mm_slli_si128(c, (2*(bpp))&15)); \
+		if (4*(bpp) < 16)				\
+			c = _mm_or_si128(c,			\
+			    _mm_slli_si128(c, (4*(bpp))&15));	\
+		break;						\
+	}							\
+}
+/*
+ * Accumulate the whole 16-byte blocks of a row with
+ * bpp bytes per pixel; return the number of bytes done.
+ */
+#define	ACC_SSE2(name, bpp, add)				\
+static tsize_t							\
+name(u_char* cp, tsize_t cc)					\
+{								\
+	__m128i x, c = _mm_setzero_si128();			\
+	tsize_t i;						\
+								\
+	for (i = 0; i + 16 <= cc; i += 16) {			\
+		x = _mm_loadu_si128((__m128i*) (cp+i));		\
+		ACC_SCAN(x, bpp, add);				\
+		x = add(x, c);					\
+		_mm_storeu_si128((__m128i*) (cp+i), x);		\
+		ACC_CARRY(c, x, bpp);				\
+	}							\
+	return (i);						\
+}
+ACC_SSE2(acc8x1, 1, _mm_add_epi8)
+ACC_SSE2(acc8x2, 2, _mm_add_epi8)
+ACC_SSE2(acc8x3, 3, _mm_add_epi8)
+ACC_SSE2(acc8x4, 4, _mm_add_epi8)
+ACC_SSE2(acc16x1, 2, _mm_add_epi16)
+ACC_SSE2(acc16x2, 4, _mm_add_epi16)
+ACC_SSE2(acc16x3, 6, _mm_add_epi16)
+ACC_SSE2(acc16x4, 8, _mm_add_epi16)
+
+static void
+horAcc8SSE2(TIFF* tif, tidata_t cp0, tsize_t cc)
+{
+	tsize_t stride = PredictorState(tif)->stride;
+	u_char* cp = (u_char*) cp0;
+	tsize_t i;
+
+	switch (stride) {
+	case 1:  i = acc8x1(cp, cc); break;
+	case 2:  i = acc8x2(cp, cc); break;
+	case 3:  i = acc8x3(cp, cc); break;
+	default: i = acc8x4(cp, cc); break;
+	}
+	for (i = (i > stride ? i : stride); i < cc; i++)
+		cp[i] += cp[i-stride];
+}
+
+static void
+horAcc16SSE2(TIFF* tif, tidata_t cp0, tsize_t cc)
+{
+	tsize_t stride = PredictorState(tif)->stride;
+	uint16* wp = (uint16*) cp0;
+	tsize_t i, wc = cc / 2;
+
+	switch (stride) {
+	case 1:  i = acc16x1(cp0, 2*wc); break;
+	case 2:  i = acc16x2(cp0, 2*wc); break;
+	case 3:  i = acc16x3(cp0, 2*wc); break;
+	default: i = acc16x4(cp0, 2*wc); break;
+	}
+	for (i = (i/2 > stride ? i/2 : stride); i < wc; i++)
+		wp[i] += wp[i-stride];
+}
+
+static void
+swabHorAcc16SSE2(TIFF* tif, tidata_t cp0, tsize_t cc)
+{
+	if (cc / 2 > PredictorState(tif)->stride)
+		TIFFSwabArrayOfShort((uint16*) cp0, cc / 2);
+	horAcc16SSE2(tif, cp0, cc);
+}
+
+/*
+ * Differencing has no carry: each block is its samples
+ * less the same samples one pixel before.  Going from the
+ * end of the row back, these are still the original ones;
+ * the few samples left at the start are done in C.
+ */
+static void
+horDiff8SSE2(TIFF* tif, tidata_t cp0, tsize_t cc)
+{
+	tsize_t stride = PredictorState(tif)->stride;
+	u_char* cp = (u_char*) cp0;
+	tsize_t i;
+
+	for (i = cc; i - 16 >= stride; i -= 16)
+		_mm_storeu_si128((__m128i*) (cp+i-16), _mm_sub_epi8(
+		    _mm_loadu_si128((__m128i*) (cp+i-16)),
+		    _mm_loadu_si128((__m128i*) (cp+i-16-stride))));
+	while (--i >= stride)
+		cp[i] -= cp[i-stride];
+}
+
+static void
+horDiff16SSE2(TIFF* tif, tidata_t cp0, tsize_t cc)
+{
+	tsize_t stride = PredictorState(tif)->stride;
+	uint16* wp = (uint16*) cp0;
+	tsize_t i;
+
+	for (i = cc/2; i - 8 >= stride; i -= 8)
+		_mm_storeu_si128((__m128i*) (wp+i-8), _mm_sub_epi16(
+		    _mm_loadu_si128((__m128i*) (wp+i-8)),
+		    _mm_loadu_si128((__m128i*) (wp+i-8-stride))));
+	while (--i >= stride)
+		wp[i] -= wp[i-stride];
+}
+
+TIFF_AVX2_TARGET static void
+horDiff8AVX2(TIFF* tif, tidata_t cp0, tsize_t cc)
+{
+	tsize_t stride = PredictorState(tif)->stride;
+	u_char* cp = (u_char*) cp0;
+	tsize_t i;
+
+	for (i = cc; i - 32 >= stride; i -= 32)
+		_mm256_storeu_si256((__m256i*) (cp+i-32), _mm256_sub_epi8(
+		    _mm256_loadu_si256((__m256i*) (cp+i-32)),
+		    _mm256_loadu_si256((__m256i*) (cp+i-32-stride))));
+	while (--i >= stride)
+		cp[i] -= cp[i-stride];
+}
+
+TIFF_AVX2_TARGET static void
+horDiff16AVX2(TIFF* tif, tidata_t cp0, tsize_t cc)
+{
+	tsize_t stride = PredictorState(tif)->stride;
+	uint16* wp = (uint16*) cp0;
+	tsize_t i;
+
+	for (i = cc/2; i - 16 >= stride; i -= 16)
+		_mm256_storeu_si256((__m256i*) (wp+i-16), _mm256_sub_epi16(
+		    _mm256_loadu_si256((__m256i*) (wp+i-16)),
+		    _mm256_loadu_si256((__m256i*) (wp+i-16-stride))));
+	while (--i >= stride)
+		wp[i] -= wp[i-stride];
+}
+#endif /* TIFF_SIMD_SUPPORTED */
+
 static int
 PredictorEncodeRow(TIFF* tif, tidata_t bp, tsize_t cc, tsample_t s)
 {
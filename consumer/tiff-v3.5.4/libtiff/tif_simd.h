@@ -0,0 +1,62 @@
+/* $Header$ */
+
+/*
+ * Copyright (c) 1988-1997 Sam Leffler
+ * Copyright (c) 1991-1997 Silicon Graphics, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifndef _TIFFSIMD_
+#define	_TIFFSIMD_
+/*
+ * SIMD Support.
+ *
+ * Some inner loops (the horizontal predictor, the color to
+ * grayscale conversion of tiff2bw) have SSE2 and AVX2 versions
+ * next to the C code they replace; they give exactly the same
+ * results, and the one to use is picked at run time according
+ * to _TIFFSIMDLevel().  The vector code is compiled only by
+ * GCC-compatible compilers for x86-64, where SSE2 is always
+ * there; elsewhere TIFF_SIMD_SUPPORTED is left undefined and
+ * _TIFFSIMDLevel() returns TIFF_SIMD_NONE.
+ */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define	TIFF_SIMD_SUPPORTED
+#endif
+
+#define	TIFF_SIMD_NONE	0		/* C code only */
+#define	TIFF_SIMD_SSE2	1
+#define	TIFF_SIMD_AVX2	2
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+extern	int _TIFFSIMDLevel(void);
+#if defined(__cplusplus)
+}
+#endif
+
+#ifdef TIFF_SIMD_SUPPORTED
+#include <immintrin.h>
+
+#define	TIFF_AVX2_TARGET	__attribute__((target("avx2")))
+#endif
+#endif /* _TIFFSIMD_ */
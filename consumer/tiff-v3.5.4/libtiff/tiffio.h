@@ -167,6 +167,7 @@ struct _TIFFRGBAImage {
 
         int	row_offset;
         int     col_offset;
+	uint16	req_orientation;		/* raster origin: TOPLEFT/BOTLEFT */
 };
 
 /*
@@ -68,6 +68,7 @@ main(int argc, char* argv[])
 	TIFF *out;
 	FILE *in;
 	uint32 w, h;
+	u_long width, height;
 	int prec;
 	char *infile;
 	int c;
@@ -124,8 +125,10 @@ main(int argc, char* argv[])
 	default:
 		BadPPM(infile);
 	}
-	if (fscanf(in, " %ld %ld %d", &w, &h, &prec) != 3)
+	if (fscanf(in, " %lu %lu %d", &width, &height, &prec) != 3)
 		BadPPM(infile);
+	w = (uint32) width;
+	h = (uint32) height;
 	if (getc(in) != '\n' || w <= 0 || h <= 0 || prec != 255)
 		BadPPM(infile);
 
@@ -215,7 +218,6 @@ char* stuff[] = {
 "",
 " -c jpeg[:opts]  compress output with JPEG encoding",
 " -c lzw[:opts]	compress output with Lempel-Ziv & Welch encoding",
-"               (no longer supported due to Unisys patent enforcement)", 
 " -c zip[:opts]	compress output with deflate encoding",
 " -c packbits	compress output with packbits encoding",
 " -c none	use no compression algorithm on output",
@@ -0,0 +1,557 @@
+/* $Header$ */
+
+/*
+ * Copyright (c) 1988-1997 Sam Leffler
+ * Copyright (c) 1991-1997 Silicon Graphics, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Strip pipeline for the conversion tools (see strippipe.h).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "strippipe.h"
+
+#ifndef howmany
+#define	howmany(x, y)	(((x)+((y)-1))/(y))
+#endif
+#define	roundup(x, y)	(howmany(x,y)*((uint32)(y)))
+
+/*
+ * A memory file for the private encoders.  Only the data written since
+ * the last call to memReset is kept, starting at offset ``base''; writes
+ * below it (the header and directory offset) are dropped.
+ */
+typedef struct {
+	tdata_t	data;
+	tsize_t	size;			/* allocated */
+	toff_t	base;			/* file offset of data[0] */
+	toff_t	end;			/* file offset past the last byte */
+	toff_t	off;			/* current file offset */
+} memFile;
+
+static tsize_t
+memRead(thandle_t fd, tdata_t buf, tsize_t size)
+{
+	(void) fd; (void) buf; (void) size;
+	return (0);
+}
+
+static tsize_t
+memWrite(thandle_t fd, tdata_t buf, tsize_t size)
+{
+	memFile* mf = (memFile*) fd;
+	toff_t end = mf->off + size;
+
+	if (mf->off >= mf->base) {
+		if ((tsize_t) (end - mf->base) > mf->size) {
+			tsize_t n = roundup(end - mf->base, 64*1024);
+			tdata_t data = _TIFFrealloc(mf->data, n);
+
+			if (data == NULL)
+				return (0);
+			mf->data = data;
+			mf->size = n;
+		}
+		if (mf->off > mf->end)
+			_TIFFmemset((char*) mf->data + (mf->end - mf->base),
+			    0, mf->off - mf->end);
+		_TIFFmemcpy((char*) mf->data + (mf->off - mf->base),
+		    buf, size);
+	}
+	mf->off = end;
+	if (end > mf->end)
+		mf->end = end;
+	return (size);
+}
+
+static toff_t
+memSeek(thandle_t fd, toff_t off, int whence)
+{
+	memFile* mf = (memFile*) fd;
+
+	switch (whence) {
+	case SEEK_SET:	mf->off = off; break;
+	case SEEK_CUR:	mf->off += off; break;
+	case SEEK_END:	mf->off = mf->end + off; break;
+	}
+	return (mf->off);
+}
+
+static int
+memClose(thandle_t fd)
+{
+	(void) fd;
+	return (0);
+}
+
+static toff_t
+memSize(thandle_t fd)
+{
+	return (((memFile*) fd)->end);
+}
+
+static int
+memMap(thandle_t fd, tdata_t* base, toff_t* size)
+{
+	(void) fd; (void) base; (void) size;
+	return (0);
+}
+
+static void
+memUnmap(thandle_t fd, tdata_t base, toff_t size)
+{
+	(void) fd; (void) base; (void) size;
+}
+
+/*
+ * Start the memory file afresh in the given buffer.
+ */
+static void
+memReset(memFile* mf, tdata_t data, tsize_t size)
+{
+	mf->data = data;
+	mf->size = size;
+	mf->base = mf->end;
+}
+
+/*
+ * A job is a run of consecutive strips, or of whole rows of tiles; its
+ * slot holds them compressed, back to back, until the main thread has
+ * written them out.
+ */
+typedef struct {
+	int	ready;
+	int	ok;
+	uint32	job;
+	tdata_t	data;			/* compressed strips */
+	tsize_t	size;			/* allocated */
+	toff_t*	offset;			/* of each strip in data */
+	tsize_t* count;			/* bytes in each strip */
+} pipeSlot;
+
+typedef struct {
+	TIFF*	in;
+	TIFF*	out;
+	uint32	width;
+	uint32	height;
+	uint32	rowsperstrip;		/* or tile length */
+	uint32	tilewidth;		/* 0 if the output is in strips */
+	uint32	across;			/* tiles across, 1 for strips */
+	uint32	jobrows;
+	uint32	njobs;
+	tsize_t	scanline;		/* of the output */
+	tsize_t	tilesize;
+	tsize_t	pixelsize;		/* bytes in a pixel of the output */
+	stripPipeProc proc;
+	void*	arg;
+
+	pthread_mutex_t lock;
+	pthread_cond_t converted;	/* a slot became ready */
+	pthread_cond_t written;		/* a slot became free */
+	uint32	next;			/* next job to convert */
+	uint32	done;			/* jobs written out */
+	int	abort;
+	uint32	nslots;
+	pipeSlot* slots;
+} stripPipeState;
+
+#define	CopyField(tag, v) \
+    if (TIFFGetField(from, tag, &v)) TIFFSetField(to, tag, v)
+
+/*
+ * Setup a private encoder with the fields of the
+ * output that the codecs look at.
+ */
+static int
+cpEncoder(TIFF* from, TIFF* to)
+{
+	uint32 longv;
+	uint16 shortv;
+
+	CopyField(TIFFTAG_IMAGEWIDTH, longv);
+	CopyField(TIFFTAG_IMAGELENGTH, longv);
+	CopyField(TIFFTAG_BITSPERSAMPLE, shortv);
+	CopyField(TIFFTAG_SAMPLESPERPIXEL, shortv);
+	CopyField(TIFFTAG_PLANARCONFIG, shortv);
+	CopyField(TIFFTAG_PHOTOMETRIC, shortv);
+	CopyField(TIFFTAG_FILLORDER, shortv);
+	if (TIFFIsTiled(from)) {
+		CopyField(TIFFTAG_TILEWIDTH, longv);
+		CopyField(TIFFTAG_TILELENGTH, longv);
+	} else
+		CopyField(TIFFTAG_ROWSPERSTRIP, longv);
+	CopyField(TIFFTAG_COMPRESSION, shortv);
+	switch (shortv) {
+	case COMPRESSION_LZW:
+	case COMPRESSION_DEFLATE:
+		CopyField(TIFFTAG_PREDICTOR, shortv);
+		break;
+	}
+	return (1);
+}
+#undef CopyField
+
+/*
+ * Return 1 if the strips or tiles of ``out'' can be compressed
+ * by private encoders: its codec must not keep state that ends
+ * up in the directory (as JPEG tables do) or need fields that
+ * cpEncoder does not know about.  Tiles are cut out of the
+ * converted rows, so their pixels must be whole bytes.
+ */
+int
+stripPipeOK(TIFF* out)
+{
+	uint16 compression, config, bitspersample;
+
+	if (TIFFIsByteSwapped(out))
+		return (0);
+	TIFFGetFieldDefaulted(out, TIFFTAG_PLANARCONFIG, &config);
+	if (config != PLANARCONFIG_CONTIG)
+		return (0);
+	TIFFGetFieldDefaulted(out, TIFFTAG_BITSPERSAMPLE, &bitspersample);
+	if (TIFFIsTiled(out) && bitspersample % 8 != 0)
+		return (0);
+	TIFFGetFieldDefaulted(out, TIFFTAG_COMPRESSION, &compression);
+	switch (compression) {
+	case COMPRESSION_NONE:
+	case COMPRESSION_PACKBITS:
+	case COMPRESSION_LZW:
+	case COMPRESSION_DEFLATE:
+		return (1);
+	}
+	return (0);
+}
+
+/*
+ * Return the rows of the output strips, or
+ * the length of its tiles.
+ */
+static uint32
+blockRows(TIFF* out)
+{
+	uint32 rows;
+
+	if (TIFFIsTiled(out))
+		TIFFGetField(out, TIFFTAG_TILELENGTH, &rows);
+	else
+		TIFFGetFieldDefaulted(out, TIFFTAG_ROWSPERSTRIP, &rows);
+	return (rows);
+}
+
+/*
+ * Return the rows in a job: a run of whole output strips
+ * (or rows of tiles) that, if it is not too long, also
+ * starts and ends on strips of the input, so that no input
+ * strip needs to be decoded by two jobs; otherwise as few
+ * output strips as cover an input strip.
+ */
+uint32
+stripPipeRows(uint32 inrows, TIFF* out)
+{
+	uint32 height, rowsperstrip, rows;
+
+	TIFFGetField(out, TIFFTAG_IMAGELENGTH, &height);
+	rowsperstrip = blockRows(out);
+	if (rowsperstrip > height)
+		rowsperstrip = height;
+	if (inrows > height)
+		inrows = height;
+	if (inrows == 0 || rowsperstrip == 0)
+		return (1);
+	rows = roundup(inrows > rowsperstrip ? inrows : rowsperstrip,
+	    rowsperstrip);
+	while (rows % inrows != 0 && rows < 8 * (inrows + rowsperstrip))
+		rows += rowsperstrip;
+	if (rows % inrows != 0)
+		rows = roundup(inrows > rowsperstrip ? inrows : rowsperstrip,
+		    rowsperstrip);
+	return (rows);
+}
+
+/*
+ * Compress the tiles of rows [row, row+n) of the image, held as
+ * scanlines in buf; the parts of the tiles off the image are zero.
+ */
+static int
+pipeTiles(stripPipeState* sp, TIFF* enc, uint32 row, uint32 n,
+    tdata_t buf, tdata_t tilebuf)
+{
+	tsize_t tilerow = sp->tilewidth * sp->pixelsize;
+	tsize_t cc;
+	uint32 col, i;
+
+	for (col = 0; col < sp->width; col += sp->tilewidth) {
+		cc = (sp->width - col < sp->tilewidth ?
+		    sp->width - col : sp->tilewidth) * sp->pixelsize;
+		_TIFFmemset(tilebuf, 0, sp->tilesize);
+		for (i = 0; i < n; i++)
+			_TIFFmemcpy((char*) tilebuf + i * tilerow,
+			    (char*) buf + i * sp->scanline +
+			    col * sp->pixelsize, cc);
+		if (TIFFWriteEncodedTile(enc, TIFFComputeTile(enc, col, row,
+		    0, 0), tilebuf, sp->tilesize) != sp->tilesize)
+			return (0);
+	}
+	return (1);
+}
+
+/*
+ * Convert and compress one job into its slot.
+ */
+static int
+pipeJob(stripPipeState* sp, TIFF* in, TIFF* enc, memFile* mf,
+    tdata_t buf, tdata_t tilebuf, pipeSlot* slot)
+{
+	uint32 row = slot->job * sp->jobrows;
+	uint32 nrows = sp->jobrows;
+	tstrip_t strip = row / sp->rowsperstrip * sp->across;
+	uint32* offsets;
+	uint32* counts;
+	uint32 r, n;
+	int i;
+
+	if (row + nrows > sp->height)
+		nrows = sp->height - row;
+	if (!(*sp->proc)(in, row, nrows, buf, sp->arg))
+		return (0);
+	memReset(mf, slot->data, slot->size);
+	for (r = 0; r < nrows; r += sp->rowsperstrip, strip++) {
+		n = nrows - r < sp->rowsperstrip ? nrows - r : sp->rowsperstrip;
+		if (sp->tilewidth != 0) {
+			if (!pipeTiles(sp, enc, row + r, n,
+			    (char*) buf + r * sp->scanline, tilebuf))
+				break;
+		} else if (TIFFWriteEncodedStrip(enc, strip,
+		    (char*) buf + r * sp->scanline, n * sp->scanline) !=
+		    n * sp->scanline)
+			break;
+	}
+	slot->data = mf->data;
+	slot->size = mf->size;
+	mf->data = NULL;
+	mf->size = 0;
+	if (r < nrows)
+		return (0);
+	/* NB: TIFFTAG_STRIPOFFSETS returns the tile offsets too */
+	TIFFGetField(enc, TIFFTAG_STRIPOFFSETS, &offsets);
+	TIFFGetField(enc, TIFFTAG_STRIPBYTECOUNTS, &counts);
+	strip = row / sp->rowsperstrip * sp->across;
+	for (i = 0; i < howmany(nrows, sp->rowsperstrip) * sp->across;
+	    i++, strip++) {
+		slot->offset[i] = offsets[strip] - mf->base;
+		slot->count[i] = counts[strip];
+	}
+	return (1);
+}
+
+static void*
+pipeWorker(void* arg)
+{
+	stripPipeState* sp = (stripPipeState*) arg;
+	memFile mf;
+	TIFF *in = NULL, *enc = NULL;
+	tdata_t buf, tilebuf = NULL;
+	pipeSlot* slot;
+	int ok = 0;
+
+	_TIFFmemset(&mf, 0, sizeof (mf));
+	buf = _TIFFmalloc(sp->jobrows * sp->scanline);
+	if (sp->tilewidth != 0 &&
+	    (tilebuf = _TIFFmalloc(sp->tilesize)) == NULL) {
+		_TIFFfree(buf);
+		buf = NULL;
+	}
+	if (buf != NULL &&
+	    (in = TIFFOpen(TIFFFileName(sp->in), "r")) != NULL &&
+	    TIFFSetDirectory(in, TIFFCurrentDirectory(sp->in)) &&
+	    (enc = TIFFClientOpen(TIFFFileName(sp->out), "w", (thandle_t) &mf,
+	    memRead, memWrite, memSeek, memClose, memSize,
+	    memMap, memUnmap)) != NULL)
+		ok = cpEncoder(sp->out, enc);
+	if (!ok)
+		TIFFError(TIFFFileName(sp->in), "Cannot start pipeline thread");
+
+	pthread_mutex_lock(&sp->lock);
+	if (!ok)
+		sp->abort = 1;
+	while (!sp->abort && sp->next < sp->njobs) {
+		if (sp->next >= sp->done + sp->nslots) {
+			pthread_cond_wait(&sp->written, &sp->lock);
+			continue;
+		}
+		slot = &sp->slots[sp->next % sp->nslots];
+		slot->job = sp->next++;
+		pthread_mutex_unlock(&sp->lock);
+
+		ok = pipeJob(sp, in, enc, &mf, buf, tilebuf, slot);
+
+		pthread_mutex_lock(&sp->lock);
+		slot->ok = ok;
+		slot->ready = 1;
+		pthread_cond_broadcast(&sp->converted);
+	}
+	pthread_mutex_unlock(&sp->lock);
+
+	if (enc != NULL)
+		TIFFClose(enc);
+	if (mf.data != NULL)
+		_TIFFfree(mf.data);
+	if (in != NULL)
+		TIFFClose(in);
+	if (buf != NULL)
+		_TIFFfree(buf);
+	if (tilebuf != NULL)
+		_TIFFfree(tilebuf);
+	return (NULL);
+}
+
+/*
+ * Convert and write the whole image on nthreads threads.
+ * jobrows should be a multiple of the rows per strip (or
+ * tile length) of the output (see stripPipeRows).  Returns
+ * 1 on success.
+ */
+int
+stripPipe(TIFF* in, TIFF* out, uint32 jobrows, int nthreads,
+    stripPipeProc proc, void* arg)
+{
+	stripPipeState sp;
+	pthread_t* threads;
+	pipeSlot* slot;
+	uint32 job, nstrips;
+	tstrip_t strip;
+	int i, n, started, ok = 1;
+
+	_TIFFmemset(&sp, 0, sizeof (sp));
+	sp.in = in;
+	sp.out = out;
+	sp.proc = proc;
+	sp.arg = arg;
+	TIFFGetField(out, TIFFTAG_IMAGEWIDTH, &sp.width);
+	TIFFGetField(out, TIFFTAG_IMAGELENGTH, &sp.height);
+	sp.rowsperstrip = blockRows(out);
+	sp.across = 1;
+	if (TIFFIsTiled(out)) {
+		TIFFGetField(out, TIFFTAG_TILEWIDTH, &sp.tilewidth);
+		sp.across = howmany(sp.width, sp.tilewidth);
+		sp.tilesize = TIFFTileSize(out);
+		sp.pixelsize = TIFFTileRowSize(out) / sp.tilewidth;
+	} else if (sp.rowsperstrip > sp.height)
+		sp.rowsperstrip = sp.height;
+	if (sp.height == 0)
+		return (1);
+	if (jobrows > sp.height)
+		jobrows = sp.height;
+	sp.jobrows = roundup(jobrows, sp.rowsperstrip);
+	sp.njobs = howmany(sp.height, sp.jobrows);
+	sp.scanline = TIFFScanlineSize(out);
+	nstrips = sp.jobrows / sp.rowsperstrip * sp.across;
+
+	sp.nslots = 2 * nthreads;
+	sp.slots = (pipeSlot*) _TIFFmalloc(sp.nslots * sizeof (pipeSlot));
+	threads = (pthread_t*) _TIFFmalloc(nthreads * sizeof (pthread_t));
+	if (sp.slots == NULL || threads == NULL) {
+		TIFFError(TIFFFileName(in), "No space for pipeline");
+		return (0);
+	}
+	_TIFFmemset(sp.slots, 0, sp.nslots * sizeof (pipeSlot));
+	for (i = 0; i < sp.nslots; i++) {
+		sp.slots[i].offset =
+		    (toff_t*) _TIFFmalloc(nstrips * sizeof (toff_t));
+		sp.slots[i].count =
+		    (tsize_t*) _TIFFmalloc(nstrips * sizeof (tsize_t));
+		if (sp.slots[i].offset == NULL || sp.slots[i].count == NULL)
+			ok = 0;
+	}
+	pthread_mutex_init(&sp.lock, NULL);
+	pthread_cond_init(&sp.converted, NULL);
+	pthread_cond_init(&sp.written, NULL);
+
+	for (started = 0; ok && started < nthreads; started++)
+		if (pthread_create(&threads[started], NULL,
+		    pipeWorker, &sp) != 0)
+			break;
+	if (started == 0) {
+		TIFFError(TIFFFileName(in), "Cannot start pipeline");
+		ok = 0;
+	}
+
+	/*
+	 * Write the jobs out in order as they come in.
+	 */
+	for (job = 0; ok && job < sp.njobs; job++) {
+		slot = &sp.slots[job % sp.nslots];
+		pthread_mutex_lock(&sp.lock);
+		while (!(slot->ready && slot->job == job) && !sp.abort)
+			pthread_cond_wait(&sp.converted, &sp.lock);
+		pthread_mutex_unlock(&sp.lock);
+		if (!slot->ready || !slot->ok) {
+			ok = 0;
+			break;
+		}
+		strip = job * nstrips;
+		n = howmany(job == sp.njobs-1 ?
+		    sp.height - job * sp.jobrows : sp.jobrows,
+		    sp.rowsperstrip) * sp.across;
+		for (i = 0; i < n; i++, strip++)
+			if (slot->count[i] > 0 && (sp.tilewidth != 0 ?
+			    TIFFWriteRawTile(out, strip,
+			    (char*) slot->data + slot->offset[i],
+			    slot->count[i]) : TIFFWriteRawStrip(out, strip,
+			    (char*) slot->data + slot->offset[i],
+			    slot->count[i])) == -1) {
+				ok = 0;
+				break;
+			}
+		pthread_mutex_lock(&sp.lock);
+		slot->ready = 0;
+		sp.done++;
+		pthread_cond_broadcast(&sp.written);
+		pthread_mutex_unlock(&sp.lock);
+	}
+
+	pthread_mutex_lock(&sp.lock);
+	sp.abort = 1;
+	pthread_cond_broadcast(&sp.written);
+	pthread_mutex_unlock(&sp.lock);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_cond_destroy(&sp.written);
+	pthread_cond_destroy(&sp.converted);
+	pthread_mutex_destroy(&sp.lock);
+	for (i = 0; i < sp.nslots; i++) {
+		if (sp.slots[i].data != NULL)
+			_TIFFfree(sp.slots[i].data);
+		if (sp.slots[i].offset != NULL)
+			_TIFFfree(sp.slots[i].offset);
+		if (sp.slots[i].count != NULL)
+			_TIFFfree(sp.slots[i].count);
+	}
+	_TIFFfree(sp.slots);
+	_TIFFfree(threads);
+	return (ok);
+}
@@ -0,0 +1,56 @@
+/* $Header$ */
+
+/*
+ * Copyright (c) 1988-1997 Sam Leffler
+ * Copyright (c) 1991-1997 Silicon Graphics, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#ifndef _STRIPPIPE_
+#define	_STRIPPIPE_
+/*
+ * Strip pipeline for the conversion tools.
+ *
+ * The output image is cut into jobs of whole strips, or whole rows of
+ * tiles, which a pool of threads reads, converts and compresses at the
+ * same time; the strips or tiles are then written in order with
+ * TIFFWriteRawStrip or TIFFWriteRawTile, so the file is laid out just as
+ * if they had been written one after the other.  libtiff keeps all
+ * of its codec state in the TIFF handle, so every thread reads from a
+ * handle of its own on the input file and compresses with a private handle
+ * on a memory file set up like the output; the library itself is not
+ * made thread-aware.
+ */
+#include "tiffio.h"
+
+/*
+ * Convert rows [row, row+nrows) of the image into buf, laid out as
+ * scanlines of the output image.  ``in'' is the calling thread's own
+ * handle on the input, set to the same directory.  Returns 1 on success.
+ */
+typedef	int (*stripPipeProc)(TIFF* in, uint32 row, uint32 nrows,
+	    tdata_t buf, void* arg);
+
+extern	int stripPipeOK(TIFF* out);
+extern	uint32 stripPipeRows(uint32 inrows, TIFF* out);
+extern	int stripPipe(TIFF* in, TIFF* out, uint32 jobrows, int nthreads,
+	    stripPipeProc proc, void* arg);
+#endif /* _STRIPPIPE_ */
@@ -29,6 +29,8 @@
 #include <string.h>
 #include <ctype.h>
 #include "tiffio.h"
+#include "tif_simd.h"
+#include "strippipe.h"
 
 #define	streq(a,b)	(strcmp((a),(b)) == 0)
 #define	strneq(a,b,n)	(strncmp(a,b,n) == 0)
@@ -42,11 +44,132 @@ int	BLUE = PCT(11);		/* 11% */
 static	void usage(void);
 static	int processCompressOptions(char*);
 
+static	int simdlevel = TIFF_SIMD_NONE;
+
+#ifdef TIFF_SIMD_SUPPORTED
+/*
+ * Vector versions of the conversions, 16 pixels at a time.
+ * The weighted sum is done in 16-bit lanes: its bits 8-15,
+ * which are all that is kept, come out the same as with the
+ * int arithmetic of the C loops for any -R/-G/-B weights.
+ * Each returns the number of pixels done; the C loops
+ * finish the row.
+ */
+#define	Z	(-1)			/* shuffle index for a zero byte */
+#define	GRAY16(r, g, b, wr, wg, wb, add, mul) \
+	add(add(mul(r, wr), mul(g, wg)), mul(b, wb))
+
+TIFF_AVX2_TARGET static uint32
+compresscontigAVX2(unsigned char* out, unsigned char* rgb, uint32 n)
+{
+	__m256i wr = _mm256_set1_epi16((short) RED);
+	__m256i wg = _mm256_set1_epi16((short) GREEN);
+	__m256i wb = _mm256_set1_epi16((short) BLUE);
+	__m128i in0, in1, in2, r, g, b;
+	__m256i v;
+	uint32 i;
+
+	for (i = 0; i + 16 <= n; i += 16, rgb += 48) {
+		in0 = _mm_loadu_si128((__m128i*) rgb);
+		in1 = _mm_loadu_si128((__m128i*) (rgb+16));
+		in2 = _mm_loadu_si128((__m128i*) (rgb+32));
+		r = _mm_or_si128(_mm_or_si128(
+		    _mm_shuffle_epi8(in0, _mm_setr_epi8(0, 3, 6, 9, 12, 15,
+			Z, Z, Z, Z, Z, Z, Z, Z, Z, Z)),
+		    _mm_shuffle_epi8(in1, _mm_setr_epi8(Z, Z, Z, Z, Z, Z,
+			2, 5, 8, 11, 14, Z, Z, Z, Z, Z))),
+		    _mm_shuffle_epi8(in2, _mm_setr_epi8(Z, Z, Z, Z, Z, Z,
+			Z, Z, Z, Z, Z, 1, 4, 7, 10, 13)));
+		g = _mm_or_si128(_mm_or_si128(
+		    _mm_shuffle_epi8(in0, _mm_setr_epi8(1, 4, 7, 10, 13,
+			Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z)),
+		    _mm_shuffle_epi8(in1, _mm_setr_epi8(Z, Z, Z, Z, Z,
+			0, 3, 6, 9, 12, 15, Z, Z, Z, Z, Z))),
+		    _mm_shuffle_epi8(in2, _mm_setr_epi8(Z, Z, Z, Z, Z, Z,
+			Z, Z, Z, Z, Z, 2, 5, 8, 11, 14)));
+		b = _mm_or_si128(_mm_or_si128(
+		    _mm_shuffle_epi8(in0, _mm_setr_epi8(2, 5, 8, 11, 14,
+			Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z)),
+		    _mm_shuffle_epi8(in1, _mm_setr_epi8(Z, Z, Z, Z, Z,
+			1, 4, 7, 10, 13, Z, Z, Z, Z, Z, Z))),
+		    _mm_shuffle_epi8(in2, _mm_setr_epi8(Z, Z, Z, Z, Z, Z,
+			Z, Z, Z, Z, 0, 3, 6, 9, 12, 15)));
+		v = GRAY16(_mm256_cvtepu8_epi16(r), _mm256_cvtepu8_epi16(g),
+		    _mm256_cvtepu8_epi16(b), wr, wg, wb,
+		    _mm256_add_epi16, _mm256_mullo_epi16);
+		v = _mm256_srli_epi16(v, 8);
+		_mm_storeu_si128((__m128i*) (out+i),
+		    _mm_packus_epi16(_mm256_castsi256_si128(v),
+		    _mm256_extracti128_si256(v, 1)));
+	}
+	return (i);
+}
+
+static uint32
+compresssepSSE2(unsigned char* out,
+    unsigned char* r, unsigned char* g, unsigned char* b, uint32 n)
+{
+	__m128i wr = _mm_set1_epi16((short) RED);
+	__m128i wg = _mm_set1_epi16((short) GREEN);
+	__m128i wb = _mm_set1_epi16((short) BLUE);
+	__m128i zero = _mm_setzero_si128();
+	__m128i vr, vg, vb, lo, hi;
+	uint32 i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		vr = _mm_loadu_si128((__m128i*) (r+i));
+		vg = _mm_loadu_si128((__m128i*) (g+i));
+		vb = _mm_loadu_si128((__m128i*) (b+i));
+		lo = GRAY16(_mm_unpacklo_epi8(vr, zero),
+		    _mm_unpacklo_epi8(vg, zero), _mm_unpacklo_epi8(vb, zero),
+		    wr, wg, wb, _mm_add_epi16, _mm_mullo_epi16);
+		hi = GRAY16(_mm_unpackhi_epi8(vr, zero),
+		    _mm_unpackhi_epi8(vg, zero), _mm_unpackhi_epi8(vb, zero),
+		    wr, wg, wb, _mm_add_epi16, _mm_mullo_epi16);
+		_mm_storeu_si128((__m128i*) (out+i), _mm_packus_epi16(
+		    _mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+	}
+	return (i);
+}
+
+TIFF_AVX2_TARGET static uint32
+compresssepAVX2(unsigned char* out,
+    unsigned char* r, unsigned char* g, unsigned char* b, uint32 n)
+{
+	__m256i wr = _mm256_set1_epi16((short) RED);
+	__m256i wg = _mm256_set1_epi16((short) GREEN);
+	__m256i wb = _mm256_set1_epi16((short) BLUE);
+	__m256i v;
+	uint32 i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		v = GRAY16(
+		    _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*) (r+i))),
+		    _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*) (g+i))),
+		    _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*) (b+i))),
+		    wr, wg, wb, _mm256_add_epi16, _mm256_mullo_epi16);
+		v = _mm256_srli_epi16(v, 8);
+		_mm_storeu_si128((__m128i*) (out+i),
+		    _mm_packus_epi16(_mm256_castsi256_si128(v),
+		    _mm256_extracti128_si256(v, 1)));
+	}
+	return (i);
+}
+#undef GRAY16
+#undef Z
+#endif /* TIFF_SIMD_SUPPORTED */
+
 static void
 compresscontig(unsigned char* out, unsigned char* rgb, uint32 n)
 {
 	register int v, red = RED, green = GREEN, blue = BLUE;
 
+#ifdef TIFF_SIMD_SUPPORTED
+	if (simdlevel >= TIFF_SIMD_AVX2) {
+		uint32 i = compresscontigAVX2(out, rgb, n);
+		out += i, rgb += 3*i, n -= i;
+	}
+#endif
 	while (n-- > 0) {
 		v = red*(*rgb++);
 		v += green*(*rgb++);
@@ -61,6 +184,14 @@ compresssep(unsigned char* out,
 {
 	register uint32 red = RED, green = GREEN, blue = BLUE;
 
+#ifdef TIFF_SIMD_SUPPORTED
+	if (simdlevel != TIFF_SIMD_NONE) {
+		uint32 i = (simdlevel >= TIFF_SIMD_AVX2 ?
+		    compresssepAVX2(out, r, g, b, n) :
+		    compresssepSSE2(out, r, g, b, n));
+		out += i, r += i, g += i, b += i, n -= i;
+	}
+#endif
 	while (n-- > 0)
 		*out++ = (red*(*r++) + green*(*g++) + blue*(*b++)) >> 8;
 }
@@ -75,24 +206,129 @@ checkcmap(TIFF* tif, int n, uint16* r, uint16* g, uint16* b)
 	return (8);
 }
 
+/*
+ * Palette images go through a table of the gray
+ * level of each colormap entry, made once up front.
+ */
 static void
-compresspalette(unsigned char* out, unsigned char* data, uint32 n, uint16* rmap, uint16* gmap, uint16* bmap)
+graypalette(unsigned char* gray, int n, uint16* rmap, uint16* gmap, uint16* bmap)
 {
 	register int v, red = RED, green = GREEN, blue = BLUE;
+	int ix;
 
-	while (n-- > 0) {
-		unsigned int ix = *data++;
+	for (ix = 0; ix < n; ix++) {
 		v = red*rmap[ix];
 		v += green*gmap[ix];
 		v += blue*bmap[ix];
-		*out++ = v>>8;
+		gray[ix] = v>>8;
 	}
 }
 
+static void
+compresspalette(unsigned char* out, unsigned char* data, uint32 n, unsigned char* gray)
+{
+	while (n-- > 0)
+		*out++ = gray[*data++];
+}
+
 static	uint16 compression = (uint16) -1;
 static	uint16 predictor = 0;
 static	int jpegcolormode = JPEGCOLORMODE_RGB;
 static	int quality = 75;		/* JPEG quality */
+static	int nthreads = 1;		/* -j: strip pipeline threads */
+
+/*
+ * Strip pipeline converters: each reads its rows
+ * through the thread's own handle on the input.
+ */
+typedef struct {
+	uint32	w;
+	unsigned char* gray;		/* palette gray levels */
+} cvtArg;
+
+/*
+ * Most codecs can only read a strip from its start, so
+ * decode the rows of the strip that come before ``row''.
+ */
+static int
+skiprows(TIFF* in, unsigned char* buf, uint32 row, tsample_t s)
+{
+	uint32 rowsperstrip, r;
+
+	TIFFGetFieldDefaulted(in, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);
+	for (r = row - row % rowsperstrip; r < row; r++)
+		if (TIFFReadScanline(in, buf, r, s) < 0)
+			return (0);
+	return (1);
+}
+
+static int
+cvtpalette(TIFF* in, uint32 row, uint32 nrows, tdata_t buf, void* arg)
+{
+	cvtArg* ca = (cvtArg*) arg;
+	unsigned char *inbuf, *outbuf = (unsigned char*) buf;
+	int ok = 1;
+
+	inbuf = (unsigned char *)_TIFFmalloc(TIFFScanlineSize(in));
+	if (inbuf == NULL)
+		return (0);
+	ok = skiprows(in, inbuf, row, 0);
+	for (; ok && nrows-- > 0; row++, outbuf += ca->w) {
+		if (TIFFReadScanline(in, inbuf, row, 0) < 0)
+			ok = 0;
+		else
+			compresspalette(outbuf, inbuf, ca->w, ca->gray);
+	}
+	_TIFFfree(inbuf);
+	return (ok);
+}
+
+static int
+cvtcontig(TIFF* in, uint32 row, uint32 nrows, tdata_t buf, void* arg)
+{
+	cvtArg* ca = (cvtArg*) arg;
+	unsigned char *inbuf, *outbuf = (unsigned char*) buf;
+	int ok = 1;
+
+	inbuf = (unsigned char *)_TIFFmalloc(TIFFScanlineSize(in));
+	if (inbuf == NULL)
+		return (0);
+	ok = skiprows(in, inbuf, row, 0);
+	for (; ok && nrows-- > 0; row++, outbuf += ca->w) {
+		if (TIFFReadScanline(in, inbuf, row, 0) < 0)
+			ok = 0;
+		else
+			compresscontig(outbuf, inbuf, ca->w);
+	}
+	_TIFFfree(inbuf);
+	return (ok);
+}
+
+static int
+cvtsep(TIFF* in, uint32 row, uint32 nrows, tdata_t buf, void* arg)
+{
+	cvtArg* ca = (cvtArg*) arg;
+	unsigned char *inbuf, *outbuf = (unsigned char*) buf;
+	tsize_t rowsize = TIFFScanlineSize(in);
+	tsample_t s;
+	int ok = 1;
+
+	inbuf = (unsigned char *)_TIFFmalloc(3*rowsize);
+	if (inbuf == NULL)
+		return (0);
+	for (s = 0; ok && s < 3; s++)
+		ok = skiprows(in, inbuf, row, s);
+	for (; ok && nrows-- > 0; row++, outbuf += ca->w) {
+		for (s = 0; ok && s < 3; s++)
+			if (TIFFReadScanline(in, inbuf+s*rowsize, row, s) < 0)
+				ok = 0;
+		if (ok)
+			compresssep(outbuf,
+			    inbuf, inbuf+rowsize, inbuf+2*rowsize, ca->w);
+	}
+	_TIFFfree(inbuf);
+	return (ok);
+}
 
 static	void cpTags(TIFF* in, TIFF* out);
 
@@ -109,6 +345,9 @@ main(int argc, char* argv[])
 	uint16* red;
 	uint16* green;
 	uint16* blue;
+	unsigned char gray[256];
+	uint32 inrows;
+	cvtArg ca;
 	tsize_t rowsize;
 	register uint32 row;
 	register tsample_t s;
@@ -118,12 +357,17 @@ main(int argc, char* argv[])
 	extern int optind;
 	extern char *optarg;
 
-	while ((c = getopt(argc, argv, "c:r:R:G:B:")) != -1)
+	while ((c = getopt(argc, argv, "c:j:r:R:G:B:")) != -1)
 		switch (c) {
 		case 'c':		/* compression scheme */
 			if (!processCompressOptions(optarg))
 				usage();
 			break;
+		case 'j':		/* pipeline threads */
+			nthreads = atoi(optarg);
+			if (nthreads < 1)
+				usage();
+			break;
 		case 'r':		/* rows/strip */
 			rowsperstrip = atoi(optarg);
 			break;
@@ -197,6 +441,15 @@ main(int argc, char* argv[])
 	outbuf = (unsigned char *)_TIFFmalloc(TIFFScanlineSize(out));
 	TIFFSetField(out, TIFFTAG_ROWSPERSTRIP,
 	    TIFFDefaultStripSize(out, rowsperstrip));
+	if (nthreads > 1 && !stripPipeOK(out)) {
+		fprintf(stderr,
+		    "%s: Compression scheme needs a single thread.\n",
+		    argv[optind+1]);
+		nthreads = 1;
+	}
+	TIFFGetFieldDefaulted(in, TIFFTAG_ROWSPERSTRIP, &inrows);
+	ca.w = w;
+	simdlevel = _TIFFSIMDLevel();
 
 #define	pack(a,b)	((a)<<8 | (b))
 	switch (pack(photometric, config)) {
@@ -217,16 +470,30 @@ main(int argc, char* argv[])
 			}
 #undef CVT
 		}
+		graypalette(gray, 1<<bitspersample, red, green, blue);
+		if (nthreads > 1) {
+			ca.gray = gray;
+			if (!stripPipe(in, out, stripPipeRows(inrows, out),
+			    nthreads, cvtpalette, &ca))
+				return (-1);
+			break;
+		}
 		inbuf = (unsigned char *)_TIFFmalloc(TIFFScanlineSize(in));
 		for (row = 0; row < h; row++) {
 			if (TIFFReadScanline(in, inbuf, row, 0) < 0)
 				break;
-			compresspalette(outbuf, inbuf, w, red, green, blue);
+			compresspalette(outbuf, inbuf, w, gray);
 			if (TIFFWriteScanline(out, outbuf, row, 0) < 0)
 				break;
 		}
 		break;
 	case pack(PHOTOMETRIC_RGB, PLANARCONFIG_CONTIG):
+		if (nthreads > 1) {
+			if (!stripPipe(in, out, stripPipeRows(inrows, out),
+			    nthreads, cvtcontig, &ca))
+				return (-1);
+			break;
+		}
 		inbuf = (unsigned char *)_TIFFmalloc(TIFFScanlineSize(in));
 		for (row = 0; row < h; row++) {
 			if (TIFFReadScanline(in, inbuf, row, 0) < 0)
@@ -237,6 +504,12 @@ main(int argc, char* argv[])
 		}
 		break;
 	case pack(PHOTOMETRIC_RGB, PLANARCONFIG_SEPARATE):
+		if (nthreads > 1) {
+			if (!stripPipe(in, out, stripPipeRows(inrows, out),
+			    nthreads, cvtsep, &ca))
+				return (-1);
+			break;
+		}
 		rowsize = TIFFScanlineSize(in);
 		inbuf = (unsigned char *)_TIFFmalloc(3*rowsize);
 		for (row = 0; row < h; row++) {
@@ -373,9 +646,9 @@ char* stuff[] = {
 " -B %		use #% from blue channel",
 "",
 " -r #		make each strip have no more than # rows",
+" -j #		read, convert and compress strips on # threads",
 "",
 " -c lzw[:opts]	compress output with Lempel-Ziv & Welch encoding",
-"               (no longer supported due to Unisys patent enforcement)", 
 " -c zip[:opts]	compress output with deflate encoding",
 " -c packbits	compress output with packbits encoding",
 " -c g3[:opts]	compress output with CCITT Group 3 encoding",
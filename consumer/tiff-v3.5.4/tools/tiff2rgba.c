@@ -29,6 +29,7 @@
 #include <stdlib.h>
 
 #include "tiffio.h"
+#include "strippipe.h"
 
 #define	streq(a,b)	(strcmp(a,b) == 0)
 #define	CopyField(tag, v) \
@@ -42,6 +43,7 @@
 uint16	compression = COMPRESSION_PACKBITS;
 uint32	rowsperstrip = (uint32) -1;
 int	process_by_block = 0; /* default is whole image at once */
+int	nthreads = 1;	/* threads of the strip pipeline, see -j */
 
 
 static	int tiffcvt(TIFF* in, TIFF* out);
@@ -55,7 +57,7 @@ main(int argc, char* argv[])
     extern int optind;
     extern char *optarg;
 
-    while ((c = getopt(argc, argv, "c:r:t:b")) != -1)
+    while ((c = getopt(argc, argv, "c:j:r:t:b")) != -1)
         switch (c) {
           case 'b':
             process_by_block = 1;
@@ -74,6 +76,12 @@ main(int argc, char* argv[])
                 usage();
             break;
 
+          case 'j':
+            nthreads = atoi(optarg);
+            if (nthreads < 1)
+                usage();
+            break;
+
           case 'r':
             rowsperstrip = atoi(optarg);
             break;
@@ -111,28 +119,168 @@ main(int argc, char* argv[])
     return (0);
 }
 
+/*
+ * Largest RGBA raster that a source block (a strip or a row of tiles) may
+ * need before it is converted a share at a time instead: the memory used
+ * then depends on the width of the image, but never on its length.
+ */
+#define	MAX_BLOCK_RASTER	(16*1024*1024)
+
+/*
+ * Rows in each block the RGBA interface reads from the source: a strip
+ * or a row of tiles.  TIFFRGBAImageGet() can start on any row, but a
+ * request that starts or ends inside a block decodes part of it twice.
+ */
+
+static uint32
+block_height( TIFF *in )
+
+{
+    uint32  block = (uint32) -1;
+    uint32  height;
+
+    if( TIFFIsTiled( in ) )
+        TIFFGetField(in, TIFFTAG_TILELENGTH, &block);
+    else
+        TIFFGetFieldDefaulted(in, TIFFTAG_ROWSPERSTRIP, &block);
+    TIFFGetField(in, TIFFTAG_IMAGELENGTH, &height);
+
+    return block < height ? block : height;
+}
+
+/*
+ * Rows of the source to convert at a time: a whole block, or an even
+ * share of one that is too large.  Packed YCbCr strips can only be
+ * read whole, however large they are.
+ */
+
+static uint32
+source_rows( TIFF *in )
+
+{
+    uint32  width, maxrows, block = block_height( in );
+
+    if( !TIFFIsTiled( in ) && TIFFVStripSize( in, 1 ) != TIFFScanlineSize( in ) )
+        return block;
+
+    TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &width);
+    maxrows = width > MAX_BLOCK_RASTER / 4 ? 1 : MAX_BLOCK_RASTER / (4 * width);
+    if( block > maxrows )
+        block = howmany(block, howmany(block, maxrows));
+
+    return block;
+}
+
+/*
+ * Rows to convert and write at a time: whole output strips that
+ * also cover whole shares of the source blocks when they can.
+ */
+
+static uint32
+job_rows( TIFF *in, TIFF *out )
+
+{
+    return stripPipeRows( source_rows( in ), out );
+}
+
+/*
+ * Return 1 if the first row of the source is the bottom of the image.
+ */
+
+static int
+bottom_up( TIFF *in )
+
+{
+    uint16  orientation;
+
+    TIFFGetFieldDefaulted(in, TIFFTAG_ORIENTATION, &orientation);
+    switch( orientation )
+    {
+      case ORIENTATION_BOTLEFT:
+      case ORIENTATION_BOTRIGHT:
+      case ORIENTATION_RIGHTBOT:
+      case ORIENTATION_LEFTBOT:
+        return 1;
+      default:
+        return 0;
+    }
+}
+
+/*
+ * read_rgba()
+ *
+ * read a w x h window of the image, whose top left corner is at (col,
+ * row) of the output, into an RGBA raster laid out top down.  The
+ * reader is asked for a top left origin, so rows go straight into
+ * place; a source that starts at the bottom is read from the mirrored
+ * rows.  col must fall on a tile of a tiled source.
+ */
+
+static int
+read_rgba( TIFF *in, uint32 col, uint32 row, uint32 w, uint32 h,
+           uint32 *raster )
+
+{
+    TIFFRGBAImage img;
+    char    emsg[1024];
+    int     ok;
+
+    if (!TIFFRGBAImageBegin(&img, in, 0, emsg)) {
+        TIFFError(TIFFFileName(in), emsg);
+        return (0);
+    }
+
+    img.req_orientation = ORIENTATION_TOPLEFT;
+    img.row_offset = bottom_up( in ) ? img.height - row - h : row;
+    img.col_offset = col;
+    ok = TIFFRGBAImageGet(&img, raster, w, h);
+
+    TIFFRGBAImageEnd(&img);
+
+    return ok;
+}
+
+/*
+ * cvt_rows()
+ *
+ * strip pipeline converter: read rows [row, row+nrows) as RGBA
+ * straight into the output scanlines.
+ */
+
+static int
+cvt_rows( TIFF *in, uint32 row, uint32 nrows, tdata_t buf, void *arg )
+
+{
+    uint32  width;
+
+    (void) arg;
+
+    TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &width);
+
+    return read_rgba( in, 0, row, width, nrows, (uint32*) buf );
+}
+
+/*
+ * cvt_by_tile()
+ *
+ * convert one output tile at a time; only a tile of RGBA is held.
+ */
+
 static int
 cvt_by_tile( TIFF *in, TIFF *out )
 
 {
-    uint32* raster;			/* retrieve RGBA image */
+    uint32* raster;			/* retrieve RGBA tile */
     uint32  width, height;		/* image width & height */
     uint32  tile_width, tile_height;
-    uint32  row, col;
-    uint32  *wrk_line;
+    uint32  read_xsize, read_ysize;
+    uint32  row, col, i_row;
     int	    ok = 1;
 
     TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &width);
     TIFFGetField(in, TIFFTAG_IMAGELENGTH, &height);
-
-    if( !TIFFGetField(in, TIFFTAG_TILEWIDTH, &tile_width)
-        || !TIFFGetField(in, TIFFTAG_TILELENGTH, &tile_height) ) {
-        TIFFError(TIFFFileName(in), "Source image not tiled");
-        return (0);
-    }
-    
-    TIFFSetField(out, TIFFTAG_TILEWIDTH, tile_width );
-    TIFFSetField(out, TIFFTAG_TILELENGTH, tile_height );
+    TIFFGetField(out, TIFFTAG_TILEWIDTH, &tile_width);
+    TIFFGetField(out, TIFFTAG_TILELENGTH, &tile_height);
 
     /*
      * Allocate tile buffer
@@ -143,45 +291,39 @@ cvt_by_tile( TIFF *in, TIFF *out )
         return (0);
     }
 
-    /*
-     * Allocate a scanline buffer for swapping during the vertical
-     * mirroring pass.
-     */
-    wrk_line = (uint32*)_TIFFmalloc(tile_width * sizeof (uint32));
-    if (wrk_line == 0) {
-        TIFFError(TIFFFileName(in), "No space for raster scanline buffer");
-        ok = 0;
-    }
-    
     /*
      * Loop over the tiles.
      */
     for( row = 0; ok && row < height; row += tile_height )
     {
+        read_ysize = height - row < tile_height ? height - row : tile_height;
+
         for( col = 0; ok && col < width; col += tile_width )
         {
-            int		i_row;
+            read_xsize = width - col < tile_width ? width - col : tile_width;
 
-            /* Read the tile into an RGBA array */
-            if (!TIFFReadRGBATile(in, col, row, raster)) {
+            /* Read the visible part of the tile into an RGBA array */
+            if (!read_rgba(in, col, row, read_xsize, read_ysize, raster)) {
                 ok = 0;
                 break;
             }
 
             /*
-             * For some reason the TIFFReadRGBATile() function chooses the
-             * lower left corner as the origin.  Vertically mirror scanlines.
+             * A tile clipped by the image comes back read_xsize pixels
+             * wide: spread the rows out to the tile width, last row
+             * first so none is overwritten, and clear the rest.
              */
-            for( i_row = 0; i_row < tile_height / 2; i_row++ )
+            if( read_xsize < tile_width || read_ysize < tile_height )
             {
-                uint32	*top_line, *bottom_line;
-
-                top_line = raster + tile_width * i_row;
-                bottom_line = raster + tile_width * (tile_height-i_row-1);
-
-                _TIFFmemcpy(wrk_line, top_line, 4*tile_width);
-                _TIFFmemcpy(top_line, bottom_line, 4*tile_width);
-                _TIFFmemcpy(bottom_line, wrk_line, 4*tile_width);
+                for( i_row = read_ysize; i_row-- > 0; )
+                {
+                    memmove(raster + i_row * tile_width,
+                            raster + i_row * read_xsize, 4 * read_xsize);
+                    _TIFFmemset(raster + i_row * tile_width + read_xsize,
+                                0, 4 * (tile_width - read_xsize));
+                }
+                _TIFFmemset(raster + read_ysize * tile_width, 0,
+                            4 * tile_width * (tile_height - read_ysize));
             }
 
             /*
@@ -200,195 +342,75 @@ cvt_by_tile( TIFF *in, TIFF *out )
     }
 
     _TIFFfree( raster );
-    _TIFFfree( wrk_line );
 
     return ok;
 }
 
+/*
+ * cvt_by_strip()
+ *
+ * convert a few output strips at a time, as many as cover a source
+ * block when that is not too large.
+ */
+
 static int
 cvt_by_strip( TIFF *in, TIFF *out )
 
 {
-    uint32* raster;			/* retrieve RGBA image */
+    uint32* raster;			/* retrieve RGBA rows */
     uint32  width, height;		/* image width & height */
-    uint32  row;
-    uint32  *wrk_line;
+    uint32  row, strip, jobrows, nrows;
     int	    ok = 1;
 
     TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &width);
     TIFFGetField(in, TIFFTAG_IMAGELENGTH, &height);
 
-    if( !TIFFGetField(in, TIFFTAG_ROWSPERSTRIP, &rowsperstrip) ) {
-        TIFFError(TIFFFileName(in), "Source image not in strips");
-        return (0);
-    }
-    
-    TIFFSetField(out, TIFFTAG_ROWSPERSTRIP, rowsperstrip);
+    jobrows = job_rows( in, out );
+    if( jobrows > height )
+        jobrows = height;
 
-    /*
-     * Allocate strip buffer
-     */
-    raster = (uint32*)_TIFFmalloc(width * rowsperstrip * sizeof (uint32));
+    raster = (uint32*)_TIFFmalloc(width * jobrows * sizeof (uint32));
     if (raster == 0) {
         TIFFError(TIFFFileName(in), "No space for raster buffer");
         return (0);
     }
 
-    /*
-     * Allocate a scanline buffer for swapping during the vertical
-     * mirroring pass.
-     */
-    wrk_line = (uint32*)_TIFFmalloc(width * sizeof (uint32));
-    if (wrk_line == 0) {
-        TIFFError(TIFFFileName(in), "No space for raster scanline buffer");
-        ok = 0;
-    }
-    
-    /*
-     * Loop over the strips.
-     */
-    for( row = 0; ok && row < height; row += rowsperstrip )
+    for( row = 0; ok && row < height; row += jobrows )
     {
-        int	rows_to_write, i_row;
+        nrows = height - row < jobrows ? height - row : jobrows;
 
-        /* Read the strip into an RGBA array */
-        if (!TIFFReadRGBAStrip(in, row, raster)) {
+        if (!cvt_rows(in, row, nrows, raster, NULL)) {
             ok = 0;
             break;
         }
 
         /*
-         * Figure out the number of scanlines actually in this strip.
+         * Write out the result in strips
          */
-        if( row + rowsperstrip > height )
-            rows_to_write = height - row;
-        else
-            rows_to_write = rowsperstrip;
 
-        /*
-         * For some reason the TIFFReadRGBAStrip() function chooses the
-         * lower left corner as the origin.  Vertically mirror scanlines.
-         */
-
-        for( i_row = 0; i_row < rows_to_write / 2; i_row++ )
+        for( strip = 0; strip * rowsperstrip < nrows; strip++ )
         {
-            uint32	*top_line, *bottom_line;
-
-            top_line = raster + width * i_row;
-            bottom_line = raster + width * (rows_to_write-i_row-1);
+            uint32  rows_to_write = nrows - strip * rowsperstrip;
 
-            _TIFFmemcpy(wrk_line, top_line, 4*width);
-            _TIFFmemcpy(top_line, bottom_line, 4*width);
-            _TIFFmemcpy(bottom_line, wrk_line, 4*width);
-        }
+            if( rows_to_write > rowsperstrip )
+                rows_to_write = rowsperstrip;
 
-        /*
-         * Write out the result in a strip
-         */
-
-        if( TIFFWriteEncodedStrip( out, row / rowsperstrip, raster,
-                                   4 * rows_to_write * width ) == -1 )
-        {
-            ok = 0;
-            break;
+            if( TIFFWriteEncodedStrip( out,
+                                       (row / rowsperstrip) + strip,
+                                       raster + strip * rowsperstrip * width,
+                                       4 * rows_to_write * width ) == -1 )
+            {
+                ok = 0;
+                break;
+            }
         }
     }
 
     _TIFFfree( raster );
-    _TIFFfree( wrk_line );
 
     return ok;
 }
 
-/*
- * cvt_whole_image()
- *
- * read the whole image into one big RGBA buffer and then write out
- * strips from that.  This is using the traditional TIFFReadRGBAImage()
- * API that we trust.
- */
-
-static int
-cvt_whole_image( TIFF *in, TIFF *out )
-
-{
-    uint32* raster;			/* retrieve RGBA image */
-    uint32  width, height;		/* image width & height */
-    uint32	row;
-    uint32  *wrk_line;
-        
-        
-    TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &width);
-    TIFFGetField(in, TIFFTAG_IMAGELENGTH, &height);
-
-    rowsperstrip = TIFFDefaultStripSize(out, rowsperstrip);
-    TIFFSetField(out, TIFFTAG_ROWSPERSTRIP, rowsperstrip);
-
-    raster = (uint32*)_TIFFmalloc(width * height * sizeof (uint32));
-    if (raster == 0) {
-        TIFFError(TIFFFileName(in), "No space for raster buffer");
-        return (0);
-    }
-
-    /* Read the image in one chunk into an RGBA array */
-    if (!TIFFReadRGBAImage(in, width, height, raster, 0)) {
-        _TIFFfree(raster);
-        return (0);
-    }
-
-    /* For some reason the TIFFReadRGBAImage() function chooses the
-       lower left corner as the origin.  Vertically mirror scanlines. */
-
-    wrk_line = (uint32*)_TIFFmalloc(width * sizeof (uint32));
-    if (wrk_line == 0) {
-        TIFFError(TIFFFileName(in), "No space for raster scanline buffer");
-        return (0);
-    }
-    
-    for( row = 0; row < height / 2; row++ )
-    {
-        uint32	*top_line, *bottom_line;
-
-        top_line = raster + width * row;
-        bottom_line = raster + width * (height-row-1);
-
-        _TIFFmemcpy(wrk_line, top_line, 4*width);
-        _TIFFmemcpy(top_line, bottom_line, 4*width);
-        _TIFFmemcpy(bottom_line, wrk_line, 4*width);
-    }
-
-    _TIFFfree( wrk_line );
-    
-
-    /* Write out the result in strips */
-
-    for( row = 0; row < height; row += rowsperstrip )
-    {
-        uint32* raster_strip;
-        int	rows_to_write;
-
-        raster_strip = raster + row * width;
-
-        if( row + rowsperstrip > height )
-            rows_to_write = height - row;
-        else
-            rows_to_write = rowsperstrip;
-
-        if( TIFFWriteEncodedStrip( out, row / rowsperstrip,
-                                   raster_strip,
-                                   4 * rows_to_write * width ) == -1 )
-        {
-            _TIFFfree( raster );
-            return 0;
-        }
-    }
-
-    _TIFFfree( raster );
-
-    return 1;
-}
-
-
 static int
 tiffcvt(TIFF* in, TIFF* out)
 {
@@ -421,16 +443,56 @@ tiffcvt(TIFF* in, TIFF* out)
 	TIFFSetField(out, TIFFTAG_SOFTWARE, TIFFGetVersion());
 	CopyField(TIFFTAG_DOCUMENTNAME, stringv);
 
+        /*
+         * With -b the output is laid out like the source: the same tiles,
+         * or the same strips; otherwise it is in strips of the asked size.
+         */
         if( process_by_block && TIFFIsTiled( in ) )
+        {
+            CopyField(TIFFTAG_TILEWIDTH, longv);
+            CopyField(TIFFTAG_TILELENGTH, longv);
+        }
+        else
+        {
+            if( process_by_block )
+            {
+                if( !TIFFGetField(in, TIFFTAG_ROWSPERSTRIP, &rowsperstrip) ) {
+                    TIFFError(TIFFFileName(in), "Source image not in strips");
+                    return (0);
+                }
+            }
+            else
+                rowsperstrip = TIFFDefaultStripSize(out, rowsperstrip);
+            TIFFSetField(out, TIFFTAG_ROWSPERSTRIP, rowsperstrip);
+        }
+
+        if( nthreads > 1 )
+        {
+            /*
+             * A strip is decoded from its start by every thread that
+             * needs part of it, so strips too large to convert at once
+             * are left to a single thread, which reads them in order.
+             */
+            if( !stripPipeOK( out ) )
+                TIFFWarning(TIFFFileName(in),
+                            "Compression scheme needs a single thread");
+            else if( !TIFFIsTiled( in )
+                     && source_rows( in ) < block_height( in ) )
+                TIFFWarning(TIFFFileName(in),
+                            "Source strips too large to share between threads");
+            else
+                return( stripPipe( in, out, job_rows( in, out ), nthreads,
+                                   cvt_rows, NULL ) );
+        }
+
+        if( TIFFIsTiled( out ) )
             return( cvt_by_tile( in, out ) );
-        else if( process_by_block )
-            return( cvt_by_strip( in, out ) );
         else
-            return( cvt_whole_image( in, out ) );
+            return( cvt_by_strip( in, out ) );
 }
 
 static char* usageMsg[] = {
-    "usage: tiff2rgba [-c comp] [-r rows] [-b] input... output\n",
+    "usage: tiff2rgba [-c comp] [-r rows] [-b] [-j threads] input... output\n",
     "where comp is one of the following compression algorithms:\n",
     " jpeg\t\tJPEG encoding\n",
     " lzw\t\tLempel-Ziv & Welch encoding\n",
@@ -439,6 +501,7 @@ static char* usageMsg[] = {
     "and the other options are:\n",
     " -r\trows/strip\n",
     " -b (progress by block rather than as a whole image)\n",
+    " -j\tread, convert and compress strips or tiles on # threads\n",
     NULL
 };
 
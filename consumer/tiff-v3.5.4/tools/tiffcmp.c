@@ -455,7 +455,7 @@ static int
 CheckLongTag(TIFF* tif1, TIFF* tif2, int tag, char* name)
 {
 	uint32 v1, v2;
-	CHECK(v1 == v2, "%s: %lu %lu\n");
+	CHECK(v1 == v2, "%s: %u %u\n");
 }
 
 static int
@@ -476,7 +476,7 @@ static void
 eof(const char* name, uint32 row, int s)
 {
 
-	printf("%s: EOF at scanline %lu", name, row);
+	printf("%s: EOF at scanline %u", name, row);
 	if (s >= 0)
 		printf(", sample %d", s);
 	printf("\n");
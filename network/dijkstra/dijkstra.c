@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "textload.h"
 
 #define NONE                               9999
 
@@ -147,7 +148,8 @@ int dijkstra(int chStart, int chEnd)
 
 int main(int argc, char *argv[]) {
   int i,j,k;
-  FILE *fp;
+  int *v;
+  long n;
   
   if (argc<3) {
     fprintf(stderr, "Usage: dijkstra <NUM_NODES> <INPUT_FILE>\n");
@@ -164,17 +166,24 @@ int main(int argc, char *argv[]) {
         AdjMatrix[i] = (int*) malloc(num_nodes*sizeof(int));
     }
 
-  /* open the adjacency matrix file */
-  fp = fopen (argv[2],"r");
+  /* load the adjacency matrix file */
+  n = tl_load_ints(argv[2], (long)num_nodes*num_nodes, &v);
+  if (n < 0) {
+    perror(argv[2]);
+    exit(1);
+  }
 
   /* make a fully connected matrix */
+  k = NONE;
   for (i=0;i<num_nodes;i++) {
     for (j=0;j<num_nodes;j++) {
-      /* make it more sparce */
-      fscanf(fp,"%d",&k);
+      /* a short file repeats the last cost, as the fscanf loop did */
+      if ((long)i*num_nodes+j < n)
+        k = v[(long)i*num_nodes+j];
 			AdjMatrix[i][j]= k;
     }
   }
+  free(v);
 
   /* finds 10 shortest paths between nodes */
   for (i=0,j=num_nodes/2;i<20;i++,j++) {
@@ -48,6 +48,7 @@
 #include <arpa/inet.h>
 
 #include "patricia.h"
+#include "textload.h"
 
 struct MyNode {
 	int foo;
@@ -60,8 +61,8 @@ main(int argc, char **argv)
 	struct ptree *phead;
 	struct ptree *p,*pfind;
 	struct ptree_mask *pm;
-	FILE *fp;
-	char line[128];
+	struct tl_rec *rec;
+	long i, n;
 	char addr_str[16];
 	struct in_addr addr;
 	unsigned long mask=0xffffffff;
@@ -72,11 +73,11 @@ main(int argc, char **argv)
 		exit(-1);
 	}
 	/*
-	 * Open file of IP addresses and masks.
+	 * Load the file of time stamps and IP addresses.
 	 * Each line looks like:
-	 *    10.0.3.4 0xffff0000
+	 *    0.245680 2 1 53 53
 	 */
-	if ((fp = fopen(argv[1], "r")) == NULL) {
+	if ((n = tl_load_recs(argv[1], -1, &rec)) < 0) {
 		printf("File %s doesn't seem to exist\n",argv[1]);
 		exit(1);
 	}
@@ -123,12 +124,13 @@ main(int argc, char **argv)
 	/*
 	 * The main loop to insert nodes.
 	 */
-	while (fgets(line, 128, fp)) {
+	for (i = 0; i < n; i++) {
 		/*
 		 * Read in each IP address and mask and convert them to
 		 * more usable formats.
 		 */
-		sscanf(line, "%f %d", &time, (unsigned int *)&addr);
+		time = rec[i].f;
+		addr.s_addr = (unsigned int)rec[i].i;
 		//inet_aton(addr_str, &addr);
 
 		/*
@@ -194,6 +196,7 @@ main(int argc, char **argv)
 			exit(1);
 		}
 	}
+	free(rec);
 
 	exit(0);
 }
@@ -13,6 +13,7 @@
 #include <limits.h>                                         /* rdg 10/93 */
 #include <stddef.h>
 #include <string.h>
+#include "search.h"
 typedef unsigned char uchar;
 
 #define LOWER_ACCENTED_CHARS
@@ -46,16 +47,17 @@ unsigned char lowervec[UCHAR_MAX+1] = {                     /* rdg 10/93 */
 
 #define LARGE 32767
 
-static int patlen;
-static int skip[UCHAR_MAX+1];                               /* rdg 10/93 */
-static int skip2;
-static uchar *pat;
+static struct search_ctx bmha_ctx;     /* for the non-reentrant versions */
 
-void bmha_init(const char *pattern)
+void bmha_init_r(struct search_ctx *ctx, const char *pattern)
 {
       int i, j;
-      pat = (uchar *)pattern;
-      patlen = strlen(pattern);
+      int patlen, *skip = ctx->skip;
+      uchar *pat;
+
+      ctx->pat = pat = (uchar *)pattern;
+      ctx->patlen = patlen = strlen(pattern);
+      ctx->find = bmha_search_r;
       for (i = 0; i <= UCHAR_MAX; ++i)                      /* rdg 10/93 */
       {
             skip[i] = patlen;
@@ -69,16 +71,20 @@ void bmha_init(const char *pattern)
             if (j == patlen - 1)
                   skip[i] = LARGE;
       }
-      skip2 = patlen;
+      ctx->skip2 = patlen;
       for (i = 0; i < patlen - 1; ++i)
       {
             if ( lowerc(pat[i]) == lowerc(pat[patlen - 1]) )
-                  skip2 = patlen - i - 1;
+                  ctx->skip2 = patlen - i - 1;
       }
 }
 
-char *bmha_search(const char *string, const int stringlen)
+char *bmha_search_r(const struct search_ctx *ctx, const char *string,
+                    const int stringlen)
 {
+      const int patlen = ctx->patlen, skip2 = ctx->skip2;
+      const int *skip = ctx->skip;
+      const uchar *pat = ctx->pat;
       int i, j;
       char *s;
 
@@ -103,3 +109,13 @@ char *bmha_search(const char *string, const int stringlen)
                   return NULL;                              /* rdg 10/93 */
       }
 }
+
+void bmha_init(const char *pattern)
+{
+      bmha_init_r(&bmha_ctx, pattern);
+}
+
+char *bmha_search(const char *string, const int stringlen)
+{
+      return bmha_search_r(&bmha_ctx, string, stringlen);
+}
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include "search.h"
 typedef unsigned char uchar;
 
 void bmhi_init(const char *);
@@ -27,29 +28,37 @@ void bhmi_cleanup(void);
 
 #define LARGE 32767             /* flag for last character match    */
 
-static int patlen;              /* # chars in pattern               */
-static int skip[UCHAR_MAX+1];   /* skip-ahead count for test chars  */
-static int skip2;               /* skip-ahead after non-match with
-                                ** matching final character         */
-static uchar *pat = NULL;       /* uppercase copy of pattern        */
+/*
+** In the context:
+**    patlen  # chars in pattern
+**    skip    skip-ahead count for test chars
+**    skip2   skip-ahead after non-match with matching final character
+**    pat     uppercase copy of pattern
+*/
+
+static struct search_ctx bmhi_ctx;     /* for the non-reentrant versions */
 
 /*
-** bmhi_init() is called prior to bmhi_search() to calculate the
-** skip array for the given pattern.
+** bmhi_init_r() is called prior to bmhi_search_r() to calculate the
+** skip array for the given pattern.  The context starts out zeroed
+** and owns its copy of the pattern until bmhi_cleanup_r().
 ** Error: exit(1) is called if no memory is available.
 */
 
-void bmhi_init(const char *pattern)
+void bmhi_init_r(struct search_ctx *ctx, const char *pattern)
 {
       int i, lastpatchar;
-      patlen = strlen(pattern);
+      int patlen, *skip = ctx->skip;
+      uchar *pat;
+
+      ctx->patlen = patlen = strlen(pattern);
+      ctx->find = bmhi_search_r;
 
       /* Make uppercase copy of pattern */
 
-      pat = realloc ((void*)pat, patlen);
+      ctx->pat = pat = realloc ((void*)ctx->pat, patlen);
       if (!pat)
             exit(1);
-      else  atexit(bhmi_cleanup);
       for (i=0; i < patlen; i++)
             pat[i] = toupper(pattern[i]);
 
@@ -65,16 +74,20 @@ void bmhi_init(const char *pattern)
       lastpatchar = pat[patlen - 1];
       skip[        lastpatchar ] = LARGE;
       skip[tolower(lastpatchar)] = LARGE;
-      skip2 = patlen;                     /* Horspool's fixed second shift */
+      ctx->skip2 = patlen;                /* Horspool's fixed second shift */
       for (i = 0; i < patlen - 1; ++i)
       {
             if ( pat[i] == lastpatchar )
-                  skip2 = patlen - i - 1;
+                  ctx->skip2 = patlen - i - 1;
       }
 }
 
-char *bmhi_search(const char *string, const int stringlen)
+char *bmhi_search_r(const struct search_ctx *ctx, const char *string,
+                    const int stringlen)
 {
+      const int patlen = ctx->patlen, skip2 = ctx->skip2;
+      const int *skip = ctx->skip;
+      const uchar *pat = ctx->pat;
       int i, j;
       char *s;
 
@@ -100,7 +113,27 @@ char *bmhi_search(const char *string, const int stringlen)
       }
 }
 
+void bmhi_cleanup_r(struct search_ctx *ctx)
+{
+      free(ctx->pat);
+      ctx->pat = NULL;
+}
+
+void bmhi_init(const char *pattern)
+{
+      static int registered = 0;
+
+      bmhi_init_r(&bmhi_ctx, pattern);
+      if (!registered)
+            registered = !atexit(bhmi_cleanup);
+}
+
+char *bmhi_search(const char *string, const int stringlen)
+{
+      return bmhi_search_r(&bmhi_ctx, string, stringlen);
+}
+
 void bhmi_cleanup(void)
 {
-      free(pat);
+      bmhi_cleanup_r(&bmhi_ctx);
 }
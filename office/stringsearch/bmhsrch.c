@@ -12,38 +12,43 @@
 #include <limits.h>                                         /* rdg 10/93 */
 #include <stddef.h>
 #include <string.h>
+#include "search.h"
 typedef unsigned char uchar;
 
 
 #define LARGE 32767
 
-static int patlen;
-static int skip[UCHAR_MAX+1];                               /* rdg 10/93 */
-static int skip2;
-static uchar *pat;
+static struct search_ctx bmh_ctx;      /* for the non-reentrant versions */
 
-void bmh_init(const char *pattern)
+void bmh_init_r(struct search_ctx *ctx, const char *pattern)
 {
           int i, lastpatchar;
+          int patlen, *skip = ctx->skip;
+          uchar *pat;
 
-          pat = (uchar *)pattern;
-          patlen = strlen(pattern);
+          ctx->pat = pat = (uchar *)pattern;
+          ctx->patlen = patlen = strlen(pattern);
+          ctx->find = bmh_search_r;
           for (i = 0; i <= UCHAR_MAX; ++i)                  /* rdg 10/93 */
                 skip[i] = patlen;
           for (i = 0; i < patlen; ++i)
                 skip[pat[i]] = patlen - i - 1;
           lastpatchar = pat[patlen - 1];
           skip[lastpatchar] = LARGE;
-          skip2 = patlen;                 /* Horspool's fixed second shift */
+          ctx->skip2 = patlen;            /* Horspool's fixed second shift */
           for (i = 0; i < patlen - 1; ++i)
           {
                 if (pat[i] == lastpatchar)
-                      skip2 = patlen - i - 1;
+                      ctx->skip2 = patlen - i - 1;
           }
 }
 
-char *bmh_search(const char *string, const int stringlen)
+char *bmh_search_r(const struct search_ctx *ctx, const char *string,
+                   const int stringlen)
 {
+      const int patlen = ctx->patlen, skip2 = ctx->skip2;
+      const int *skip = ctx->skip;
+      const uchar *pat = ctx->pat;
       int i, j;
       char *s;
 
@@ -68,3 +73,13 @@ char *bmh_search(const char *string, const int stringlen)
                   return NULL;                              /* rdg 10/93 */
       }
 }
+
+void bmh_init(const char *pattern)
+{
+      bmh_init_r(&bmh_ctx, pattern);
+}
+
+char *bmh_search(const char *string, const int stringlen)
+{
+      return bmh_search_r(&bmh_ctx, string, stringlen);
+}
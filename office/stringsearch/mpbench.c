@@ -0,0 +1,144 @@
+/* +++Date last modified: 18-Oct-2026 */
+
+/*
+**  Multi-pattern search benchmark
+**
+**  Reads a pattern file (one pattern per line) and a corpus, and scans
+**  every line of the corpus for all matches of the set, once with each
+**  engine that can handle the set.  Prints the matches found and the
+**  throughput of each engine, and fails if the engines disagree.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "search.h"
+
+static char *slurp(const char *name, long *len)
+{
+      FILE *fp;
+      char *buf;
+
+      if ((fp = fopen(name, "rb")) == NULL)
+            return NULL;
+      fseek(fp, 0, SEEK_END);
+      *len = ftell(fp);
+      rewind(fp);
+      if ((buf = (char *)malloc(*len + 1)) != NULL &&
+          fread(buf, 1, *len, fp) != (size_t)*len)
+      {
+            free(buf);
+            buf = NULL;
+      }
+      fclose(fp);
+      if (buf)
+            buf[*len] = '\0';
+      return buf;
+}
+
+static double now(void)
+{
+      struct timeval tv;
+
+      gettimeofday(&tv, NULL);
+      return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/*
+**  Scan every line, counting matching lines and matches.  After each
+**  match the search resumes one byte past its start.
+*/
+
+static void scan(const struct mpsearch *m, const char *text, long len,
+                 long *lines, long *matches)
+{
+      const char *line = text, *eol, *p, *here;
+      int which, n;
+
+      for (; line < text + len; line = eol + 1)
+      {
+            if ((eol = memchr(line, '\n', text + len - line)) == NULL)
+                  eol = text + len;
+            p = line;
+            n = 0;
+            while ((here = mp_search(m, p, eol - p, &which)) != NULL)
+            {
+                  ++n;
+                  p = here + 1;
+            }
+            if (n)
+            {
+                  ++*lines;
+                  *matches += n;
+            }
+      }
+}
+
+int main(int argc, char **argv)
+{
+      static const char *names[] = { "auto", "aho-corasick", "teddy" };
+      static const int engines[] = { MP_AC, MP_TEDDY };
+      struct mpsearch *m;
+      char *pattext, *text, *p, **pats;
+      long patlen, len, lines, matches, ref_lines = -1, ref_matches = -1;
+      int npats, runs = 1, r, e;
+      double t;
+
+      if (argc < 3)
+      {
+            fprintf(stderr, "USAGE: ./mpsearch [PATTERNS] [CORPUS] [RUNS]\n");
+            return 1;
+      }
+      if (argc > 3 && (runs = atoi(argv[3])) < 1)
+            runs = 1;
+      if ((pattext = slurp(argv[1], &patlen)) == NULL ||
+          (text = slurp(argv[2], &len)) == NULL)
+      {
+            perror("mpsearch");
+            return 1;
+      }
+
+      pats = (char **)malloc((patlen + 1) * sizeof(char *));
+      for (npats = 0, p = strtok(pattext, "\r\n"); p; p = strtok(NULL, "\r\n"))
+            pats[npats++] = p;
+      printf("%d patterns, %ld bytes of text, %d runs\n", npats, len, runs);
+
+      for (e = 0; e < (int)(sizeof(engines) / sizeof(engines[0])); ++e)
+      {
+            if ((m = mp_init((const char **)pats, npats, engines[e])) == NULL)
+            {
+                  printf("%-14s not available for this set\n",
+                         names[engines[e]]);
+                  continue;
+            }
+            t = now();
+            for (r = 0; r < runs; ++r)
+            {
+                  lines = matches = 0;
+                  scan(m, text, len, &lines, &matches);
+            }
+            t = now() - t;
+            printf("%-14s %ld lines, %ld matches, %.1f MB/s\n",
+                   names[engines[e]], lines, matches,
+                   t > 0 ? (double)len * runs / t / 1e6 : 0.0);
+            mp_free(m);
+
+            if (ref_lines < 0)
+            {
+                  ref_lines = lines;
+                  ref_matches = matches;
+            }
+            else if (lines != ref_lines || matches != ref_matches)
+            {
+                  fprintf(stderr, "ERROR: %s disagrees with %s\n",
+                          names[engines[e]], names[engines[0]]);
+                  return 1;
+            }
+      }
+
+      free(pats);
+      free(pattext);
+      free(text);
+      return 0;
+}
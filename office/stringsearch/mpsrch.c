@@ -0,0 +1,411 @@
+/* +++Date last modified: 18-Oct-2026 */
+
+/*
+**  Multi-pattern string search
+**
+**  Looks for any of a set of patterns in one pass over the subject.
+**  Two engines are provided:
+**
+**  MP_AC     Aho-Corasick, compiled to a dense DFA.  Bytes that occur
+**            in no pattern share one input class, so each state only
+**            needs a row of nclass (not 256) transitions.
+**  MP_TEDDY  A Teddy-style SIMD prefilter for small sets (up to
+**            MP_TEDDY_MAX patterns).  Patterns are spread over eight
+**            buckets; the first one to three bytes of each pattern are
+**            encoded as nibble masks, and PSHUFB looks up sixteen
+**            candidate start positions at a time.  Candidates are then
+**            verified with memcmp().  Needs SSSE3 at run time.
+**
+**  MP_AUTO picks Teddy when the set is small enough and the CPU has
+**  SSSE3, and Aho-Corasick otherwise.
+**
+**  Both engines report the same match: the one that ends first in the
+**  subject, the longest of those, and the lowest pattern index of
+**  those.  Empty patterns never match.
+*/
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "search.h"
+typedef unsigned char uchar;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_TEDDY
+#include <tmmintrin.h>
+#endif
+
+#define TEDDY_BUCKETS 8
+
+struct mpsearch {
+      int engine;                   /* MP_AC or MP_TEDDY                */
+      int npat;
+      uchar **pat;                  /* private copies of the patterns   */
+      int *patlen;
+
+      /* Aho-Corasick DFA */
+      int nclass;
+      uchar cls[UCHAR_MAX+1];       /* byte -> input class              */
+      int *delta;                   /* nstates x nclass next rows       */
+      int *out;                     /* longest pattern ending here, -1  */
+
+      /* Teddy */
+      int fplen;                    /* fingerprint bytes (1..3)         */
+      int nbucket[TEDDY_BUCKETS];
+      int bucket[TEDDY_BUCKETS][MP_TEDDY_MAX];
+      uchar lo[3][16];              /* low nibble -> bucket bits        */
+      uchar hi[3][16];              /* high nibble -> bucket bits       */
+};
+
+/*
+**  Is (start, end, idx) a better match than the best one so far?
+*/
+
+static int better(long start, long end, int idx,
+                  long bstart, long bend, int bidx)
+{
+      if (end != bend)
+            return end < bend;
+      if (start != bstart)
+            return start < bstart;
+      return idx < bidx;
+}
+
+static int ac_build(struct mpsearch *m)
+{
+      int i, j, c, s, t, nstates, total = 0;
+      int *queue, *fail, head, tail;
+
+      /* Input classes: 0 for bytes used by no pattern */
+      memset(m->cls, 0, sizeof(m->cls));
+      m->nclass = 1;
+      for (i = 0; i < m->npat; ++i)
+      {
+            total += m->patlen[i];
+            for (j = 0; j < m->patlen[i]; ++j)
+            {
+                  if (0 == m->cls[m->pat[i][j]])
+                        m->cls[m->pat[i][j]] = m->nclass++;
+            }
+      }
+
+      m->delta = (int *)calloc((size_t)(total + 1) * m->nclass, sizeof(int));
+      m->out = (int *)malloc((total + 1) * sizeof(int));
+      fail = (int *)malloc((total + 1) * sizeof(int));
+      queue = (int *)malloc((total + 1) * sizeof(int));
+      if (!m->delta || !m->out || !fail || !queue)
+      {
+            free(fail);
+            free(queue);
+            return 0;
+      }
+
+      /* Trie; 0 in delta[] means "no edge" until the DFA is filled in */
+      nstates = 1;
+      m->out[0] = -1;
+      for (i = 0; i < m->npat; ++i)
+      {
+            if (0 == m->patlen[i])
+                  continue;
+            for (s = 0, j = 0; j < m->patlen[i]; ++j)
+            {
+                  c = m->cls[m->pat[i][j]];
+                  if (0 == m->delta[s * m->nclass + c])
+                  {
+                        m->out[nstates] = -1;
+                        m->delta[s * m->nclass + c] = nstates++;
+                  }
+                  s = m->delta[s * m->nclass + c];
+            }
+            if (m->out[s] < 0)            /* keep the lowest index      */
+                  m->out[s] = i;
+      }
+
+      /* Breadth-first: failure links, outputs and the full DFA */
+      head = tail = 0;
+      for (c = 0; c < m->nclass; ++c)
+      {
+            if ((t = m->delta[c]) != 0)
+            {
+                  fail[t] = 0;
+                  queue[tail++] = t;
+            }
+      }
+      while (head < tail)
+      {
+            s = queue[head++];
+            if (m->out[s] < 0)
+                  m->out[s] = m->out[fail[s]];
+            for (c = 0; c < m->nclass; ++c)
+            {
+                  t = m->delta[s * m->nclass + c];
+                  if (t != 0)
+                  {
+                        fail[t] = m->delta[fail[s] * m->nclass + c];
+                        queue[tail++] = t;
+                  }
+                  else  m->delta[s * m->nclass + c] =
+                              m->delta[fail[s] * m->nclass + c];
+            }
+      }
+
+      /*
+      **  Store the row offset of the next state instead of its number,
+      **  negated (less one) for states where a pattern ends, so the
+      **  inner loop is one load and one sign test per byte.
+      */
+      for (i = 0; i < nstates * m->nclass; ++i)
+      {
+            t = m->delta[i];
+            m->delta[i] = m->out[t] < 0 ? t * m->nclass : -t * m->nclass - 1;
+      }
+
+      free(fail);
+      free(queue);
+      return 1;
+}
+
+static char *ac_search(const struct mpsearch *m, const char *string,
+                       const int stringlen, int *which)
+{
+      const uchar *p = (const uchar *)string;
+      const int *delta = m->delta, *out = m->out;
+      const uchar *cls = m->cls;
+      int i, s = 0, nclass = m->nclass;
+
+      for (i = 0; i < stringlen; ++i)
+      {
+            if ((s = delta[s + cls[p[i]]]) < 0)
+            {
+                  s = out[(-s - 1) / nclass];
+                  if (which)
+                        *which = s;
+                  return (char *)string + i + 1 - m->patlen[s];
+            }
+      }
+      return NULL;
+}
+
+#ifdef HAVE_TEDDY
+
+static int teddy_build(struct mpsearch *m)
+{
+      int i, j, b, minlen = INT_MAX;
+
+      if (m->npat > MP_TEDDY_MAX || !__builtin_cpu_supports("ssse3"))
+            return 0;
+      for (i = 0; i < m->npat; ++i)
+      {
+            if (m->patlen[i] > 0 && m->patlen[i] < minlen)
+                  minlen = m->patlen[i];
+      }
+      if (INT_MAX == minlen)
+            return 0;
+      m->fplen = minlen < 3 ? minlen : 3;
+
+      memset(m->lo, 0, sizeof(m->lo));
+      memset(m->hi, 0, sizeof(m->hi));
+      memset(m->nbucket, 0, sizeof(m->nbucket));
+      for (i = 0; i < m->npat; ++i)
+      {
+            if (0 == m->patlen[i])
+                  continue;
+            b = i % TEDDY_BUCKETS;
+            m->bucket[b][m->nbucket[b]++] = i;
+            for (j = 0; j < m->fplen; ++j)
+            {
+                  m->lo[j][m->pat[i][j] & 0xf] |= 1 << b;
+                  m->hi[j][m->pat[i][j] >> 4] |= 1 << b;
+            }
+      }
+      return 1;
+}
+
+/*
+**  Verify the patterns in buckets bits at start, keeping the best.
+*/
+
+static void teddy_verify(const struct mpsearch *m, const uchar *p,
+                         long n, long start, int bits,
+                         long *bstart, long *bend, int *bidx)
+{
+      int b, k, i;
+
+      for (b = 0; b < TEDDY_BUCKETS; ++b)
+      {
+            if (!(bits & (1 << b)))
+                  continue;
+            for (k = 0; k < m->nbucket[b]; ++k)
+            {
+                  i = m->bucket[b][k];
+                  if (start + m->patlen[i] <= n &&
+                      0 == memcmp(p + start, m->pat[i], m->patlen[i]) &&
+                      better(start, start + m->patlen[i], i,
+                             *bstart, *bend, *bidx))
+                  {
+                        *bstart = start;
+                        *bend = start + m->patlen[i];
+                        *bidx = i;
+                  }
+            }
+      }
+}
+
+/*
+**  Candidate bucket bits for the sixteen starts at p.
+*/
+
+__attribute__((target("ssse3")))
+static int teddy_block(const struct mpsearch *m, const uchar *p, uchar *bits)
+{
+      const __m128i nib = _mm_set1_epi8(0x0f);
+      __m128i c, r = _mm_set1_epi8((char)0xff);
+      int j;
+
+      for (j = 0; j < m->fplen; ++j)
+      {
+            c = _mm_loadu_si128((const __m128i *)(p + j));
+            r = _mm_and_si128(r, _mm_and_si128(
+                  _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)m->lo[j]),
+                                   _mm_and_si128(c, nib)),
+                  _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)m->hi[j]),
+                                   _mm_and_si128(_mm_srli_epi16(c, 4), nib))));
+      }
+      _mm_storeu_si128((__m128i *)bits, r);
+      return ~_mm_movemask_epi8(_mm_cmpeq_epi8(r, _mm_setzero_si128())) & 0xffff;
+}
+
+static char *teddy_search(const struct mpsearch *m, const char *string,
+                          const int stringlen, int *which)
+{
+      const uchar *p = (const uchar *)string;
+      uchar bits[16], tail[16 + 2];
+      long n = stringlen, pos, start;
+      long bstart = LONG_MAX, bend = LONG_MAX;
+      int bidx = INT_MAX, j, mask;
+
+      /*
+      **  A match ending at bend starts before it, so once one is found
+      **  only earlier candidate starts need to be looked at.  The last,
+      **  partial block is run on a zero padded copy.
+      */
+      for (pos = 0; pos < n && pos < bend; pos += 16)
+      {
+            if (pos + 16 + m->fplen - 1 <= n)
+                  mask = teddy_block(m, p + pos, bits);
+            else
+            {
+                  memset(tail, 0, sizeof(tail));
+                  memcpy(tail, p + pos, n - pos);
+                  mask = teddy_block(m, tail, bits);
+            }
+            while (mask)
+            {
+                  j = __builtin_ctz(mask);
+                  mask &= mask - 1;
+                  if ((start = pos + j) >= bend || start >= n)
+                        break;
+                  teddy_verify(m, p, n, start, bits[j],
+                               &bstart, &bend, &bidx);
+            }
+      }
+
+      if (LONG_MAX == bend)
+            return NULL;
+      if (which)
+            *which = bidx;
+      return (char *)string + bstart;
+}
+
+#endif /* HAVE_TEDDY */
+
+/*
+**  Call this with the patterns to build a search set.  The patterns are
+**  copied.  Returns NULL if out of memory, or if engine is MP_TEDDY and
+**  the set or the CPU can't use it.
+*/
+
+struct mpsearch *mp_init(const char **patterns, const int npatterns,
+                         const int engine)
+{
+      struct mpsearch *m;
+      int i, ok = 0;
+
+      if ((m = (struct mpsearch *)calloc(1, sizeof(*m))) == NULL)
+            return NULL;
+      m->npat = npatterns;
+      m->pat = (uchar **)calloc(npatterns + 1, sizeof(uchar *));
+      m->patlen = (int *)malloc((npatterns + 1) * sizeof(int));
+      if (!m->pat || !m->patlen)
+      {
+            mp_free(m);
+            return NULL;
+      }
+      for (i = 0; i < npatterns; ++i)
+      {
+            m->patlen[i] = strlen(patterns[i]);
+            if ((m->pat[i] = (uchar *)malloc(m->patlen[i] + 1)) == NULL)
+            {
+                  mp_free(m);
+                  return NULL;
+            }
+            memcpy(m->pat[i], patterns[i], m->patlen[i] + 1);
+      }
+
+#ifdef HAVE_TEDDY
+      if (MP_AC != engine && teddy_build(m))
+      {
+            m->engine = MP_TEDDY;
+            return m;
+      }
+#endif
+      if (MP_TEDDY != engine && ac_build(m))
+      {
+            m->engine = MP_AC;
+            ok = 1;
+      }
+      if (!ok)
+      {
+            mp_free(m);
+            return NULL;
+      }
+      return m;
+}
+
+/*
+**  Call this with a buffer to search.  Returns the start of the match
+**  and, if which is not NULL, the index of the pattern found.
+*/
+
+char *mp_search(const struct mpsearch *m, const char *string,
+                const int stringlen, int *which)
+{
+#ifdef HAVE_TEDDY
+      if (MP_TEDDY == m->engine)
+            return teddy_search(m, string, stringlen, which);
+#endif
+      return ac_search(m, string, stringlen, which);
+}
+
+int mp_engine(const struct mpsearch *m)
+{
+      return m->engine;
+}
+
+void mp_free(struct mpsearch *m)
+{
+      int i;
+
+      if (NULL == m)
+            return;
+      if (m->pat)
+      {
+            for (i = 0; i < m->npat; ++i)
+                  free(m->pat[i]);
+      }
+      free(m->pat);
+      free(m->patlen);
+      free(m->delta);
+      free(m->out);
+      free(m);
+}
@@ -15,37 +15,40 @@
 #include <stddef.h>
 #include <string.h>
 #include <limits.h>
+#include "search.h"
 
-static size_t table[UCHAR_MAX + 1];
-static size_t len;
-static char *findme;
+static struct search_ctx pbm_ctx;      /* for the non-reentrant versions */
 
 /*
 **  Call this with the string to locate to initialize the table
 */
 
-void init_search(const char *string)
+void init_search_r(struct search_ctx *ctx, const char *string)
 {
-      size_t i;
+      size_t i, len;
 
-      len = strlen(string);
+      ctx->patlen = len = strlen(string);
+      ctx->find = strsearch_r;
       for (i = 0; i <= UCHAR_MAX; i++)                      /* rdg 10/93 */
-            table[i] = len;
+            ctx->skip[i] = len;
       for (i = 0; i < len; i++)
-            table[(unsigned char)string[i]] = len - i - 1;
-      findme = (char *)string;
+            ctx->skip[(unsigned char)string[i]] = len - i - 1;
+      ctx->pat = (unsigned char *)string;
 }
 
 /*
 **  Call this with a buffer to search
 */
 
-char *strsearch(const char *string)
+char *strsearch_r(const struct search_ctx *ctx, const char *string,
+                  const int stringlen)
 {
       register size_t shift;
+      register size_t len = ctx->patlen;
       register size_t pos = len - 1;
+      const int *table = ctx->skip;
       char *here;
-      size_t limit=strlen(string);
+      size_t limit = stringlen;
 
       while (pos < limit)
       {
@@ -56,7 +59,7 @@ char *strsearch(const char *string)
             }
             if (0 == shift)
             {
-                  if (0 == strncmp(findme,
+                  if (0 == memcmp(ctx->pat,
                         here = (char *)&string[pos-len+1], len))
                   {
                         return(here);
@@ -67,6 +70,18 @@ char *strsearch(const char *string)
       return NULL;
 }
 
+void init_search(const char *string)
+{
+      init_search_r(&pbm_ctx, string);
+}
+
+char *strsearch(const char *string)
+{
+      return strsearch_r(&pbm_ctx, string, strlen(string));
+}
+
+#ifndef NO_MAIN   /* search_mt links the search functions only */
+
 #include <stdio.h>
 
 main(int argc, char** argv)
@@ -2767,3 +2782,4 @@ main(int argc, char** argv)
       return 0;
 }
 
+#endif /* NO_MAIN */
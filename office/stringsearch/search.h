@@ -4,6 +4,24 @@
 **  SNIPPETS string searching functions
 */
 
+#include <limits.h>
+
+/*
+**  Search state for the reentrant (_r) functions.  Each thread can keep
+**  its own contexts; the original functions use one static context per
+**  algorithm.  The BMH family keeps the limitation that pattern length
+**  plus string length must be less than 32767.
+*/
+
+struct search_ctx {
+      int patlen;
+      int skip[UCHAR_MAX+1];
+      int skip2;
+      unsigned char *pat;         /* bmhi_init_r() allocates its own copy */
+      char *(*find)(const struct search_ctx *ctx,
+                    const char *string, const int stringlen);
+};
+
 void  init_search(const char *string);                /* Pbmsrch.C      */
 char *strsearch(const char *string);                  /* Pbmsrch.C      */
 void  bmh_init(const char *pattern);                  /* Bmhsrch.C      */
@@ -15,3 +33,38 @@ char *bmhi_search(const char *string,                 /* Bhmisrch.C     */
 void  bmha_init(const char *pattern);                 /* Bmhasrch.C     */
 char *bmha_search(const char *string,                 /* Bmhasrch.C     */
                   const int stringlen);
+
+void  init_search_r(struct search_ctx *ctx,           /* Pbmsrch.C      */
+                    const char *string);
+char *strsearch_r(const struct search_ctx *ctx,       /* Pbmsrch.C      */
+                  const char *string, const int stringlen);
+void  bmh_init_r(struct search_ctx *ctx,              /* Bmhsrch.C      */
+                 const char *pattern);
+char *bmh_search_r(const struct search_ctx *ctx,      /* Bmhsrch.C      */
+                   const char *string, const int stringlen);
+void  bmhi_init_r(struct search_ctx *ctx,             /* Bhmisrch.C     */
+                  const char *pattern);
+char *bmhi_search_r(const struct search_ctx *ctx,     /* Bhmisrch.C     */
+                    const char *string, const int stringlen);
+void  bmhi_cleanup_r(struct search_ctx *ctx);         /* Bhmisrch.C     */
+void  bmha_init_r(struct search_ctx *ctx,             /* Bmhasrch.C     */
+                  const char *pattern);
+char *bmha_search_r(const struct search_ctx *ctx,     /* Bmhasrch.C     */
+                    const char *string, const int stringlen);
+void  simd_init_r(struct search_ctx *ctx,             /* Simdsrch.C     */
+                  const char *pattern);
+char *simd_search_r(const struct search_ctx *ctx,     /* Simdsrch.C     */
+                    const char *string, const int stringlen);
+
+#define MP_AUTO   0                                   /* Mpsrch.C       */
+#define MP_AC     1
+#define MP_TEDDY  2
+#define MP_TEDDY_MAX 32                /* largest set for MP_TEDDY      */
+
+struct mpsearch;
+struct mpsearch *mp_init(const char **patterns,       /* Mpsrch.C       */
+                         const int npatterns, const int engine);
+char *mp_search(const struct mpsearch *m,             /* Mpsrch.C       */
+                const char *string, const int stringlen, int *which);
+int   mp_engine(const struct mpsearch *m);            /* Mpsrch.C       */
+void  mp_free(struct mpsearch *m);                    /* Mpsrch.C       */
@@ -0,0 +1,172 @@
+/* +++Date last modified: 18-Oct-2026 */
+
+/*
+**  Multi-threaded string search throughput benchmark
+**
+**  Maps a (large) file and counts every occurrence of a pattern with
+**  each of the reentrant search functions, splitting the file over N
+**  threads that each own their search_ctx.  The file is searched in
+**  blocks small enough for the BMH family; blocks overlap by
+**  patlen - 1 bytes and a match is counted by the block it starts in.
+**
+**  The case-sensitive algorithms must agree on the count; bmhi and
+**  bmha ignore case and are only reported.
+*/
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "search.h"
+
+#define BLOCK     16384
+#define MAXTHREADS 256
+
+struct algo {
+      const char *name;
+      void (*init)(struct search_ctx *, const char *);
+      int nocase;
+};
+
+static const struct algo algos[] = {
+      { "pbm",  init_search_r, 0 },
+      { "bmh",  bmh_init_r,    0 },
+      { "bmhi", bmhi_init_r,   1 },
+      { "bmha", bmha_init_r,   1 },
+      { "simd", simd_init_r,   0 },
+};
+
+struct job {
+      const struct algo *algo;
+      const char *pattern;
+      const char *text;
+      long size;
+      long lo, hi;                /* match starts counted by this job */
+      long count;
+};
+
+static double now(void)
+{
+      struct timeval tv;
+
+      gettimeofday(&tv, NULL);
+      return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void *run(void *arg)
+{
+      struct job *j = (struct job *)arg;
+      struct search_ctx ctx;
+      const char *p, *here;
+      long b, end, lim;
+      int patlen;
+
+      memset(&ctx, 0, sizeof(ctx));
+      j->algo->init(&ctx, j->pattern);
+      patlen = ctx.patlen;
+      j->count = 0;
+      for (b = j->lo; b < j->hi; b = end)
+      {
+            end = b + BLOCK < j->hi ? b + BLOCK : j->hi;
+            lim = end + patlen - 1 < j->size ? end + patlen - 1 : j->size;
+            for (p = j->text + b;
+                 (here = ctx.find(&ctx, p, lim - (p - j->text))) != NULL &&
+                 here < j->text + end; p = here + 1)
+                  ++j->count;
+      }
+      if (bmhi_init_r == j->algo->init)
+            bmhi_cleanup_r(&ctx);
+      return NULL;
+}
+
+int main(int argc, char **argv)
+{
+      struct job job[MAXTHREADS];
+      pthread_t tid[MAXTHREADS];
+      struct stat st;
+      const char *text;
+      long count, ref = -1;
+      int fd, nthreads = 1, a, i;
+      double t;
+
+      if (argc < 3)
+      {
+            fprintf(stderr, "USAGE: ./search_mt [FILE] [PATTERN] [THREADS]\n");
+            return 1;
+      }
+      if (argc > 3)
+            nthreads = atoi(argv[3]);
+      if (nthreads < 1)
+            nthreads = 1;
+      if (nthreads > MAXTHREADS)
+            nthreads = MAXTHREADS;
+      if (strlen(argv[2]) == 0 || strlen(argv[2]) >= BLOCK)
+      {
+            fprintf(stderr, "ERROR: pattern must be 1..%d bytes\n", BLOCK - 1);
+            return 1;
+      }
+
+      if ((fd = open(argv[1], O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+      {
+            perror(argv[1]);
+            return 1;
+      }
+      text = st.st_size ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)
+                        : "";
+      if (MAP_FAILED == text)
+      {
+            perror(argv[1]);
+            return 1;
+      }
+      close(fd);
+
+      printf("%ld bytes, \"%s\", %d threads\n", (long)st.st_size, argv[2],
+             nthreads);
+      for (a = 0; a < (int)(sizeof(algos) / sizeof(algos[0])); ++a)
+      {
+            t = now();
+            for (i = 0; i < nthreads; ++i)
+            {
+                  job[i].algo = &algos[a];
+                  job[i].pattern = argv[2];
+                  job[i].text = text;
+                  job[i].size = st.st_size;
+                  job[i].lo = st.st_size / nthreads * i;
+                  job[i].hi = i == nthreads - 1 ? st.st_size
+                                                : st.st_size / nthreads * (i + 1);
+                  if (i && pthread_create(&tid[i], NULL, run, &job[i]))
+                  {
+                        perror("pthread_create");
+                        return 1;
+                  }
+            }
+            run(&job[0]);
+            for (count = job[0].count, i = 1; i < nthreads; ++i)
+            {
+                  pthread_join(tid[i], NULL);
+                  count += job[i].count;
+            }
+            t = now() - t;
+
+            printf("%-5s %10ld matches%s %8.3f GB/s\n", algos[a].name, count,
+                   algos[a].nocase ? " (any case)" : "           ",
+                   t > 0 ? st.st_size / t / 1e9 : 0.0);
+            if (!algos[a].nocase)
+            {
+                  if (ref < 0)
+                        ref = count;
+                  else if (count != ref)
+                  {
+                        fprintf(stderr, "ERROR: %s disagrees with %s\n",
+                                algos[a].name, algos[0].name);
+                        return 1;
+                  }
+            }
+      }
+      return 0;
+}
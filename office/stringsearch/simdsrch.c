@@ -0,0 +1,138 @@
+/* +++Date last modified: 18-Oct-2026 */
+
+/*
+**  Case-sensitive SIMD substring search
+**
+**  For every candidate position i the first pattern byte is compared
+**  with string[i] and the last pattern byte with string[i + patlen - 1],
+**  32 (AVX2) or 16 (SSE2) positions at a time.  Only positions where
+**  both bytes match are checked with memcmp(), so the filter rejects
+**  nearly all positions without a branch per byte.
+**
+**  The AVX2 kernel is picked at run time by simd_init_r(); without it
+**  the SSE2 kernel (or plain C off x86) is used.  The vector kernels
+**  need a non-empty pattern and finish the tail in the next narrower
+**  kernel.
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include "search.h"
+typedef unsigned char uchar;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/*
+**  Plain C, also used for the tail of the vector kernels.
+*/
+
+static char *simd_search_c(const struct search_ctx *ctx, const char *string,
+                           const int stringlen)
+{
+      const uchar *pat = ctx->pat;
+      const int patlen = ctx->patlen;
+      const char *p = string, *end = string + stringlen - patlen;
+
+      if (0 == patlen || stringlen < patlen)
+            return NULL;
+      for (; p <= end; ++p)
+      {
+            if ((p = memchr(p, pat[0], end - p + 1)) == NULL)
+                  return NULL;
+            if ((uchar)p[patlen - 1] == pat[patlen - 1] &&
+                0 == memcmp(p + 1, pat + 1, patlen - 1))
+                  return (char *)p;
+      }
+      return NULL;
+}
+
+#ifdef HAVE_X86_SIMD
+
+__attribute__((target("sse2")))
+static char *simd_search_sse2(const struct search_ctx *ctx,
+                              const char *string, const int stringlen)
+{
+      const uchar *pat = ctx->pat;
+      const int patlen = ctx->patlen, mid = patlen > 2 ? patlen - 2 : 0;
+      const __m128i first = _mm_set1_epi8((char)pat[0]);
+      const __m128i last = _mm_set1_epi8((char)pat[patlen - 1]);
+      __m128i a, b;
+      int i, bit, mask;
+
+      for (i = 0; i + 16 + patlen - 1 <= stringlen; i += 16)
+      {
+            a = _mm_loadu_si128((const __m128i *)(string + i));
+            b = _mm_loadu_si128((const __m128i *)(string + i + patlen - 1));
+            mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, a),
+                                                   _mm_cmpeq_epi8(last, b)));
+            while (mask)
+            {
+                  bit = __builtin_ctz(mask);
+                  if (0 == memcmp(string + i + bit + 1, pat + 1, mid))
+                        return (char *)string + i + bit;
+                  mask &= mask - 1;
+            }
+      }
+      return simd_search_c(ctx, string + i, stringlen - i);
+}
+
+__attribute__((target("avx2")))
+static char *simd_search_avx2(const struct search_ctx *ctx,
+                              const char *string, const int stringlen)
+{
+      const uchar *pat = ctx->pat;
+      const int patlen = ctx->patlen, mid = patlen > 2 ? patlen - 2 : 0;
+      const __m256i first = _mm256_set1_epi8((char)pat[0]);
+      const __m256i last = _mm256_set1_epi8((char)pat[patlen - 1]);
+      __m256i a, b;
+      int i, bit;
+      unsigned mask;
+
+      for (i = 0; i + 32 + patlen - 1 <= stringlen; i += 32)
+      {
+            a = _mm256_loadu_si256((const __m256i *)(string + i));
+            b = _mm256_loadu_si256((const __m256i *)(string + i + patlen - 1));
+            mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(
+                        _mm256_cmpeq_epi8(first, a),
+                        _mm256_cmpeq_epi8(last, b)));
+            while (mask)
+            {
+                  bit = __builtin_ctz(mask);
+                  if (0 == memcmp(string + i + bit + 1, pat + 1, mid))
+                        return (char *)string + i + bit;
+                  mask &= mask - 1;
+            }
+      }
+      return simd_search_sse2(ctx, string + i, stringlen - i);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+/*
+**  Call this with the string to locate.  The pattern is not copied.
+*/
+
+void simd_init_r(struct search_ctx *ctx, const char *pattern)
+{
+      ctx->pat = (uchar *)pattern;
+      ctx->patlen = strlen(pattern);
+      ctx->find = simd_search_c;
+#ifdef HAVE_X86_SIMD
+      if (ctx->patlen > 0)
+      {
+            if (__builtin_cpu_supports("avx2"))
+                  ctx->find = simd_search_avx2;
+            else if (__builtin_cpu_supports("sse2"))
+                  ctx->find = simd_search_sse2;
+      }
+#endif
+}
+
+char *simd_search_r(const struct search_ctx *ctx, const char *string,
+                    const int stringlen)
+{
+      return ctx->find(ctx, string, stringlen);
+}
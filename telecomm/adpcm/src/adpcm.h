@@ -17,3 +17,23 @@ struct adpcm_state {
 
 void adpcm_coder ARGS((short [], char [], int, struct adpcm_state *));
 void adpcm_decoder ARGS((char [], short [], int, struct adpcm_state *));
+
+extern int stepsizeTable[89];	/* in adpcm.c, used by adpcmblk.c too */
+
+/*
+** Framed mode (adpcmblk.c): the state is reset at every block, so blocks
+** can be coded independently.  A framed stream starts with the 4 bytes
+** ADPCM_FRAME_MAGIC and the block size in samples (32 bits, little
+** endian), followed by the blocks; only the last one may be shorter.
+*/
+#define ADPCM_FRAME_MAGIC	"IMAB"
+#define ADPCM_BLOCK_HEADER	4	/* bytes in front of every block */
+#define ADPCM_BLOCK_DEFAULT	1017	/* samples; 512 byte blocks */
+#define ADPCM_MAXTHREADS	64
+
+int adpcm_block_bytes ARGS((int));
+int adpcm_block_encode ARGS((short [], int, char []));
+int adpcm_block_decode ARGS((char [], int, short []));
+long adpcm_blocks_decode ARGS((char [], long, int, short []));
+long adpcm_frame_encode ARGS((short [], long, int, char [], int));
+long adpcm_frame_decode ARGS((char [], long, int, short [], int));
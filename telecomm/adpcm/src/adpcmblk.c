@@ -0,0 +1,354 @@
+/*
+** Framed ("block") mode for the Intel/DVI ADPCM coder.
+**
+** The plain coder carries valprev/index across the whole stream, so a
+** stream can only be coded from start to end.  In the framed mode the
+** state is reset every nsamples samples, IMA/WAV style: every block
+** starts with a 4 byte header
+**
+**	byte 0-1	first sample of the block, little endian
+**	byte 2		initial step index
+**	byte 3		1 if the last nibble of the block is padding
+**
+** followed by the remaining samples of the block, coded with
+** adpcm_coder() from that state.  Blocks can therefore be coded and
+** decoded independently, and in any order.  The initial step index is
+** derived from the block itself (the step that covers the first
+** difference), so it doesn't depend on the previous block either.
+**
+** adpcm_blocks_decode() decodes a run of equally sized blocks; with AVX2
+** it decodes eight of them at a time, one per 32 bit lane, which takes
+** the serial valpred/index dependency off the critical path.
+*/
+
+#include "adpcm.h"
+#include <pthread.h>
+#include <stddef.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAVE_AVX2_DECODER
+#include <immintrin.h>
+#endif
+
+/*
+** Number of bytes a block of nsamples samples takes.
+*/
+int
+adpcm_block_bytes(nsamples)
+    int nsamples;
+{
+    return ADPCM_BLOCK_HEADER + nsamples / 2;
+}
+
+/*
+** Code nsamples (>= 1) samples as one block.  Returns the number of
+** bytes written to outdata.
+*/
+int
+adpcm_block_encode(indata, nsamples, outdata)
+    short indata[];
+    int nsamples;
+    char outdata[];
+{
+    struct adpcm_state state;
+    int diff, index = 0;
+
+    if ( nsamples > 1 ) {
+	diff = indata[1] - indata[0];
+	if ( diff < 0 ) diff = -diff;
+	while ( index < 88 && 2*stepsizeTable[index] < diff )
+	    index++;
+    }
+    outdata[0] = indata[0] & 0xff;
+    outdata[1] = (indata[0] >> 8) & 0xff;
+    outdata[2] = index;
+    outdata[3] = (nsamples - 1) & 1;
+
+    state.valprev = indata[0];
+    state.index = index;
+    adpcm_coder(indata + 1, outdata + ADPCM_BLOCK_HEADER, nsamples - 1, &state);
+    return adpcm_block_bytes(nsamples);
+}
+
+/*
+** Decode one block of nbytes bytes.  Returns the number of samples
+** written to outdata, or -1 if the block is malformed.
+*/
+int
+adpcm_block_decode(indata, nbytes, outdata)
+    char indata[];
+    int nbytes;
+    short outdata[];
+{
+    struct adpcm_state state;
+    unsigned char *hdr = (unsigned char *)indata;
+    int ncoded;
+
+    if ( nbytes < ADPCM_BLOCK_HEADER || hdr[2] > 88 || hdr[3] > 1 )
+	return -1;
+    ncoded = 2*(nbytes - ADPCM_BLOCK_HEADER) - hdr[3];
+    if ( ncoded < 0 )
+	return -1;
+
+    state.valprev = (short)(hdr[0] | (hdr[1] << 8));
+    state.index = hdr[2];
+    outdata[0] = state.valprev;
+    adpcm_decoder(indata + ADPCM_BLOCK_HEADER, outdata + 1, ncoded, &state);
+    return ncoded + 1;
+}
+
+#ifdef HAVE_AVX2_DECODER
+
+/*
+** Decode eight blocks of nsamples samples each, lane b working on the
+** block at indata + b*nbytes.  Bit-exact with adpcm_decoder().
+*/
+__attribute__((target("avx2")))
+static void
+decode8(indata, nbytes, nsamples, outdata)
+    unsigned char *indata;
+    int nbytes;
+    int nsamples;
+    short outdata[];
+{
+    const __m256i idxtab = _mm256_setr_epi32(-1, -1, -1, -1, 2, 4, 6, 8);
+    const __m256i seven = _mm256_set1_epi32(7), eight = _mm256_set1_epi32(8);
+    const __m256i four = _mm256_set1_epi32(4), two = _mm256_set1_epi32(2);
+    const __m256i one = _mm256_set1_epi32(1), f = _mm256_set1_epi32(0xf);
+    const __m256i zero = _mm256_setzero_si256(), top = _mm256_set1_epi32(88);
+    const __m256i vmin = _mm256_set1_epi32(-32768);
+    const __m256i vmax = _mm256_set1_epi32(32767);
+    __m256i valpred, index, step, bytes, delta, d, vpdiff, sign;
+    int v[8], in[8], b, j;
+    unsigned char *p;
+
+    for ( b = 0; b < 8; b++ ) {
+	p = indata + b*nbytes;
+	v[b] = (short)(p[0] | (p[1] << 8));
+	in[b] = p[2];
+	outdata[b*nsamples] = v[b];
+    }
+    valpred = _mm256_loadu_si256((__m256i *)v);
+    index = _mm256_loadu_si256((__m256i *)in);
+    step = _mm256_i32gather_epi32(stepsizeTable, index, 4);
+    bytes = zero;		/* loaded every other sample */
+
+    p = indata + ADPCM_BLOCK_HEADER;
+    for ( j = 0; j < nsamples - 1; j++ ) {
+	/* Step 1 - get the delta values, high nibble first */
+	if ( (j & 1) == 0 ) {
+	    for ( b = 0; b < 8; b++ )
+		in[b] = p[b*nbytes + (j >> 1)];
+	    bytes = _mm256_loadu_si256((__m256i *)in);
+	    delta = _mm256_and_si256(_mm256_srli_epi32(bytes, 4), f);
+	} else
+	    delta = _mm256_and_si256(bytes, f);
+
+	/* Step 2 - Find new index value (for later) */
+	d = _mm256_and_si256(delta, seven);
+	index = _mm256_add_epi32(index, _mm256_permutevar8x32_epi32(idxtab, d));
+	index = _mm256_min_epi32(_mm256_max_epi32(index, zero), top);
+
+	/* Step 3/4 - Compute difference and new predicted value */
+	sign = _mm256_cmpeq_epi32(_mm256_and_si256(delta, eight), eight);
+	vpdiff = _mm256_srai_epi32(step, 3);
+	vpdiff = _mm256_add_epi32(vpdiff, _mm256_and_si256(step,
+		    _mm256_cmpeq_epi32(_mm256_and_si256(d, four), four)));
+	vpdiff = _mm256_add_epi32(vpdiff, _mm256_and_si256(
+		    _mm256_srai_epi32(step, 1),
+		    _mm256_cmpeq_epi32(_mm256_and_si256(d, two), two)));
+	vpdiff = _mm256_add_epi32(vpdiff, _mm256_and_si256(
+		    _mm256_srai_epi32(step, 2),
+		    _mm256_cmpeq_epi32(_mm256_and_si256(d, one), one)));
+	valpred = _mm256_blendv_epi8(_mm256_add_epi32(valpred, vpdiff),
+				     _mm256_sub_epi32(valpred, vpdiff), sign);
+
+	/* Step 5 - clamp output value */
+	valpred = _mm256_min_epi32(_mm256_max_epi32(valpred, vmin), vmax);
+
+	/* Step 6 - Update step value */
+	step = _mm256_i32gather_epi32(stepsizeTable, index, 4);
+
+	/* Step 7 - Output value */
+	_mm256_storeu_si256((__m256i *)v, valpred);
+	for ( b = 0; b < 8; b++ )
+	    outdata[b*nsamples + 1 + j] = v[b];
+    }
+}
+
+#endif /* HAVE_AVX2_DECODER */
+
+/*
+** Decode nblocks consecutive blocks of nsamples samples each.  Returns
+** the number of samples written, or -1 if a block is malformed.
+*/
+long
+adpcm_blocks_decode(indata, nblocks, nsamples, outdata)
+    char indata[];
+    long nblocks;
+    int nsamples;
+    short outdata[];
+{
+    int nbytes = adpcm_block_bytes(nsamples);
+    long i = 0, b;
+    unsigned char *hdr;
+
+    for ( b = 0; b < nblocks; b++ ) {
+	hdr = (unsigned char *)indata + b*nbytes;
+	if ( hdr[2] > 88 || hdr[3] != ((nsamples - 1) & 1) )
+	    return -1;
+    }
+#ifdef HAVE_AVX2_DECODER
+    if ( __builtin_cpu_supports("avx2") )
+	for ( ; i + 8 <= nblocks; i += 8 )
+	    decode8((unsigned char *)indata + i*nbytes, nbytes, nsamples,
+		    outdata + i*nsamples);
+#endif
+    for ( ; i < nblocks; i++ )
+	adpcm_block_decode(indata + i*nbytes, nbytes, outdata + i*nsamples);
+    return nblocks*nsamples;
+}
+
+/*
+** Whole buffers of blocks, split over nthreads threads.  Every thread
+** gets a contiguous run of full blocks; the short block at the end of
+** the stream, if any, is done by the caller.
+*/
+struct frame_job {
+    short *samples;
+    char *bytes;
+    long nblocks;
+    int nsamples;
+    long result;
+};
+
+static void *
+encode_job(arg)
+    void *arg;
+{
+    struct frame_job *j = (struct frame_job *)arg;
+    int nbytes = adpcm_block_bytes(j->nsamples);
+    long b;
+
+    for ( b = 0; b < j->nblocks; b++ )
+	adpcm_block_encode(j->samples + b*j->nsamples, j->nsamples,
+			   j->bytes + b*nbytes);
+    j->result = 0;
+    return NULL;
+}
+
+static void *
+decode_job(arg)
+    void *arg;
+{
+    struct frame_job *j = (struct frame_job *)arg;
+
+    j->result = adpcm_blocks_decode(j->bytes, j->nblocks, j->nsamples,
+				    j->samples);
+    return NULL;
+}
+
+static long
+run_jobs(fn, samples, bytes, nblocks, nsamples, nthreads)
+    void *(*fn)();
+    short *samples;
+    char *bytes;
+    long nblocks;
+    int nsamples;
+    int nthreads;
+{
+    struct frame_job job[ADPCM_MAXTHREADS];
+    pthread_t tid[ADPCM_MAXTHREADS];
+    char joinable[ADPCM_MAXTHREADS];
+    int nbytes = adpcm_block_bytes(nsamples), t;
+    long first = 0, result = 0;
+
+    if ( nthreads > ADPCM_MAXTHREADS ) nthreads = ADPCM_MAXTHREADS;
+    if ( nthreads > nblocks ) nthreads = nblocks;
+    if ( nthreads < 1 ) nthreads = 1;
+
+    for ( t = 0; t < nthreads; t++ ) {
+	job[t].nblocks = nblocks/nthreads + (t < nblocks % nthreads);
+	job[t].nsamples = nsamples;
+	job[t].samples = samples + first*nsamples;
+	job[t].bytes = bytes + first*nbytes;
+	first += job[t].nblocks;
+	joinable[t] = t && pthread_create(&tid[t], NULL, fn, &job[t]) == 0;
+	if ( t && !joinable[t] )
+	    fn(&job[t]);	/* no thread to spare, do it here */
+    }
+    fn(&job[0]);
+    for ( t = 0; t < nthreads; t++ ) {
+	if ( joinable[t] )
+	    pthread_join(tid[t], NULL);
+	if ( job[t].result < 0 )
+	    result = -1;
+    }
+    return result;
+}
+
+/*
+** Code nsamples samples as blocks of blocksize samples on nthreads
+** threads.  Returns the number of bytes written to outdata.
+*/
+long
+adpcm_frame_encode(indata, nsamples, blocksize, outdata, nthreads)
+    short indata[];
+    long nsamples;
+    int blocksize;
+    char outdata[];
+    int nthreads;
+{
+    long nblocks = nsamples / blocksize;
+    int rest = nsamples % blocksize;
+    long nbytes = nblocks * adpcm_block_bytes(blocksize);
+
+    if ( nblocks > 0 )
+	run_jobs(encode_job, indata, outdata, nblocks, blocksize, nthreads);
+    if ( rest > 0 )
+	nbytes += adpcm_block_encode(indata + nblocks*blocksize, rest,
+				     outdata + nbytes);
+    return nbytes;
+}
+
+/*
+** Decode nbytes bytes of blocks of blocksize samples on nthreads
+** threads.  Returns the number of samples written to outdata, or -1 if
+** a block is malformed.
+*/
+long
+adpcm_frame_decode(indata, nbytes, blocksize, outdata, nthreads)
+    char indata[];
+    long nbytes;
+    int blocksize;
+    short outdata[];
+    int nthreads;
+{
+    int blockbytes = adpcm_block_bytes(blocksize);
+    long nblocks = nbytes / blockbytes;
+    int rest = nbytes % blockbytes, n;
+    long nsamples;
+
+    /*
+    ** With an odd block size a short last block of blocksize-1 samples
+    ** takes as many bytes as a full one; its pad flag tells them apart.
+    */
+    if ( rest == 0 && nblocks > 0 &&
+	 indata[(nblocks - 1)*blockbytes + 3] != ((blocksize - 1) & 1) ) {
+	nblocks--;
+	rest = blockbytes;
+    }
+    nsamples = nblocks * blocksize;
+    if ( nblocks > 0 &&
+	 run_jobs(decode_job, outdata, indata, nblocks, blocksize,
+		  nthreads) < 0 )
+	return -1;
+    if ( rest > 0 ) {
+	n = adpcm_block_decode(indata + nblocks*blockbytes, rest,
+			       outdata + nsamples);
+	if ( n < 0 || n > blocksize )
+	    return -1;
+	nsamples += n;
+    }
+    return nsamples;
+}
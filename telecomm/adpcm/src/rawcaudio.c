@@ -1,29 +1,129 @@
 /* testc - Test adpcm coder */
+/*
+** rawcaudio [-b samples] [-j threads] < in.pcm > out.adpcm
+**
+** Without -b the whole input is coded as one stream, as always.  With
+** -b the output is framed (see adpcm.h) with blocks of that many
+** samples, which are coded on -j threads.
+*/
 
 #include "adpcm.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 struct adpcm_state state;
 
-#define NSAMPLES 1000
+#define NSAMPLES (1<<20)	/* even, so the stream splits on byte bounds */
 
-char	abuf[NSAMPLES/2];
 short	sbuf[NSAMPLES];
 
-main() {
-    int n;
+/* read() until the buffer is full or the input ends */
+static long
+readfull(fd, buf, nbytes)
+    int fd;
+    char *buf;
+    long nbytes;
+{
+    long got = 0, n;
 
-    while(1) {
-	n = read(0, sbuf, NSAMPLES*2);
+    while ( got < nbytes ) {
+	n = read(fd, buf + got, nbytes - got);
 	if ( n < 0 ) {
 	    perror("input file");
 	    exit(1);
 	}
 	if ( n == 0 ) break;
-	adpcm_coder(sbuf, abuf, n/2, &state);
-	write(1, abuf, n/4);
+	got += n;
     }
-    fprintf(stderr, "Final valprev=%d, index=%d\n",
-	    state.valprev, state.index);
+    return got;
+}
+
+static void
+writefull(fd, buf, nbytes)
+    int fd;
+    char *buf;
+    long nbytes;
+{
+    long n;
+
+    while ( nbytes > 0 ) {
+	n = write(fd, buf, nbytes);
+	if ( n <= 0 ) {
+	    perror("output file");
+	    exit(1);
+	}
+	buf += n;
+	nbytes -= n;
+    }
+}
+
+static void
+usage()
+{
+    fprintf(stderr, "usage: rawcaudio [-b samples] [-j threads]\n");
+    exit(1);
+}
+
+main(argc, argv)
+    int argc;
+    char **argv;
+{
+    long n, nsamples, nblocks = 0, len;
+    int blocksize = 0, nthreads = 1, c;
+    unsigned char hdr[8];
+    char *abuf;
+
+    while ( (c = getopt(argc, argv, "b:j:")) != -1 ) {
+	switch ( c ) {
+	case 'b':
+	    blocksize = atoi(optarg);
+	    if ( blocksize < 1 || blocksize > 0xffff ) usage();
+	    break;
+	case 'j':
+	    nthreads = atoi(optarg);
+	    if ( nthreads < 1 ) usage();
+	    break;
+	default:
+	    usage();
+	}
+    }
+    if ( optind != argc ) usage();
+
+    if ( blocksize == 0 ) {
+	abuf = malloc(NSAMPLES/2);
+	if ( abuf == NULL ) {
+	    perror("rawcaudio");
+	    exit(1);
+	}
+	while ( (n = readfull(0, (char *)sbuf, (long)NSAMPLES*2)) > 0 ) {
+	    adpcm_coder(sbuf, abuf, n/2, &state);
+	    writefull(1, abuf, n/4);
+	}
+	fprintf(stderr, "Final valprev=%d, index=%d\n",
+		state.valprev, state.index);
+	exit(0);
+    }
+
+    /* Whole blocks per buffer, so only the last block can be short */
+    nsamples = NSAMPLES - NSAMPLES % blocksize;
+    if ( nsamples == 0 ) nsamples = blocksize;
+    abuf = malloc((nsamples/blocksize + 1) * adpcm_block_bytes(blocksize));
+    if ( abuf == NULL ) {
+	perror("rawcaudio");
+	exit(1);
+    }
+    memcpy(hdr, ADPCM_FRAME_MAGIC, 4);
+    hdr[4] = blocksize & 0xff;
+    hdr[5] = (blocksize >> 8) & 0xff;
+    hdr[6] = hdr[7] = 0;
+    writefull(1, (char *)hdr, 8L);
+    while ( (n = readfull(0, (char *)sbuf, nsamples*2)) >= 2 ) {
+	len = adpcm_frame_encode(sbuf, n/2, blocksize, abuf, nthreads);
+	writefull(1, abuf, len);
+	nblocks += (n/2 + blocksize - 1) / blocksize;
+    }
+    fprintf(stderr, "Blocks=%ld of %d samples\n", nblocks, blocksize);
     exit(0);
 }
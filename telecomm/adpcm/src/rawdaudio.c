@@ -1,29 +1,139 @@
 /* testd - Test adpcm decoder */
+/*
+** rawdaudio [-f] [-j threads] < in.adpcm > out.pcm
+**
+** -f decodes a framed stream as written by rawcaudio -b, with the
+** blocks decoded on -j threads.
+*/
 
 #include "adpcm.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 struct adpcm_state state;
 
-#define NSAMPLES 1000
+#define NSAMPLES (1<<20)
 
 char	abuf[NSAMPLES/2];
-short	sbuf[NSAMPLES];
 
-main() {
-    int n;
+/* read() until the buffer is full or the input ends */
+static long
+readfull(fd, buf, nbytes)
+    int fd;
+    char *buf;
+    long nbytes;
+{
+    long got = 0, n;
 
-    while(1) {
-	n = read(0, abuf, NSAMPLES/2);
+    while ( got < nbytes ) {
+	n = read(fd, buf + got, nbytes - got);
 	if ( n < 0 ) {
 	    perror("input file");
 	    exit(1);
 	}
 	if ( n == 0 ) break;
-	adpcm_decoder(abuf, sbuf, n*2, &state);
-	write(1, sbuf, n*4);
+	got += n;
     }
-    fprintf(stderr, "Final valprev=%d, index=%d\n",
-	    state.valprev, state.index);
+    return got;
+}
+
+static void
+writefull(fd, buf, nbytes)
+    int fd;
+    char *buf;
+    long nbytes;
+{
+    long n;
+
+    while ( nbytes > 0 ) {
+	n = write(fd, buf, nbytes);
+	if ( n <= 0 ) {
+	    perror("output file");
+	    exit(1);
+	}
+	buf += n;
+	nbytes -= n;
+    }
+}
+
+static void
+usage()
+{
+    fprintf(stderr, "usage: rawdaudio [-f] [-j threads]\n");
+    exit(1);
+}
+
+main(argc, argv)
+    int argc;
+    char **argv;
+{
+    long n, nbytes, nsamples, nblocks = 0;
+    int framed = 0, nthreads = 1, blocksize, blockbytes, c;
+    unsigned char hdr[8];
+    short *sbuf;
+
+    while ( (c = getopt(argc, argv, "fj:")) != -1 ) {
+	switch ( c ) {
+	case 'f':
+	    framed = 1;
+	    break;
+	case 'j':
+	    nthreads = atoi(optarg);
+	    if ( nthreads < 1 ) usage();
+	    break;
+	default:
+	    usage();
+	}
+    }
+    if ( optind != argc ) usage();
+
+    if ( !framed ) {
+	sbuf = malloc((long)NSAMPLES*2);
+	if ( sbuf == NULL ) {
+	    perror("rawdaudio");
+	    exit(1);
+	}
+	while ( (n = readfull(0, abuf, (long)NSAMPLES/2)) > 0 ) {
+	    adpcm_decoder(abuf, sbuf, n*2, &state);
+	    writefull(1, (char *)sbuf, n*4);
+	}
+	fprintf(stderr, "Final valprev=%d, index=%d\n",
+		state.valprev, state.index);
+	exit(0);
+    }
+
+    if ( readfull(0, (char *)hdr, 8L) != 8 ||
+	 memcmp(hdr, ADPCM_FRAME_MAGIC, 4) != 0 ) {
+	fprintf(stderr, "rawdaudio: not a framed adpcm stream\n");
+	exit(1);
+    }
+    blocksize = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16) | (hdr[7] << 24);
+    if ( blocksize < 1 || blocksize > 0xffff ) {
+	fprintf(stderr, "rawdaudio: bad block size %d\n", blocksize);
+	exit(1);
+    }
+
+    /* Whole blocks per buffer, so only the last block can be short */
+    blockbytes = adpcm_block_bytes(blocksize);
+    nbytes = sizeof(abuf) - sizeof(abuf) % blockbytes;
+    if ( nbytes == 0 ) nbytes = blockbytes;
+    sbuf = malloc((nbytes/blockbytes) * blocksize * sizeof(short));
+    if ( sbuf == NULL || nbytes > sizeof(abuf) ) {
+	fprintf(stderr, "rawdaudio: block size %d too large\n", blocksize);
+	exit(1);
+    }
+    while ( (n = readfull(0, abuf, nbytes)) > 0 ) {
+	nsamples = adpcm_frame_decode(abuf, n, blocksize, sbuf, nthreads);
+	if ( nsamples < 0 ) {
+	    fprintf(stderr, "rawdaudio: corrupt block after %ld blocks\n",
+		    nblocks);
+	    exit(1);
+	}
+	writefull(1, (char *)sbuf, nsamples*2);
+	nblocks += (n + blockbytes - 1) / blockbytes;
+    }
+    fprintf(stderr, "Blocks=%ld of %d samples\n", nblocks, blocksize);
     exit(0);
 }
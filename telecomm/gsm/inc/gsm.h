@@ -38,6 +38,7 @@
  */
 
 typedef struct gsm_state * 	gsm;
+typedef struct gsm_batch *	gsm_batch;		/* n channels	 */
 typedef short		   	gsm_signal;		/* signed 16 bit */
 typedef unsigned char		gsm_byte;
 typedef gsm_byte 		gsm_frame[33];		/* 33 * 8 bits	 */
@@ -60,9 +61,25 @@ extern int  gsm_option  GSM_P((gsm, int, int *));
 extern void gsm_encode  GSM_P((gsm, gsm_signal *, gsm_byte  *));
 extern int  gsm_decode  GSM_P((gsm, gsm_byte   *, gsm_signal *));
 
+extern void gsm_stream_encode GSM_P((gsm, gsm_signal *, gsm_byte   *, long));
+extern long gsm_stream_decode GSM_P((gsm, gsm_byte   *, gsm_signal *, long));
+
 extern int  gsm_explode GSM_P((gsm, gsm_byte   *, gsm_signal *));
 extern void gsm_implode GSM_P((gsm, gsm_signal *, gsm_byte   *));
 
+extern gsm_batch gsm_batch_create   GSM_P((int));
+extern void	 gsm_batch_destroy  GSM_P((gsm_batch));
+extern int	 gsm_batch_channels GSM_P((gsm_batch));
+extern gsm	 gsm_batch_channel  GSM_P((gsm_batch, int));
+
+extern void gsm_batch_encode GSM_P((gsm_batch, gsm_signal *, gsm_byte   *));
+extern int  gsm_batch_decode GSM_P((gsm_batch, gsm_byte   *, gsm_signal *));
+
+extern void gsm_farm_encode  GSM_P((gsm_batch, int,
+				    gsm_signal *, gsm_byte *, int));
+extern int  gsm_farm_decode  GSM_P((gsm_batch, int,
+				    gsm_byte *, gsm_signal *, int));
+
 #undef	GSM_P
 
 #endif	/* GSM_H */
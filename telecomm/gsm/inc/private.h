@@ -145,6 +145,15 @@ extern void Gsm_Coder P((
 		word	* xmaxc,/* [0..3] Coded maximum amplitude OUT	*/
 		word	* xMc	/* [13*4] normalized RPE samples OUT	*/));
 
+extern void Gsm_Long_Term_Coder P((
+		struct gsm_state	* S,
+		word	* d,	/* [0..159] short term residual	IN	*/
+		word	* Nc,	/* [0..3] LTP lag		OUT 	*/
+		word	* bc,	/* [0..3] coded LTP gain	OUT 	*/
+		word	* Mc,	/* [0..3] RPE grid selection	OUT     */
+		word	* xmaxc,/* [0..3] Coded maximum amplitude OUT	*/
+		word	* xMc	/* [13*4] normalized RPE samples OUT	*/));
+
 extern void Gsm_Long_Term_Predictor P((		/* 4x for 160 samples */
 		struct gsm_state * S,
 		word	* d,	/* [0..39]   residual signal	IN	*/
@@ -186,6 +195,19 @@ extern void Gsm_Decoder P((
 		word	* xMcr,		/* [0..13*4]		IN	*/
 		word	* s));		/* [0..159]		OUT 	*/
 
+extern void Gsm_Long_Term_Decoder P((
+		struct gsm_state * S,
+		word	* Ncr,		/* [0..3] 		IN 	*/
+		word	* bcr,		/* [0..3]		IN	*/
+		word	* Mcr,		/* [0..3] 		IN 	*/
+		word	* xmaxcr,	/* [0..3]		IN 	*/
+		word	* xMcr,		/* [0..13*4]		IN	*/
+		word	* wt));		/* [0..159]		OUT 	*/
+
+extern void Gsm_Postprocessing P((
+		struct gsm_state * S,
+		word	* s));		/* [0..159]		IN/OUT	*/
+
 extern void Gsm_Decoding P((
 		struct gsm_state * S,
 		word 	xmaxcr,
@@ -220,11 +242,38 @@ extern void Gsm_Short_Term_Synthesis_Filter P((
 		word	* drp,		/* received d [0...39]	   IN	*/
 		word	* s));		/* signal   s [0..159]	  OUT	*/
 
+/*
+ *  The short term filters of n channels in lockstep, one channel per
+ *  SIMD lane (short_term.c); d, LARc etc. point to each channel's data.
+ */
+extern void Gsm_Short_Term_Analysis_Filter_N P((
+		struct gsm_state ** S,
+		word	** LARc,	/* coded log area ratio [0..7]  IN	*/
+		word	** d,		/* st res. signal [0..159]	IN/OUT	*/
+		int	n));
+
+extern void Gsm_Short_Term_Synthesis_Filter_N P((
+		struct gsm_state ** S,
+		word	** LARcr, 	/* log area ratios [0..7]  IN	*/
+		word	** drp,		/* received d [0...159]	   IN	*/
+		word	** s,		/* signal   s [0..159]	  OUT	*/
+		int	n));
+
 extern void Gsm_Update_of_reconstructed_short_time_residual_signal P((
 		word	* dpp,		/* [0...39]	IN	*/
 		word	* ep,		/* [0...39]	IN	*/
 		word	* dp));		/* [-120...-1]  IN/OUT 	*/
 
+/*
+ *  SIMD kernel level (simd.c)
+ */
+#define	GSM_SIMD_NONE	0
+#define	GSM_SIMD_SSE2	1
+#define	GSM_SIMD_SSSE3	2
+#define	GSM_SIMD_AVX2	3
+
+extern int	Gsm_SIMD P((void));
+
 /*
  *  Tables from table.c
  */
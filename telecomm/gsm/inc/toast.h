@@ -98,8 +98,14 @@
 #include	"proto.h"
 
 extern int 	audio_init_input P((void)), audio_init_output P((void));
-extern int	ulaw_input   P((gsm_signal*)), ulaw_output   P((gsm_signal *));
-extern int	alaw_input   P((gsm_signal*)), alaw_output   P((gsm_signal *));
-extern int	linear_input P((gsm_signal*)), linear_output P((gsm_signal *));
+/*
+ *	Samples are read, converted and written this many frames
+ *	at a time.
+ */
+#define	TOAST_FRAMES		256
+
+extern int	ulaw_input   P((gsm_signal *, int)), ulaw_output   P((gsm_signal *, int));
+extern int	alaw_input   P((gsm_signal *, int)), alaw_output   P((gsm_signal *, int));
+extern int	linear_input P((gsm_signal *, int)), linear_output P((gsm_signal *, int));
 
 #endif		/* TOAST_H */
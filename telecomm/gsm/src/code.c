@@ -55,22 +55,47 @@ void Gsm_Coder P8((S,s,LARc,Nc,bc,Mc,xmaxc,xMc),
 	word	* xMc	/* [13*4] normalized RPE samples	OUT	*/
 )
 {
-	int	k;
-	word	* dp  = S->dp0 + 120;	/* [ -120...-1 ] */
-	word	* dpp = dp;		/* [ 0...39 ]	 */
-
-	static word	e [50] = {0};
-
 	word	so[160];
 
 	Gsm_Preprocess			(S, s, so);
 	Gsm_LPC_Analysis		(S, so, LARc);
 	Gsm_Short_Term_Analysis_Filter	(S, LARc, so);
+	Gsm_Long_Term_Coder		(S, so, Nc, bc, Mc, xmaxc, xMc);
+}
+
+/*
+ *  Procedures 4.2.11 to 4.2.18 for the four sub-segments of a frame
+ *  whose short term residual is d[0..159].  Split off Gsm_Coder so
+ *  that the batch coder (gsm_batch.c) can run the short term analysis
+ *  of many channels in lockstep before it.
+ */
+
+void Gsm_Long_Term_Coder P7((S,d,Nc,bc,Mc,xmaxc,xMc),
+	struct gsm_state	* S,
+	word	* d,	/* [0..159] short term residual		IN	*/
+	word	* Nc,	/* [0..3] LTP lag			OUT 	*/
+	word	* bc,	/* [0..3] coded LTP gain		OUT 	*/
+	word	* Mc,	/* [0..3] RPE grid selection		OUT     */
+	word	* xmaxc,/* [0..3] Coded maximum amplitude	OUT	*/
+	word	* xMc	/* [13*4] normalized RPE samples	OUT	*/
+)
+{
+	int	k;
+	word	* dp  = S->dp0 + 120;	/* [ -120...-1 ] */
+	word	* dpp = dp;		/* [ 0...39 ]	 */
+
+	/*  e[0..4] and e[45..49] are read by the weighting filter but
+	 *  never written.  Not static, so that states can be coded on
+	 *  several threads at once.
+	 */
+	word	e [50];
+
+	for (k = 0; k < 5; k++) e[k] = e[45 + k] = 0;
 
 	for (k = 0; k <= 3; k++, xMc += 13) {
 
 		Gsm_Long_Term_Predictor	( S,
-					 so+k*40, /* d      [0..39] IN	*/
+					 d+k*40,  /* d      [0..39] IN	*/
 					 dp,	  /* dp  [-120..-1] IN	*/
 					e + 5,	  /* e      [0..39] OUT	*/
 					dpp,	  /* dpp    [0..39] OUT */
@@ -16,7 +16,7 @@
  *  4.3 FIXED POINT IMPLEMENTATION OF THE RPE-LTP DECODER
  */
 
-static void Postprocessing P2((S,s),
+void Gsm_Postprocessing P2((S,s),
 	struct gsm_state	* S,
 	register word 		* s)
 {
@@ -45,9 +45,33 @@ void Gsm_Decoder P8((S,LARcr, Ncr,bcr,Mcr,xmaxcr,xMcr,s),
 	word		* xMcr,		/* [0..13*4]		IN	*/
 
 	word		* s)		/* [0..159]		OUT 	*/
+{
+	word		wt[160];
+
+	Gsm_Long_Term_Decoder( S, Ncr, bcr, Mcr, xmaxcr, xMcr, wt );
+	Gsm_Short_Term_Synthesis_Filter( S, LARcr, wt, s );
+	Gsm_Postprocessing(S, s);
+}
+
+/*
+ *  RPE decoding and long term synthesis of the four sub-segments,
+ *  giving the reconstructed short term residual wt[0..159].  Split off
+ *  Gsm_Decoder for the batch decoder (gsm_batch.c).
+ */
+
+void Gsm_Long_Term_Decoder P7((S,Ncr,bcr,Mcr,xmaxcr,xMcr,wt),
+	struct gsm_state	* S,
+
+	word		* Ncr,		/* [0..3] 		IN 	*/
+	word		* bcr,		/* [0..3]		IN	*/
+	word		* Mcr,		/* [0..3] 		IN 	*/
+	word		* xmaxcr,	/* [0..3]		IN 	*/
+	word		* xMcr,		/* [0..13*4]		IN	*/
+
+	word		* wt)		/* [0..159]		OUT 	*/
 {
 	int		j, k;
-	word		erp[40], wt[160];
+	word		erp[40];
 	word		* drp = S->dp0 + 120;
 
 	for (j=0; j <= 3; j++, xmaxcr++, bcr++, Ncr++, Mcr++, xMcr += 13) {
@@ -57,7 +81,4 @@ void Gsm_Decoder P8((S,LARcr, Ncr,bcr,Mcr,xmaxcr,xMcr,s),
 
 		for (k = 0; k <= 39; k++) wt[ j * 40 + k ] =  drp[ k ];
 	}
-
-	Gsm_Short_Term_Synthesis_Filter( S, LARcr, wt, s );
-	Postprocessing(S, s);
 }
@@ -0,0 +1,297 @@
+/*
+ *  Batch interface: n independent channels, each with its own
+ *  gsm_state, coded one frame per channel per call.  The per-channel
+ *  stages run channel after channel; the short term filters of all
+ *  channels run in lockstep, one channel per SIMD lane (short_term.c).
+ *  The output is the same as calling gsm_encode()/gsm_decode() on each
+ *  channel.
+ *
+ *  gsm_farm_encode()/gsm_farm_decode() code several frames per channel
+ *  and split the channels over threads.
+ */
+
+#include	"config.h"
+
+#ifdef	HAS_STRING_H
+#include	<string.h>
+#else
+#	include "proto.h"
+	extern char	* memset P((char *, int, int));
+#endif
+
+#ifdef	HAS_STDLIB_H
+#	include	<stdlib.h>
+#else
+#	ifdef	HAS_MALLOC_H
+#		include 	<malloc.h>
+#	else
+		extern char * malloc();
+		extern void free();
+#	endif
+#endif
+
+#include	<pthread.h>
+
+#include	"private.h"
+#include	"gsm.h"
+#include	"proto.h"
+
+#define	GROUP		64	/* channels per lockstep group	*/
+#define	SLICE		16	/* farm slices are multiples of	*/
+#define	MAXTHREADS	64
+
+struct gsm_batch {
+	int			n;
+	struct gsm_state	* S;	/* [0..n-1] */
+};
+
+gsm_batch gsm_batch_create P1((n), int n)
+{
+	gsm_batch	b;
+	int		i;
+
+	if (n < 1) return 0;
+	b = (gsm_batch)malloc(sizeof(*b));
+	if (!b) return b;
+	b->S = (struct gsm_state *)malloc(n * sizeof(struct gsm_state));
+	if (!b->S) {
+		free((char *)b);
+		return 0;
+	}
+	memset((char *)b->S, 0, n * sizeof(struct gsm_state));
+	for (i = 0; i < n; i++) b->S[i].nrp = 40;
+	b->n = n;
+	return b;
+}
+
+void gsm_batch_destroy P1((b), gsm_batch b)
+{
+	if (b) {
+		free((char *)b->S);
+		free((char *)b);
+	}
+}
+
+int gsm_batch_channels P1((b), gsm_batch b)
+{
+	return b->n;
+}
+
+/*  The state of channel i, for gsm_option().
+ */
+gsm gsm_batch_channel P2((b, i), gsm_batch b, int i)
+{
+	return i >= 0 && i < b->n ? b->S + i : 0;
+}
+
+/*
+ *  One frame for each of the n channels starting at S; source and c
+ *  hold n consecutive frames.
+ */
+static void encode_range P4((S, n, source, c),
+	struct gsm_state * S,
+	int		n,
+	gsm_signal	* source,	/* [0..n-1][0..159]	IN	*/
+	gsm_byte	* c)		/* [0..n-1][0..32]	OUT	*/
+{
+	word		so[GROUP][160], LARc[GROUP][8];
+	word		Nc[4], bc[4], Mc[4], xmaxc[4], xmc[13*4];
+	gsm_signal	p[76];
+	struct gsm_state * Sp[GROUP];
+	word		* sop[GROUP], * LARcp[GROUP];
+	int		m, i, k, j;
+
+	for (; n > 0; n -= m, S += m, source += m * 160, c += m * 33) {
+
+		m = n < GROUP ? n : GROUP;
+		for (i = 0; i < m; i++) {
+			Sp[i]    = S + i;
+			sop[i]   = so[i];
+			LARcp[i] = LARc[i];
+			Gsm_Preprocess	 (S + i, source + i * 160, so[i]);
+			Gsm_LPC_Analysis (S + i, so[i], LARc[i]);
+		}
+
+		Gsm_Short_Term_Analysis_Filter_N( Sp, LARcp, sop, m );
+
+		for (i = 0; i < m; i++) {
+			Gsm_Long_Term_Coder( S + i, so[i],
+					     Nc, bc, Mc, xmaxc, xmc );
+
+			/*  Parameters in the order gsm_implode() takes them
+			 */
+			for (k = 0; k < 8; k++) p[k] = LARc[i][k];
+			for (k = 0; k < 4; k++) {
+				p[8 + k * 17]     = Nc[k];
+				p[8 + k * 17 + 1] = bc[k];
+				p[8 + k * 17 + 2] = Mc[k];
+				p[8 + k * 17 + 3] = xmaxc[k];
+				for (j = 0; j < 13; j++)
+					p[8 + k * 17 + 4 + j] = xmc[k * 13 + j];
+			}
+			gsm_implode( S + i, p, c + i * 33 );
+		}
+	}
+}
+
+static int decode_range P4((S, n, c, target),
+	struct gsm_state * S,
+	int		n,
+	gsm_byte	* c,		/* [0..n-1][0..32]	IN	*/
+	gsm_signal	* target)	/* [0..n-1][0..159]	OUT	*/
+{
+	word		wt[GROUP][160], LARc[GROUP][8];
+	word		Nc[4], bc[4], Mc[4], xmaxc[4], xmc[13*4];
+	gsm_signal	p[76];
+	struct gsm_state * Sp[GROUP];
+	word		* wtp[GROUP], * LARcp[GROUP], * sp[GROUP];
+	int		m, i, k, j;
+
+	/*  Like gsm_decode(), touch nothing if a frame is bad
+	 */
+	for (i = 0; i < n; i++)
+		if (((c[i * 33] >> 4) & 0x0F) != GSM_MAGIC) return -1;
+
+	for (; n > 0; n -= m, S += m, c += m * 33, target += m * 160) {
+
+		m = n < GROUP ? n : GROUP;
+		for (i = 0; i < m; i++) {
+			Sp[i]    = S + i;
+			wtp[i]   = wt[i];
+			LARcp[i] = LARc[i];
+			sp[i]    = target + i * 160;
+
+			(void)gsm_explode( S + i, c + i * 33, p );
+			for (k = 0; k < 8; k++) LARc[i][k] = p[k];
+			for (k = 0; k < 4; k++) {
+				Nc[k]    = p[8 + k * 17];
+				bc[k]    = p[8 + k * 17 + 1];
+				Mc[k]    = p[8 + k * 17 + 2];
+				xmaxc[k] = p[8 + k * 17 + 3];
+				for (j = 0; j < 13; j++)
+					xmc[k * 13 + j] = p[8 + k * 17 + 4 + j];
+			}
+			Gsm_Long_Term_Decoder( S + i, Nc, bc, Mc, xmaxc, xmc,
+					       wt[i] );
+		}
+
+		Gsm_Short_Term_Synthesis_Filter_N( Sp, LARcp, wtp, sp, m );
+
+		for (i = 0; i < m; i++)
+			Gsm_Postprocessing( S + i, sp[i] );
+	}
+	return 0;
+}
+
+/*  One frame per channel: source[i * 160 .. i * 160 + 159] is channel i's.
+ */
+void gsm_batch_encode P3((b, source, c),
+	gsm_batch b, gsm_signal * source, gsm_byte * c)
+{
+	encode_range( b->S, b->n, source, c );
+}
+
+int gsm_batch_decode P3((b, c, target),
+	gsm_batch b, gsm_byte * c, gsm_signal * target)
+{
+	return decode_range( b->S, b->n, c, target );
+}
+
+/*
+ *  The farm: nframes frames per channel, frame-major (frame f of
+ *  channel i is at (f * n + i) * 160 resp. * 33), as if gsm_batch_encode
+ *  were called nframes times.  Each thread takes a slice of the
+ *  channels through all frames, so the threads never wait on each
+ *  other.
+ */
+struct farm_job {
+	gsm_batch	b;
+	int		lo, hi, nframes;
+	gsm_signal	* pcm;
+	gsm_byte	* gsm;
+	int		result;
+};
+
+static void * farm_encode_job P1((arg), void * arg)
+{
+	struct farm_job	* j = (struct farm_job *)arg;
+	long		f, at;
+
+	for (f = 0; f < j->nframes; f++) {
+		at = f * j->b->n + j->lo;
+		encode_range( j->b->S + j->lo, j->hi - j->lo,
+			      j->pcm + at * 160, j->gsm + at * 33 );
+	}
+	j->result = 0;
+	return 0;
+}
+
+static void * farm_decode_job P1((arg), void * arg)
+{
+	struct farm_job	* j = (struct farm_job *)arg;
+	long		f, at;
+
+	j->result = 0;
+	for (f = 0; f < j->nframes; f++) {
+		at = f * j->b->n + j->lo;
+		if (decode_range( j->b->S + j->lo, j->hi - j->lo,
+				  j->gsm + at * 33, j->pcm + at * 160 ) < 0)
+			j->result = -1;
+	}
+	return 0;
+}
+
+static int farm P6((b, nframes, pcm, c, nthreads, fn),
+	gsm_batch	b,
+	int		nframes,
+	gsm_signal	* pcm,
+	gsm_byte	* c,
+	int		nthreads,
+	void *		(* fn)())
+{
+	struct farm_job	job[MAXTHREADS];
+	pthread_t	tid[MAXTHREADS];
+	char		joinable[MAXTHREADS];
+	int		per, t, lo, result = 0;
+
+	if (nthreads > MAXTHREADS) nthreads = MAXTHREADS;
+	if (nthreads < 1) nthreads = 1;
+
+	/*  Slices in whole lane groups, so that no group is split
+	 */
+	per = (b->n + nthreads - 1) / nthreads;
+	per = (per + SLICE - 1) / SLICE * SLICE;
+
+	for (t = 0, lo = 0; lo < b->n; t++, lo += per) {
+		job[t].b       = b;
+		job[t].lo      = lo;
+		job[t].hi      = lo + per < b->n ? lo + per : b->n;
+		job[t].nframes = nframes;
+		job[t].pcm     = pcm;
+		job[t].gsm     = c;
+		joinable[t] = t && !pthread_create(tid + t, 0, fn, job + t);
+		if (t && !joinable[t]) (*fn)(job + t);
+	}
+	(*fn)(job);
+	while (t--) {
+		if (joinable[t]) pthread_join(tid[t], 0);
+		if (job[t].result < 0) result = -1;
+	}
+	return result;
+}
+
+void gsm_farm_encode P5((b, nframes, source, c, nthreads),
+	gsm_batch b, int nframes, gsm_signal * source, gsm_byte * c,
+	int nthreads)
+{
+	(void)farm( b, nframes, source, c, nthreads, farm_encode_job );
+}
+
+/*  Returns -1 if a frame was bad; the rest of its slice is still decoded.
+ */
+int gsm_farm_decode P5((b, nframes, c, target, nthreads),
+	gsm_batch b, int nframes, gsm_byte * c, gsm_signal * target,
+	int nthreads)
+{
+	return farm( b, nframes, target, c, nthreads, farm_decode_job );
+}
@@ -0,0 +1,39 @@
+/*
+ *  Stream interface: code a whole buffer of consecutive frames of one
+ *  channel in one call.  The result is the same as calling
+ *  gsm_encode()/gsm_decode() frame after frame; callers that move
+ *  large blocks (toast) pay for one call and one I/O request per
+ *  buffer instead of per 20 ms frame.
+ */
+
+#include	"private.h"
+#include	"gsm.h"
+#include	"proto.h"
+
+void gsm_stream_encode P4((s, source, c, nframes),
+	gsm		s,
+	gsm_signal	* source,
+	gsm_byte	* c,
+	long		nframes)
+{
+	for (; nframes > 0; nframes--, source += 160, c += sizeof(gsm_frame))
+		gsm_encode(s, source, c);
+}
+
+/*
+ *  Returns the number of frames decoded.  If that is less than
+ *  nframes, the frame after the last one decoded is bad (no magic);
+ *  the frames before it have been written to target.
+ */
+long gsm_stream_decode P4((s, c, target, nframes),
+	gsm		s,
+	gsm_byte	* c,
+	gsm_signal	* target,
+	long		nframes)
+{
+	long	n;
+
+	for (n = 0; n < nframes; n++, c += sizeof(gsm_frame), target += 160)
+		if (gsm_decode(s, c, target)) break;
+	return n;
+}
@@ -0,0 +1,225 @@
+/*
+ *  gsmbench -- how many concurrent calls a core can transcode.
+ *
+ *	gsmbench [-c calls] [-j threads] [-s seconds] file
+ *
+ *  Every call gets its own gsm state and a different stretch of the
+ *  input (a Sun .au file, u-law or 16 bit linear, or raw host-order 16
+ *  bit linear).  The calls are encoded and decoded three ways: a
+ *  gsm_encode()/gsm_decode() loop over the calls, the batch interface
+ *  on one thread, and the farm on -j threads.  All three must produce
+ *  the same bytes.  "calls/core" is the number of calls that could run
+ *  in real time (8000 samples/s) on one core.
+ */
+
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<sys/time.h>
+
+#include	"gsm.h"
+#include	"proto.h"
+
+#define	FRAME	160
+
+static char	* progname;
+
+extern int	getopt P((int, char **, char *));
+extern int	optind;
+extern char	* optarg;
+
+static double now P0()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static gsm_signal ulaw2linear P1((u), int u)
+{
+	int	t;
+
+	u = ~u & 0xFF;
+	t = (((u & 0x0F) << 3) + 0x84) << ((u & 0x70) >> 4);
+	return (u & 0x80) ? 0x84 - t : t - 0x84;
+}
+
+/*  The samples of a file; *n gets their number.
+ */
+static gsm_signal * load P2((name, n), char * name, long * n)
+{
+	FILE		* f = fopen(name, "rb");
+	unsigned char	* b;
+	gsm_signal	* s;
+	long		size, off = 0, i;
+	int		enc = 3, raw = 1;
+
+	if (!f || fseek(f, 0L, SEEK_END) || (size = ftell(f)) < 0) {
+		perror(name);
+		exit(1);
+	}
+	rewind(f);
+	b = (unsigned char *)malloc(size + 1);
+	if (!b || fread(b, 1, size, f) != (size_t)size) {
+		perror(name);
+		exit(1);
+	}
+	fclose(f);
+
+	if (size >= 24 && !memcmp(b, ".snd", 4)) {
+		off = (long)b[4] << 24 | (long)b[5] << 16 | b[6] << 8 | b[7];
+		enc = b[15];
+		raw = 0;
+		if (off > size || (enc != 1 && enc != 3)) {
+			fprintf(stderr, "%s: %s: unsupported .au encoding\n",
+				progname, name);
+			exit(1);
+		}
+	}
+	*n = enc == 1 ? size - off : (size - off) / 2;
+	s = (gsm_signal *)malloc((*n + 1) * sizeof(*s));
+	if (!s) {
+		perror(progname);
+		exit(1);
+	}
+	for (i = 0; i < *n; i++) {
+		if (enc == 1)
+			s[i] = ulaw2linear(b[off + i]);
+		else if (raw)
+			memcpy(s + i, b + off + 2 * i, 2);
+		else
+			s[i] = (gsm_signal)(b[off + 2 * i] << 8 | b[off + 2 * i + 1]);
+	}
+	free(b);
+	return s;
+}
+
+static void report P5((what, how, t, audio, threads),
+	char * what, char * how, double t, double audio, int threads)
+{
+	printf("%s %-10s %8.3f s %10.1f x real time %8.1f calls/core\n",
+		what, how, t, t > 0 ? audio / t : 0.0,
+		t > 0 ? audio / t / threads : 0.0);
+}
+
+static void same P4((what, a, b, n), char * what, void * a, void * b, long n)
+{
+	if (memcmp(a, b, n)) {
+		fprintf(stderr, "%s: %s output differs from the reference\n",
+			progname, what);
+		exit(1);
+	}
+}
+
+int main P2((ac, av), int ac, char ** av)
+{
+	int		calls = 256, threads = 1, seconds = 5, frames, opt;
+	long		nsamples, i, f, len;
+	gsm_signal	* audio, * pcm, * out, * ref_out;
+	gsm_byte	* ref, * code;
+	gsm		* g;
+	gsm_batch	b;
+	double		t, secs;
+
+	progname = av[0];
+	while ((opt = getopt(ac, av, "c:j:s:")) != EOF) switch (opt) {
+	case 'c': calls   = atoi(optarg); break;
+	case 'j': threads = atoi(optarg); break;
+	case 's': seconds = atoi(optarg); break;
+	default:  goto usage;
+	}
+	if (optind != ac - 1 || calls < 1 || threads < 1 || seconds < 1) {
+usage:		fprintf(stderr,
+			"usage: %s [-c calls] [-j threads] [-s seconds] file\n",
+			progname);
+		return 1;
+	}
+
+	audio = load(av[optind], &nsamples);
+	if (nsamples < FRAME) {
+		fprintf(stderr, "%s: %s: too short\n", progname, av[optind]);
+		return 1;
+	}
+	frames = seconds * 8000 / FRAME;
+	len    = (long)calls * frames;
+	pcm     = (gsm_signal *)malloc(len * FRAME * sizeof(gsm_signal));
+	out     = (gsm_signal *)malloc(len * FRAME * sizeof(gsm_signal));
+	ref_out = (gsm_signal *)malloc(len * FRAME * sizeof(gsm_signal));
+	ref     = (gsm_byte *)malloc(len * sizeof(gsm_frame));
+	code    = (gsm_byte *)malloc(len * sizeof(gsm_frame));
+	g       = (gsm *)malloc(calls * sizeof(gsm));
+	if (!pcm || !out || !ref_out || !ref || !code || !g) {
+		perror(progname);
+		return 1;
+	}
+
+	/*  Frame f of call i, frame-major; call i starts 997 frames
+	 *  after call i - 1, wrapping around the input.
+	 */
+	for (f = 0; f < frames; f++)
+		for (i = 0; i < calls; i++) {
+			long	at = ((i * 997 + f) * FRAME) % (nsamples - FRAME + 1);
+			memcpy(pcm + (f * calls + i) * FRAME, audio + at,
+				FRAME * sizeof(gsm_signal));
+		}
+	secs = (double)calls * frames * FRAME / 8000;
+	printf("%d calls x %d s, %d threads\n", calls, seconds, threads);
+
+	/*  Encode
+	 */
+	for (i = 0; i < calls; i++) g[i] = gsm_create();
+	t = now();
+	for (f = 0; f < len; f++)
+		gsm_encode(g[f % calls], pcm + f * FRAME, ref + f * 33);
+	report("encode", "gsm_encode", now() - t, secs, 1);
+	for (i = 0; i < calls; i++) gsm_destroy(g[i]);
+
+	b = gsm_batch_create(calls);
+	t = now();
+	for (f = 0; f < frames; f++)
+		gsm_batch_encode(b, pcm + f * calls * FRAME,
+				    code + f * calls * 33);
+	report("encode", "batch", now() - t, secs, 1);
+	same("batch encode", ref, code, len * 33);
+	gsm_batch_destroy(b);
+
+	b = gsm_batch_create(calls);
+	memset(code, 0, len * 33);
+	t = now();
+	gsm_farm_encode(b, frames, pcm, code, threads);
+	report("encode", "farm", now() - t, secs, threads);
+	same("farm encode", ref, code, len * 33);
+	gsm_batch_destroy(b);
+
+	/*  Decode
+	 */
+	for (i = 0; i < calls; i++) g[i] = gsm_create();
+	t = now();
+	for (f = 0; f < len; f++)
+		gsm_decode(g[f % calls], ref + f * 33, ref_out + f * FRAME);
+	report("decode", "gsm_decode", now() - t, secs, 1);
+	for (i = 0; i < calls; i++) gsm_destroy(g[i]);
+
+	b = gsm_batch_create(calls);
+	t = now();
+	for (f = 0; f < frames; f++)
+		gsm_batch_decode(b, ref + f * calls * 33,
+				    out + f * calls * FRAME);
+	report("decode", "batch", now() - t, secs, 1);
+	same("batch decode", ref_out, out, len * FRAME * sizeof(gsm_signal));
+	gsm_batch_destroy(b);
+
+	b = gsm_batch_create(calls);
+	memset(out, 0, len * FRAME * sizeof(gsm_signal));
+	t = now();
+	if (gsm_farm_decode(b, frames, ref, out, threads) < 0) {
+		fprintf(stderr, "%s: bad frame\n", progname);
+		return 1;
+	}
+	report("decode", "farm", now() - t, secs, threads);
+	same("farm decode", ref_out, out, len * FRAME * sizeof(gsm_signal));
+	gsm_batch_destroy(b);
+
+	return 0;
+}
@@ -70,6 +70,118 @@ init_umul_table()
 
 #ifndef  USE_FLOAT_MUL
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& !defined(USE_TABLE_MUL)
+#	define	HAVE_SIMD_LTP
+#	include	<immintrin.h>
+#endif
+
+#ifdef	HAVE_SIMD_LTP
+
+/*
+ *  The cross-correlation for all lags at once, with PMADDWD.
+ *
+ *  |wt[k]| <= 512 (d[] is scaled to 9 bits and a sign), so a sum of 40
+ *  products wt[k] * dp[k - lambda] stays below 2^30 and the 32 bit
+ *  lanes give exactly the sums of the reference loop.
+ *
+ *  x[] is dp[-128..-1] followed by 8 zeros, so that the kernels can
+ *  do lags 40..127 in groups of 4 or 8 and read 48 samples per lag;
+ *  L[lambda - 40] gets the correlation for lag lambda.
+ */
+
+__attribute__((target("sse2")))
+static void Cross_correlation_sse2 P3((wt,xp,L),
+	word		* wt,	/* [0..47], zero from 40	IN	*/
+	word		* xp,	/* x + 128, i.e. dp		IN	*/
+	longword	* L)	/* [0..87]			OUT	*/
+{
+	__m128i		w[5], a[4], t0, t1, t2, t3;
+	int		r[4], lambda, j, c;
+
+	for (c = 0; c < 5; c++)
+		w[c] = _mm_loadu_si128((__m128i *)(wt + 8 * c));
+
+	for (lambda = 40; lambda <= 120; lambda += 4) {
+		for (j = 0; j < 4; j++) {
+			word	* p = xp - (lambda + j);
+
+			a[j] = _mm_madd_epi16(w[0], _mm_loadu_si128((__m128i *)p));
+			for (c = 1; c < 5; c++)
+				a[j] = _mm_add_epi32(a[j], _mm_madd_epi16(w[c],
+				       _mm_loadu_si128((__m128i *)(p + 8 * c))));
+		}
+		/*  Transpose and add: r[j] = sum of the lanes of a[j]
+		 */
+		t0 = _mm_add_epi32(_mm_unpacklo_epi32(a[0], a[1]),
+				   _mm_unpackhi_epi32(a[0], a[1]));
+		t1 = _mm_add_epi32(_mm_unpacklo_epi32(a[2], a[3]),
+				   _mm_unpackhi_epi32(a[2], a[3]));
+		t2 = _mm_unpacklo_epi64(t0, t1);
+		t3 = _mm_unpackhi_epi64(t0, t1);
+		_mm_storeu_si128((__m128i *)r, _mm_add_epi32(t2, t3));
+
+		for (j = 0; j < 4; j++) L[lambda - 40 + j] = r[j];
+	}
+}
+
+__attribute__((target("avx2")))
+static void Cross_correlation_avx2 P3((wt,xp,L),
+	word		* wt,
+	word		* xp,
+	longword	* L)
+{
+	__m256i		w[3], a[8], h01, h23, h45, h67, lo, hi;
+	int		r[8], lambda, j, c;
+
+	for (c = 0; c < 3; c++)
+		w[c] = _mm256_loadu_si256((__m256i *)(wt + 16 * c));
+
+	for (lambda = 40; lambda <= 120; lambda += 8) {
+		for (j = 0; j < 8; j++) {
+			word	* p = xp - (lambda + j);
+
+			a[j] = _mm256_madd_epi16(w[0],
+				_mm256_loadu_si256((__m256i *)p));
+			for (c = 1; c < 3; c++)
+				a[j] = _mm256_add_epi32(a[j], _mm256_madd_epi16(w[c],
+				       _mm256_loadu_si256((__m256i *)(p + 16 * c))));
+		}
+		h01 = _mm256_hadd_epi32(a[0], a[1]);
+		h23 = _mm256_hadd_epi32(a[2], a[3]);
+		h45 = _mm256_hadd_epi32(a[4], a[5]);
+		h67 = _mm256_hadd_epi32(a[6], a[7]);
+		h01 = _mm256_hadd_epi32(h01, h23);	/* 0 1 2 3 | 0 1 2 3 */
+		h45 = _mm256_hadd_epi32(h45, h67);	/* 4 5 6 7 | 4 5 6 7 */
+		lo  = _mm256_permute2x128_si256(h01, h45, 0x20);
+		hi  = _mm256_permute2x128_si256(h01, h45, 0x31);
+		_mm256_storeu_si256((__m256i *)r, _mm256_add_epi32(lo, hi));
+
+		for (j = 0; j < 8; j++) L[lambda - 40 + j] = r[j];
+	}
+}
+
+static void Cross_correlation P3((wt,dp,L),
+	word		* wt,	/* [0..39]			IN	*/
+	word		* dp,	/* [-120..-1]			IN	*/
+	longword	* L)	/* [0..87]			OUT	*/
+{
+	word		w[48], x[136];
+	int		k;
+
+	for (k = 0; k < 40; k++)   w[k] = wt[k];
+	for (k = 40; k < 48; k++)  w[k] = 0;
+	for (k = 0; k < 8; k++)    x[k] = x[128 + k] = 0;
+	for (k = 0; k < 120; k++)  x[8 + k] = dp[k - 120];
+
+	if (Gsm_SIMD() >= GSM_SIMD_AVX2)
+		Cross_correlation_avx2( w, x + 128, L );
+	else
+		Cross_correlation_sse2( w, x + 128, L );
+}
+
+#endif	/* HAVE_SIMD_LTP */
+
 static void Calculation_of_the_LTP_parameters P4((d,dp,bc_out,Nc_out),
 	register word	* d,		/* [0..39]	IN	*/
 	register word	* dp,		/* [-120..-1]	IN	*/
@@ -117,6 +229,20 @@ static void Calculation_of_the_LTP_parameters P4((d,dp,bc_out,Nc_out),
 	L_max = 0;
 	Nc    = 40;	/* index for the maximum cross-correlation */
 
+#ifdef	HAVE_SIMD_LTP
+	if (Gsm_SIMD() >= GSM_SIMD_SSE2) {
+
+		longword	L_cc[ 88 ];
+
+		Cross_correlation( wt, dp, L_cc );
+		for (lambda = 40; lambda <= 120; lambda++)
+			if (L_cc[ lambda - 40 ] > L_max) {
+				Nc    = lambda;
+				L_max = L_cc[ lambda - 40 ];
+			}
+	}
+	else
+#endif
 	for (lambda = 40; lambda <= 120; lambda++) {
 
 # undef STEP
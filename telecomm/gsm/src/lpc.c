@@ -22,6 +22,102 @@
 
 /* 4.2.4 */
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& !defined(USE_FLOAT_MUL)
+#	define	HAVE_SIMD_ACF
+#	include	<immintrin.h>
+#endif
+
+#ifdef	HAVE_SIMD_ACF
+
+/*
+ *  L_ACF[0..8] of the scaled s[0..159] with PMADDWD.  After scaling
+ *  |s[i]| <= 2048, so every sum of up to 160 products fits in 31 bits
+ *  and the 32 bit lanes are exact.  x[] is s[] behind 8 zeros; lag k
+ *  multiplies s[i] by x[8 + i - k], which is zero for i < k.
+ */
+
+__attribute__((target("sse2")))
+static void Autocorrelation_sse2 P3((s, x, r),
+	word	* s,		/* [0..159]		IN	*/
+	word	* x,		/* [0..167]		IN	*/
+	int	* r)		/* [0..8], or more	OUT	*/
+{
+	__m128i		acc[9], v, t0, t1;
+	int		i, k;
+
+	for (k = 0; k < 9; k++) acc[k] = _mm_setzero_si128();
+	for (i = 0; i < 160; i += 8) {
+		v = _mm_loadu_si128((__m128i *)(s + i));
+		for (k = 0; k < 9; k++)
+			acc[k] = _mm_add_epi32(acc[k], _mm_madd_epi16(v,
+				 _mm_loadu_si128((__m128i *)(x + 8 + i - k))));
+	}
+	for (k = 0; k < 8; k += 4) {
+		t0 = _mm_add_epi32(_mm_unpacklo_epi32(acc[k], acc[k+1]),
+				   _mm_unpackhi_epi32(acc[k], acc[k+1]));
+		t1 = _mm_add_epi32(_mm_unpacklo_epi32(acc[k+2], acc[k+3]),
+				   _mm_unpackhi_epi32(acc[k+2], acc[k+3]));
+		_mm_storeu_si128((__m128i *)(r + k),
+			_mm_add_epi32(_mm_unpacklo_epi64(t0, t1),
+				      _mm_unpackhi_epi64(t0, t1)));
+	}
+	t0 = _mm_add_epi32(acc[8], _mm_shuffle_epi32(acc[8], 0x4E));
+	t0 = _mm_add_epi32(t0, _mm_shuffle_epi32(t0, 0xB1));
+	r[8] = _mm_cvtsi128_si32(t0);
+}
+
+__attribute__((target("avx2")))
+static void Autocorrelation_avx2 P3((s, x, r),
+	word	* s,
+	word	* x,
+	int	* r)
+{
+	__m256i		acc[9], v;
+	__m128i		t;
+	int		i, k;
+
+	for (k = 0; k < 9; k++) acc[k] = _mm256_setzero_si256();
+	for (i = 0; i < 160; i += 16) {
+		v = _mm256_loadu_si256((__m256i *)(s + i));
+		for (k = 0; k < 9; k++)
+			acc[k] = _mm256_add_epi32(acc[k], _mm256_madd_epi16(v,
+				 _mm256_loadu_si256((__m256i *)(x + 8 + i - k))));
+	}
+	acc[0] = _mm256_hadd_epi32(acc[0], acc[1]);
+	acc[2] = _mm256_hadd_epi32(acc[2], acc[3]);
+	acc[4] = _mm256_hadd_epi32(acc[4], acc[5]);
+	acc[6] = _mm256_hadd_epi32(acc[6], acc[7]);
+	acc[0] = _mm256_hadd_epi32(acc[0], acc[2]);	/* 0 1 2 3 | 0 1 2 3 */
+	acc[4] = _mm256_hadd_epi32(acc[4], acc[6]);	/* 4 5 6 7 | 4 5 6 7 */
+	_mm256_storeu_si256((__m256i *)r, _mm256_add_epi32(
+		_mm256_permute2x128_si256(acc[0], acc[4], 0x20),
+		_mm256_permute2x128_si256(acc[0], acc[4], 0x31)));
+
+	t = _mm_add_epi32(_mm256_castsi256_si128(acc[8]),
+			  _mm256_extracti128_si256(acc[8], 1));
+	t = _mm_add_epi32(t, _mm_shuffle_epi32(t, 0x4E));
+	t = _mm_add_epi32(t, _mm_shuffle_epi32(t, 0xB1));
+	r[8] = _mm_cvtsi128_si32(t);
+}
+
+static void Autocorrelation_simd P2((s, L_ACF),
+	word	 * s,		/* [0..159]	IN	*/
+	longword * L_ACF)	/* [0..8]	OUT	*/
+{
+	word		x[168];
+	int		r[9], k;
+
+	for (k = 0; k < 8; k++)   x[k] = 0;
+	for (k = 0; k < 160; k++) x[8 + k] = s[k];
+
+	if (Gsm_SIMD() >= GSM_SIMD_AVX2) Autocorrelation_avx2( s, x, r );
+	else				 Autocorrelation_sse2( s, x, r );
+
+	for (k = 0; k < 9; k++) L_ACF[k] = (longword)r[k] << 1;
+}
+
+#endif	/* HAVE_SIMD_ACF */
 
 static void Autocorrelation P2((s, L_ACF),
 	word     * s,		/* [0..159]	IN/OUT  */
@@ -90,6 +186,10 @@ static void Autocorrelation P2((s, L_ACF),
 
 	/*  Compute the L_ACF[..].
 	 */
+#ifdef	HAVE_SIMD_ACF
+	if (Gsm_SIMD() >= GSM_SIMD_SSE2) Autocorrelation_simd( s, L_ACF );
+	else
+#endif
 	{
 # ifdef	USE_FLOAT_MUL
 		register float * sp = float_s;
@@ -9,6 +9,14 @@
 #include <stdio.h>
 #include <assert.h>
 
+#include "config.h"
+#ifdef	HAS_STRING_H
+#include <string.h>
+#else
+#	include "proto.h"
+	extern char	* memset P((char *, int, int));
+#endif
+
 #include "private.h"
 
 #include "gsm.h"
@@ -427,3 +435,293 @@ void Gsm_Short_Term_Synthesis_Filter P4((S, LARcr, wt, s),
 	LARp_to_rp( LARp );
 	FILTER(S, LARp, 120, wt + 40, s + 40);
 }
+
+/*
+ *  MULTI-CHANNEL SHORT TERM FILTERING
+ *
+ *  The _N variants run the filters of n independent channels in
+ *  lockstep.  Decoding and interpolation of the LARs (4.2.8, 4.2.9) are
+ *  done per channel; the filtering itself runs GSM_LANES channels at a
+ *  time, channel c in 16 bit lane c.  That is bit-exact with the scalar
+ *  filters: GSM_ADD and GSM_SUB are saturating PADDSW and PSUBSW, and
+ *  GSM_MULT_R is PMULHRSW since rp[i] is never MIN_WORD (see
+ *  LARp_to_rp).
+ */
+
+#define	GSM_LANES	16
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& !(defined(FAST) && defined(USE_FLOAT_MUL))
+#	define	HAVE_LANES
+#	include	<immintrin.h>
+#endif
+
+#ifdef	HAVE_LANES
+
+/*
+ *  Lane data is kept transposed: x[t * GSM_LANES + c] is sample t of
+ *  the channel in lane c, rp[i * GSM_LANES + c] its coefficient i.
+ */
+
+__attribute__((target("avx2")))
+static void Short_term_analysis_filtering_avx2 P4((rp,u,k_n,s),
+	word	* rp,	/* [0..7][lanes]	IN	*/
+	word	* u,	/* [0..7][lanes]	IN/OUT	*/
+	int 	k_n, 	/*   k_end - k_start	*/
+	word	* s	/* [0..n-1][lanes]	IN/OUT	*/
+)
+{
+	__m256i		r[8], uu[8], di, sav, ui;
+	int		i;
+
+	for (i = 0; i < 8; i++) {
+		r[i]  = _mm256_loadu_si256((__m256i *)(rp + i * GSM_LANES));
+		uu[i] = _mm256_loadu_si256((__m256i *)(u  + i * GSM_LANES));
+	}
+	for (; k_n--; s += GSM_LANES) {
+
+		di = sav = _mm256_loadu_si256((__m256i *)s);
+
+		for (i = 0; i < 8; i++) {
+			ui    = uu[i];
+			uu[i] = sav;
+			sav   = _mm256_adds_epi16(ui,
+					_mm256_mulhrs_epi16(r[i], di));
+			di    = _mm256_adds_epi16(di,
+					_mm256_mulhrs_epi16(r[i], ui));
+		}
+		_mm256_storeu_si256((__m256i *)s, di);
+	}
+	for (i = 0; i < 8; i++)
+		_mm256_storeu_si256((__m256i *)(u + i * GSM_LANES), uu[i]);
+}
+
+/*  The same on 8 lanes; called once per half.
+ */
+__attribute__((target("ssse3")))
+static void Short_term_analysis_filtering_ssse3 P4((rp,u,k_n,s),
+	word	* rp,
+	word	* u,
+	int 	k_n,
+	word	* s
+)
+{
+	__m128i		r[8], uu[8], di, sav, ui;
+	int		i;
+
+	for (i = 0; i < 8; i++) {
+		r[i]  = _mm_loadu_si128((__m128i *)(rp + i * GSM_LANES));
+		uu[i] = _mm_loadu_si128((__m128i *)(u  + i * GSM_LANES));
+	}
+	for (; k_n--; s += GSM_LANES) {
+
+		di = sav = _mm_loadu_si128((__m128i *)s);
+
+		for (i = 0; i < 8; i++) {
+			ui    = uu[i];
+			uu[i] = sav;
+			sav   = _mm_adds_epi16(ui, _mm_mulhrs_epi16(r[i], di));
+			di    = _mm_adds_epi16(di, _mm_mulhrs_epi16(r[i], ui));
+		}
+		_mm_storeu_si128((__m128i *)s, di);
+	}
+	for (i = 0; i < 8; i++)
+		_mm_storeu_si128((__m128i *)(u + i * GSM_LANES), uu[i]);
+}
+
+__attribute__((target("avx2")))
+static void Short_term_synthesis_filtering_avx2 P5((rrp,v,k,wt,sr),
+	word	* rrp,	/* [0..7][lanes]	IN	*/
+	word	* v,	/* [0..8][lanes]	IN/OUT	*/
+	int	k,	/* k_end - k_start	*/
+	word	* wt,	/* [0..k-1][lanes]	IN	*/
+	word	* sr	/* [0..k-1][lanes]	OUT	*/
+)
+{
+	__m256i		r[8], vv[9], sri;
+	int		i;
+
+	for (i = 0; i < 8; i++)
+		r[i]  = _mm256_loadu_si256((__m256i *)(rrp + i * GSM_LANES));
+	for (i = 0; i < 9; i++)
+		vv[i] = _mm256_loadu_si256((__m256i *)(v + i * GSM_LANES));
+
+	for (; k--; wt += GSM_LANES, sr += GSM_LANES) {
+		sri = _mm256_loadu_si256((__m256i *)wt);
+		for (i = 8; i--;) {
+			sri     = _mm256_subs_epi16(sri,
+					_mm256_mulhrs_epi16(r[i], vv[i]));
+			vv[i+1] = _mm256_adds_epi16(vv[i],
+					_mm256_mulhrs_epi16(r[i], sri));
+		}
+		_mm256_storeu_si256((__m256i *)sr, vv[0] = sri);
+	}
+	for (i = 0; i < 9; i++)
+		_mm256_storeu_si256((__m256i *)(v + i * GSM_LANES), vv[i]);
+}
+
+__attribute__((target("ssse3")))
+static void Short_term_synthesis_filtering_ssse3 P5((rrp,v,k,wt,sr),
+	word	* rrp,
+	word	* v,
+	int	k,
+	word	* wt,
+	word	* sr
+)
+{
+	__m128i		r[8], vv[9], sri;
+	int		i;
+
+	for (i = 0; i < 8; i++)
+		r[i]  = _mm_loadu_si128((__m128i *)(rrp + i * GSM_LANES));
+	for (i = 0; i < 9; i++)
+		vv[i] = _mm_loadu_si128((__m128i *)(v + i * GSM_LANES));
+
+	for (; k--; wt += GSM_LANES, sr += GSM_LANES) {
+		sri = _mm_loadu_si128((__m128i *)wt);
+		for (i = 8; i--;) {
+			sri     = _mm_subs_epi16(sri, _mm_mulhrs_epi16(r[i], vv[i]));
+			vv[i+1] = _mm_adds_epi16(vv[i], _mm_mulhrs_epi16(r[i], sri));
+		}
+		_mm_storeu_si128((__m128i *)sr, vv[0] = sri);
+	}
+	for (i = 0; i < 9; i++)
+		_mm_storeu_si128((__m128i *)(v + i * GSM_LANES), vv[i]);
+}
+
+static int lanes_cpu P0()
+{
+	switch (Gsm_SIMD()) {
+	case GSM_SIMD_AVX2:	return 2;
+	case GSM_SIMD_SSSE3:	return 1;
+	default:		return 0;
+	}
+}
+
+/*
+ *  Coefficients of the four interpolation segments of one channel,
+ *  stored into lane c of rp[4][8][GSM_LANES].
+ */
+static void Lane_coefficients P4((S,LARc,rp,c),
+	struct gsm_state * S,
+	word	* LARc,
+	word	* rp,
+	int	c)
+{
+	word		* LARpp_j	= S->LARpp[ S->j      ];
+	word		* LARpp_j_1	= S->LARpp[ S->j ^= 1 ];
+	word		LARp[4][8];
+	int		i, k;
+
+	Decoding_of_the_coded_Log_Area_Ratios( LARc, LARpp_j );
+
+	Coefficients_0_12(  LARpp_j_1, LARpp_j, LARp[0] );
+	Coefficients_13_26( LARpp_j_1, LARpp_j, LARp[1] );
+	Coefficients_27_39( LARpp_j_1, LARpp_j, LARp[2] );
+	Coefficients_40_159( LARpp_j, LARp[3] );
+
+	for (k = 0; k < 4; k++) {
+		LARp_to_rp( LARp[k] );
+		for (i = 0; i < 8; i++)
+			rp[ (k * 8 + i) * GSM_LANES + c ] = LARp[k][i];
+	}
+}
+
+#endif	/* HAVE_LANES */
+
+void Gsm_Short_Term_Analysis_Filter_N P4((S,LARc,d,n),
+	struct gsm_state ** S,
+	word	** LARc,	/* coded log area ratio [0..7]  IN	*/
+	word	** d,		/* signal [0..159]		IN/OUT	*/
+	int	n)
+{
+#ifdef	HAVE_LANES
+	static int	seg[5] = { 0, 13, 27, 40, 160 };
+	word		rp[4 * 8 * GSM_LANES], u[8 * GSM_LANES];
+	word		x[160 * GSM_LANES];
+	int		cpu = lanes_cpu(), m, c, i, k, t;
+
+	for (; cpu && n > 0; n -= m, S += m, LARc += m, d += m) {
+
+		m = n < GSM_LANES ? n : GSM_LANES;
+		memset((char *)rp, 0, sizeof(rp));
+		memset((char *)u, 0, sizeof(u));
+		if (m < GSM_LANES) memset((char *)x, 0, sizeof(x));
+
+		for (c = 0; c < m; c++) {
+			Lane_coefficients( S[c], LARc[c], rp, c );
+			for (i = 0; i < 8; i++) u[ i * GSM_LANES + c ] = S[c]->u[i];
+			for (t = 0; t < 160; t++) x[ t * GSM_LANES + c ] = d[c][t];
+		}
+
+		for (k = 0; k < 4; k++) {
+			word	* r = rp + k * 8 * GSM_LANES;
+			word	* s = x + seg[k] * GSM_LANES;
+
+			if (cpu == 2)
+				Short_term_analysis_filtering_avx2(
+					r, u, seg[k+1] - seg[k], s );
+			else for (c = 0; c < m; c += 8)
+				Short_term_analysis_filtering_ssse3(
+					r + c, u + c, seg[k+1] - seg[k], s + c );
+		}
+
+		for (c = 0; c < m; c++) {
+			for (i = 0; i < 8; i++) S[c]->u[i] = u[ i * GSM_LANES + c ];
+			for (t = 0; t < 160; t++) d[c][t] = x[ t * GSM_LANES + c ];
+		}
+	}
+#endif
+	for (; n > 0; n--)
+		Gsm_Short_Term_Analysis_Filter( *S++, *LARc++, *d++ );
+}
+
+void Gsm_Short_Term_Synthesis_Filter_N P5((S,LARcr,wt,s,n),
+	struct gsm_state ** S,
+	word	** LARcr,	/* received log area ratios [0..7] IN  */
+	word	** wt,		/* received d [0..159]		   IN  */
+	word	** s,		/* signal   s [0..159]		  OUT  */
+	int	n)
+{
+#ifdef	HAVE_LANES
+	static int	seg[5] = { 0, 13, 27, 40, 160 };
+	word		rp[4 * 8 * GSM_LANES], v[9 * GSM_LANES];
+	word		x[160 * GSM_LANES];
+	int		cpu = lanes_cpu(), m, c, i, k, t;
+
+	for (; cpu && n > 0; n -= m, S += m, LARcr += m, wt += m, s += m) {
+
+		m = n < GSM_LANES ? n : GSM_LANES;
+		memset((char *)rp, 0, sizeof(rp));
+		memset((char *)v, 0, sizeof(v));
+		if (m < GSM_LANES) memset((char *)x, 0, sizeof(x));
+
+		for (c = 0; c < m; c++) {
+			Lane_coefficients( S[c], LARcr[c], rp, c );
+			for (i = 0; i < 9; i++) v[ i * GSM_LANES + c ] = S[c]->v[i];
+			for (t = 0; t < 160; t++) x[ t * GSM_LANES + c ] = wt[c][t];
+		}
+
+		/* in place: sample t is read before it is written */
+		for (k = 0; k < 4; k++) {
+			word	* r = rp + k * 8 * GSM_LANES;
+			word	* p = x + seg[k] * GSM_LANES;
+
+			if (cpu == 2)
+				Short_term_synthesis_filtering_avx2(
+					r, v, seg[k+1] - seg[k], p, p );
+			else for (c = 0; c < m; c += 8)
+				Short_term_synthesis_filtering_ssse3(
+					r + c, v + c, seg[k+1] - seg[k],
+					p + c, p + c );
+		}
+
+		for (c = 0; c < m; c++) {
+			for (i = 0; i < 9; i++) S[c]->v[i] = v[ i * GSM_LANES + c ];
+			for (t = 0; t < 160; t++) s[c][t] = x[ t * GSM_LANES + c ];
+		}
+	}
+#endif
+	for (; n > 0; n--)
+		Gsm_Short_Term_Synthesis_Filter( *S++, *LARcr++, *wt++, *s++ );
+}
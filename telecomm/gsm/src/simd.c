@@ -0,0 +1,41 @@
+/*
+ *  Which SIMD kernels the library may use.
+ *
+ *  The answer is the best level the CPU supports, capped by the
+ *  environment variable GSMSIMD if it is set (GSMSIMD=0 runs the
+ *  reference C code only), so that the test in tst/check can run the
+ *  correctness vectors through both paths.  All kernels are bit-exact
+ *  with the reference code.
+ */
+
+#include	"config.h"
+
+#ifdef	HAS_STDLIB_H
+#	include	<stdlib.h>
+#else
+	extern char * getenv();
+#endif
+
+#include	"private.h"
+#include	"gsm.h"
+#include	"proto.h"
+
+int Gsm_SIMD P0()
+{
+	static int	level = -1;
+	int		l = GSM_SIMD_NONE;
+	char		* env;
+
+	if (level < 0) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))	  l = GSM_SIMD_AVX2;
+		else if (__builtin_cpu_supports("ssse3")) l = GSM_SIMD_SSSE3;
+		else if (__builtin_cpu_supports("sse2"))  l = GSM_SIMD_SSE2;
+#endif
+		if ((env = getenv("GSMSIMD")) != 0 && atoi(env) < l)
+			l = atoi(env) < 0 ? GSM_SIMD_NONE : atoi(env);
+		level = l;
+	}
+	return level;
+}
@@ -26,9 +26,11 @@ FILE	*in, 	 *out;
 char	*inname, *outname;
 
 /*
- *  The function (*output)() writes a frame of 160 samples given as
- *  160 signed 16 bit values (gsm_signals) to <out>.
- *  The function (*input)() reads one such frame from <in>.
+ *  The function (*output)(buf, n) writes n samples given as n signed
+ *  16 bit values (gsm_signals) to <out>; n is a multiple of 160.
+ *  The function (*input)(buf, n) reads up to n such samples from <in>
+ *  and returns how many it got.  Both move whole blocks of up to
+ *  TOAST_FRAMES frames at a time.
  *  The function (*init_output)() begins output (e.g. writes a header).,
  *  The function (*init_input)() begins input (e.g. skips a header).
  *
@@ -41,8 +43,8 @@ char	*inname, *outname;
  *  for a format `foo' live in toast_foo.c.
  */
 
-int	(*output   ) P((gsm_signal *)),
-	(*input    ) P((gsm_signal *));
+int	(*output   ) P((gsm_signal *, int)),
+	(*input    ) P((gsm_signal *, int));
 int	(*init_input)  P((void)),
 	(*init_output) P((void));
 
@@ -55,8 +57,8 @@ struct fmtdesc {
 	int  (* init_input )  P((void)),
 	     (* init_output)  P((void));
 
-	int  (* input ) P((gsm_signal * )),
-	     (* output) P((gsm_signal * ));
+	int  (* input ) P((gsm_signal *, int)),
+	     (* output) P((gsm_signal *, int));
 
 } f_audio = {
 		"audio",
@@ -517,10 +519,10 @@ static int open_output P1((name), char *name)
 static int process_encode P0()
 {
 	gsm      	r;
-	gsm_signal    	s[ 160 ];
-	gsm_frame	d;
+	static gsm_signal	s[ TOAST_FRAMES * 160 ];
+	static gsm_frame	d[ TOAST_FRAMES ];
  
-	int		cc;
+	int		cc, n;
 
 	if (!(r = gsm_create())) {
 		perror(progname);
@@ -529,17 +531,23 @@ static int process_encode P0()
 	(void)gsm_option(r, GSM_OPT_FAST,    &f_fast);
 	(void)gsm_option(r, GSM_OPT_VERBOSE, &f_verbose);
 
-	while ((cc = (*input)(s)) > 0) {
-		if (cc < sizeof(s) / sizeof(*s))
-			memset((char *)(s+cc), 0, sizeof(s)-(cc * sizeof(*s)));
-		gsm_encode(r, s, d);
-		if (fwrite((char *)d, sizeof(d), 1, out) != 1) {
+	while ((cc = (*input)(s, sizeof(s) / sizeof(*s))) > 0) {
+
+		/*  Only the last block can be short; its partial
+		 *  frame is padded with silence.
+		 */
+		n = (cc + 159) / 160;
+		if (cc < n * 160)
+			memset((char *)(s+cc), 0, (n * 160 - cc) * sizeof(*s));
+		gsm_stream_encode(r, s, (gsm_byte *)d, n);
+		if (fwrite((char *)d, sizeof(*d), n, out) != n) {
 			perror(outname ? outname : "stdout");
 			fprintf(stderr, "%s: error writing to %s\n",
 				progname, outname ? outname : "stdout");
 			gsm_destroy(r);
 			return -1;
 		}
+		if (cc < sizeof(s) / sizeof(*s)) break;
 	}
 	if (cc < 0) {
 		perror(inname ? inname : "stdin");
@@ -556,10 +564,10 @@ static int process_encode P0()
 static int process_decode P0()
 {
 	gsm      	r;
-	gsm_frame	s;
-	gsm_signal	d[ 160 ];
+	static gsm_frame	s[ TOAST_FRAMES ];
+	static gsm_signal	d[ TOAST_FRAMES * 160 ];
  
-	int		cc;
+	int		cc, n, ok;
 
 	if (!(r = gsm_create())) {	/* malloc failed */
 		perror(progname);
@@ -570,34 +578,41 @@ static int process_decode P0()
 
 	while ((cc = fread(s, 1, sizeof(s), in)) > 0) {
 
-		if (cc != sizeof(s)) {
-			if (cc >= 0) fprintf(stderr,
-			"%s: incomplete frame (%d byte%s missing) from %s\n",
-					progname, sizeof(s) - cc,
-					"s" + (sizeof(s) - cc == 1),
-					inname ? inname : "stdin" );
+		/*  Decode and write the good frames of the block
+		 *  before complaining about the first bad one.
+		 */
+		n  = cc / sizeof(*s);
+		ok = gsm_stream_decode(r, (gsm_byte *)s, d, n);
+
+		if (ok > 0 && (*output)(d, ok * 160) < 0) {
+			perror(outname);
+			fprintf(stderr, "%s: error writing to %s\n",
+					progname, outname);
 			gsm_destroy(r);
-			errno = 0;
 			return -1;
 		}
-		if (gsm_decode(r, s, d)) {
+		if (ok < n) {
 			fprintf(stderr, "%s: bad frame in %s\n", 
 				progname, inname ? inname : "stdin");
 			gsm_destroy(r);
 			errno = 0;
 			return -1;
 		}
-
-		if ((*output)(d) < 0) {
-			perror(outname);
-			fprintf(stderr, "%s: error writing to %s\n",
-					progname, outname);
+		if (cc != n * sizeof(*s)) {
+			cc -= n * sizeof(*s);
+			fprintf(stderr,
+			"%s: incomplete frame (%d byte%s missing) from %s\n",
+					progname, sizeof(*s) - cc,
+					"s" + (sizeof(*s) - cc == 1),
+					inname ? inname : "stdin" );
 			gsm_destroy(r);
+			errno = 0;
 			return -1;
 		}
+		if (cc < sizeof(s)) break;
 	}
 
-	if (cc < 0) {
+	if (ferror(in)) {
 		perror(inname ? inname : "stdin" );
 		fprintf(stderr, "%s: error reading from %s\n", progname,
 			inname ? inname : "stdin");
@@ -313,21 +313,26 @@ static unsigned char  s2a[] = {
 	 91,219, 27,155,123,251, 59,187, 75,203, 11,139,107,235, 43,171
 };
 
-int alaw_input P1((buf), gsm_signal * buf) 
+/*
+ *  Whole blocks are moved with one fread()/fwrite() through a byte
+ *  buffer and converted with the tables above.
+ */
+static unsigned char	abuf[ TOAST_FRAMES * 160 ];
+
+int alaw_input P2((buf, n), gsm_signal * buf, int n)
 {
-	int  i, c;
+	int	i, cc;
 
-	for (i = 0; i < 160 && (c = fgetc(in)) != EOF; i++) buf[i] = A2S( c );
-	if (c == EOF && ferror(in)) return -1;
-	return i;
+	cc = fread((char *)abuf, 1, n, in);
+	if (cc < n && ferror(in)) return -1;
+	for (i = 0; i < cc; i++) buf[i] = A2S( abuf[i] );
+	return cc;
 }
 
-int alaw_output P1((buf), gsm_signal * buf) 
+int alaw_output P2((buf, n), gsm_signal * buf, int n)
 {
-	int  i;
+	int	i;
 
-	for (i = 0; i < 160; i++, buf++)
-		if (fputc( S2A( *buf ), out) == EOF) return -1;
-	return 0;
+	for (i = 0; i < n; i++) abuf[i] = S2A( buf[i] );
+	return -( fwrite((char *)abuf, 1, n, out) != n );
 }
-
@@ -18,53 +18,35 @@ extern FILE	* in, 	  * out;
 extern char	* inname;
 extern char	* progname;
 
-extern int	(*output) P((gsm_signal *)),
-		(*input ) P((gsm_signal *));
+extern int	(*output) P((gsm_signal *, int)),
+		(*input ) P((gsm_signal *, int));
 
-extern int	alaw_input   P((gsm_signal *)),
-		ulaw_input   P((gsm_signal *)),
-		linear_input P((gsm_signal *));
-
-extern int	ulaw_output P((gsm_signal *));
-
-static int put_u32 P2((f, u), FILE * f, unsigned long u)
+static void put_u32 P2((p, u), unsigned char * p, unsigned long u)
 {
-	/*  Write a 32-bit unsigned value msb first. 
+	/*  Store a 32-bit unsigned value msb first. 
 	 */
-	if (  putc( (char)((u>>24) & 0x0FF), f) == EOF
-	   || putc( (char)((u>>16) & 0x0FF), f) == EOF
-	   || putc( (char)((u>> 8) & 0x0FF), f) == EOF
-	   || putc( (char)( u      & 0x0FF), f) == EOF) return -1;
-
-	return 0;
+	p[0] = (u>>24) & 0x0FF;
+	p[1] = (u>>16) & 0x0FF;
+	p[2] = (u>> 8) & 0x0FF;
+	p[3] =  u      & 0x0FF;
 }
 
-static int get_u32 P2((f, up), FILE * f, unsigned long * up)
+static unsigned long get_u32 P1((p), unsigned char * p)
 {
-	/*  Read a 32-bit unsigned value msb first.
+	/*  Fetch a 32-bit unsigned value msb first.
 	 */
-	int		i;
-	unsigned long 	u;
-
-	if (  				      (i = getc(f)) == EOF
-	   || ((u =        (unsigned char)i), (i = getc(f)) == EOF)
-	   || ((u = (u<<8)|(unsigned char)i), (i = getc(f)) == EOF)
-	   || ((u = (u<<8)|(unsigned char)i), (i = getc(f)) == EOF)) return -1;
-	*up = 	    (u<<8)|(unsigned char)i;
-	return 0;
+	return    ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16)
+		| ((unsigned long)p[2] <<  8) |  (unsigned long)p[3];
 }
 
 int audio_init_input P0()
 {
+	unsigned char	hdr[ 4*4 ];	/* magic, len, size, enc */
 	unsigned long	len, enc;	/* unsigned 32 bits	*/
 
-	if (  fgetc(in) != '.' 
-	   || fgetc(in) != 's'
-	   || fgetc(in) != 'n'
-	   || fgetc(in) != 'd'
-	   || get_u32( in, &len )
-	   || get_u32( in, &enc )	/* skip this */
-	   || get_u32( in, &enc )
+	if (  fread((char *)hdr, 1, sizeof(hdr), in) != sizeof(hdr)
+	   || memcmp((char *)hdr, ".snd", 4)
+	   || ((len = get_u32(hdr + 4)), (enc = get_u32(hdr + 12)), 0)
 	   || fseek(in, (long)(len - 4*4), 1) < 0) {
 		fprintf(stderr, 
 	"%s: bad (missing?) header in Sun audio file \"%s\";\n\
@@ -89,15 +71,17 @@ int audio_init_input P0()
 
 int audio_init_output P0()
 {
-	if (  fputs(".snd", out) == EOF
-	   || put_u32(out, 32)
-	   || put_u32(out, ~(unsigned long)0)
-	   || put_u32(out, 1)
-	   || put_u32(out, 8000)
-	   || put_u32(out, 1)
-	   || put_u32(out, 0)
-	   || put_u32(out, 0)) return -1;
-
-	return 0;
+	unsigned char	hdr[ 8*4 ];
+
+	memcpy((char *)hdr, ".snd", 4);
+	put_u32(hdr +  4, 32);
+	put_u32(hdr +  8, ~(unsigned long)0);
+	put_u32(hdr + 12, 1);
+	put_u32(hdr + 16, 8000);
+	put_u32(hdr + 20, 1);
+	put_u32(hdr + 24, 0);
+	put_u32(hdr + 28, 0);
+
+	return -( fwrite((char *)hdr, 1, sizeof(hdr), out) != sizeof(hdr) );
 }
 
@@ -13,12 +13,14 @@
 
 extern FILE	*in, *out;
 
-int linear_input (buf) gsm_signal * buf;
+int linear_input P2((buf, n), gsm_signal * buf, int n)
 {
-	return fread( (char *)buf, sizeof(*buf), 160, in );
+	int	cc = fread( (char *)buf, sizeof(*buf), n, in );
+
+	return cc < n && ferror(in) ? -1 : cc;
 }
 
-int linear_output P1((buf), gsm_signal * buf) 
+int linear_output P2((buf, n), gsm_signal * buf, int n) 
 {
-	return -( fwrite( (char *)buf, sizeof(*buf), 160, out ) != 160 );
+	return -( fwrite( (char *)buf, sizeof(*buf), n, out ) != n );
 }
@@ -601,21 +601,26 @@ static unsigned char s2u[] = {
 0175,0176
 };
 
-int ulaw_input P1((buf), gsm_signal * buf)
+/*
+ *  Whole blocks are moved with one fread()/fwrite() through a byte
+ *  buffer and converted with the tables above.
+ */
+static unsigned char	ubuf[ TOAST_FRAMES * 160 ];
+
+int ulaw_input P2((buf, n), gsm_signal * buf, int n)
 {
-	int i, c;
+	int	i, cc;
 
-	for (i = 0; i < 160 && (c = fgetc(in)) != EOF; i++) buf[i] = U2S(c);
-	if (c == EOF && ferror(in)) return -1;
-	return i;
+	cc = fread((char *)ubuf, 1, n, in);
+	if (cc < n && ferror(in)) return -1;
+	for (i = 0; i < cc; i++) buf[i] = U2S( ubuf[i] );
+	return cc;
 }
 
-int ulaw_output P1((buf), gsm_signal * buf)
+int ulaw_output P2((buf, n), gsm_signal * buf, int n)
 {
-	int i;
+	int	i;
 
-	for(i = 0; i < 160; i++, buf++)
-		if (fputc( (char)S2U( (unsigned short)*buf ), out) == EOF)
-			return -1;
-	return 0;
+	for (i = 0; i < n; i++) ubuf[i] = S2U( buf[i] );
+	return -( fwrite((char *)ubuf, 1, n, out) != n );
 }